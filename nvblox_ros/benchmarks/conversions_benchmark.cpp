@@ -0,0 +1,379 @@
+// SPDX-FileCopyrightText: NVIDIA CORPORATION & AFFILIATES
+// Copyright (c) 2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+// Microbenchmarks of the conversions between ROS messages and nvblox types.
+// The GPU benchmarks are only registered if there is a CUDA device, the CPU
+// ones (the host side steps of the conversions) run everywhere. For machine
+// readable results run with:
+//   nvblox_conversions_benchmark --benchmark_format=json \
+//       --benchmark_out=conversions.json
+
+#include <benchmark/benchmark.h>
+#include <cuda_runtime.h>
+#include <glog/logging.h>
+
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <cv_bridge/cv_bridge.h>
+#include <sensor_msgs/image_encodings.h>
+
+#include "nvblox_ros/conversions/image_conversions.hpp"
+#include "nvblox_ros/conversions/mesh_conversions.hpp"
+#include "nvblox_ros/conversions/pointcloud_conversions.hpp"
+
+#include "synthetic_scene.hpp"
+
+namespace nvblox {
+namespace benchmarks {
+namespace {
+
+// VGA, HD, full HD and 4K.
+const std::vector<std::vector<int64_t>> kImageSizes = {
+    {640, 480}, {1280, 720}, {1920, 1080}, {3840, 2160}};
+const std::vector<int64_t> kNumLidarBeams = {16, 32, 64, 128};
+const std::vector<int64_t> kNumMeshBlocks = {1000, 10000, 100000};
+
+constexpr int kLidarAzimuthDivisions = 1800;
+constexpr float kLidarVerticalFovRad = 30.0f * M_PI / 180.0f;
+constexpr float kBlockSize = 0.4f;
+// Each synthetic mesh block is a grid of this many quads per side.
+constexpr int kMeshQuadsPerSide = 4;
+
+const SyntheticScene& scene() {
+  static const SyntheticScene scene;
+  return scene;
+}
+
+sensor_msgs::ImagePtr renderDepthImage(int width, int height,
+                                       const std::string& encoding) {
+  const sensor_msgs::CameraInfo camera_info =
+      SyntheticScene::cameraInfo(width, height);
+  sensor_msgs::ImagePtr image = scene().renderDepthImage(
+      camera_info, scene().sensorPose(0, true), ros::Time(0.0));
+  if (encoding == sensor_msgs::image_encodings::TYPE_16UC1) {
+    cv_bridge::CvImagePtr cv_image = cv_bridge::toCvCopy(image);
+    cv_image->image.convertTo(cv_image->image, CV_16UC1, 1000.0);
+    cv_image->encoding = encoding;
+    image = cv_image->toImageMsg();
+  }
+  return image;
+}
+
+sensor_msgs::ImagePtr renderColorImage(int width, int height) {
+  return scene().renderColorImage(SyntheticScene::cameraInfo(width, height),
+                                  scene().sensorPose(0, true), ros::Time(0.0));
+}
+
+Lidar makeLidar(int num_beams) {
+  return Lidar(kLidarAzimuthDivisions, num_beams, kLidarVerticalFovRad);
+}
+
+sensor_msgs::PointCloud2ConstPtr renderLidarPointcloud(const Lidar& lidar) {
+  return scene().renderLidarPointcloud(lidar, scene().sensorPose(0, false),
+                                       ros::Time(0.0));
+}
+
+// The mesh of a block: a (slightly slanted) planar patch, unwelded, as the
+// mesh integrator outputs it.
+struct MeshBlockVectors {
+  Index3D block_index;
+  std::vector<Vector3f> vertices;
+  std::vector<Vector3f> normals;
+  std::vector<Color> colors;
+  std::vector<int> triangles;
+};
+
+std::vector<MeshBlockVectors> makeMeshBlocks(int num_blocks) {
+  const int side = static_cast<int>(std::ceil(std::sqrt(num_blocks)));
+  const float quad_size = kBlockSize / kMeshQuadsPerSide;
+  std::vector<MeshBlockVectors> blocks(num_blocks);
+  for (int i = 0; i < num_blocks; i++) {
+    MeshBlockVectors& block = blocks[i];
+    block.block_index = Index3D(i % side, i / side, 0);
+    const Vector3f origin = block.block_index.cast<float>() * kBlockSize;
+    const Vector3f normal = Vector3f(0.1f, 0.1f, 1.0f).normalized();
+    auto vertex = [&](int x, int y) {
+      return origin + Vector3f(x * quad_size, y * quad_size,
+                               0.5f * kBlockSize + 0.01f * (x + y));
+    };
+    for (int x = 0; x < kMeshQuadsPerSide; x++) {
+      for (int y = 0; y < kMeshQuadsPerSide; y++) {
+        for (const Vector3f& corner :
+             {vertex(x, y), vertex(x + 1, y), vertex(x + 1, y + 1),
+              vertex(x, y), vertex(x + 1, y + 1), vertex(x, y + 1)}) {
+          block.triangles.push_back(block.vertices.size());
+          block.vertices.push_back(corner);
+          block.normals.push_back(normal);
+          block.colors.push_back(scene().colorAt(corner));
+        }
+      }
+    }
+  }
+  return blocks;
+}
+
+template <typename T>
+void copyToBlock(const std::vector<T>& values, unified_vector<T>* vector) {
+  vector->resize(values.size());
+  CHECK_EQ(cudaMemcpy(vector->data(), values.data(), values.size() * sizeof(T),
+                      cudaMemcpyDefault),
+           cudaSuccess);
+}
+
+std::unique_ptr<MeshLayer> makeMeshLayer(
+    const std::vector<MeshBlockVectors>& blocks) {
+  auto mesh_layer =
+      std::make_unique<MeshLayer>(kBlockSize, MemoryType::kDevice);
+  for (const MeshBlockVectors& block : blocks) {
+    MeshBlock::Ptr mesh_block =
+        mesh_layer->allocateBlockAtIndex(block.block_index);
+    copyToBlock(block.vertices, &mesh_block->vertices);
+    copyToBlock(block.normals, &mesh_block->normals);
+    copyToBlock(block.colors, &mesh_block->colors);
+    copyToBlock(block.triangles, &mesh_block->triangles);
+  }
+  return mesh_layer;
+}
+
+void setImageCounters(const sensor_msgs::Image& image,
+                      benchmark::State* state) {
+  state->SetItemsProcessed(state->iterations() * image.width * image.height);
+  state->SetBytesProcessed(state->iterations() * image.data.size());
+}
+
+// GPU benchmarks.
+
+void depthImageFromImageMessage(benchmark::State& state,
+                                const std::string& encoding) {
+  const sensor_msgs::ImagePtr image =
+      renderDepthImage(state.range(0), state.range(1), encoding);
+  DepthImage depth_image;
+  for (auto _ : state) {
+    CHECK(conversions::depthImageFromImageMessage(image, &depth_image));
+  }
+  setImageCounters(*image, &state);
+}
+
+void colorImageFromImageMessage(benchmark::State& state) {
+  const sensor_msgs::ImagePtr image =
+      renderColorImage(state.range(0), state.range(1));
+  ColorImage color_image;
+  for (auto _ : state) {
+    CHECK(conversions::colorImageFromImageMessage(image, &color_image));
+  }
+  setImageCounters(*image, &state);
+}
+
+void depthImageFromPointcloud(benchmark::State& state) {
+  const Lidar lidar = makeLidar(state.range(0));
+  const sensor_msgs::PointCloud2ConstPtr cloud = renderLidarPointcloud(lidar);
+  conversions::PointcloudConverter converter;
+  DepthImage depth_image;
+  for (auto _ : state) {
+    converter.depthImageFromPointcloudGPU(cloud, lidar, &depth_image);
+  }
+  state.SetItemsProcessed(state.iterations() * lidar.numel());
+}
+
+void meshMessageFromMeshBlocks(benchmark::State& state) {
+  const std::unique_ptr<MeshLayer> mesh_layer =
+      makeMeshLayer(makeMeshBlocks(state.range(0)));
+  const std::vector<Index3D> block_indices = mesh_layer->getAllBlockIndices();
+  for (auto _ : state) {
+    nvblox_msgs::Mesh mesh_msg;
+    conversions::meshMessageFromMeshBlocks(*mesh_layer, block_indices,
+                                           &mesh_msg);
+    benchmark::DoNotOptimize(mesh_msg);
+  }
+  state.SetItemsProcessed(state.iterations() * block_indices.size());
+}
+
+void markerMessageFromMeshLayer(benchmark::State& state) {
+  const std::unique_ptr<MeshLayer> mesh_layer =
+      makeMeshLayer(makeMeshBlocks(state.range(0)));
+  for (auto _ : state) {
+    visualization_msgs::MarkerArray marker_msg;
+    conversions::markerMessageFromMeshLayer(*mesh_layer, "map", &marker_msg);
+    benchmark::DoNotOptimize(marker_msg);
+  }
+  state.SetItemsProcessed(state.iterations() *
+                          mesh_layer->numAllocatedBlocks());
+}
+
+// CPU benchmarks.
+
+void depthBufferFromMillimeterImageMessageCpu(benchmark::State& state) {
+  const sensor_msgs::ImagePtr image =
+      renderDepthImage(state.range(0), state.range(1),
+                       sensor_msgs::image_encodings::TYPE_16UC1);
+  std::vector<float> depth_buffer;
+  for (auto _ : state) {
+    conversions::depthBufferFromMillimeterImageMessage(*image, &depth_buffer);
+    benchmark::DoNotOptimize(depth_buffer.data());
+  }
+  setImageCounters(*image, &state);
+}
+
+// The host side of colorImageFromImageMessage.
+void rgbaFromColorImageMessageCpu(benchmark::State& state) {
+  const sensor_msgs::ImagePtr image =
+      renderColorImage(state.range(0), state.range(1));
+  for (auto _ : state) {
+    cv_bridge::CvImageConstPtr rgba_image = cv_bridge::toCvCopy(image, "rgba8");
+    benchmark::DoNotOptimize(rgba_image->image.data);
+  }
+  setImageCounters(*image, &state);
+}
+
+void pointsFromPointcloudMsgCpu(benchmark::State& state) {
+  const Lidar lidar = makeLidar(state.range(0));
+  const sensor_msgs::PointCloud2ConstPtr cloud = renderLidarPointcloud(lidar);
+  std::vector<Vector3f> points;
+  points.reserve(lidar.numel());
+  for (auto _ : state) {
+    conversions::pointsFromPointcloudMsg(*cloud, &points);
+    benchmark::DoNotOptimize(points.data());
+  }
+  state.SetItemsProcessed(state.iterations() * lidar.numel());
+  state.SetBytesProcessed(state.iterations() * cloud->data.size());
+}
+
+void meshBlockMessagesFromMeshBlockVectorsCpu(benchmark::State& state) {
+  const std::vector<MeshBlockVectors> blocks = makeMeshBlocks(state.range(0));
+  for (auto _ : state) {
+    nvblox_msgs::Mesh mesh_msg;
+    mesh_msg.blocks.resize(blocks.size());
+    for (size_t i = 0; i < blocks.size(); i++) {
+      conversions::meshBlockMessageFromMeshBlockVectors(
+          blocks[i].vertices, blocks[i].normals, blocks[i].colors,
+          blocks[i].triangles, &mesh_msg.blocks[i]);
+    }
+    benchmark::DoNotOptimize(mesh_msg);
+  }
+  state.SetItemsProcessed(state.iterations() * blocks.size());
+}
+
+void meshBlockFingerprintsCpu(benchmark::State& state) {
+  const std::vector<MeshBlockVectors> blocks = makeMeshBlocks(state.range(0));
+  conversions::MeshBlockFingerprintCache cache;
+  for (auto _ : state) {
+    for (const MeshBlockVectors& block : blocks) {
+      benchmark::DoNotOptimize(cache.updateFingerprint(
+          block.block_index, block.vertices, block.triangles, block.colors));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * blocks.size());
+}
+
+void pointsToCubesMarkerMsgCpu(benchmark::State& state) {
+  std::vector<Vector3f> points;
+  for (const MeshBlockVectors& block : makeMeshBlocks(state.range(0))) {
+    points.push_back(block.vertices.front());
+  }
+  conversions::PointcloudConverter converter;
+  for (auto _ : state) {
+    visualization_msgs::Marker marker;
+    converter.pointsToCubesMarkerMsg(points, 0.05f, Color::Red(), &marker);
+    benchmark::DoNotOptimize(marker);
+  }
+  state.SetItemsProcessed(state.iterations() * points.size());
+}
+
+bool hasCudaDevice() {
+  int num_devices = 0;
+  return cudaGetDeviceCount(&num_devices) == cudaSuccess && num_devices > 0;
+}
+
+void imageSizes(benchmark::internal::Benchmark* family) {
+  family->ArgNames({"width", "height"});
+  for (const std::vector<int64_t>& size : kImageSizes) {
+    family->Args(size);
+  }
+}
+
+void lidarBeams(benchmark::internal::Benchmark* family) {
+  family->ArgName("beams");
+  for (const int64_t num_beams : kNumLidarBeams) {
+    family->Arg(num_beams);
+  }
+}
+
+void meshBlocks(benchmark::internal::Benchmark* family) {
+  family->ArgName("blocks")->Unit(benchmark::kMillisecond);
+  for (const int64_t num_blocks : kNumMeshBlocks) {
+    family->Arg(num_blocks);
+  }
+}
+
+void registerBenchmarks(bool with_gpu) {
+  using benchmark::RegisterBenchmark;
+  if (with_gpu) {
+    RegisterBenchmark("DepthImageFromImageMessage/32FC1",
+                      depthImageFromImageMessage,
+                      sensor_msgs::image_encodings::TYPE_32FC1)
+        ->Apply(imageSizes);
+    RegisterBenchmark("DepthImageFromImageMessage/16UC1",
+                      depthImageFromImageMessage,
+                      sensor_msgs::image_encodings::TYPE_16UC1)
+        ->Apply(imageSizes);
+    RegisterBenchmark("ColorImageFromImageMessage", colorImageFromImageMessage)
+        ->Apply(imageSizes);
+    RegisterBenchmark("DepthImageFromPointcloudGPU", depthImageFromPointcloud)
+        ->Apply(lidarBeams);
+    RegisterBenchmark("MeshMessageFromMeshBlocks", meshMessageFromMeshBlocks)
+        ->Apply(meshBlocks);
+    RegisterBenchmark("MarkerMessageFromMeshLayer", markerMessageFromMeshLayer)
+        ->Apply(meshBlocks);
+  }
+  RegisterBenchmark("Cpu/DepthBufferFromMillimeterImageMessage",
+                    depthBufferFromMillimeterImageMessageCpu)
+      ->Apply(imageSizes);
+  RegisterBenchmark("Cpu/RgbaFromColorImageMessage",
+                    rgbaFromColorImageMessageCpu)
+      ->Apply(imageSizes);
+  RegisterBenchmark("Cpu/PointsFromPointcloudMsg", pointsFromPointcloudMsgCpu)
+      ->Apply(lidarBeams);
+  RegisterBenchmark("Cpu/MeshBlockMessagesFromMeshBlockVectors",
+                    meshBlockMessagesFromMeshBlockVectorsCpu)
+      ->Apply(meshBlocks);
+  RegisterBenchmark("Cpu/MeshBlockFingerprints", meshBlockFingerprintsCpu)
+      ->Apply(meshBlocks);
+  RegisterBenchmark("Cpu/PointsToCubesMarkerMsg", pointsToCubesMarkerMsgCpu)
+      ->Apply(meshBlocks);
+}
+
+}  // namespace
+}  // namespace benchmarks
+}  // namespace nvblox
+
+int main(int argc, char* argv[]) {
+  google::InitGoogleLogging(argv[0]);
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  const bool with_gpu = nvblox::benchmarks::hasCudaDevice();
+  if (!with_gpu) {
+    LOG(WARNING) << "No CUDA device found, only running the CPU benchmarks.";
+  }
+  nvblox::benchmarks::registerBenchmarks(with_gpu);
+  benchmark::RunSpecifiedBenchmarks();
+  return 0;
+}
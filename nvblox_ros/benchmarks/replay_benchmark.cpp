@@ -0,0 +1,251 @@
+// SPDX-FileCopyrightText: NVIDIA CORPORATION & AFFILIATES
+// Copyright (c) 2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+// Runs the processing pipeline of the node on deterministic synthetic data and
+// reports the latencies of its stages as JSON, such that runs can be compared
+// across commits. Doesn't need a ROS master. Usage:
+//   nvblox_replay_benchmark [--num_frames=240] [--lidar] [--output=out.json]
+// See printUsage() for all options.
+
+#include <glog/logging.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include <nvblox/core/internal/warmup_cuda.h>
+
+#include "nvblox_ros/mapper_initialization.hpp"
+#include "nvblox_ros/replay_pipeline.hpp"
+
+#include "synthetic_scene.hpp"
+
+namespace {
+
+struct BenchmarkOptions {
+  int num_frames = 240;
+  // Frames processed before the statistics are reset.
+  int num_warmup_frames = 10;
+  int image_width = 640;
+  int image_height = 480;
+  // Integrate a LiDAR instead of a depth camera.
+  bool lidar = false;
+  bool color = true;
+  // Update the ESDF and the mesh every n frames.
+  int esdf_every_n_frames = 5;
+  int mesh_every_n_frames = 5;
+  float voxel_size = 0.05f;
+  bool esdf_2d = false;
+  // Parameter file of the node, for the integrator settings.
+  std::string params;
+  std::string output;
+};
+
+void printUsage(const char* name) {
+  const BenchmarkOptions defaults;
+  std::cerr
+      << "Usage: " << name << " [options]\n"
+      << "  --num_frames=N           Frames to process (" << defaults.num_frames
+      << ").\n"
+      << "  --num_warmup_frames=N    Frames before measuring ("
+      << defaults.num_warmup_frames << ").\n"
+      << "  --image_width=N          Camera width (" << defaults.image_width
+      << ").\n"
+      << "  --image_height=N         Camera height (" << defaults.image_height
+      << ").\n"
+      << "  --lidar                  Use a LiDAR instead of a depth camera.\n"
+      << "  --no_color               Don't integrate color images.\n"
+      << "  --esdf_every_n_frames=N  ESDF update period ("
+      << defaults.esdf_every_n_frames << ").\n"
+      << "  --mesh_every_n_frames=N  Mesh update period ("
+      << defaults.mesh_every_n_frames << ").\n"
+      << "  --voxel_size=X           Voxel size in meters ("
+      << defaults.voxel_size << ").\n"
+      << "  --esdf_2d                Compute a 2D ESDF.\n"
+      << "  --params=FILE            Node parameter file (.yaml) to initialize\n"
+      << "                           the integrators from.\n"
+      << "  --output=FILE            Write the JSON there instead of stdout.\n";
+}
+
+bool parseOptions(int argc, char* argv[], BenchmarkOptions* options) {
+  for (int i = 1; i < argc; i++) {
+    const std::string arg = argv[i];
+    const size_t equals = arg.find('=');
+    const std::string name = arg.substr(0, equals);
+    const std::string value =
+        equals == std::string::npos ? "" : arg.substr(equals + 1);
+    if (name == "--num_frames") {
+      options->num_frames = std::atoi(value.c_str());
+    } else if (name == "--num_warmup_frames") {
+      options->num_warmup_frames = std::atoi(value.c_str());
+    } else if (name == "--image_width") {
+      options->image_width = std::atoi(value.c_str());
+    } else if (name == "--image_height") {
+      options->image_height = std::atoi(value.c_str());
+    } else if (name == "--lidar") {
+      options->lidar = true;
+    } else if (name == "--no_color") {
+      options->color = false;
+    } else if (name == "--esdf_every_n_frames") {
+      options->esdf_every_n_frames = std::atoi(value.c_str());
+    } else if (name == "--mesh_every_n_frames") {
+      options->mesh_every_n_frames = std::atoi(value.c_str());
+    } else if (name == "--voxel_size") {
+      options->voxel_size = std::atof(value.c_str());
+    } else if (name == "--esdf_2d") {
+      options->esdf_2d = true;
+    } else if (name == "--params") {
+      options->params = value;
+    } else if (name == "--output") {
+      options->output = value;
+    } else {
+      std::cerr << "Unknown option: " << arg << "\n";
+      return false;
+    }
+  }
+  return options->num_frames > 0 && options->num_warmup_frames >= 0 &&
+         options->image_width > 0 && options->image_height > 0 &&
+         options->esdf_every_n_frames > 0 &&
+         options->mesh_every_n_frames > 0 && options->voxel_size > 0.0f;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  google::InitGoogleLogging(argv[0]);
+  FLAGS_alsologtostderr = true;
+  google::InstallFailureSignalHandler();
+
+  BenchmarkOptions options;
+  if (!parseOptions(argc, argv, &options)) {
+    printUsage(argv[0]);
+    return 1;
+  }
+
+  nvblox::warmupCuda();
+
+  nvblox::ReplayPipelineOptions pipeline_options;
+  pipeline_options.voxel_size = options.voxel_size;
+  pipeline_options.esdf_2d = options.esdf_2d;
+  if (!options.params.empty() &&
+      !nvblox::loadParameterFile(options.params,
+                                 &pipeline_options.mapper_parameters)) {
+    return 1;
+  }
+  nvblox::ReplayPipeline pipeline(pipeline_options);
+
+  const nvblox::benchmarks::SyntheticScene scene;
+  const sensor_msgs::CameraInfo camera_info =
+      nvblox::benchmarks::SyntheticScene::cameraInfo(options.image_width,
+                                                     options.image_height);
+  const nvblox::Lidar lidar(
+      pipeline_options.lidar_width, pipeline_options.lidar_height,
+      pipeline_options.lidar_vertical_fov_deg * M_PI / 180.0);
+
+  // Only the pipeline is timed, not the rendering of the inputs.
+  constexpr double kFramePeriodS = 0.1;
+  std::chrono::duration<double> processing_time(0.0);
+  nvblox_msgs::DistanceMapSlice map_slice;
+  nvblox_msgs::Mesh mesh;
+  const int num_frames = options.num_warmup_frames + options.num_frames;
+  for (int frame = 0; frame < num_frames; frame++) {
+    if (frame == options.num_warmup_frames) {
+      pipeline.statistics().clear();
+      processing_time = std::chrono::duration<double>(0.0);
+    }
+    const ros::Time stamp(frame * kFramePeriodS);
+    const nvblox::Transform T_L_C = scene.sensorPose(frame, !options.lidar);
+
+    sensor_msgs::PointCloud2ConstPtr cloud;
+    sensor_msgs::ImageConstPtr depth_image;
+    sensor_msgs::ImageConstPtr color_image;
+    if (options.lidar) {
+      cloud = scene.renderLidarPointcloud(lidar, T_L_C, stamp);
+    } else {
+      depth_image = scene.renderDepthImage(camera_info, T_L_C, stamp);
+      if (options.color) {
+        color_image = scene.renderColorImage(camera_info, T_L_C, stamp);
+      }
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    bool success = true;
+    if (options.lidar) {
+      success &= pipeline.processLidarPointcloud(cloud, T_L_C);
+    } else {
+      success &= pipeline.processDepthImage(depth_image, camera_info, T_L_C);
+      if (options.color) {
+        success &= pipeline.processColorImage(color_image, camera_info, T_L_C);
+      }
+    }
+    if ((frame + 1) % options.esdf_every_n_frames == 0) {
+      pipeline.processEsdf(&map_slice);
+    }
+    if ((frame + 1) % options.mesh_every_n_frames == 0) {
+      mesh.block_indices.clear();
+      mesh.blocks.clear();
+      pipeline.processMesh(&mesh);
+    }
+    const std::chrono::duration<double> frame_time =
+        std::chrono::steady_clock::now() - start;
+    processing_time += frame_time;
+    pipeline.statistics().add("frame", frame_time.count());
+    if (!success) {
+      LOG(ERROR) << "Failed to process frame " << frame << ".";
+      return 1;
+    }
+  }
+
+  std::ofstream file;
+  if (!options.output.empty()) {
+    file.open(options.output);
+    if (!file) {
+      LOG(ERROR) << "Couldn't open " << options.output << ".";
+      return 1;
+    }
+  }
+  std::ostream& out = options.output.empty() ? std::cout : file;
+  const nvblox::Mapper& mapper = pipeline.mapper();
+  out << "{\n"
+      << "\"benchmark\": \"nvblox_replay_benchmark\",\n"
+      << "\"options\": {"
+      << "\"num_frames\": " << options.num_frames
+      << ", \"num_warmup_frames\": " << options.num_warmup_frames
+      << ", \"image_width\": " << options.image_width
+      << ", \"image_height\": " << options.image_height
+      << ", \"lidar\": " << (options.lidar ? "true" : "false")
+      << ", \"color\": " << (options.color ? "true" : "false")
+      << ", \"esdf_every_n_frames\": " << options.esdf_every_n_frames
+      << ", \"mesh_every_n_frames\": " << options.mesh_every_n_frames
+      << ", \"voxel_size\": " << options.voxel_size
+      << ", \"esdf_2d\": " << (options.esdf_2d ? "true" : "false")
+      << ", \"params\": \"" << options.params << "\"},\n"
+      << "\"processing_time_s\": " << processing_time.count() << ",\n"
+      << "\"frames_per_s\": " << options.num_frames / processing_time.count()
+      << ",\n"
+      << "\"num_blocks\": {"
+      << "\"tsdf\": " << mapper.tsdf_layer().numAllocatedBlocks()
+      << ", \"color\": " << mapper.color_layer().numAllocatedBlocks()
+      << ", \"esdf\": " << mapper.esdf_layer().numAllocatedBlocks()
+      << ", \"mesh\": " << mapper.mesh_layer().numAllocatedBlocks() << "},\n"
+      << "\"stages\": ";
+  pipeline.statistics().writeJson(out);
+  out << "\n}\n";
+  return 0;
+}
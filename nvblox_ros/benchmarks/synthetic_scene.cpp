@@ -0,0 +1,215 @@
+// SPDX-FileCopyrightText: NVIDIA CORPORATION & AFFILIATES
+// Copyright (c) 2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include <sensor_msgs/image_encodings.h>
+#include <sensor_msgs/point_cloud2_iterator.h>
+
+#include "synthetic_scene.hpp"
+
+namespace nvblox {
+namespace benchmarks {
+
+namespace {
+
+// The sensors go around the room once in this many frames.
+constexpr int kFramesPerRevolution = 240;
+constexpr float kTrajectoryRadius = 2.0f;
+constexpr float kSensorHeight = 1.2f;
+// Size of the checkerboard pattern on the surfaces.
+constexpr float kCheckerSize = 0.5f;
+
+}  // namespace
+
+SyntheticScene::SyntheticScene()
+    : room_min_(-5.0f, -5.0f, 0.0f), room_max_(5.0f, 5.0f, 3.0f) {
+  spheres_.push_back({Vector3f(1.5f, 1.0f, 1.0f), 0.7f});
+  spheres_.push_back({Vector3f(-2.0f, 0.5f, 0.5f), 0.5f});
+  spheres_.push_back({Vector3f(0.0f, -2.5f, 1.8f), 1.0f});
+}
+
+float SyntheticScene::castRay(const Vector3f& origin,
+                              const Vector3f& direction) const {
+  // We're inside of the room, so the ray leaves it through the closest of the
+  // walls it's heading to.
+  float distance = std::numeric_limits<float>::max();
+  for (int i = 0; i < 3; i++) {
+    if (direction[i] > 0.0f) {
+      distance = std::min(distance, (room_max_[i] - origin[i]) / direction[i]);
+    } else if (direction[i] < 0.0f) {
+      distance = std::min(distance, (room_min_[i] - origin[i]) / direction[i]);
+    }
+  }
+  for (const Sphere& sphere : spheres_) {
+    const Vector3f offset = origin - sphere.center;
+    const float a = direction.squaredNorm();
+    const float b = 2.0f * direction.dot(offset);
+    const float c = offset.squaredNorm() - sphere.radius * sphere.radius;
+    const float discriminant = b * b - 4.0f * a * c;
+    if (discriminant < 0.0f) {
+      continue;
+    }
+    const float hit = (-b - std::sqrt(discriminant)) / (2.0f * a);
+    if (hit > 0.0f) {
+      distance = std::min(distance, hit);
+    }
+  }
+  return distance < std::numeric_limits<float>::max() ? distance : -1.0f;
+}
+
+Color SyntheticScene::colorAt(const Vector3f& point) const {
+  const int checker = static_cast<int>(std::floor(point.x() / kCheckerSize) +
+                                       std::floor(point.y() / kCheckerSize) +
+                                       std::floor(point.z() / kCheckerSize));
+  const uint8_t shade = (checker % 2 == 0) ? 220 : 120;
+  // Tint by height, such that the surfaces can be told apart.
+  const float height = (point.z() - room_min_.z()) /
+                       (room_max_.z() - room_min_.z());
+  return Color(shade, static_cast<uint8_t>(shade * (1.0f - 0.5f * height)),
+               static_cast<uint8_t>(shade * (0.5f + 0.5f * height)));
+}
+
+Transform SyntheticScene::sensorPose(int frame, bool is_optical) const {
+  const float angle = 2.0f * M_PI * frame / kFramesPerRevolution;
+  const Vector3f center = 0.5f * (room_min_ + room_max_);
+  // Looking towards the center of the room.
+  const Eigen::Matrix3f R_L_B =
+      Eigen::AngleAxisf(angle + M_PI, Vector3f::UnitZ()).toRotationMatrix();
+  Transform T_L_C = Transform::Identity();
+  T_L_C.translation() =
+      Vector3f(center.x() + kTrajectoryRadius * std::cos(angle),
+               center.y() + kTrajectoryRadius * std::sin(angle),
+               kSensorHeight);
+  if (is_optical) {
+    // The optical frame has z forward, x right and y down.
+    Eigen::Matrix3f R_B_C;
+    R_B_C << 0.0f, 0.0f, 1.0f,  //
+        -1.0f, 0.0f, 0.0f,      //
+        0.0f, -1.0f, 0.0f;
+    T_L_C.linear() = R_L_B * R_B_C;
+  } else {
+    T_L_C.linear() = R_L_B;
+  }
+  return T_L_C;
+}
+
+sensor_msgs::CameraInfo SyntheticScene::cameraInfo(int width, int height) {
+  const double focal_length = 0.5 * width;
+  sensor_msgs::CameraInfo camera_info;
+  camera_info.width = width;
+  camera_info.height = height;
+  camera_info.distortion_model = "plumb_bob";
+  camera_info.D.assign(5, 0.0);
+  camera_info.K = {focal_length, 0.0, 0.5 * width,  //
+                   0.0, focal_length, 0.5 * height, 0.0, 0.0, 1.0};
+  camera_info.R = {1.0, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 1.0};
+  camera_info.P = {focal_length, 0.0, 0.5 * width,  0.0, 0.0, focal_length,
+                   0.5 * height, 0.0, 0.0,          0.0, 1.0, 0.0};
+  return camera_info;
+}
+
+sensor_msgs::ImagePtr SyntheticScene::renderDepthImage(
+    const sensor_msgs::CameraInfo& camera_info, const Transform& T_L_C,
+    const ros::Time& stamp) const {
+  sensor_msgs::ImagePtr image(new sensor_msgs::Image());
+  image->header.stamp = stamp;
+  image->header.frame_id = "camera";
+  image->width = camera_info.width;
+  image->height = camera_info.height;
+  image->encoding = sensor_msgs::image_encodings::TYPE_32FC1;
+  image->step = image->width * sizeof(float);
+  image->data.resize(image->height * image->step);
+  float* depths = reinterpret_cast<float*>(image->data.data());
+  for (uint32_t v = 0; v < image->height; v++) {
+    for (uint32_t u = 0; u < image->width; u++) {
+      // The ray has a z of one, so the distance along it is the depth.
+      const Vector3f ray_C((u + 0.5f - camera_info.K[2]) / camera_info.K[0],
+                           (v + 0.5f - camera_info.K[5]) / camera_info.K[4],
+                           1.0f);
+      const float depth = castRay(T_L_C.translation(), T_L_C.linear() * ray_C);
+      depths[v * image->width + u] = std::max(depth, 0.0f);
+    }
+  }
+  return image;
+}
+
+sensor_msgs::ImagePtr SyntheticScene::renderColorImage(
+    const sensor_msgs::CameraInfo& camera_info, const Transform& T_L_C,
+    const ros::Time& stamp) const {
+  sensor_msgs::ImagePtr image(new sensor_msgs::Image());
+  image->header.stamp = stamp;
+  image->header.frame_id = "camera";
+  image->width = camera_info.width;
+  image->height = camera_info.height;
+  image->encoding = sensor_msgs::image_encodings::RGB8;
+  image->step = image->width * 3;
+  image->data.resize(image->height * image->step);
+  for (uint32_t v = 0; v < image->height; v++) {
+    for (uint32_t u = 0; u < image->width; u++) {
+      const Vector3f ray_L =
+          T_L_C.linear() *
+          Vector3f((u + 0.5f - camera_info.K[2]) / camera_info.K[0],
+                   (v + 0.5f - camera_info.K[5]) / camera_info.K[4], 1.0f);
+      const float distance = castRay(T_L_C.translation(), ray_L);
+      const Color color = distance > 0.0f
+                              ? colorAt(T_L_C.translation() + distance * ray_L)
+                              : Color::Black();
+      uint8_t* pixel = &image->data[v * image->step + 3 * u];
+      pixel[0] = color.r;
+      pixel[1] = color.g;
+      pixel[2] = color.b;
+    }
+  }
+  return image;
+}
+
+sensor_msgs::PointCloud2Ptr SyntheticScene::renderLidarPointcloud(
+    const Lidar& lidar, const Transform& T_L_C, const ros::Time& stamp) const {
+  sensor_msgs::PointCloud2Ptr cloud(new sensor_msgs::PointCloud2());
+  cloud->header.stamp = stamp;
+  cloud->header.frame_id = "lidar";
+  sensor_msgs::PointCloud2Modifier modifier(*cloud);
+  modifier.setPointCloud2FieldsByString(1, "xyz");
+  modifier.resize(lidar.num_azimuth_divisions() *
+                  lidar.num_elevation_divisions());
+  sensor_msgs::PointCloud2Iterator<float> iter_x(*cloud, "x");
+  sensor_msgs::PointCloud2Iterator<float> iter_y(*cloud, "y");
+  sensor_msgs::PointCloud2Iterator<float> iter_z(*cloud, "z");
+  // One point per pixel of the LiDAR model, such that the cloud matches it.
+  for (int v = 0; v < lidar.num_elevation_divisions(); v++) {
+    for (int u = 0; u < lidar.num_azimuth_divisions(); u++) {
+      const Vector3f ray_C = lidar.vectorFromPixelIndices(Index2D(u, v));
+      const float distance =
+          castRay(T_L_C.translation(), T_L_C.linear() * ray_C);
+      const Vector3f point_C = std::max(distance, 0.0f) * ray_C;
+      *iter_x = point_C.x();
+      *iter_y = point_C.y();
+      *iter_z = point_C.z();
+      ++iter_x;
+      ++iter_y;
+      ++iter_z;
+    }
+  }
+  return cloud;
+}
+
+}  // namespace benchmarks
+}  // namespace nvblox
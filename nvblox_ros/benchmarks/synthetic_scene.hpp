@@ -0,0 +1,87 @@
+// SPDX-FileCopyrightText: NVIDIA CORPORATION & AFFILIATES
+// Copyright (c) 2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef NVBLOX_ROS__BENCHMARKS__SYNTHETIC_SCENE_HPP_
+#define NVBLOX_ROS__BENCHMARKS__SYNTHETIC_SCENE_HPP_
+
+#include <vector>
+
+#include <sensor_msgs/CameraInfo.h>
+#include <sensor_msgs/Image.h>
+#include <sensor_msgs/PointCloud2.h>
+
+#include <nvblox/nvblox.h>
+
+namespace nvblox {
+namespace benchmarks {
+
+/// A deterministic scene to generate sensor data from: the inside of a box
+/// shaped room with a few spheres in it. The sensors move on a circle around
+/// the center of the room.
+class SyntheticScene {
+ public:
+  SyntheticScene();
+
+  /// Casts a ray into the scene.
+  /// @param origin Origin of the ray.
+  /// @param direction Direction of the ray, doesn't need to be normalized.
+  /// @return The first hit, as origin + distance * direction, or a negative
+  /// value if there is none.
+  float castRay(const Vector3f& origin, const Vector3f& direction) const;
+
+  /// Color of the surface at a point.
+  Color colorAt(const Vector3f& point) const;
+
+  /// Pose of a sensor in the scene, T_L_C.
+  /// @param frame The frame number.
+  /// @param is_optical Whether the sensor uses the optical frame convention
+  /// (z forward, y down) like cameras, or x forward and z up like LiDARs.
+  Transform sensorPose(int frame, bool is_optical) const;
+
+  /// A pinhole camera with a 90 degree horizontal field of view.
+  static sensor_msgs::CameraInfo cameraInfo(int width, int height);
+
+  /// Renders a 32FC1 depth image (in meters).
+  sensor_msgs::ImagePtr renderDepthImage(
+      const sensor_msgs::CameraInfo& camera_info, const Transform& T_L_C,
+      const ros::Time& stamp) const;
+
+  /// Renders an rgb8 color image.
+  sensor_msgs::ImagePtr renderColorImage(
+      const sensor_msgs::CameraInfo& camera_info, const Transform& T_L_C,
+      const ros::Time& stamp) const;
+
+  /// Renders an (organized) xyz pointcloud of a LiDAR, in the LiDAR frame.
+  sensor_msgs::PointCloud2Ptr renderLidarPointcloud(
+      const Lidar& lidar, const Transform& T_L_C,
+      const ros::Time& stamp) const;
+
+ private:
+  struct Sphere {
+    Vector3f center;
+    float radius;
+  };
+
+  Vector3f room_min_;
+  Vector3f room_max_;
+  std::vector<Sphere> spheres_;
+};
+
+}  // namespace benchmarks
+}  // namespace nvblox
+
+#endif  // NVBLOX_ROS__BENCHMARKS__SYNTHETIC_SCENE_HPP_
@@ -0,0 +1,127 @@
+// SPDX-FileCopyrightText: NVIDIA CORPORATION & AFFILIATES
+// Copyright (c) 2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef NVBLOX_ROS__BAG_PROCESSOR_HPP_
+#define NVBLOX_ROS__BAG_PROCESSOR_HPP_
+
+#include <map>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <rosbag/bag.h>
+#include <ros/time.h>
+#include <sensor_msgs/CameraInfo.h>
+#include <tf2/buffer_core.h>
+
+#include "nvblox_ros/replay_pipeline.hpp"
+
+namespace nvblox {
+
+/// Settings of the BagProcessor. Topics left empty aren't processed. The
+/// mapper is set up from pipeline.mapper_parameters, like the node's.
+struct BagProcessorOptions {
+  std::string global_frame = "map";
+  std::string depth_image_topic;
+  std::string depth_camera_info_topic;
+  std::string color_image_topic;
+  std::string color_camera_info_topic;
+  std::string pointcloud_topic;
+  std::string tf_topic = "/tf";
+  std::string tf_static_topic = "/tf_static";
+  /// Rates of the ESDF and mesh updates, in bag (sensor) time such that the
+  /// result doesn't depend on the processing speed.
+  float esdf_update_rate_hz = 2.0f;
+  float mesh_update_rate_hz = 5.0f;
+  ReplayPipelineOptions pipeline;
+};
+
+/// Builds a map from recorded bags, without a ROS master and without real
+/// time playback. The transforms of the bags are first loaded into a tf2
+/// buffer, then every sensor message is processed in the order of the bags,
+/// as fast as the hardware allows. Nothing is dropped because the processing
+/// lags, such that the result is deterministic. Not thread safe.
+class BagProcessor {
+ public:
+  /// Number of messages per outcome.
+  struct Counts {
+    size_t depth_images = 0;
+    size_t color_images = 0;
+    size_t pointclouds = 0;
+    size_t esdf_updates = 0;
+    size_t mesh_updates = 0;
+    /// No transform to the global frame at the message stamp.
+    size_t skipped_no_transform = 0;
+    /// No camera info received (yet) for an image.
+    size_t skipped_no_camera_info = 0;
+    /// The message couldn't be converted.
+    size_t failed = 0;
+  };
+
+  explicit BagProcessor(
+      const BagProcessorOptions& options = BagProcessorOptions());
+  ~BagProcessor() = default;
+
+  /// Processes the bags, in the order of their message (receive) stamps.
+  /// The ESDF and mesh are updated a last time at the end.
+  /// @return False if a bag couldn't be read.
+  bool process(const std::vector<std::string>& bag_paths);
+
+  /// Writes the options, counts, processing time and the latencies of the
+  /// pipeline stages as JSON. The latencies are in milliseconds.
+  void writeReport(std::ostream& out) const;
+
+  ReplayPipeline& pipeline() { return pipeline_; }
+  const ReplayPipeline& pipeline() const { return pipeline_; }
+  const Counts& counts() const { return counts_; }
+  /// Span of the processed messages, in bag time.
+  double bag_duration_s() const { return bag_duration_s_; }
+  /// Wall time spent processing (excluding the loading of the transforms).
+  double processing_time_s() const { return processing_time_s_; }
+
+ private:
+  /// Adds the transforms of the bags to the tf buffer.
+  /// @return The number of transforms.
+  size_t loadTransforms(const std::vector<const rosbag::Bag*>& bags);
+
+  bool lookupTransform(const std::string& frame_id, const ros::Time& stamp,
+                       Transform* T_L_S);
+
+  /// Runs the ESDF and mesh updates which are due at this bag time.
+  void updateOutputs(const ros::Time& stamp);
+
+  bool computesMesh() const;
+
+  const BagProcessorOptions options_;
+  ReplayPipeline pipeline_;
+  std::unique_ptr<tf2::BufferCore> tf_buffer_;
+
+  // Latest camera info of each camera info topic.
+  std::map<std::string, sensor_msgs::CameraInfo::ConstPtr> camera_infos_;
+
+  ros::Time next_esdf_update_;
+  ros::Time next_mesh_update_;
+
+  Counts counts_;
+  double bag_duration_s_ = 0.0;
+  double processing_time_s_ = 0.0;
+};
+
+}  // namespace nvblox
+
+#endif  // NVBLOX_ROS__BAG_PROCESSOR_HPP_
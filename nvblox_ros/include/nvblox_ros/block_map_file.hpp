@@ -0,0 +1,266 @@
+// SPDX-FileCopyrightText: NVIDIA CORPORATION & AFFILIATES
+// Copyright (c) 2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef NVBLOX_ROS__BLOCK_MAP_FILE_HPP_
+#define NVBLOX_ROS__BLOCK_MAP_FILE_HPP_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <nvblox/nvblox.h>
+
+namespace nvblox {
+
+/// Layers which can be stored in a block map file. Meshes and ESDFs are not
+/// stored, they're recomputed from the loaded blocks.
+enum class BlockMapLayerType : uint32_t {
+  kTsdf = 0,
+  kColor = 1,
+  kOccupancy = 2,
+};
+
+/// Compression applied to each block.
+enum class BlockMapCompression : uint32_t {
+  kNone = 0,
+  kLz4 = 1,
+};
+
+/// How blocks are represented before compression.
+enum class BlockMapEncoding : uint32_t {
+  /// The raw voxel block.
+  kRaw = 0,
+  /// TSDF voxels with the distance and weight quantized to 16 bit each (see
+  /// QuantizedTsdfVoxel). Lossy.
+  kQuantizedTsdf = 1,
+};
+
+/// Block map files (.nvbm) store the voxel blocks of a map together with a
+/// block index, such that the map can be memory-mapped and loaded partially.
+/// Layout (all little endian, 8 byte aligned):
+///  - BlockMapFileHeader
+///  - BlockMapLayerHeader for each stored layer
+///  - The voxel blocks, each encoded and compressed on its own (raw in
+///    version 1 files)
+///  - For each layer, its index: BlockMapIndexEntry[num_blocks], sorted by
+///    block index (x, then y, then z).
+/// Because the index is sorted on disk, opening a file only maps it and reads
+/// the headers, independent of the size of the map.
+struct BlockMapFileHeader {
+  char magic[4];
+  uint32_t version;
+  float voxel_size;
+  uint32_t num_layers;
+};
+
+struct BlockMapLayerHeader {
+  uint32_t layer_type;
+  /// Size of a (decoded) block of this layer.
+  uint32_t block_num_bytes;
+  /// A BlockMapCompression.
+  uint32_t compression;
+  /// A BlockMapEncoding.
+  uint32_t encoding;
+  uint64_t num_blocks;
+  /// Offset of the first index entry from the start of the file.
+  uint64_t index_offset;
+};
+
+/// Layer header of version 1 files, which store the blocks raw and
+/// uncompressed. Still read, such that existing maps stay loadable.
+struct BlockMapLayerHeaderV1 {
+  uint32_t layer_type;
+  uint32_t block_num_bytes;
+  uint64_t num_blocks;
+  uint64_t index_offset;
+};
+
+struct BlockMapIndexEntry {
+  int32_t x;
+  int32_t y;
+  int32_t z;
+  /// Number of bytes stored for the block.
+  uint32_t num_bytes;
+  /// Offset of the block from the start of the file.
+  uint64_t offset;
+};
+
+static_assert(sizeof(BlockMapFileHeader) == 16, "Unexpected padding");
+static_assert(sizeof(BlockMapLayerHeader) == 32, "Unexpected padding");
+static_assert(sizeof(BlockMapLayerHeaderV1) == 24, "Unexpected padding");
+static_assert(sizeof(BlockMapIndexEntry) == 24, "Unexpected padding");
+
+class BlockMapFile;
+
+/// A TSDF voxel in the kQuantizedTsdf encoding. The distance is stored in
+/// units of 1/kDistanceStepsPerVoxel voxels, the weight in units of
+/// 1/kWeightStepsPerUnit. Values outside the range are clamped.
+struct QuantizedTsdfVoxel {
+  static constexpr float kDistanceStepsPerVoxel = 1024.0f;
+  static constexpr float kWeightStepsPerUnit = 256.0f;
+  int16_t distance;
+  uint16_t weight;
+};
+
+struct BlockMapFileOptions {
+  BlockMapCompression compression = BlockMapCompression::kLz4;
+  /// Store TSDF blocks in the (lossy) kQuantizedTsdf encoding.
+  bool quantize_tsdf = false;
+  /// Threads used to encode/decode blocks. 0 uses one per core.
+  int num_threads = 0;
+};
+
+struct BlockMapFileStatistics {
+  size_t num_blocks = 0;
+  /// Size of the blocks in memory.
+  size_t raw_num_bytes = 0;
+  /// Size of the blocks in the file.
+  size_t stored_num_bytes = 0;
+};
+
+/// Writes the (non-empty) TSDF, color and occupancy layers of the mapper to a
+/// block map file.
+/// @param filename Path of the file to (over)write.
+/// @param mapper The mapper to write.
+/// @param options How to store the blocks.
+/// @param previous_file If not null, an open file the mapper's map was
+/// (partially) loaded from. Its blocks which were never loaded are copied over
+/// from disk, such that they don't have to be loaded into the mapper first.
+/// They're copied as they are if they're stored as the options ask for, and
+/// transcoded otherwise.
+/// @param statistics Optional output of the written sizes.
+/// @return Whether the file was written.
+bool writeBlockMapFile(const std::string& filename, const Mapper& mapper,
+                       const BlockMapFileOptions& options,
+                       const BlockMapFile* previous_file = nullptr,
+                       BlockMapFileStatistics* statistics = nullptr);
+
+/// Read access to a block map file. The file is memory-mapped, so blocks are
+/// only read from disk once they're loaded into a layer. Keeps track of the
+/// blocks loaded so far, such that regions can be loaded repeatedly (e.g.
+/// around a moving robot) without overwriting blocks the mapper has updated
+/// since.
+class BlockMapFile {
+ public:
+  BlockMapFile() = default;
+  ~BlockMapFile();
+
+  BlockMapFile(const BlockMapFile&) = delete;
+  BlockMapFile& operator=(const BlockMapFile&) = delete;
+
+  /// Maps the file and checks its headers. Closes a previously opened file.
+  /// @return Whether the file is a valid block map file.
+  bool open(const std::string& filename);
+  void close();
+  bool isOpen() const { return data_ != nullptr; }
+
+  const std::string& filename() const { return filename_; }
+  float voxel_size() const { return voxel_size_; }
+
+  /// Number of blocks stored for the given layer (0 if not stored).
+  size_t numBlocks(BlockMapLayerType layer_type) const;
+
+  /// Threads used to decode blocks. 0 uses one per core.
+  int num_threads() const { return num_threads_; }
+  void num_threads(int num_threads);
+
+  /// Loads the stored blocks overlapping the AABB into the mapper's layers.
+  /// Blocks which were loaded before, or which are already allocated in the
+  /// mapper, are skipped.
+  /// @return The indices of the blocks loaded in any of the layers.
+  std::vector<Index3D> loadBlocksInAABB(const AxisAlignedBoundingBox& aabb,
+                                        Mapper* mapper);
+
+  /// Same as above, for all blocks of the file.
+  std::vector<Index3D> loadAllBlocks(Mapper* mapper);
+
+  /// Same as above, for the blocks overlapping a sphere.
+  std::vector<Index3D> loadBlocksInRadius(const Vector3f& center,
+                                          float radius_m, Mapper* mapper);
+
+  /// The index entries of the layer's blocks which were never loaded, sorted
+  /// by block index.
+  std::vector<const BlockMapIndexEntry*> unloadedEntries(
+      BlockMapLayerType layer_type) const;
+
+  /// The stored bytes of an entry, or nullptr if the entry points outside the
+  /// file.
+  const uint8_t* entryData(const BlockMapIndexEntry& entry) const;
+
+  /// How the blocks of a layer are stored.
+  /// @return false if the layer isn't stored.
+  bool layerFormat(BlockMapLayerType layer_type, uint32_t* block_num_bytes,
+                   BlockMapCompression* compression,
+                   BlockMapEncoding* encoding) const;
+
+  /// Decodes the blocks of a layer's entries (in parallel) into consecutive
+  /// slots of decoded_blocks, each the size of a block of the layer. Blocks
+  /// which can't be decoded are flagged in is_valid.
+  void decodeEntries(BlockMapLayerType layer_type,
+                     const std::vector<const BlockMapIndexEntry*>& entries,
+                     std::vector<uint8_t>* decoded_blocks,
+                     std::vector<uint8_t>* is_valid) const;
+
+ private:
+  struct LayerIndex {
+    BlockMapLayerType type;
+    uint32_t block_num_bytes;
+    BlockMapCompression compression;
+    BlockMapEncoding encoding;
+    const BlockMapIndexEntry* entries;
+    size_t num_entries;
+    Index3DSet loaded;
+  };
+
+  // Returns the index entries of the layer's blocks overlapping the AABB.
+  std::vector<const BlockMapIndexEntry*> entriesInAABB(
+      const LayerIndex& layer_index, const AxisAlignedBoundingBox& aabb) const;
+
+  // Loads the blocks of the entries into the mapper and appends their
+  // indices to loaded_blocks.
+  void loadEntries(const std::vector<const BlockMapIndexEntry*>& entries,
+                   LayerIndex* layer_index, Mapper* mapper,
+                   std::vector<Index3D>* loaded_blocks);
+
+  // Decodes the blocks of the entries (in parallel) into consecutive
+  // block_num_bytes sized slots of decoded_blocks. Blocks which can't be
+  // decoded are flagged in is_valid.
+  void decodeEntries(const LayerIndex& layer_index,
+                     const std::vector<const BlockMapIndexEntry*>& entries,
+                     std::vector<uint8_t>* decoded_blocks,
+                     std::vector<uint8_t>* is_valid) const;
+
+  template <typename VoxelType>
+  void loadEntriesIntoLayer(
+      const std::vector<const BlockMapIndexEntry*>& entries,
+      LayerIndex* layer_index, VoxelBlockLayer<VoxelType>* layer_ptr,
+      std::vector<Index3D>* loaded_blocks);
+
+  std::string filename_;
+  const uint8_t* data_ = nullptr;
+  size_t size_ = 0;
+  float voxel_size_ = 0.0f;
+  float block_size_ = 0.0f;
+  int num_threads_ = 0;
+  std::vector<LayerIndex> layer_indices_;
+};
+
+}  // namespace nvblox
+
+#include "nvblox_ros/impl/block_map_file_impl.hpp"
+
+#endif  // NVBLOX_ROS__BLOCK_MAP_FILE_HPP_
@@ -0,0 +1,104 @@
+// SPDX-FileCopyrightText: NVIDIA CORPORATION & AFFILIATES
+// Copyright (c) 2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef NVBLOX_ROS__BLOCK_PAGER_HPP_
+#define NVBLOX_ROS__BLOCK_PAGER_HPP_
+
+#include <string>
+#include <vector>
+
+#include <nvblox/nvblox.h>
+
+#include "nvblox_ros/map_journal.hpp"
+
+namespace nvblox {
+
+/// Keeps the map in memory bounded without losing it: blocks far from the
+/// robot are moved to a block store on disk and evicted from the mapper, and
+/// they're read back asynchronously once the robot comes close again.
+/// The store is a map journal, so reads and writes happen on its background
+/// thread. It only lives as long as the pager: it's emptied on opening and
+/// deleted on closing.
+/// Not thread safe, all methods have to be called under the map lock.
+class BlockPager {
+ public:
+  BlockPager() = default;
+  ~BlockPager();
+
+  BlockPager(const BlockPager&) = delete;
+  BlockPager& operator=(const BlockPager&) = delete;
+
+  /// Creates an empty block store.
+  /// @param filename Path of the store. An existing file is replaced.
+  /// @param mapper The mapper whose blocks are paged.
+  /// @return Whether the store could be created.
+  bool open(const std::string& filename, Mapper* mapper);
+  void close();
+  bool isOpen() const { return store_.isOpen(); }
+
+  /// Drops all paged out blocks, e.g. because the map was replaced.
+  void clear(Mapper* mapper);
+
+  /// The blocks allocated in any layer which are further than the radius from
+  /// the center.
+  std::vector<Index3D> blocksOutsideRadius(const Vector3f& center,
+                                           float radius_m,
+                                           const Mapper& mapper) const;
+
+  /// Moves the blocks (of all layers) to the store and deletes them from the
+  /// mapper.
+  void pageOut(const std::vector<Index3D>& block_indices, Mapper* mapper);
+
+  /// Requests the paged out blocks within the radius of the center to be read
+  /// back. They're added to the mapper by insertPagedInBlocks().
+  void requestPageIn(const Vector3f& center, float radius_m);
+
+  /// Adds the blocks read back since the last call to the mapper. Blocks that
+  /// were allocated again in the meantime keep their current content.
+  /// @return The indices of the paged in blocks.
+  std::vector<Index3D> insertPagedInBlocks(Mapper* mapper);
+
+  /// Reads back the given paged out blocks and adds them to the mapper
+  /// (blocking). Blocks which aren't paged out are skipped.
+  /// @return The indices of the paged in blocks.
+  std::vector<Index3D> pageIn(const std::vector<Index3D>& block_indices,
+                              Mapper* mapper);
+
+  /// Reads back all paged out blocks and adds them to the mapper (blocking).
+  /// @return The indices of the paged in blocks.
+  std::vector<Index3D> pageInAll(Mapper* mapper);
+
+  /// The blocks currently on disk only.
+  const Index3DSet& pagedOutBlocks() const { return paged_out_blocks_; }
+  size_t numPagedOutBlocks() const { return paged_out_blocks_.size(); }
+
+  MapJournal::Statistics storeStatistics() const {
+    return store_.statistics();
+  }
+
+ private:
+  std::string filename_;
+  float block_size_ = 0.0f;
+  MapJournal store_;
+  // Blocks on disk only, and the subset of them which are being read back.
+  Index3DSet paged_out_blocks_;
+  Index3DSet requested_blocks_;
+};
+
+}  // namespace nvblox
+
+#endif  // NVBLOX_ROS__BLOCK_PAGER_HPP_
@@ -67,6 +67,9 @@ class EsdfSliceConverter {
   AxisAlignedBoundingBox getBoundingBoxOfLayerAtHeight(
       const EsdfLayer& layer, const float z_slice_level);
 
+  // Memory reserved by the buffers.
+  std::vector<BufferCapacity> bufferCapacities() const;
+
  private:
   // Output methods to access GPU layer *slice* in a more efficient way.
   // The output is a float image whose size *should* match the AABB with
@@ -24,6 +24,7 @@
 #include <opencv2/opencv.hpp>
 
 #include <string>
+#include <vector>
 
 #include <sensor_msgs/CameraInfo.h>
 #include <sensor_msgs/Image.h>
@@ -34,6 +35,11 @@ namespace conversions {
 // Convert camera info message to NVBlox camera object
 Camera cameraFromMessage(const sensor_msgs::CameraInfo& camera_info);
 
+// Convert a 16UC1 depth image (in millimeters) to depths in meters, on the
+// CPU.
+void depthBufferFromMillimeterImageMessage(const sensor_msgs::Image& image_msg,
+                                           std::vector<float>* depth_buffer);
+
 // Convert image to depth frame object
 bool depthImageFromImageMessage(const sensor_msgs::ImageConstPtr& image_msg,
                                 DepthImage* depth_frame);
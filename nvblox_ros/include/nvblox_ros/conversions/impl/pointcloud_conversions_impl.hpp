@@ -0,0 +1,40 @@
+// SPDX-FileCopyrightText: NVIDIA CORPORATION & AFFILIATES
+// Copyright (c) 2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef NVBLOX_ROS__CONVERSIONS__IMPL__POINTCLOUD_CONVERSIONS_IMPL_HPP_
+#define NVBLOX_ROS__CONVERSIONS__IMPL__POINTCLOUD_CONVERSIONS_IMPL_HPP_
+
+#include <sensor_msgs/point_cloud2_iterator.h>
+
+namespace nvblox {
+namespace conversions {
+
+template <typename VectorType>
+void pointsFromPointcloudMsg(const sensor_msgs::PointCloud2& pointcloud_msg,
+                             VectorType* points) {
+  CHECK_NOTNULL(points);
+  points->clear();
+  sensor_msgs::PointCloud2ConstIterator<float> iter_xyz(pointcloud_msg, "x");
+  for (; iter_xyz != iter_xyz.end(); ++iter_xyz) {
+    points->push_back(Vector3f(iter_xyz[0], iter_xyz[1], iter_xyz[2]));
+  }
+}
+
+}  // namespace conversions
+}  // namespace nvblox
+
+#endif  // NVBLOX_ROS__CONVERSIONS__IMPL__POINTCLOUD_CONVERSIONS_IMPL_HPP_
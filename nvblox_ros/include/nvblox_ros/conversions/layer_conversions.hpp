@@ -18,6 +18,8 @@
 #ifndef NVBLOX_ROS__CONVERSIONS__LAYER_CONVERSIONS_HPP_
 #define NVBLOX_ROS__CONVERSIONS__LAYER_CONVERSIONS_HPP_
 
+#include <vector>
+
 #include <nvblox/nvblox.h>
 
 #include "nvblox_ros/conversions/pointcloud_conversions.hpp"
@@ -41,6 +43,9 @@ class LayerConverter {
                                     const AxisAlignedBoundingBox& aabb,
                                     sensor_msgs::PointCloud2* pointcloud_msg);
 
+  // Memory reserved by the buffers.
+  std::vector<BufferCapacity> bufferCapacities() const;
+
  private:
   cudaStream_t cuda_stream_ = nullptr;
 
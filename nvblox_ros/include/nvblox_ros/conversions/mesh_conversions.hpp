@@ -30,14 +30,55 @@
 namespace nvblox {
 namespace conversions {
 
+// Keeps a content fingerprint (hash of quantized vertices, triangles and
+// colors) of every mesh block that was last sent out. Blocks that get
+// re-meshed without their geometry actually changing (e.g. a static wall that
+// is observed again) can then be dropped from incremental mesh messages.
+class MeshBlockFingerprintCache {
+ public:
+  MeshBlockFingerprintCache() = default;
+
+  // Vertex positions are quantized to this resolution (in meters) before
+  // hashing, such that numerical noise in re-meshing doesn't count as change.
+  void vertex_quantization_m(float vertex_quantization_m);
+  float vertex_quantization_m() const { return vertex_quantization_m_; }
+
+  // Fingerprints the block and stores the result. Returns true if the
+  // fingerprint differs from the stored one (or if there was none).
+  bool updateFingerprint(const Index3D& block_index,
+                         const std::vector<Vector3f>& vertices,
+                         const std::vector<int>& triangles,
+                         const std::vector<Color>& colors);
+
+  // Forget blocks, for example because they were deleted from the layer.
+  void erase(const Index3D& block_index);
+  void clear();
+
+  size_t size() const { return fingerprints_.size(); }
+
+ private:
+  float vertex_quantization_m_ = 0.005f;
+  Index3DHashMapType<uint64_t>::type fingerprints_;
+};
+
+// Convert the (CPU) data of a single mesh block to a message.
+void meshBlockMessageFromMeshBlockVectors(
+    const std::vector<Vector3f>& vertices, const std::vector<Vector3f>& normals,
+    const std::vector<Color>& colors, const std::vector<int>& triangles,
+    nvblox_msgs::MeshBlock* mesh_block_msg);
+
 // Convert a mesh to a message.
 void meshMessageFromMeshLayer(const BlockLayer<MeshBlock>& mesh_layer,
                               nvblox_msgs::Mesh* mesh_msg);
 
+// Convert the requested mesh blocks to a message. If a fingerprint cache is
+// passed, blocks whose content did not change since they were last converted
+// are left out of the message.
 void meshMessageFromMeshBlocks(
     const BlockLayer<MeshBlock>& mesh_layer,
     const std::vector<Index3D>& block_indices, nvblox_msgs::Mesh* mesh_msg,
-    const std::vector<Index3D>& deleted_indices = std::vector<Index3D>());
+    const std::vector<Index3D>& deleted_indices = std::vector<Index3D>(),
+    MeshBlockFingerprintCache* fingerprint_cache = nullptr);
 
 // Convert a mesh to a marker array.
 void markerMessageFromMeshLayer(const BlockLayer<MeshBlock>& mesh_layer,
@@ -40,6 +40,20 @@ struct alignas(16) PclPointXYZI {
   float intensity;
 };
 
+// Memory reserved by a buffer, for telemetry.
+struct BufferCapacity {
+  std::string name;
+  size_t capacity_bytes;
+};
+
+// Gathers the xyz coordinates of the points of a pointcloud message (on the
+// CPU), which may have other fields in between.
+// @tparam VectorType A vector of Vector3f, for example std::vector or
+// host_vector.
+template <typename VectorType>
+void pointsFromPointcloudMsg(const sensor_msgs::PointCloud2& pointcloud_msg,
+                             VectorType* points);
+
 void copyDevicePointcloudToMsg(
     const device_vector<PclPointXYZI>& pcl_pointcloud_device,
     sensor_msgs::PointCloud2* pointcloud_msg);
@@ -80,6 +94,9 @@ class PointcloudConverter {
                               const float cube_size, const Color& color,
                               visualization_msgs::Marker* marker_ptr);
 
+  // Memory reserved by the buffers.
+  std::vector<BufferCapacity> bufferCapacities() const;
+
  private:
   std::unordered_set<Lidar, Lidar::Hash> checked_lidar_models_;
 
@@ -94,4 +111,6 @@ class PointcloudConverter {
 }  // namespace conversions
 }  // namespace nvblox
 
+#include "nvblox_ros/conversions/impl/pointcloud_conversions_impl.hpp"
+
 #endif  // NVBLOX_ROS__CONVERSIONS__POINTCLOUD_CONVERSIONS_HPP_
@@ -0,0 +1,103 @@
+// SPDX-FileCopyrightText: NVIDIA CORPORATION & AFFILIATES
+// Copyright (c) 2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef NVBLOX_ROS__HUMAN_TRACKING_HPP_
+#define NVBLOX_ROS__HUMAN_TRACKING_HPP_
+
+#include <cstdint>
+#include <vector>
+
+#include <nvblox/core/types.h>
+
+namespace nvblox {
+
+/// A connected set of voxels.
+struct VoxelCluster {
+  Vector3f centroid;
+  Vector3f min_corner;
+  Vector3f max_corner;
+  int num_voxels = 0;
+};
+
+/// Groups voxel centers into connected components. Two voxels are connected
+/// if they are within max_gap_voxels voxels of each other along every axis
+/// (i.e. 26-connectivity for a gap of 1). Implemented with a hash of voxel
+/// indices and union-find, so it's linear in the number of voxels.
+/// @param voxel_centers The centers of the voxels (e.g. human voxels).
+/// @param voxel_size The size of the voxels.
+/// @param max_gap_voxels The neighbourhood in which voxels are connected.
+/// @param min_cluster_size Smaller clusters are discarded.
+/// @return The clusters.
+std::vector<VoxelCluster> clusterVoxelCenters(
+    const std::vector<Vector3f>& voxel_centers, float voxel_size,
+    int max_gap_voxels, int min_cluster_size);
+
+/// An instance being tracked over time.
+struct TrackedInstance {
+  uint32_t id = 0;
+  Vector3f centroid = Vector3f::Zero();
+  Vector3f extent = Vector3f::Zero();
+  Vector3f velocity = Vector3f::Zero();
+  int num_voxels = 0;
+  double first_seen_s = 0.0;
+  double last_seen_s = 0.0;
+};
+
+/// A lightweight tracker that associates clusters with tracked instances by
+/// nearest (constant velocity predicted) centroid.
+class InstanceTracker {
+ public:
+  InstanceTracker() = default;
+
+  /// Associates the clusters observed at time_s with the tracked instances,
+  /// starts new instances for unassociated clusters and drops instances which
+  /// haven't been observed for timeout_s.
+  void update(const std::vector<VoxelCluster>& clusters, double time_s);
+
+  /// The instances currently tracked.
+  const std::vector<TrackedInstance>& instances() const { return instances_; }
+
+  /// Clusters further than this from an instance are not associated with it.
+  float max_association_distance_m() const {
+    return max_association_distance_m_;
+  }
+  void max_association_distance_m(float max_association_distance_m) {
+    max_association_distance_m_ = max_association_distance_m;
+  }
+
+  /// Instances not observed for this long are dropped.
+  double timeout_s() const { return timeout_s_; }
+  void timeout_s(double timeout_s) { timeout_s_ = timeout_s; }
+
+  /// Weight of the newest velocity measurement in [0, 1].
+  float velocity_smoothing() const { return velocity_smoothing_; }
+  void velocity_smoothing(float velocity_smoothing) {
+    velocity_smoothing_ = velocity_smoothing;
+  }
+
+ private:
+  float max_association_distance_m_ = 0.75f;
+  double timeout_s_ = 1.0;
+  float velocity_smoothing_ = 0.5f;
+
+  std::vector<TrackedInstance> instances_;
+  uint32_t next_id_ = 0;
+};
+
+}  // namespace nvblox
+
+#endif  // NVBLOX_ROS__HUMAN_TRACKING_HPP_
@@ -0,0 +1,78 @@
+// SPDX-FileCopyrightText: NVIDIA CORPORATION & AFFILIATES
+// Copyright (c) 2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef NVBLOX_ROS__IMPL__BLOCK_MAP_FILE_IMPL_HPP_
+#define NVBLOX_ROS__IMPL__BLOCK_MAP_FILE_IMPL_HPP_
+
+#include <vector>
+
+#include <ros/console.h>
+
+namespace nvblox {
+
+template <typename VoxelType>
+void BlockMapFile::loadEntriesIntoLayer(
+    const std::vector<const BlockMapIndexEntry*>& entries,
+    LayerIndex* layer_index, VoxelBlockLayer<VoxelType>* layer_ptr,
+    std::vector<Index3D>* loaded_blocks) {
+  CHECK_NOTNULL(layer_index);
+  CHECK_NOTNULL(layer_ptr);
+  CHECK_NOTNULL(loaded_blocks);
+  using BlockType = VoxelBlock<VoxelType>;
+  if (layer_index->block_num_bytes != sizeof(BlockType)) {
+    ROS_ERROR_STREAM("Block size in " << filename_ << " ("
+                                      << layer_index->block_num_bytes
+                                      << " bytes) doesn't match the layer ("
+                                      << sizeof(BlockType) << " bytes).");
+    return;
+  }
+
+  // Mark the blocks as loaded even if we skip them, such that blocks the
+  // mapper (re)created are never overwritten by later loads.
+  std::vector<const BlockMapIndexEntry*> entries_to_load;
+  for (const BlockMapIndexEntry* entry : entries) {
+    const Index3D block_index(entry->x, entry->y, entry->z);
+    if (layer_index->loaded.insert(block_index).second &&
+        !layer_ptr->isBlockAllocated(block_index)) {
+      entries_to_load.push_back(entry);
+    }
+  }
+
+  std::vector<uint8_t> decoded_blocks;
+  std::vector<uint8_t> is_valid;
+  decodeEntries(*layer_index, entries_to_load, &decoded_blocks, &is_valid);
+
+  for (size_t i = 0; i < entries_to_load.size(); i++) {
+    const BlockMapIndexEntry* entry = entries_to_load[i];
+    const Index3D block_index(entry->x, entry->y, entry->z);
+    if (!is_valid[i]) {
+      ROS_WARN_STREAM("Skipping corrupt block " << block_index.transpose()
+                                                << " in " << filename_);
+      continue;
+    }
+    typename BlockType::Ptr block_ptr =
+        layer_ptr->allocateBlockAtIndex(block_index);
+    checkCudaErrors(cudaMemcpy(block_ptr.get(),
+                               decoded_blocks.data() + i * sizeof(BlockType),
+                               sizeof(BlockType), cudaMemcpyDefault));
+    loaded_blocks->push_back(block_index);
+  }
+}
+
+}  // namespace nvblox
+
+#endif  // NVBLOX_ROS__IMPL__BLOCK_MAP_FILE_IMPL_HPP_
@@ -0,0 +1,109 @@
+// SPDX-FileCopyrightText: NVIDIA CORPORATION & AFFILIATES
+// Copyright (c) 2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef NVBLOX_ROS__IMPL__MAP_JOURNAL_IMPL_HPP_
+#define NVBLOX_ROS__IMPL__MAP_JOURNAL_IMPL_HPP_
+
+#include <utility>
+#include <vector>
+
+#include <ros/console.h>
+
+namespace nvblox {
+
+template <typename VoxelType>
+void MapJournal::restoreLayer(RecordIndex* record_index_ptr,
+                              VoxelBlockLayer<VoxelType>* layer_ptr,
+                              std::vector<Index3D>* restored_blocks) {
+  CHECK_NOTNULL(record_index_ptr);
+  CHECK_NOTNULL(layer_ptr);
+  CHECK_NOTNULL(restored_blocks);
+  Record record;
+  for (auto it = record_index_ptr->begin(); it != record_index_ptr->end();) {
+    const Index3D& block_index = it->first;
+    if (!readRecord(it->second, &record) ||
+        record.data.size() != sizeof(VoxelBlock<VoxelType>)) {
+      ROS_WARN_STREAM("Dropping corrupt record of block "
+                      << block_index.transpose() << " in " << filename_);
+      it = record_index_ptr->erase(it);
+      continue;
+    }
+    if (insertRecord(record, layer_ptr)) {
+      restored_blocks->push_back(block_index);
+    }
+    ++it;
+  }
+}
+
+template <typename VoxelType>
+bool MapJournal::insertRecord(const Record& record,
+                              VoxelBlockLayer<VoxelType>* layer_ptr) {
+  CHECK_NOTNULL(layer_ptr);
+  using BlockType = VoxelBlock<VoxelType>;
+  const Index3D block_index(record.header.x, record.header.y,
+                            record.header.z);
+  if (record.data.size() != sizeof(BlockType) ||
+      layer_ptr->isBlockAllocated(block_index)) {
+    return false;
+  }
+  typename BlockType::Ptr block_ptr =
+      layer_ptr->allocateBlockAtIndex(block_index);
+  checkCudaErrors(cudaMemcpy(block_ptr.get(), record.data.data(),
+                             sizeof(BlockType), cudaMemcpyDefault));
+  return true;
+}
+
+template <typename VoxelType>
+size_t MapJournal::appendRecord(const VoxelBlockLayer<VoxelType>& layer,
+                                BlockMapLayerType layer_type,
+                                const Index3D& block_index,
+                                std::vector<Record>* records) {
+  CHECK_NOTNULL(records);
+  using BlockType = VoxelBlock<VoxelType>;
+  Index3DSet& journaled_blocks =
+      journaled_blocks_[static_cast<size_t>(layer_type)];
+
+  Record record;
+  const typename BlockType::ConstPtr block_ptr =
+      layer.getBlockAtIndex(block_index);
+  if (block_ptr) {
+    record.data.resize(sizeof(BlockType));
+    checkCudaErrors(cudaMemcpy(record.data.data(), block_ptr.get(),
+                               sizeof(BlockType), cudaMemcpyDefault));
+    journaled_blocks.insert(block_index);
+  } else if (journaled_blocks.erase(block_index) == 0) {
+    // The block isn't in the layer, and never was as far as the journal
+    // knows, so there's nothing to delete.
+    return 0;
+  }
+  record.header.magic = kMapJournalRecordMagic;
+  record.header.layer_type = static_cast<uint32_t>(layer_type);
+  record.header.x = block_index.x();
+  record.header.y = block_index.y();
+  record.header.z = block_index.z();
+  record.header.num_bytes = record.data.size();
+  record.header.checksum =
+      mapJournalChecksum(record.data.data(), record.data.size());
+  record.header.reserved = 0;
+  const size_t num_bytes = sizeof(record.header) + record.data.size();
+  records->push_back(std::move(record));
+  return num_bytes;
+}
+
+}  // namespace nvblox
+
+#endif  // NVBLOX_ROS__IMPL__MAP_JOURNAL_IMPL_HPP_
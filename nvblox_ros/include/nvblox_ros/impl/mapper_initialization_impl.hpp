@@ -0,0 +1,47 @@
+// SPDX-FileCopyrightText: NVIDIA CORPORATION & AFFILIATES
+// Copyright (c) 2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef NVBLOX_ROS__IMPL__MAPPER_INITIALIZATION_IMPL_HPP_
+#define NVBLOX_ROS__IMPL__MAPPER_INITIALIZATION_IMPL_HPP_
+
+#include <string>
+
+namespace nvblox {
+
+template <typename T>
+bool getParam(const YAML::Node& parameters, const std::string& name,
+              T* value) {
+  CHECK_NOTNULL(value);
+  if (!parameters.IsMap()) {
+    return false;
+  }
+  const YAML::Node parameter = parameters[name];
+  if (!parameter || !parameter.IsScalar()) {
+    return false;
+  }
+  try {
+    *value = parameter.as<T>();
+  } catch (const YAML::BadConversion& e) {
+    ROS_WARN_STREAM("Ignoring the parameter " << name << ": " << e.what());
+    return false;
+  }
+  return true;
+}
+
+}  // namespace nvblox
+
+#endif  // NVBLOX_ROS__IMPL__MAPPER_INITIALIZATION_IMPL_HPP_
@@ -0,0 +1,41 @@
+// SPDX-FileCopyrightText: NVIDIA CORPORATION & AFFILIATES
+// Copyright (c) 2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef NVBLOX_ROS__IMPL__MEMORY_BUDGET_IMPL_HPP_
+#define NVBLOX_ROS__IMPL__MEMORY_BUDGET_IMPL_HPP_
+
+#include <string>
+
+namespace nvblox {
+
+template <typename LayerType>
+LayerMemoryUsage getLayerMemoryUsage(const std::string& name,
+                                     const LayerType& layer,
+                                     size_t budget_bytes) {
+  LayerMemoryUsage usage;
+  usage.name = name;
+  usage.bytes_per_block = sizeof(typename LayerType::BlockType);
+  usage.budget_bytes = budget_bytes;
+  for (const Index3D& block_index : layer.getAllBlockIndices()) {
+    usage.block_indices.insert(block_index);
+  }
+  return usage;
+}
+
+}  // namespace nvblox
+
+#endif  // NVBLOX_ROS__IMPL__MEMORY_BUDGET_IMPL_HPP_
@@ -22,7 +22,7 @@
 #include <string>
 #include <vector>
 
-#include <nvblox/utils/timing.h>
+#include "nvblox_ros/stage_timer.hpp"
 
 namespace nvblox {
 
@@ -31,7 +31,7 @@ void NvbloxNode::processMessageQueue(
     std::deque<QueuedType>* queue_ptr, std::mutex* queue_mutex_ptr,
     MessageReadyCallback<QueuedType> message_ready_check,
     ProcessMessageCallback<QueuedType> callback) {
-  timing::Timer ros_total_timer("ros/total");
+  StageTimer ros_total_timer("ros/total", &stage_statistics_);
 
   // Copy over all the pointers we actually want to process here.
   std::vector<QueuedType> items_to_process;
@@ -89,10 +89,6 @@ void NvbloxNode::processMessageQueue(
   for (auto image_pair : items_to_process) {
     callback(image_pair);
   }
-
-  // nvblox statistics
-  ROS_INFO_STREAM_THROTTLE(10, "Timing statistics: \n"
-                                   << nvblox::timing::Timing::Print());
 }
 
 template <typename MessageType>
@@ -100,7 +96,7 @@ void NvbloxNode::pushMessageOntoQueue(MessageType message,
                                       std::deque<MessageType>* queue_ptr,
                                       std::mutex* queue_mutex_ptr) {
   // Push it into the queue.
-  timing::Timer ros_total_timer("ros/total");
+  StageTimer ros_total_timer("ros/total", &stage_statistics_);
   {
     const std::lock_guard<std::mutex> lock(*queue_mutex_ptr);
     queue_ptr->emplace_back(message);
@@ -112,7 +108,7 @@ inline void NvbloxNode::limitQueueSizeByDeletingOldestMessages(
     const size_t max_num_messages, const std::string& queue_name,
     std::deque<MessageType>* queue_ptr, std::mutex* queue_mutex_ptr) {
   // Delete extra elements in the queue.
-  timing::Timer ros_total_timer("ros/total");
+  StageTimer ros_total_timer("ros/total", &stage_statistics_);
   const std::lock_guard<std::mutex> lock(*queue_mutex_ptr);
   if (queue_ptr->size() > max_num_messages) {
     const int num_elements_to_delete = queue_ptr->size() - max_num_messages;
@@ -0,0 +1,59 @@
+// SPDX-FileCopyrightText: NVIDIA CORPORATION & AFFILIATES
+// Copyright (c) 2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef NVBLOX_ROS__IMPL__REGION_CLEARING_IMPL_HPP_
+#define NVBLOX_ROS__IMPL__REGION_CLEARING_IMPL_HPP_
+
+#include <memory>
+
+namespace nvblox {
+
+template <typename VoxelType>
+void resetVoxels(const RegionBlocks& region_blocks,
+                 VoxelBlockLayer<VoxelType>* layer_ptr) {
+  CHECK_NOTNULL(layer_ptr);
+  using BlockType = VoxelBlock<VoxelType>;
+  constexpr int kVoxelsPerSide = BlockType::kVoxelsPerSide;
+  CHECK_EQ(region_blocks.partial_blocks.size(),
+           region_blocks.partial_masks.size());
+  auto host_block = std::make_unique<BlockType>();
+  for (size_t i = 0; i < region_blocks.partial_blocks.size(); i++) {
+    const typename BlockType::Ptr block_ptr =
+        layer_ptr->getBlockAtIndex(region_blocks.partial_blocks[i]);
+    if (!block_ptr) {
+      continue;
+    }
+    checkCudaErrors(cudaMemcpy(host_block.get(), block_ptr.get(),
+                               sizeof(BlockType), cudaMemcpyDefault));
+    const VoxelMask& mask = region_blocks.partial_masks[i];
+    for (int x = 0; x < kVoxelsPerSide; x++) {
+      for (int y = 0; y < kVoxelsPerSide; y++) {
+        for (int z = 0; z < kVoxelsPerSide; z++) {
+          if (mask[(x * kVoxelsPerSide + y) * kVoxelsPerSide + z]) {
+            host_block->voxels[x][y][z] = VoxelType();
+          }
+        }
+      }
+    }
+    checkCudaErrors(cudaMemcpy(block_ptr.get(), host_block.get(),
+                               sizeof(BlockType), cudaMemcpyDefault));
+  }
+}
+
+}  // namespace nvblox
+
+#endif  // NVBLOX_ROS__IMPL__REGION_CLEARING_IMPL_HPP_
@@ -0,0 +1,134 @@
+// SPDX-FileCopyrightText: NVIDIA CORPORATION & AFFILIATES
+// Copyright (c) 2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef NVBLOX_ROS__IMPL__STAMP_JOIN_BUFFER_IMPL_HPP_
+#define NVBLOX_ROS__IMPL__STAMP_JOIN_BUFFER_IMPL_HPP_
+
+#include <algorithm>
+#include <utility>
+
+namespace nvblox {
+
+template <typename FirstType, typename SecondType>
+StampJoinBuffer<FirstType, SecondType>::StampJoinBuffer(
+    const ros::Duration& tolerance, size_t max_pending, JoinCallback callback)
+    : tolerance_(tolerance),
+      max_pending_(std::max<size_t>(max_pending, 1)),
+      callback_(std::move(callback)) {}
+
+template <typename FirstType, typename SecondType>
+void StampJoinBuffer<FirstType, SecondType>::addFirst(const ros::Time& stamp,
+                                                      const FirstType& item) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  SecondType match;
+  if (!joinOrInsert(stamp, item, &first_pending_, &second_pending_,
+                    &statistics_.num_first_missed,
+                    &statistics_.num_second_missed, &match)) {
+    return;
+  }
+  lock.unlock();
+  callback_(item, match);
+}
+
+template <typename FirstType, typename SecondType>
+void StampJoinBuffer<FirstType, SecondType>::addSecond(const ros::Time& stamp,
+                                                       const SecondType& item) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  FirstType match;
+  if (!joinOrInsert(stamp, item, &second_pending_, &first_pending_,
+                    &statistics_.num_second_missed,
+                    &statistics_.num_first_missed, &match)) {
+    return;
+  }
+  lock.unlock();
+  callback_(match, item);
+}
+
+template <typename FirstType, typename SecondType>
+template <typename ItemType, typename OtherType>
+bool StampJoinBuffer<FirstType, SecondType>::joinOrInsert(
+    const ros::Time& stamp, const ItemType& item,
+    std::deque<PendingItem<ItemType>>* pending,
+    std::deque<PendingItem<OtherType>>* other_pending, size_t* num_missed,
+    size_t* num_other_missed, OtherType* match) {
+  const ros::WallTime now = ros::WallTime::now();
+
+  // Pending items of the other stream that are older than this item (minus
+  // the tolerance) can't be joined anymore, because the stamps in this stream
+  // are increasing.
+  while (!other_pending->empty() &&
+         other_pending->front().stamp + tolerance_ < stamp) {
+    other_pending->pop_front();
+    ++(*num_other_missed);
+  }
+
+  // Find the closest pending item of the other stream.
+  auto best_it = other_pending->end();
+  ros::Duration best_difference = tolerance_;
+  for (auto it = other_pending->begin(); it != other_pending->end(); ++it) {
+    const ros::Duration difference =
+        (it->stamp > stamp) ? (it->stamp - stamp) : (stamp - it->stamp);
+    if (difference <= best_difference) {
+      best_difference = difference;
+      best_it = it;
+    }
+  }
+
+  if (best_it != other_pending->end()) {
+    const double latency_s = (now - best_it->arrival_time).toSec();
+    ++statistics_.num_joined;
+    total_join_latency_s_ += latency_s;
+    statistics_.mean_join_latency_s =
+        total_join_latency_s_ / statistics_.num_joined;
+    statistics_.max_join_latency_s =
+        std::max(statistics_.max_join_latency_s, latency_s);
+    *match = std::move(best_it->item);
+    other_pending->erase(best_it);
+    return true;
+  }
+
+  // No partner (yet). Store this item, making room if needed.
+  pending->push_back(PendingItem<ItemType>{stamp, now, item});
+  while (pending->size() > max_pending_) {
+    pending->pop_front();
+    ++(*num_missed);
+  }
+  return false;
+}
+
+template <typename FirstType, typename SecondType>
+typename StampJoinBuffer<FirstType, SecondType>::Statistics
+StampJoinBuffer<FirstType, SecondType>::statistics() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return statistics_;
+}
+
+template <typename FirstType, typename SecondType>
+size_t StampJoinBuffer<FirstType, SecondType>::numPendingFirst() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return first_pending_.size();
+}
+
+template <typename FirstType, typename SecondType>
+size_t StampJoinBuffer<FirstType, SecondType>::numPendingSecond() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return second_pending_.size();
+}
+
+}  // namespace nvblox
+
+#endif  // NVBLOX_ROS__IMPL__STAMP_JOIN_BUFFER_IMPL_HPP_
@@ -0,0 +1,93 @@
+// SPDX-FileCopyrightText: NVIDIA CORPORATION & AFFILIATES
+// Copyright (c) 2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef NVBLOX_ROS__LATENCY_STATISTICS_HPP_
+#define NVBLOX_ROS__LATENCY_STATISTICS_HPP_
+
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace nvblox {
+
+/// Collects the latencies of named processing stages and summarizes them by
+/// their percentiles. The percentiles are computed over a window of the most
+/// recent samples of each stage, such that the memory stays bounded in long
+/// runs. Thread safe.
+class LatencyStatistics {
+ public:
+  struct Summary {
+    /// Over all samples.
+    size_t count = 0;
+    double total_s = 0.0;
+    double mean_s = 0.0;
+    double min_s = 0.0;
+    double max_s = 0.0;
+    /// Over the window of recent samples.
+    double p50_s = 0.0;
+    double p95_s = 0.0;
+    double p99_s = 0.0;
+  };
+
+  /// @param window_size Number of recent samples per stage the percentiles
+  /// are computed over.
+  explicit LatencyStatistics(size_t window_size = 10000);
+  ~LatencyStatistics() = default;
+
+  /// Adds a sample of a stage.
+  void add(const std::string& stage, double latency_s);
+
+  /// The summary of a stage, all zero for unknown stages.
+  Summary summary(const std::string& stage) const;
+
+  /// All stages with samples, in alphabetical order.
+  std::vector<std::string> stages() const;
+
+  void clear();
+
+  /// Writes the summaries of all stages as a JSON object keyed by the stage
+  /// names. The latencies are in milliseconds.
+  void writeJson(std::ostream& out) const;
+
+  /// Nearest rank percentile of the samples.
+  /// @param samples The samples, get sorted.
+  /// @param fraction The percentile, in [0, 1].
+  static double percentile(std::vector<double>* samples, double fraction);
+
+ private:
+  struct Stage {
+    size_t count = 0;
+    double total_s = 0.0;
+    double min_s = 0.0;
+    double max_s = 0.0;
+    // Ring buffer of the recent samples.
+    std::vector<double> window;
+    size_t window_next = 0;
+  };
+
+  Summary summarize(const Stage& stage) const;
+
+  const size_t window_size_;
+  std::map<std::string, Stage> stages_;
+  mutable std::mutex mutex_;
+};
+
+}  // namespace nvblox
+
+#endif  // NVBLOX_ROS__LATENCY_STATISTICS_HPP_
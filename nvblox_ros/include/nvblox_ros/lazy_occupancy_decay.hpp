@@ -0,0 +1,105 @@
+// SPDX-FileCopyrightText: NVIDIA CORPORATION & AFFILIATES
+// Copyright (c) 2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef NVBLOX_ROS__LAZY_OCCUPANCY_DECAY_HPP_
+#define NVBLOX_ROS__LAZY_OCCUPANCY_DECAY_HPP_
+
+#include <vector>
+
+#include <nvblox/nvblox.h>
+
+namespace nvblox {
+
+/// Decays an occupancy layer lazily. Instead of decaying the whole layer at a
+/// fixed rate, we store per block the time up to which the decay has been
+/// applied. Whenever blocks are read, the decay that is due is applied to them
+/// in a single step. Before new observations are integrated into blocks, their
+/// due decay is applied and their time is reset to the time of the
+/// observations. The result is the same as decaying at decay_rate_hz, except
+/// that the steps are rounded to the time of the last update of a block.
+class LazyOccupancyDecay {
+ public:
+  LazyOccupancyDecay();
+  ~LazyOccupancyDecay();
+
+  /// Applies the decay that is due at time_s to the given blocks.
+  /// @param block_indices Blocks about to be read. Unallocated ones are
+  /// skipped.
+  /// @param time_s The current time (in seconds).
+  /// @param layer_ptr The layer to decay.
+  void decayBlocks(const std::vector<Index3D>& block_indices, double time_s,
+                   OccupancyLayer* layer_ptr);
+
+  /// Applies the decay that is due at time_s to blocks about to be updated
+  /// and restarts their decay at time_s, such that the new observations
+  /// aren't decayed for the time before they were made. Call before
+  /// integrating observations made at time_s.
+  /// @param block_indices Blocks about to be updated. The decay of the
+  /// unallocated ones starts at time_s, once the update allocates them.
+  void decayBlocksForUpdate(const std::vector<Index3D>& block_indices,
+                            double time_s, OccupancyLayer* layer_ptr);
+
+  /// Applies the decay that is due at time_s to all blocks and deallocates
+  /// the blocks that are fully decayed (i.e. all voxels are unknown again).
+  /// @return The deallocated blocks.
+  std::vector<Index3D> sweep(double time_s, OccupancyLayer* layer_ptr);
+
+  /// The rate at which decay steps are applied (in Hz).
+  double decay_rate_hz() const { return decay_rate_hz_; }
+  void decay_rate_hz(double decay_rate_hz);
+
+  /// The decay probabilities, see OccupancyDecayIntegrator.
+  float free_region_decay_probability() const {
+    return free_region_decay_probability_;
+  }
+  void free_region_decay_probability(float free_region_decay_probability);
+  float occupied_region_decay_probability() const {
+    return occupied_region_decay_probability_;
+  }
+  void occupied_region_decay_probability(
+      float occupied_region_decay_probability);
+
+ private:
+  // Decays the blocks by their number of steps. Outputs per block if it's
+  // fully decayed.
+  void decayBlocksOnGPU(const std::vector<Index3D>& block_indices,
+                        const std::vector<int>& num_steps,
+                        OccupancyLayer* layer_ptr,
+                        std::vector<int>* is_decayed);
+
+  // Returns the number of due decay steps for the block and marks them as
+  // applied.
+  int takeDueSteps(const Index3D& block_index, double time_s);
+
+  double decay_rate_hz_ = 10.0;
+  float free_region_decay_probability_ = 0.55f;
+  float occupied_region_decay_probability_ = 0.4f;
+
+  // Time up to which decay has been applied, per block.
+  Index3DHashMapType<double>::type last_decay_time_s_;
+
+  cudaStream_t cuda_stream_ = nullptr;
+
+  // Buffers
+  device_vector<Index3D> block_indices_device_;
+  device_vector<int> num_steps_device_;
+  device_vector<int> is_decayed_device_;
+};
+
+}  // namespace nvblox
+
+#endif  // NVBLOX_ROS__LAZY_OCCUPANCY_DECAY_HPP_
@@ -0,0 +1,250 @@
+// SPDX-FileCopyrightText: NVIDIA CORPORATION & AFFILIATES
+// Copyright (c) 2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef NVBLOX_ROS__MAP_JOURNAL_HPP_
+#define NVBLOX_ROS__MAP_JOURNAL_HPP_
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <nvblox/nvblox.h>
+
+#include "nvblox_ros/block_map_file.hpp"
+
+namespace nvblox {
+
+/// Map journals (.nvbj) are append-only logs of block records. Layout:
+///  - MapJournalFileHeader
+///  - A sequence of records, each a MapJournalRecordHeader followed by
+///    num_bytes of raw block data. Records without data (tombstones) mark the
+///    block as deleted.
+/// The latest record of a block determines its state.
+struct MapJournalFileHeader {
+  char magic[4];
+  uint32_t version;
+  float voxel_size;
+  uint32_t reserved;
+};
+
+struct MapJournalRecordHeader {
+  /// Always kMapJournalRecordMagic, used to detect torn writes.
+  uint32_t magic;
+  /// A BlockMapLayerType.
+  uint32_t layer_type;
+  int32_t x;
+  int32_t y;
+  int32_t z;
+  uint32_t num_bytes;
+  /// FNV-1a hash of the block data.
+  uint32_t checksum;
+  uint32_t reserved;
+};
+
+static_assert(sizeof(MapJournalFileHeader) == 16, "Unexpected padding");
+static_assert(sizeof(MapJournalRecordHeader) == 32, "Unexpected padding");
+
+constexpr uint32_t kMapJournalRecordMagic = 0x4e56424a;  // "NVBJ"
+
+/// Checksum of the data of a journal record.
+uint32_t mapJournalChecksum(const uint8_t* data, size_t num_bytes);
+
+/// Persists a map incrementally, such that it survives crashes. Blocks are
+/// marked dirty as they change and flush() copies (a budgeted number of) them
+/// to host memory. Writing happens on a background thread, which also serves
+/// asynchronous reads of blocks (see requestRead()). Whenever the
+/// journal grows larger than compaction_factor times its live data, it is
+/// rewritten with only the latest record of every block, so the amortized
+/// write cost stays proportional to the appended data.
+/// All methods except writeFailed() and statistics() have to be called from
+/// the same thread (or under the same lock) as the one modifying the mapper.
+class MapJournal {
+ public:
+  struct Statistics {
+    uint64_t num_records_written = 0;
+    uint64_t num_bytes_written = 0;
+    uint64_t num_records_read = 0;
+    uint64_t file_size_bytes = 0;
+    /// Bytes of the latest records of all blocks.
+    uint64_t live_bytes = 0;
+    uint64_t num_compactions = 0;
+    /// Attempts to write a batch of records which failed.
+    uint64_t num_failed_writes = 0;
+  };
+
+  MapJournal() = default;
+  ~MapJournal();
+
+  MapJournal(const MapJournal&) = delete;
+  MapJournal& operator=(const MapJournal&) = delete;
+
+  /// Opens (or creates) the journal and restores the blocks it contains into
+  /// the mapper. A torn record at the end of the journal (from a crash while
+  /// writing) is dropped.
+  /// @param filename Path of the journal.
+  /// @param mapper The mapper to restore into. Its voxel size has to match.
+  /// @param restored_blocks The indices of the restored blocks.
+  /// @return Whether the journal could be opened.
+  bool open(const std::string& filename, Mapper* mapper,
+            std::vector<Index3D>* restored_blocks);
+
+  /// Writes out the queued records and closes the journal.
+  void close();
+  bool isOpen() const { return is_open_; }
+
+  /// Marks blocks as changed (or deleted) in any of the layers. No-op if the
+  /// journal isn't open.
+  void markDirty(const std::vector<Index3D>& block_indices);
+  /// Marks all blocks of the mapper, and all blocks in the journal, as dirty.
+  /// Used when the map was replaced as a whole.
+  void markAllDirty(const Mapper& mapper);
+  /// Marks blocks as being in the journal in their current state.
+  void markClean(const std::vector<Index3D>& block_indices);
+  size_t numDirtyBlocks() const { return dirty_blocks_.size(); }
+
+  /// Queues records of dirty blocks for writing, until max_num_bytes is
+  /// exceeded. The remaining blocks stay dirty.
+  /// @return The number of bytes queued.
+  size_t flush(const Mapper& mapper, size_t max_num_bytes);
+  /// Queues records of those of the given blocks which are dirty, independent
+  /// of any budget.
+  /// @return The number of bytes queued.
+  size_t flush(const Mapper& mapper, const std::vector<Index3D>& block_indices);
+
+  /// Requests the latest records of the blocks (in all layers) to be read on
+  /// the background thread, after all previously queued records are written.
+  /// Records which failed to be written are read from the queue instead.
+  void requestRead(const std::vector<Index3D>& block_indices);
+  /// Copies the blocks read since the last call into the mapper. Blocks which
+  /// are allocated in the mapper already are left untouched.
+  /// @return The indices of the blocks whose reads completed, including the
+  /// ones without records.
+  std::vector<Index3D> insertReadBlocks(Mapper* mapper);
+  /// Blocks until all queued reads are done, and all queued writes are done
+  /// or failed (see writeFailed()).
+  void waitUntilIdle();
+
+  /// Whether the last attempt to write records failed. Failed records are
+  /// kept and retried (in order), until they're written or the journal is
+  /// closed.
+  bool writeFailed() const;
+
+  Statistics statistics() const;
+
+  /// The journal is compacted once it's larger than this factor times its
+  /// live data. Has to be set before opening the journal.
+  float compaction_factor() const { return compaction_factor_; }
+  void compaction_factor(float compaction_factor);
+
+ private:
+  struct Record {
+    MapJournalRecordHeader header;
+    std::vector<uint8_t> data;
+  };
+
+  // Offset (of the header) and data size of a record in the file.
+  struct RecordLocation {
+    uint64_t offset;
+    uint32_t num_bytes;
+  };
+  using RecordIndex = Index3DHashMapType<RecordLocation>::type;
+
+  static constexpr size_t kNumLayerTypes = 3;
+
+  // Reads the record headers and builds the index of the latest records.
+  // Returns the end of the last complete record.
+  uint64_t scan();
+
+  // Copies the latest version of the blocks to the layer.
+  // Drops corrupt records from the index.
+  template <typename VoxelType>
+  void restoreLayer(RecordIndex* record_index_ptr,
+                    VoxelBlockLayer<VoxelType>* layer_ptr,
+                    std::vector<Index3D>* restored_blocks);
+
+  // Reads the record at the location. Fails if it's corrupt.
+  bool readRecord(const RecordLocation& location, Record* record) const;
+
+  // Allocates the block of the record in the layer and copies the record data
+  // into it. Returns false if the block was allocated already or the record
+  // doesn't fit the layer.
+  template <typename VoxelType>
+  bool insertRecord(const Record& record,
+                    VoxelBlockLayer<VoxelType>* layer_ptr);
+
+  // Appends the record describing the current state of the block in the
+  // layer. Returns the bytes of the record (0 if no record is needed).
+  template <typename VoxelType>
+  size_t appendRecord(const VoxelBlockLayer<VoxelType>& layer,
+                      BlockMapLayerType layer_type, const Index3D& block_index,
+                      std::vector<Record>* records);
+  // Appends the records of the block in all layers.
+  size_t appendRecords(const Mapper& mapper, const Index3D& block_index,
+                       std::vector<Record>* records);
+  // Hands the records over to the background thread.
+  void queueRecords(std::vector<Record>&& records);
+
+  // Background thread.
+  void ioLoop();
+  // Returns false (leaving the file as it was) if the records couldn't be
+  // written.
+  bool writeRecords(const std::vector<Record>& records);
+  void readBlocks(const std::vector<Index3D>& block_indices);
+  void compact();
+
+  std::string filename_;
+  bool is_open_ = false;
+  float voxel_size_ = 0.0f;
+  float compaction_factor_ = 2.0f;
+
+  // Producer side.
+  Index3DSet dirty_blocks_;
+  // Blocks with a live record, per layer.
+  std::array<Index3DSet, kNumLayerTypes> journaled_blocks_;
+
+  // Background thread side.
+  int fd_ = -1;
+  std::array<RecordIndex, kNumLayerTypes> record_index_;
+  uint64_t file_size_ = 0;
+  uint64_t live_bytes_ = 0;
+
+  // Records handed over to the background thread.
+  std::deque<std::vector<Record>> queue_;
+  bool write_failed_ = false;
+  // Blocks to read, and the results of the completed reads.
+  std::deque<std::vector<Index3D>> read_queue_;
+  std::vector<Record> read_records_;
+  std::vector<Index3D> read_blocks_;
+  bool is_busy_ = false;
+  bool stop_ = false;
+  Statistics statistics_;
+  mutable std::mutex mutex_;
+  std::condition_variable queue_condition_;
+  std::condition_variable idle_condition_;
+  std::thread io_thread_;
+};
+
+}  // namespace nvblox
+
+#include "nvblox_ros/impl/map_journal_impl.hpp"
+
+#endif  // NVBLOX_ROS__MAP_JOURNAL_HPP_
@@ -18,16 +18,38 @@
 #ifndef NVBLOX_ROS__MAPPER_INITIALIZATION_HPP_
 #define NVBLOX_ROS__MAPPER_INITIALIZATION_HPP_
 
+#include <glog/logging.h>
+
 #include <string>
 
 #include <ros/ros.h>
+#include <yaml-cpp/yaml.h>
 
 namespace nvblox {
 
 class Mapper;
 
+/// Sets the parameters of the mapper's integrators from the node's parameters.
+/// Parameters which aren't set keep the nvblox defaults.
 void initializeMapper(Mapper* mapper_ptr, ros::NodeHandle& nh);
 
+/// Same as above, with the parameters taken from a map (e.g. a node's
+/// parameter YAML file), such that no ROS master is needed.
+void initializeMapper(Mapper* mapper_ptr, const YAML::Node& parameters);
+
+/// Loads a parameter YAML file, in the format of the files in config/.
+/// @return False if the file couldn't be read or doesn't contain a map.
+bool loadParameterFile(const std::string& filename, YAML::Node* parameters);
+
+/// Reads a parameter from a map loaded by loadParameterFile().
+/// @return False if the parameter isn't set or has the wrong type, in which
+/// case value is left unchanged.
+template <typename T>
+bool getParam(const YAML::Node& parameters, const std::string& name,
+              T* value);
+
 }  // namespace nvblox
 
+#include "nvblox_ros/impl/mapper_initialization_impl.hpp"
+
 #endif  // NVBLOX_ROS__MAPPER_INITIALIZATION_HPP_
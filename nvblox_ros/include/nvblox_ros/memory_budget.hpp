@@ -0,0 +1,136 @@
+// SPDX-FileCopyrightText: NVIDIA CORPORATION & AFFILIATES
+// Copyright (c) 2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef NVBLOX_ROS__MEMORY_BUDGET_HPP_
+#define NVBLOX_ROS__MEMORY_BUDGET_HPP_
+
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <nvblox/nvblox.h>
+
+namespace nvblox {
+
+/// Memory use of a layer and its budget.
+struct LayerMemoryUsage {
+  std::string name;
+  size_t bytes_per_block = 0;
+  /// Memory the blocks hold in addition to their fixed size (mesh data).
+  size_t extra_bytes = 0;
+  /// 0 means the layer has no budget.
+  size_t budget_bytes = 0;
+  Index3DSet block_indices;
+
+  size_t num_blocks() const { return block_indices.size(); }
+  size_t num_bytes() const {
+    return block_indices.size() * bytes_per_block + extra_bytes;
+  }
+};
+
+/// Gets the memory use of a layer.
+template <typename LayerType>
+LayerMemoryUsage getLayerMemoryUsage(const std::string& name,
+                                     const LayerType& layer,
+                                     size_t budget_bytes);
+
+/// Gets the memory use of a mesh layer, including the reserved capacity of
+/// the mesh data of its blocks. Mesh layers have no budget.
+LayerMemoryUsage getMeshLayerMemoryUsage(const std::string& name,
+                                         const MeshLayer& layer);
+
+/// Counts the blocks allocated and freed in layers, by comparing the blocks of
+/// consecutive updates.
+class BlockAllocationTracker {
+ public:
+  struct Counts {
+    uint64_t num_allocated_blocks = 0;
+    uint64_t num_freed_blocks = 0;
+    /// Over the period between the last two updates.
+    float allocated_blocks_per_s = 0.0f;
+    float freed_blocks_per_s = 0.0f;
+  };
+
+  BlockAllocationTracker() = default;
+
+  /// Compares the blocks of the layers with the ones of the last update.
+  /// @param layers The memory use of the layers.
+  /// @param time_s The current time (in seconds).
+  void update(const std::vector<LayerMemoryUsage>& layers, double time_s);
+
+  /// The counts of the layer with this name.
+  Counts counts(const std::string& layer_name) const;
+
+ private:
+  struct LayerState {
+    Index3DSet block_indices;
+    double time_s = 0.0;
+    Counts counts;
+  };
+  std::unordered_map<std::string, LayerState> layers_;
+};
+
+/// Keeps the blocks of a mapper in the order they were last observed in, and
+/// selects the least recently observed ones for eviction when layers exceed
+/// their memory budget. A block is evicted from all layers at once, since the
+/// layers of a mapper are indexed alike.
+class MemoryBudget {
+ public:
+  MemoryBudget() = default;
+
+  /// Marks the blocks as observed now.
+  void touch(const std::vector<Index3D>& block_indices);
+
+  /// Selects blocks to evict, least recently observed first, until all layers
+  /// are within their budget. Blocks within the protection radius of the
+  /// center are never selected. Blocks allocated since the last call count as
+  /// observed now. The selected blocks are no longer tracked.
+  /// @param layers The memory use of the layers.
+  /// @param center The position of the robot.
+  /// @param block_size The size of the blocks of all layers.
+  /// @return The blocks to evict.
+  std::vector<Index3D> selectBlocksToEvict(
+      const std::vector<LayerMemoryUsage>& layers, const Vector3f& center,
+      float block_size);
+
+  /// Blocks evicted from the layer with this name (so far).
+  uint64_t numEvictedBlocks(const std::string& layer_name) const;
+  size_t numTrackedBlocks() const { return lru_blocks_.size(); }
+
+  /// Blocks closer than this to the center are never evicted.
+  float protection_radius_m() const { return protection_radius_m_; }
+  void protection_radius_m(float protection_radius_m) {
+    protection_radius_m_ = protection_radius_m;
+  }
+
+ private:
+  float protection_radius_m_ = 5.0f;
+
+  // Least recently observed block first, with an index into the list.
+  std::list<Index3D> lru_blocks_;
+  Index3DHashMapType<std::list<Index3D>::iterator>::type lru_positions_;
+
+  std::unordered_map<std::string, uint64_t> num_evicted_blocks_;
+};
+
+}  // namespace nvblox
+
+#include "nvblox_ros/impl/memory_budget_impl.hpp"
+
+#endif  // NVBLOX_ROS__MEMORY_BUDGET_HPP_
@@ -20,18 +20,23 @@
 
 #include <deque>
 #include <memory>
+#include <mutex>
 #include <tuple>
+#include <utility>
+#include <vector>
 
 #include <message_filters/subscriber.h>
-#include <message_filters/sync_policies/approximate_time.h>
 #include <message_filters/synchronizer.h>
-#include <message_filters/time_synchronizer.h>
 
 #include <nvblox/mapper/multi_mapper.h>
+#include <nvblox/semantics/image_masker.h>
 #include <nvblox/semantics/image_projector.h>
 #include <nvblox/sensors/pointcloud.h>
 
+#include "nvblox_ros/human_tracking.hpp"
+#include "nvblox_ros/lazy_occupancy_decay.hpp"
 #include "nvblox_ros/nvblox_node.hpp"
+#include "nvblox_ros/stamp_join_buffer.hpp"
 
 namespace nvblox {
 
@@ -47,6 +52,18 @@ class NvbloxHumanNode : public NvbloxNode {
   void setupTimers();
   void advertiseTopics();
 
+  // Callbacks for Sensor + CamInfo and Mask + CamInfo. These feed the join
+  // buffers below.
+  void depthWithInfoCallback(
+      const sensor_msgs::ImageConstPtr& depth_img_ptr,
+      const sensor_msgs::CameraInfo::ConstPtr& camera_info_msg);
+  void colorWithInfoCallback(
+      const sensor_msgs::ImageConstPtr& color_img_ptr,
+      const sensor_msgs::CameraInfo::ConstPtr& camera_info_msg);
+  void maskWithInfoCallback(
+      const sensor_msgs::ImageConstPtr& mask_img_ptr,
+      const sensor_msgs::CameraInfo::ConstPtr& mask_camera_info_msg);
+
   // Callbacks for Sensor + Mask
   void depthPlusMaskImageCallback(
       const sensor_msgs::ImageConstPtr& depth_img_ptr,
@@ -81,32 +98,80 @@ class NvbloxHumanNode : public NvbloxNode {
   // Decay the human occupancy grid on fixed frequency
   void decayHumanOccupancy(const ros::TimerEvent& /*event*/);
 
+  // Apply the due decay to the whole human occupancy layer and reclaim fully
+  // decayed blocks (lazy decay only).
+  void sweepHumanOccupancy(const ros::TimerEvent& /*event*/);
+
+  // Enforce the memory budgets of the static and the human layers.
+  bool hasMemoryBudget() const override;
+  void enforceMemoryBudget(const ros::TimerEvent& /*event*/) override;
+
  protected:
+  // Apply the due decay to human occupancy blocks before they are read (lazy
+  // decay only).
+  void decayHumanOccupancyBlocks(const std::vector<Index3D>& block_indices);
+  // Apply the due decay to the blocks the human depth frame is about to be
+  // integrated into, and restart their decay at the frame stamp (lazy decay
+  // only).
+  void decayHumanOccupancyForUpdate(const ros::Time& frame_stamp);
+
+  // Back project the last masked (human only) depth frame to
+  // human_pointcloud_L_device_.
+  void backProjectHumanDepthFrame();
+
+  // Record the blocks in which humans were observed in the last depth frame.
+  void updateHumanBlocks(const ros::Time& timestamp);
+
+  // Update the human ESDF only within a padded region around the blocks in
+  // which humans were recently observed. Clears ESDF blocks that left the
+  // region. Returns the updated and cleared ESDF blocks and the bounding box
+  // of the slice that needs to be output.
+  std::vector<Index3D> updateHumanEsdfInRegion(
+      AxisAlignedBoundingBox* slice_aabb);
+
+  // Evict blocks from the human layers which exceed their budget, and add the
+  // usage of the layers and buffers to the message (if not null).
+  void enforceHumanMemoryBudget(nvblox_msgs::MemoryUsage* msg);
+  // Whether any of the human layers has a memory budget.
+  bool hasHumanMemoryBudget() const;
+
   // Publish human data (if any subscribers) that helps
   // visualization and debugging.
   void publishHumanDebugOutput();
 
+  // Cluster the human voxels of the last depth frame into instances, track
+  // them and publish them.
+  void publishHumanInstances();
+
   // Mapper
   // Holds the map layers and their associated integrators
   // - TsdfLayer, ColorLayer, OccupancyLayer, EsdfLayer, MeshLayer
   std::shared_ptr<MultiMapper> multi_mapper_;
   std::shared_ptr<Mapper> human_mapper_;
 
-  // Synchronize: Depth + CamInfo + SegmentationMake + CamInfo
-  typedef message_filters::sync_policies::ApproximateTime<
-      sensor_msgs::Image, sensor_msgs::CameraInfo, sensor_msgs::Image,
-      sensor_msgs::CameraInfo>
-      mask_time_policy_t;
-  std::shared_ptr<message_filters::Synchronizer<mask_time_policy_t>>
-      timesync_depth_mask_;
-  std::shared_ptr<message_filters::Synchronizer<mask_time_policy_t>>
-      timesync_color_mask_;
+  // Log the join buffer statistics (throttled).
+  void printJoinStatistics();
+
+  // Synchronize: SegmentationMask + CamInfo (exact time, like depth and color
+  // in the base class).
+  std::shared_ptr<message_filters::Synchronizer<time_policy_t>> timesync_mask_;
 
   // Segmentation mask sub.
   message_filters::Subscriber<sensor_msgs::Image> segmentation_mask_sub_;
   message_filters::Subscriber<sensor_msgs::CameraInfo>
       segmentation_camera_info_sub_;
 
+  // Join: (Depth + CamInfo) with (SegmentationMask + CamInfo) and
+  // (Color + CamInfo) with (SegmentationMask + CamInfo). Every mask is added
+  // to both buffers, so it's joined with one depth and one color image.
+  using ImageInfoPair = std::pair<sensor_msgs::ImageConstPtr,
+                                  sensor_msgs::CameraInfo::ConstPtr>;
+  using ImageMaskJoinBuffer = StampJoinBuffer<ImageInfoPair, ImageInfoPair>;
+  std::unique_ptr<ImageMaskJoinBuffer> depth_mask_join_buffer_;
+  std::unique_ptr<ImageMaskJoinBuffer> color_mask_join_buffer_;
+  // When the join statistics were last logged.
+  ros::WallTime last_join_statistics_print_time_;
+
   ros::NodeHandle nh_;
 
   // Publishers
@@ -119,15 +184,53 @@ class NvbloxHumanNode : public NvbloxNode {
   ros::Publisher combined_map_slice_publisher_;
   ros::Publisher depth_frame_overlay_publisher_;
   ros::Publisher color_frame_overlay_publisher_;
+  ros::Publisher human_instances_publisher_;
 
   // Timers
   ros::Timer human_occupancy_decay_timer_;
+  ros::Timer human_occupancy_sweep_timer_;
   ros::Timer human_esdf_processing_timer_;
 
   // Rates.
   float human_occupancy_decay_rate_hz_ = 10.0f;
+  float human_occupancy_sweep_rate_hz_ = 0.5f;
+
+  // If true, the human occupancy is decayed when it's read rather than at a
+  // fixed rate.
+  bool human_occupancy_lazy_decay_ = false;
+  LazyOccupancyDecay lazy_occupancy_decay_;
+  // Finds the blocks in view of the human depth frame.
+  ViewCalculator human_view_calculator_;
   float human_esdf_update_rate_hz_ = 10.0f;
 
+  // Human ESDF region.
+  // If true, the human ESDF is only computed around recently observed humans.
+  bool human_esdf_limit_to_region_ = true;
+  // Distance by which the region around observed humans is padded.
+  float human_esdf_region_padding_m_ = 2.0f;
+  // Blocks where no human has been observed for this long leave the region.
+  float human_esdf_region_timeout_s_ = 3.0f;
+
+  // Human instances.
+  // Human voxels within this many voxels of each other form one instance.
+  int human_cluster_max_gap_voxels_ = 1;
+  // Smaller clusters of human voxels are ignored.
+  int human_cluster_min_voxels_ = 20;
+  InstanceTracker human_tracker_;
+
+  // Human memory budget.
+  // Maximum memory of the human layers in MB. Values <= 0 disable the budget.
+  float human_occupancy_memory_budget_mb_ = 0.0f;
+  float human_esdf_memory_budget_mb_ = 0.0f;
+  // Order in which the human blocks were observed, used for eviction.
+  MemoryBudget human_memory_budget_;
+
+  // Image/mask join.
+  // Maximum stamp difference between an image and its mask.
+  float mask_join_tolerance_ms_ = 20.0f;
+  // Maximum number of images (and masks) waiting for their partner.
+  int mask_join_max_pending_ = 40;
+
   // Image queues.
   // Note these differ from the base class image queues because they also
   // include segmentation images. The base class queue are disused in the
@@ -138,10 +241,23 @@ class NvbloxHumanNode : public NvbloxNode {
   // Cache for GPU image
   MonoImage mask_image_;
 
+  // Splits depth images into the human (masked) and static (unmasked) part.
+  // We do the split here rather than in the MultiMapper such that the two
+  // integrations can be timed separately.
+  ImageMasker image_masker_;
+  DepthImage depth_frame_unmasked_;
+  DepthImage depth_frame_masked_;
+  ColorImage depth_frame_overlay_;
+
   // Image queue mutexes.
   std::mutex depth_mask_queue_mutex_;
   std::mutex color_mask_queue_mutex_;
 
+  // Protects the human mapper. The base class map_mutex_ protects the static
+  // (unmasked) mapper. If both are needed, lock them together using
+  // std::lock() to avoid deadlocks.
+  std::mutex human_map_mutex_;
+
   // Object for back projecting image to a pointcloud.
   DepthImageBackProjector image_back_projector_;
 
@@ -149,6 +265,16 @@ class NvbloxHumanNode : public NvbloxNode {
   Pointcloud human_pointcloud_C_device_;
   Pointcloud human_pointcloud_L_device_;
   Pointcloud human_voxel_centers_L_device_;
+  Pointcloud human_block_centers_L_device_;
+
+  // Blocks in which humans were observed and the (sensor) time of the last
+  // observation.
+  Index3DHashMapType<ros::Time>::type human_block_last_seen_;
+  // The ESDF blocks updated in the last region limited update.
+  Index3DSet human_esdf_region_;
+
+  // Sensor stamp of the newest depth frame integrated into the human layers.
+  ros::Time newest_human_stamp_;
 
   // Caching data of last depth frame for debug outputs
   Camera depth_camera_;
@@ -25,12 +25,16 @@
 #include <mutex>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include <message_filters/subscriber.h>
 #include <message_filters/sync_policies/approximate_time.h>
 #include <message_filters/sync_policies/exact_time.h>
 #include <message_filters/synchronizer.h>
+#include <nvblox_msgs/ClearRegion.h>
 #include <nvblox_msgs/FilePath.h>
+#include <nvblox_msgs/LoadMapRegion.h>
+#include <nvblox_msgs/MemoryUsage.h>
 #include <ros/node_handle.h>
 #include <ros/publisher.h>
 #include <ros/ros.h>
@@ -44,12 +48,22 @@
 
 #include <nvblox/nvblox.h>
 
+#include "nvblox_ros/block_map_file.hpp"
+#include "nvblox_ros/block_pager.hpp"
 #include "nvblox_ros/conversions/esdf_slice_conversions.hpp"
 #include "nvblox_ros/conversions/image_conversions.hpp"
 #include "nvblox_ros/conversions/layer_conversions.hpp"
 #include "nvblox_ros/conversions/mesh_conversions.hpp"
 #include "nvblox_ros/conversions/pointcloud_conversions.hpp"
+#include "nvblox_ros/latency_statistics.hpp"
+#include "nvblox_ros/map_journal.hpp"
 #include "nvblox_ros/mapper_initialization.hpp"
+#include "nvblox_ros/memory_budget.hpp"
+#include "nvblox_ros/region_clearing.hpp"
+#include "nvblox_ros/rolling_block_window.hpp"
+#include "nvblox_ros/stage_timer.hpp"
+#include "nvblox_ros/timing_metrics.hpp"
+#include "nvblox_ros/trace_recorder.hpp"
 #include "nvblox_ros/transformer.hpp"
 
 namespace nvblox {
@@ -81,6 +95,12 @@ class NvbloxNode {
                nvblox_msgs::FilePath::Response& response);
   bool loadMap(nvblox_msgs::FilePath::Request& request,
                nvblox_msgs::FilePath::Response& response);
+  bool loadMapRegion(nvblox_msgs::LoadMapRegion::Request& request,
+                     nvblox_msgs::LoadMapRegion::Response& response);
+  bool clearRegion(nvblox_msgs::ClearRegion::Request& request,
+                   nvblox_msgs::ClearRegion::Response& response);
+  bool dumpTrace(nvblox_msgs::FilePath::Request& request,
+                 nvblox_msgs::FilePath::Response& response);
 
   // Does whatever processing there is to be done, depending on what
   // transforms are available.
@@ -115,6 +135,78 @@ class NvbloxNode {
  protected:
   // Map clearing
   void clearMapOutsideOfRadiusOfLastKnownPose(const ros::TimerEvent& /*event*/);
+  /// Pages blocks outside of the map clearing radius around the position out
+  /// to disk, and requests the ones inside to be paged back in. Expects the
+  /// map mutex to be held.
+  void pageMapAroundPosition(const Vector3f& position);
+  /// Moves the rolling window to the position and deletes the blocks outside
+  /// of it. Expects the map mutex to be held.
+  void rollMapWindowToPosition(const Vector3f& position);
+  /// Removes blocks from all layers of the map. They're paged out if paging is
+  /// enabled, and deleted otherwise. Expects the map mutex to be held.
+  void evictBlocks(const std::vector<Index3D>& block_indices);
+  /// Deletes blocks from all layers of the map. Expects the map mutex to be
+  /// held.
+  void deleteBlocks(const std::vector<Index3D>& block_indices);
+  /// Stops updating the meshes and ESDFs of removed blocks, and schedules
+  /// their meshes for deletion.
+  void markBlocksDeleted(const std::vector<Index3D>& block_indices);
+
+  // Memory budgets
+  /// Whether any of the map layers has a memory budget.
+  bool hasMapMemoryBudget() const;
+  /// Whether any layer has a memory budget.
+  virtual bool hasMemoryBudget() const { return hasMapMemoryBudget(); }
+  /// Starts the timer enforcing the memory budgets, if any layer has a budget
+  /// or the memory usage is published, and it isn't running yet.
+  void startMemoryBudgetTimer();
+  /// Evicts blocks from the layers which exceed their budget and publishes the
+  /// memory usage (if enabled).
+  virtual void enforceMemoryBudget(const ros::TimerEvent& /*event*/);
+  /// Evicts blocks from the map layers which exceed their budget.
+  /// @param msg If not null, the usage of the layers and buffers is added to
+  /// it.
+  void enforceMapMemoryBudget(nvblox_msgs::MemoryUsage* msg);
+  /// Adds the memory usage and the allocation counts of the layers to the
+  /// message.
+  void addMemoryUsageToMessage(const std::vector<LayerMemoryUsage>& layers,
+                               const MemoryBudget& memory_budget,
+                               nvblox_msgs::MemoryUsage* msg);
+  /// Adds the capacity of the buffers to the message, with their names
+  /// prefixed.
+  static void addBufferUsageToMessage(
+      const std::string& prefix,
+      const std::vector<conversions::BufferCapacity>& buffers,
+      nvblox_msgs::MemoryUsage* msg);
+
+  // Partial map loading
+  /// Loads the blocks of the opened block map file around the map clearing
+  /// frame.
+  void pageInMapBlocks(const ros::TimerEvent& /*event*/);
+  /// Schedules blocks which were loaded (rather than integrated) for meshing,
+  /// ESDF computation and journaling. Expects the map mutex to be held.
+  void markBlocksForUpdate(const std::vector<Index3D>& block_indices);
+  /// Opens a block map file, checking that it fits the map. Expects the map
+  /// mutex to be held.
+  bool openBlockMapFile(const std::string& filename);
+
+  // Map storage
+  /// For derived nodes which replace mapper_: The map journal and the block
+  /// pager are bound to the mapper, so they're only opened once the derived
+  /// node calls openMapStorage() with its final mapper.
+  NvbloxNode(ros::NodeHandle& nh, ros::NodeHandle& nh_private,
+             bool open_map_storage);
+  /// Restores the map from the journal of a previous run into mapper_ and
+  /// opens the block pager (if enabled).
+  void openMapStorage();
+
+  // Map journal
+  /// Writes (a budgeted amount of) the changed blocks to the map journal.
+  void flushMapJournal(const ros::TimerEvent& /*event*/);
+
+  // Timing metrics
+  /// Takes a snapshot of the timers and hands it to the exporter.
+  void publishTimingMetrics(const ros::TimerEvent& /*event*/);
 
   /// Used by callbacks (internally) to add messages to queues.
   /// @tparam MessageType The type of the Message stored by the queue.
@@ -152,6 +244,16 @@ class NvbloxNode {
                            const ros::Time& last_update_stamp,
                            float max_update_rate_hz);
 
+  /// Keeps the newest of the sensor stamps integrated into a layer.
+  static void updateNewestStamp(const ros::Time& sensor_stamp,
+                                ros::Time* newest_stamp);
+  /// The stamp of an output computed from sensor data up to the given stamp:
+  /// The sensor stamp, or the current time if stamp_outputs_with_sensor_time_
+  /// is off. Adds the sensor-to-output latency to the "latency/<output>"
+  /// stage.
+  ros::Time outputStamp(const std::string& output,
+                        const ros::Time& sensor_stamp);
+
   template <typename MessageType>
   void limitQueueSizeByDeletingOldestMessages(
       const size_t max_num_messages, const std::string& queue_name,
@@ -200,11 +302,16 @@ class NvbloxNode {
   ros::Publisher map_slice_publisher_;
   ros::Publisher slice_bounds_publisher_;
   ros::Publisher mesh_marker_publisher_;
+  ros::Publisher memory_usage_publisher_;
+  ros::Publisher diagnostics_publisher_;
 
   // Services.
   ros::ServiceServer save_ply_service_;
   ros::ServiceServer save_map_service_;
   ros::ServiceServer load_map_service_;
+  ros::ServiceServer load_map_region_service_;
+  ros::ServiceServer clear_region_service_;
+  ros::ServiceServer dump_trace_service_;
 
   // Timers.
   ros::Timer depth_processing_timer_;
@@ -214,6 +321,10 @@ class NvbloxNode {
   ros::Timer esdf_processing_timer_;
   ros::Timer mesh_processing_timer_;
   ros::Timer clear_outside_radius_timer_;
+  ros::Timer map_page_in_timer_;
+  ros::Timer map_journal_timer_;
+  ros::Timer memory_budget_timer_;
+  ros::Timer timing_metrics_timer_;
 
   // ROS & nvblox settings
   float voxel_size_ = 0.05f;
@@ -272,6 +383,70 @@ class NvbloxNode {
   float map_clearing_radius_m_ = -1.0f;
   std::string map_clearing_frame_id_ = "lidar";
   float clear_outside_radius_rate_hz_ = 1.0f;
+  /// Whether blocks outside of the radius are paged out to disk (and back in
+  /// once the robot returns) rather than deleted.
+  bool page_map_outside_radius_ = false;
+  std::string map_paging_file_ = "/tmp/nvblox_paged_blocks.nvbj";
+  /// Blocks are paged out once they're this much further than the radius, so
+  /// blocks at the border aren't paged in and out repeatedly.
+  float map_paging_hysteresis_m_ = 1.0f;
+  /// Whether the map is kept to a cube with a side of twice the radius around
+  /// the map clearing frame, see RollingBlockWindow.
+  bool roll_map_window_ = false;
+
+  /// Partial map loading params
+  /// Blocks of a loaded block map file (.nvbm) within this radius of the map
+  /// clearing frame are paged in. Values <=0.0 load the whole file at once.
+  float map_page_in_radius_m_ = 10.0f;
+  float map_page_in_rate_hz_ = 1.0f;
+  /// How block map files are written and read.
+  BlockMapFileOptions map_file_options_;
+
+  /// Map journal params
+  /// The map is restored from and continuously written to this file. An
+  /// empty path disables the journal.
+  std::string map_journal_file_ = "";
+  float map_journal_flush_rate_hz_ = 1.0f;
+  /// Limits the bytes appended to the journal per second.
+  int map_journal_max_bytes_per_s_ = 20000000;
+  float map_journal_compaction_factor_ = 2.0f;
+
+  /// Memory budget params
+  /// Maximum memory of the map layers in MB. Values <= 0 disable the budget.
+  float tsdf_memory_budget_mb_ = 0.0f;
+  float color_memory_budget_mb_ = 0.0f;
+  float occupancy_memory_budget_mb_ = 0.0f;
+  float esdf_memory_budget_mb_ = 0.0f;
+  /// Blocks this close to the map clearing frame are never evicted.
+  float memory_budget_protection_radius_m_ = 5.0f;
+  float memory_budget_rate_hz_ = 1.0f;
+  /// Whether the memory usage (and allocation telemetry) is published.
+  bool publish_memory_usage_ = false;
+
+  /// Mesh publishing params
+  /// Drop re-meshed blocks whose content didn't change from mesh messages.
+  bool suppress_unchanged_mesh_blocks_ = true;
+  float mesh_block_fingerprint_quantization_m_ = 0.005f;
+
+  /// Timing metrics params
+  /// Rate at which the timer statistics are published as diagnostics (and
+  /// written to the Prometheus file). Values <= 0 disable the export.
+  float timing_metrics_rate_hz_ = 0.1f;
+  /// The timer statistics are written to this file in the Prometheus text
+  /// format. Not written if empty.
+  std::string timing_metrics_prometheus_file_ = "";
+  /// Whether the timer statistics are printed to the console as well, at the
+  /// same rate.
+  bool print_timing_statistics_ = false;
+  /// Number of events of the trace ring buffer, see TraceRecorder. Values
+  /// <= 0 disable tracing.
+  int trace_buffer_size_ = 0;
+
+  /// Output stamp params
+  /// Whether the map outputs are stamped with the newest sensor stamp
+  /// integrated into the layers they're computed from, rather than the time
+  /// they're published at, such that consumers know how old the data is.
+  bool stamp_outputs_with_sensor_time_ = true;
 
   // Mapper
   // Holds the map layers and their associated integrators
@@ -293,6 +468,11 @@ class NvbloxNode {
   ros::Time last_color_update_time_;
   ros::Time last_lidar_update_time_;
 
+  // Newest sensor stamps integrated into the static projective layer (TSDF
+  // or occupancy, from depth images and LiDAR) and the color layer.
+  ros::Time newest_tsdf_stamp_;
+  ros::Time newest_color_stamp_;
+
   // Cache the last known number of subscribers.
   size_t mesh_subscriber_count_ = 0;
 
@@ -315,6 +495,39 @@ class NvbloxNode {
   // Keeps track of the mesh blocks deleted such that we can publish them for
   // deletion in the rviz plugin
   Index3DSet mesh_blocks_deleted_;
+
+  // The block map file the map is (partially) loaded from, if any.
+  BlockMapFile block_map_file_;
+  // Loaded blocks which still have to be meshed / have their ESDF computed.
+  // The mapper only tracks blocks it integrated itself.
+  Index3DSet mesh_blocks_to_update_;
+  Index3DSet esdf_blocks_to_update_;
+
+  // Journal of the changed blocks, for crash recovery.
+  MapJournal map_journal_;
+
+  // Holds the blocks outside of the map clearing radius, if paging is enabled.
+  BlockPager block_pager_;
+
+  // The cube of blocks kept around the robot, if the rolling window is
+  // enabled.
+  RollingBlockWindow rolling_window_;
+
+  // Order in which the map blocks were observed, used for eviction.
+  MemoryBudget memory_budget_;
+
+  // Counts the blocks allocated and freed between memory usage updates.
+  BlockAllocationTracker allocation_tracker_;
+
+  // Fingerprints of the published mesh blocks, used to detect blocks which
+  // were re-meshed without changing.
+  conversions::MeshBlockFingerprintCache mesh_fingerprint_cache_;
+
+  // Latencies of the timed stages, for their percentiles. Over the recent
+  // samples only, such that they follow changes of the load.
+  LatencyStatistics stage_statistics_{1000};
+  // Publishes the timer statistics from a background thread.
+  std::unique_ptr<TimingMetricsExporter> timing_metrics_exporter_;
 };
 
 }  // namespace nvblox
@@ -0,0 +1,158 @@
+// SPDX-FileCopyrightText: NVIDIA CORPORATION & AFFILIATES
+// Copyright (c) 2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef NVBLOX_ROS__NVBLOX_SEMANTIC_NODE_HPP_
+#define NVBLOX_ROS__NVBLOX_SEMANTIC_NODE_HPP_
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <message_filters/subscriber.h>
+#include <message_filters/synchronizer.h>
+
+#include "nvblox_ros/nvblox_node.hpp"
+#include "nvblox_ros/semantic_image_splitter.hpp"
+#include "nvblox_ros/stamp_join_buffer.hpp"
+
+namespace nvblox {
+
+/// Maps K semantic classes (e.g. people, forklifts, carts), each in its own
+/// occupancy layer with its own decay and ESDF, next to the static map. A
+/// single label image (registered to the depth image) assigns the pixels to
+/// the classes.
+class NvbloxSemanticNode : public NvbloxNode {
+ public:
+  explicit NvbloxSemanticNode(ros::NodeHandle& nh,
+                              ros::NodeHandle& nh_private);
+  virtual ~NvbloxSemanticNode() = default;
+
+  // Setup. These are called by the constructor.
+  void getParameters();
+  void initializeSemanticMappers();
+  void subscribeToTopics();
+  void setupTimers();
+  void advertiseTopics();
+
+  // Callbacks. These feed the join buffer.
+  void depthWithInfoCallback(
+      const sensor_msgs::ImageConstPtr& depth_img_ptr,
+      const sensor_msgs::CameraInfo::ConstPtr& camera_info_msg);
+  void labelImageCallback(const sensor_msgs::ImageConstPtr& label_img_ptr);
+
+  // This is our internal type for passing around depth images, their
+  // intrinsics and the matching label images.
+  using DepthLabelsMsgTuple =
+      std::tuple<sensor_msgs::ImageConstPtr, sensor_msgs::CameraInfo::ConstPtr,
+                 sensor_msgs::ImageConstPtr>;
+
+  // Override the depth processing from the base node
+  void processDepthQueue(const ros::TimerEvent& /*event*/) override;
+
+  // The method for processing depth images from the internal queue.
+  virtual bool processDepthImage(const DepthLabelsMsgTuple& depth_labels_msg);
+
+  // Update and publish the ESDFs of all classes on fixed frequency.
+  void processSemanticEsdf(const ros::TimerEvent& /*event*/);
+
+  // Decay the occupancy of one class on its own frequency.
+  void decaySemanticOccupancy(size_t class_index,
+                              const ros::TimerEvent& /*event*/);
+
+ protected:
+  // Everything belonging to a single class.
+  struct SemanticClass {
+    std::string name;
+    std::vector<int> label_ids;
+    float decay_rate_hz = 10.0f;
+    std::shared_ptr<Mapper> mapper;
+
+    // Depth assigned to pixels of other classes. Beyond the integration
+    // distance, such that they clear along the ray.
+    float invalid_depth = 0.0f;
+    // Stamp of the last depth frame containing this class.
+    ros::Time last_seen;
+    // Stamp of the newest depth frame integrated into this class' mapper.
+    ros::Time newest_stamp;
+
+    ros::Timer decay_timer;
+    ros::Publisher occupancy_publisher;
+    ros::Publisher esdf_pointcloud_publisher;
+    ros::Publisher map_slice_publisher;
+  };
+
+  // Publish the ESDF and occupancy of a class (if any subscribers).
+  void publishSemanticClass(const SemanticClass& semantic_class);
+
+  std::vector<SemanticClass> semantic_classes_;
+
+  // Protects the class mappers. The base class map_mutex_ protects the static
+  // mapper.
+  std::mutex semantic_map_mutex_;
+
+  // Label image sub.
+  message_filters::Subscriber<sensor_msgs::Image> label_image_sub_;
+
+  // Join: (Depth + CamInfo) with labels.
+  using ImageInfoPair = std::pair<sensor_msgs::ImageConstPtr,
+                                  sensor_msgs::CameraInfo::ConstPtr>;
+  using DepthLabelsJoinBuffer =
+      StampJoinBuffer<ImageInfoPair, sensor_msgs::ImageConstPtr>;
+  std::unique_ptr<DepthLabelsJoinBuffer> depth_labels_join_buffer_;
+
+  // Publishers
+  ros::Publisher semantic_labels_publisher_;
+
+  // Timers
+  ros::Timer semantic_esdf_processing_timer_;
+
+  // Rates.
+  float semantic_esdf_update_rate_hz_ = 10.0f;
+
+  // A class is integrated while its pixels are in view, and for this long
+  // after, such that the free space where it was is cleared.
+  float semantic_clearing_duration_s_ = 2.0f;
+
+  // Image/label join.
+  float label_join_tolerance_ms_ = 0.0f;
+  int label_join_max_pending_ = 40;
+
+  // Image queue.
+  // Note this differs from the base class image queue because it also
+  // includes the label images. The base class depth queue is disused.
+  std::deque<DepthLabelsMsgTuple> depth_labels_queue_;
+  std::mutex depth_labels_queue_mutex_;
+
+  // Splitting the depth image
+  SemanticImageSplitter image_splitter_;
+  MonoImage label_image_;
+  DepthImage depth_frame_unmasked_;
+  std::vector<DepthImage> class_depth_frames_;
+  std::vector<int> class_pixel_counts_;
+  std::vector<PixelBoundingBox> class_bounding_boxes_;
+  // Per class, a frame of only invalid depth to clear the class with once it
+  // left the view.
+  std::vector<DepthImage> class_clearing_frames_;
+};
+
+}  // namespace nvblox
+
+#endif  // NVBLOX_ROS__NVBLOX_SEMANTIC_NODE_HPP_
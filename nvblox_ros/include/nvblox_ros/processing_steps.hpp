@@ -0,0 +1,108 @@
+// SPDX-FileCopyrightText: NVIDIA CORPORATION & AFFILIATES
+// Copyright (c) 2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef NVBLOX_ROS__PROCESSING_STEPS_HPP_
+#define NVBLOX_ROS__PROCESSING_STEPS_HPP_
+
+#include <string>
+#include <vector>
+
+#include <sensor_msgs/CameraInfo.h>
+#include <sensor_msgs/Image.h>
+#include <sensor_msgs/PointCloud2.h>
+
+#include <nvblox/nvblox.h>
+
+#include "nvblox_ros/conversions/pointcloud_conversions.hpp"
+#include "nvblox_ros/latency_statistics.hpp"
+
+namespace nvblox {
+namespace processing {
+
+// The conversion and integration steps of the NvbloxNode, shared with the
+// ReplayPipeline such that benchmarks and offline processing run the node's
+// code. Each step records its latency in the statistics, under its stage name
+// prefixed by stage_prefix (the node uses "ros/"). Locking the map is up to
+// the caller.
+
+/// Converts a depth image message. Stage "depth/conversions".
+/// @return False if the image couldn't be converted.
+bool convertDepthImage(const sensor_msgs::ImageConstPtr& depth_image_msg,
+                       const sensor_msgs::CameraInfo& camera_info,
+                       const std::string& stage_prefix,
+                       LatencyStatistics* statistics, DepthImage* depth_image,
+                       Camera* camera);
+
+/// Integrates a converted depth image. Stage "depth/integrate".
+void integrateDepthImage(const DepthImage& depth_image, const Transform& T_L_C,
+                         const Camera& camera, const std::string& stage_prefix,
+                         LatencyStatistics* statistics, Mapper* mapper);
+
+/// Converts a color image message. Stage "color/conversion".
+/// @return False if the image couldn't be converted.
+bool convertColorImage(const sensor_msgs::ImageConstPtr& color_image_msg,
+                       const sensor_msgs::CameraInfo& camera_info,
+                       const std::string& stage_prefix,
+                       LatencyStatistics* statistics, ColorImage* color_image,
+                       Camera* camera);
+
+/// Integrates a converted color image. Stage "color/integrate".
+void integrateColorImage(const ColorImage& color_image, const Transform& T_L_C,
+                         const Camera& camera, const std::string& stage_prefix,
+                         LatencyStatistics* statistics, Mapper* mapper);
+
+/// Converts a LiDAR pointcloud to a depth image. Stage "lidar/conversion".
+/// @return False if the pointcloud is inconsistent with the LiDAR.
+bool convertLidarPointcloud(const sensor_msgs::PointCloud2::ConstPtr& cloud,
+                            const Lidar& lidar,
+                            const std::string& stage_prefix,
+                            LatencyStatistics* statistics,
+                            conversions::PointcloudConverter* converter,
+                            DepthImage* depth_image);
+
+/// Integrates a converted LiDAR pointcloud. Stage "lidar/integration".
+void integrateLidarDepthImage(const DepthImage& depth_image,
+                              const Transform& T_L_C, const Lidar& lidar,
+                              const std::string& stage_prefix,
+                              LatencyStatistics* statistics, Mapper* mapper);
+
+/// Updates the ESDF of the blocks changed by the mapper, and of the given
+/// blocks, which the mapper doesn't know about (e.g. loaded from file).
+/// Stage "esdf/integrate".
+/// @param projective_layer_type The layer the ESDF is computed from.
+/// @param esdf_2d Whether to compute a slice between the min and max height
+/// (stored at the slice height) instead of the 3D ESDF.
+/// @return The updated blocks.
+std::vector<Index3D> updateEsdf(const std::vector<Index3D>& extra_blocks,
+                                ProjectiveLayerType projective_layer_type,
+                                bool esdf_2d, float esdf_2d_min_height,
+                                float esdf_2d_max_height,
+                                float esdf_slice_height,
+                                const std::string& stage_prefix,
+                                LatencyStatistics* statistics, Mapper* mapper);
+
+/// Updates and colors the mesh of the blocks changed by the mapper, and of the
+/// given blocks. Stage "mesh/integrate_and_color".
+/// @return The updated blocks.
+std::vector<Index3D> updateMesh(const std::vector<Index3D>& extra_blocks,
+                                const std::string& stage_prefix,
+                                LatencyStatistics* statistics, Mapper* mapper);
+
+}  // namespace processing
+}  // namespace nvblox
+
+#endif  // NVBLOX_ROS__PROCESSING_STEPS_HPP_
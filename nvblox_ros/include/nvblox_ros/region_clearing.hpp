@@ -0,0 +1,116 @@
+// SPDX-FileCopyrightText: NVIDIA CORPORATION & AFFILIATES
+// Copyright (c) 2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef NVBLOX_ROS__REGION_CLEARING_HPP_
+#define NVBLOX_ROS__REGION_CLEARING_HPP_
+
+#include <bitset>
+#include <functional>
+#include <vector>
+
+#include <nvblox/nvblox.h>
+
+namespace nvblox {
+
+/// The voxels of a block, by linear index (x * 64 + y * 8 + z).
+using VoxelMask =
+    std::bitset<VoxelBlock<TsdfVoxel>::kVoxelsPerSide *
+                VoxelBlock<TsdfVoxel>::kVoxelsPerSide *
+                VoxelBlock<TsdfVoxel>::kVoxelsPerSide>;
+
+/// The blocks a region overlaps, split into the ones it covers completely and
+/// the ones it covers partially.
+struct RegionBlocks {
+  std::vector<Index3D> full_blocks;
+  std::vector<Index3D> partial_blocks;
+  /// The voxels of the partial blocks within the region.
+  std::vector<VoxelMask> partial_masks;
+};
+
+/// A region of the map, made of the union of axis aligned boxes, oriented
+/// boxes and polygons (in the xy-plane) extruded along z. All of them are in
+/// the global frame. A voxel belongs to the region if its center does.
+class ClearingRegion {
+ public:
+  ClearingRegion() = default;
+
+  void addAABB(const AxisAlignedBoundingBox& aabb);
+  /// @param T_L_B Pose of the box center in the global frame.
+  /// @param size Extent of the box along its axes.
+  void addOrientedBox(const Transform& T_L_B, const Vector3f& size);
+  /// @param polygon Vertices of the polygon (in order). Polygons with fewer
+  /// than 3 vertices are ignored.
+  void addExtrudedPolygon(const std::vector<Vector2f>& polygon, float min_z,
+                          float max_z);
+
+  bool empty() const { return bounding_boxes_.empty(); }
+  bool contains(const Vector3f& position) const;
+
+  /// Whether the box overlaps the bounding box of any volume of the region.
+  bool mayIntersect(const AxisAlignedBoundingBox& aabb) const;
+
+  /// Finds the allocated blocks which the region overlaps. For each volume,
+  /// the blocks of its block index range are queried one by one, or the
+  /// allocated blocks are scanned, whichever is cheaper.
+  /// @param is_allocated Whether a block is allocated.
+  /// @param num_allocated_blocks The number of allocated blocks (an upper
+  /// bound is fine), to choose between querying and scanning.
+  /// @param get_allocated_blocks Lists the allocated blocks. Only called (at
+  /// most once) if a volume is scanned.
+  /// @param block_size The size of a block (in meters).
+  RegionBlocks findBlocks(
+      const std::function<bool(const Index3D&)>& is_allocated,
+      size_t num_allocated_blocks,
+      const std::function<std::vector<Index3D>()>& get_allocated_blocks,
+      float block_size) const;
+
+ private:
+  struct OrientedBox {
+    Transform T_B_L;
+    Vector3f half_size;
+  };
+  struct ExtrudedPolygon {
+    std::vector<Vector2f> polygon;
+    float min_z;
+    float max_z;
+  };
+
+  static bool contains(const OrientedBox& box, const Vector3f& position);
+  static bool contains(const ExtrudedPolygon& polygon,
+                       const Vector3f& position);
+
+  std::vector<AxisAlignedBoundingBox> aabbs_;
+  std::vector<OrientedBox> oriented_boxes_;
+  std::vector<ExtrudedPolygon> polygons_;
+  // Bounding boxes of all volumes above, used to find the blocks.
+  std::vector<AxisAlignedBoundingBox> bounding_boxes_;
+};
+
+/// Resets the voxels of the partially covered blocks to their default
+/// (unobserved) value. The blocks are downloaded, modified on the host and
+/// uploaded again. Unallocated blocks are skipped.
+/// @param region_blocks The blocks and the voxels to reset.
+/// @param layer_ptr The layer to modify.
+template <typename VoxelType>
+void resetVoxels(const RegionBlocks& region_blocks,
+                 VoxelBlockLayer<VoxelType>* layer_ptr);
+
+}  // namespace nvblox
+
+#include "nvblox_ros/impl/region_clearing_impl.hpp"
+
+#endif  // NVBLOX_ROS__REGION_CLEARING_HPP_
@@ -0,0 +1,120 @@
+// SPDX-FileCopyrightText: NVIDIA CORPORATION & AFFILIATES
+// Copyright (c) 2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef NVBLOX_ROS__REPLAY_PIPELINE_HPP_
+#define NVBLOX_ROS__REPLAY_PIPELINE_HPP_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <nvblox_msgs/DistanceMapSlice.h>
+#include <nvblox_msgs/Mesh.h>
+#include <sensor_msgs/CameraInfo.h>
+#include <sensor_msgs/Image.h>
+#include <sensor_msgs/PointCloud2.h>
+
+#include <nvblox/nvblox.h>
+#include <yaml-cpp/yaml.h>
+
+#include "nvblox_ros/conversions/esdf_slice_conversions.hpp"
+#include "nvblox_ros/conversions/pointcloud_conversions.hpp"
+#include "nvblox_ros/latency_statistics.hpp"
+
+namespace nvblox {
+
+/// Settings of the ReplayPipeline, the defaults match the ones of the node.
+struct ReplayPipelineOptions {
+  float voxel_size = 0.05f;
+  ProjectiveLayerType projective_layer_type = ProjectiveLayerType::kTsdf;
+  bool esdf_2d = false;
+  float esdf_2d_min_height = 0.0f;
+  float esdf_2d_max_height = 1.0f;
+  float esdf_slice_height = 1.0f;
+  int lidar_width = 1800;
+  int lidar_height = 16;
+  float lidar_vertical_fov_deg = 30.0f;
+  /// Parameters of the mapper's integrators, in the format of the node's
+  /// parameter files (see loadParameterFile()). Unset ones keep the defaults.
+  YAML::Node mapper_parameters;
+};
+
+/// Runs the processing steps of the NvbloxNode (the conversion and integration
+/// of depth, color and LiDAR, the ESDF and mesh updates, see processing_steps)
+/// without ROS communication, on messages and poses handed in by the caller.
+/// The mapper is initialized like the node's. Each step records its latency in
+/// the statistics, under the same stage names as the node's timers (e.g.
+/// "ros/depth/integrate"). Used to benchmark and to process recorded data
+/// offline. Not thread safe.
+class ReplayPipeline {
+ public:
+  explicit ReplayPipeline(
+      const ReplayPipelineOptions& options = ReplayPipelineOptions());
+  ~ReplayPipeline() = default;
+
+  /// Integrates a depth image.
+  /// @param T_L_C The pose of the camera in the map (layer) frame.
+  /// @return False if the image couldn't be converted.
+  bool processDepthImage(const sensor_msgs::ImageConstPtr& depth_image,
+                         const sensor_msgs::CameraInfo& camera_info,
+                         const Transform& T_L_C);
+
+  /// Integrates a color image.
+  bool processColorImage(const sensor_msgs::ImageConstPtr& color_image,
+                         const sensor_msgs::CameraInfo& camera_info,
+                         const Transform& T_L_C);
+
+  /// Integrates a LiDAR pointcloud.
+  /// @param T_L_C The pose of the LiDAR in the map (layer) frame.
+  /// @return False if the pointcloud doesn't match the LiDAR settings.
+  bool processLidarPointcloud(const sensor_msgs::PointCloud2::ConstPtr& cloud,
+                              const Transform& T_L_C);
+
+  /// Updates the ESDF.
+  /// @param map_slice If not null, set to the slice of the updated ESDF.
+  /// @return The updated blocks.
+  std::vector<Index3D> processEsdf(
+      nvblox_msgs::DistanceMapSlice* map_slice = nullptr);
+
+  /// Updates the mesh.
+  /// @param mesh If not null, set to the updated mesh blocks.
+  /// @return The updated blocks.
+  std::vector<Index3D> processMesh(nvblox_msgs::Mesh* mesh = nullptr);
+
+  Mapper& mapper() { return *mapper_; }
+  const Mapper& mapper() const { return *mapper_; }
+  LatencyStatistics& statistics() { return statistics_; }
+  const LatencyStatistics& statistics() const { return statistics_; }
+  const ReplayPipelineOptions& options() const { return options_; }
+
+ private:
+  const ReplayPipelineOptions options_;
+  std::unique_ptr<Mapper> mapper_;
+  LatencyStatistics statistics_;
+
+  // Buffers reused between the calls.
+  DepthImage depth_image_;
+  ColorImage color_image_;
+  DepthImage pointcloud_image_;
+  Image<float> map_slice_image_;
+  conversions::PointcloudConverter pointcloud_converter_;
+  conversions::EsdfSliceConverter esdf_slice_converter_;
+};
+
+}  // namespace nvblox
+
+#endif  // NVBLOX_ROS__REPLAY_PIPELINE_HPP_
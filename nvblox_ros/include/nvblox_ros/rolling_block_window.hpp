@@ -0,0 +1,87 @@
+// SPDX-FileCopyrightText: NVIDIA CORPORATION & AFFILIATES
+// Copyright (c) 2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef NVBLOX_ROS__ROLLING_BLOCK_WINDOW_HPP_
+#define NVBLOX_ROS__ROLLING_BLOCK_WINDOW_HPP_
+
+#include <cstdint>
+#include <vector>
+
+#include <nvblox/nvblox.h>
+
+namespace nvblox {
+
+/// A cube of blocks which follows a moving position, for local mapping. Every
+/// block of the window owns a slot in a fixed size grid, found by wrapping its
+/// index around the grid (toroidal indexing). When the window moves, the
+/// blocks leaving it are exactly the occupants of the slots the entering
+/// blocks take over, so moving only visits the slabs of slots that change
+/// instead of the whole map. The number of blocks is bounded by the number of
+/// slots.
+class RollingBlockWindow {
+ public:
+  RollingBlockWindow() = default;
+
+  /// Resizes the window, which forgets all blocks.
+  /// @param num_blocks_per_side Side of the window in blocks.
+  void resize(int num_blocks_per_side);
+
+  /// Forgets all blocks and the position of the window.
+  void clear();
+
+  /// Whether the window has been moved to a position yet.
+  bool isPlaced() const { return is_placed_; }
+
+  int num_blocks_per_side() const { return num_blocks_per_side_; }
+  size_t numSlots() const { return slot_blocks_.size(); }
+  size_t numBlocks() const { return num_blocks_; }
+
+  bool contains(const Index3D& block_index) const;
+
+  /// Registers blocks of the map, e.g. newly allocated ones. Blocks outside of
+  /// the window are returned by the next call to moveTo(). Does nothing before
+  /// the window is placed.
+  void insert(const std::vector<Index3D>& block_indices);
+
+  /// Forgets blocks, e.g. because they were removed from the map.
+  void remove(const std::vector<Index3D>& block_indices);
+
+  /// Centers the window on the block containing the position.
+  /// @return The blocks which left the window, and the blocks inserted outside
+  /// of it since the last call. They should be removed from the map.
+  std::vector<Index3D> moveTo(const Vector3f& position, float block_size);
+
+ private:
+  size_t slotIndex(const Index3D& block_index) const;
+  // Empties the slot, adding its block to the output.
+  void evictSlot(size_t slot_index, std::vector<Index3D>* evicted_blocks);
+
+  int num_blocks_per_side_ = 0;
+  bool is_placed_ = false;
+  // Lowest index of the window along every axis.
+  Index3D min_block_index_ = Index3D::Zero();
+
+  std::vector<Index3D> slot_blocks_;
+  std::vector<uint8_t> is_slot_occupied_;
+  size_t num_blocks_ = 0;
+
+  Index3DSet blocks_outside_;
+};
+
+}  // namespace nvblox
+
+#endif  // NVBLOX_ROS__ROLLING_BLOCK_WINDOW_HPP_
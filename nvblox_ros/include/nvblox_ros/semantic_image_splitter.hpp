@@ -0,0 +1,112 @@
+// SPDX-FileCopyrightText: NVIDIA CORPORATION & AFFILIATES
+// Copyright (c) 2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef NVBLOX_ROS__SEMANTIC_IMAGE_SPLITTER_HPP_
+#define NVBLOX_ROS__SEMANTIC_IMAGE_SPLITTER_HPP_
+
+#include <vector>
+
+#include <nvblox/nvblox.h>
+
+namespace nvblox {
+
+/// Inclusive bounding box of pixels.
+struct PixelBoundingBox {
+  int row_min = 0;
+  int row_max = -1;
+  int col_min = 0;
+  int col_max = -1;
+
+  bool empty() const { return row_min > row_max || col_min > col_max; }
+  int rows() const { return empty() ? 0 : row_max - row_min + 1; }
+  int cols() const { return empty() ? 0 : col_max - col_min + 1; }
+};
+
+/// Splits a depth image into one depth image per semantic class, plus one for
+/// the pixels that belong to no class. A first pass over the label image
+/// counts and bounds the pixels of each class, a second one writes the classes
+/// that are in the image, within their bounding boxes only. The label image has
+/// to be registered to the depth image (same size).
+class SemanticImageSplitter {
+ public:
+  /// The maximum number of classes.
+  static constexpr int kMaxNumClasses = 32;
+
+  SemanticImageSplitter();
+  ~SemanticImageSplitter();
+
+  /// Sets which label values make up which class.
+  /// @param class_label_ids For every class, the label values (0-255) that
+  /// belong to it. Label values which appear in no class are unmasked.
+  void setClassLabelIds(const std::vector<std::vector<int>>& class_label_ids);
+
+  int num_classes() const { return num_classes_; }
+
+  /// Split the depth image.
+  /// @param depth_image Input depth image.
+  /// @param label_image Label image, same size as the depth image.
+  /// @param unmasked_invalid_depth Depth written to the unmasked output for
+  /// pixels belonging to any class.
+  /// @param class_invalid_depths Per class, the depth written to the class'
+  /// output for pixels not belonging to the class.
+  /// @param unmasked_depth_output Depth of the pixels of no class.
+  /// @param class_depth_outputs Per class with pixels, the depth of its pixels
+  /// within its bounding box. The outputs of the other classes are left as
+  /// they are.
+  /// @param class_pixel_counts Per class, the number of its pixels with valid
+  /// depth.
+  /// @param class_bounding_boxes Per class, the bounding box of its pixels
+  /// with valid depth. Empty if there are none.
+  /// @return false if the images don't match.
+  bool splitImageOnGPU(const DepthImage& depth_image,
+                       const MonoImage& label_image,
+                       float unmasked_invalid_depth,
+                       const std::vector<float>& class_invalid_depths,
+                       DepthImage* unmasked_depth_output,
+                       std::vector<DepthImage>* class_depth_outputs,
+                       std::vector<int>* class_pixel_counts,
+                       std::vector<PixelBoundingBox>* class_bounding_boxes);
+
+  /// Makes an image of the given size where all pixels are invalid_depth.
+  void fillImageOnGPU(int rows, int cols, float invalid_depth,
+                      DepthImage* image);
+
+  /// The camera seeing the part of the camera's image within the bounding box.
+  static Camera cropCamera(const Camera& camera,
+                           const PixelBoundingBox& bounding_box);
+
+ private:
+  static constexpr int kNumLabelValues = 256;
+
+  int num_classes_ = 0;
+
+  cudaStream_t cuda_stream_ = nullptr;
+
+  // Buffers
+  device_vector<int> label_to_class_device_;
+  device_vector<float*> class_depth_outputs_device_;
+  device_vector<float> class_invalid_depths_device_;
+  device_vector<int> class_pixel_counts_device_;
+  // Per class: row_min, row_max, col_min and col_max.
+  device_vector<int> class_bounding_boxes_device_;
+  // The classes written in the second pass.
+  device_vector<int> written_class_indices_device_;
+};
+
+}  // namespace nvblox
+
+#endif  // NVBLOX_ROS__SEMANTIC_IMAGE_SPLITTER_HPP_
@@ -0,0 +1,58 @@
+// SPDX-FileCopyrightText: NVIDIA CORPORATION & AFFILIATES
+// Copyright (c) 2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef NVBLOX_ROS__STAGE_TIMER_HPP_
+#define NVBLOX_ROS__STAGE_TIMER_HPP_
+
+#include <string>
+
+#include <nvblox/utils/timing.h>
+
+#include "nvblox_ros/latency_statistics.hpp"
+#include "nvblox_ros/trace_recorder.hpp"
+
+namespace nvblox {
+
+/// Drop-in replacement of timing::Timer which additionally adds its latency
+/// to a LatencyStatistics, such that the percentiles of the stage are known,
+/// and records it as a stage of the current frame if tracing is enabled (see
+/// TraceRecorder). Stops on destruction if it wasn't stopped before.
+class StageTimer {
+ public:
+  /// @param tag Name of the timer and the stage.
+  /// @param statistics The statistics the latency is added to. Not owned.
+  StageTimer(const std::string& tag, LatencyStatistics* statistics);
+  ~StageTimer();
+
+  StageTimer(const StageTimer&) = delete;
+  StageTimer& operator=(const StageTimer&) = delete;
+
+  void Stop();
+
+ private:
+  timing::Timer timer_;
+  LatencyStatistics* statistics_;
+  const std::string tag_;
+  const TraceRecorder::Clock::time_point start_;
+  // Whether tracing was enabled when the timer started.
+  const bool is_traced_;
+  bool is_running_ = true;
+};
+
+}  // namespace nvblox
+
+#endif  // NVBLOX_ROS__STAGE_TIMER_HPP_
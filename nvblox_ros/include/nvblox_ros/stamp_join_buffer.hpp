@@ -0,0 +1,109 @@
+// SPDX-FileCopyrightText: NVIDIA CORPORATION & AFFILIATES
+// Copyright (c) 2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef NVBLOX_ROS__STAMP_JOIN_BUFFER_HPP_
+#define NVBLOX_ROS__STAMP_JOIN_BUFFER_HPP_
+
+#include <deque>
+#include <functional>
+#include <mutex>
+
+#include <ros/time.h>
+
+namespace nvblox {
+
+/// Joins two streams of timestamped items (for example images and their
+/// segmentation masks). Every item is joined at most once, with the pending
+/// item of the other stream that is closest in time, provided the stamps
+/// differ by no more than the tolerance. Items that can no longer be joined
+/// are dropped and counted as misses. We assume the stamps within each stream
+/// are (roughly) increasing, which allows us to drop items early and keep the
+/// memory bounded.
+/// @tparam FirstType Type of the items in the first stream.
+/// @tparam SecondType Type of the items in the second stream.
+template <typename FirstType, typename SecondType>
+class StampJoinBuffer {
+ public:
+  /// Called (outside of the buffer's lock) for every joined pair.
+  using JoinCallback =
+      std::function<void(const FirstType& first, const SecondType& second)>;
+
+  struct Statistics {
+    size_t num_joined = 0;
+    size_t num_first_missed = 0;
+    size_t num_second_missed = 0;
+    /// Time the earlier item of a pair waited for its partner (wall time).
+    double mean_join_latency_s = 0.0;
+    double max_join_latency_s = 0.0;
+  };
+
+  /// @param tolerance Maximum stamp difference of a joined pair.
+  /// @param max_pending Maximum number of unjoined items kept per stream.
+  /// @param callback Called for each joined pair.
+  StampJoinBuffer(const ros::Duration& tolerance, size_t max_pending,
+                  JoinCallback callback);
+  ~StampJoinBuffer() = default;
+
+  /// Add an item to the first stream. Calls the callback if it could be
+  /// joined.
+  void addFirst(const ros::Time& stamp, const FirstType& item);
+
+  /// Add an item to the second stream. Calls the callback if it could be
+  /// joined.
+  void addSecond(const ros::Time& stamp, const SecondType& item);
+
+  /// Statistics accumulated since construction.
+  Statistics statistics() const;
+
+  size_t numPendingFirst() const;
+  size_t numPendingSecond() const;
+
+ private:
+  template <typename ItemType>
+  struct PendingItem {
+    ros::Time stamp;
+    ros::WallTime arrival_time;
+    ItemType item;
+  };
+
+  // Either joins the item with a pending item of the other stream (returned in
+  // match), or stores it. Expects the mutex to be held.
+  template <typename ItemType, typename OtherType>
+  bool joinOrInsert(const ros::Time& stamp, const ItemType& item,
+                    std::deque<PendingItem<ItemType>>* pending,
+                    std::deque<PendingItem<OtherType>>* other_pending,
+                    size_t* num_missed, size_t* num_other_missed,
+                    OtherType* match);
+
+  const ros::Duration tolerance_;
+  const size_t max_pending_;
+  JoinCallback callback_;
+
+  std::deque<PendingItem<FirstType>> first_pending_;
+  std::deque<PendingItem<SecondType>> second_pending_;
+
+  Statistics statistics_;
+  double total_join_latency_s_ = 0.0;
+
+  mutable std::mutex mutex_;
+};
+
+}  // namespace nvblox
+
+#include "nvblox_ros/impl/stamp_join_buffer_impl.hpp"
+
+#endif  // NVBLOX_ROS__STAMP_JOIN_BUFFER_HPP_
@@ -0,0 +1,117 @@
+// SPDX-FileCopyrightText: NVIDIA CORPORATION & AFFILIATES
+// Copyright (c) 2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef NVBLOX_ROS__TIMING_METRICS_HPP_
+#define NVBLOX_ROS__TIMING_METRICS_HPP_
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <diagnostic_msgs/DiagnosticArray.h>
+#include <ros/publisher.h>
+#include <ros/time.h>
+
+#include "nvblox_ros/latency_statistics.hpp"
+
+namespace nvblox {
+
+/// The statistics of a timer (see timing::Timing), or of a stage which isn't
+/// timed, like the latency of an output.
+struct TimerMetrics {
+  std::string name;
+  size_t count = 0;
+  double total_s = 0.0;
+  double mean_s = 0.0;
+  double min_s = 0.0;
+  double max_s = 0.0;
+  /// Only known for timers.
+  double rate_hz = 0.0;
+  /// Percentiles over the recent samples. Only known for the timers which
+  /// record their samples, see StageTimer.
+  bool has_percentiles = false;
+  double p50_s = 0.0;
+  double p95_s = 0.0;
+  double p99_s = 0.0;
+};
+
+/// Takes a snapshot of all the nvblox timers, with the percentiles of the
+/// stages of the statistics, and of the stages without timers. Cheap, but has
+/// to be called from the thread running the timers (see timing::Timing), as
+/// it isn't thread safe.
+std::vector<TimerMetrics> collectTimerMetrics(
+    const LatencyStatistics& stage_statistics);
+
+/// One status per timer, with the values in milliseconds.
+/// @param name_prefix Prefix of the status names, e.g. the node name.
+void diagnosticArrayFromTimerMetrics(
+    const std::vector<TimerMetrics>& metrics, const std::string& name_prefix,
+    const ros::Time& stamp, diagnostic_msgs::DiagnosticArray* diagnostics_msg);
+
+/// Writes the metrics in the Prometheus text exposition format, with the
+/// timer names as "timer" labels.
+void writePrometheusText(const std::vector<TimerMetrics>& metrics,
+                         std::ostream& out);
+
+/// Exports timer metrics without costing time on the processing thread:
+/// Converting them to a diagnostic_msgs/DiagnosticArray, publishing it, and
+/// (optionally) writing them to a Prometheus text file happens on a
+/// background thread. The file is replaced atomically, such that it can be
+/// picked up by the textfile collector of the Prometheus node exporter.
+class TimingMetricsExporter {
+ public:
+  /// @param publisher Publisher of diagnostic_msgs/DiagnosticArray.
+  /// @param name_prefix Prefix of the diagnostic status names.
+  /// @param prometheus_file The file the metrics are written to. Not written
+  /// if empty.
+  TimingMetricsExporter(const ros::Publisher& publisher,
+                        const std::string& name_prefix,
+                        const std::string& prometheus_file);
+  ~TimingMetricsExporter();
+
+  TimingMetricsExporter(const TimingMetricsExporter&) = delete;
+  TimingMetricsExporter& operator=(const TimingMetricsExporter&) = delete;
+
+  /// Hands metrics over to the background thread. Replaces the metrics which
+  /// weren't exported yet, so it never blocks on the export.
+  void push(std::vector<TimerMetrics>&& metrics, const ros::Time& stamp);
+
+ private:
+  // Background thread.
+  void exportLoop();
+  void writePrometheusFile(const std::vector<TimerMetrics>& metrics) const;
+
+  ros::Publisher publisher_;
+  const std::string name_prefix_;
+  const std::string prometheus_file_;
+
+  std::vector<TimerMetrics> pending_metrics_;
+  ros::Time pending_stamp_;
+  bool has_pending_metrics_ = false;
+  bool stop_ = false;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  std::thread export_thread_;
+};
+
+}  // namespace nvblox
+
+#endif  // NVBLOX_ROS__TIMING_METRICS_HPP_
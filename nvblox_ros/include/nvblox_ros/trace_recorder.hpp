@@ -0,0 +1,114 @@
+// SPDX-FileCopyrightText: NVIDIA CORPORATION & AFFILIATES
+// Copyright (c) 2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef NVBLOX_ROS__TRACE_RECORDER_HPP_
+#define NVBLOX_ROS__TRACE_RECORDER_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <ros/time.h>
+
+namespace nvblox {
+
+/// Records the stages of every frame as events into a ring buffer, which can
+/// be written in the Chrome trace event format (viewable in chrome://tracing
+/// and Perfetto). Each event carries the stamp of the frame it belongs to and
+/// the id of the thread it ran on. Process wide, like the nvblox timers, and
+/// disabled by default: Then recording an event costs an atomic load.
+/// Thread safe.
+class TraceRecorder {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  static TraceRecorder& instance();
+
+  /// Starts recording into a ring buffer of the given number of events.
+  /// Clears the events recorded so far.
+  void enable(size_t capacity);
+  void disable();
+  bool isEnabled() const { return is_enabled_.load(std::memory_order_relaxed); }
+
+  /// Records a stage which ran from begin to end. No-op if disabled.
+  void recordStage(const std::string& name, const Clock::time_point& begin,
+                   const Clock::time_point& end, const ros::Time& frame_stamp);
+  /// Records something happening at a point in time, e.g. a message being
+  /// received. No-op if disabled.
+  void recordInstant(const std::string& name, const ros::Time& frame_stamp);
+
+  /// Writes the recorded events, oldest first, as Chrome trace JSON.
+  /// @return The number of events written.
+  size_t writeChromeTrace(std::ostream& out) const;
+
+  /// The number of recorded events in the ring buffer.
+  size_t size() const;
+  void clear();
+
+  /// The stamp of the frame the calling thread is processing, see TraceFrame.
+  static ros::Time currentFrameStamp();
+
+ private:
+  friend class TraceFrame;
+
+  struct Event {
+    std::string name;
+    // 'X' (complete) or 'i' (instant), see the trace event format.
+    char phase = 'X';
+    int64_t begin_ns = 0;
+    int64_t duration_ns = 0;
+    uint32_t thread_id = 0;
+    ros::Time frame_stamp;
+  };
+
+  TraceRecorder() = default;
+
+  void record(const std::string& name, char phase,
+              const Clock::time_point& begin, const Clock::time_point& end,
+              const ros::Time& frame_stamp);
+
+  static ros::Time& threadFrameStamp();
+
+  std::atomic<bool> is_enabled_{false};
+  // Ring buffer, the oldest event is at next_event_ once it's full.
+  std::vector<Event> events_;
+  size_t next_event_ = 0;
+  size_t num_events_ = 0;
+  mutable std::mutex mutex_;
+};
+
+/// Sets the stamp of the frame the calling thread is processing for the
+/// lifetime of the object. Events recorded in the meantime carry it.
+class TraceFrame {
+ public:
+  explicit TraceFrame(const ros::Time& frame_stamp);
+  ~TraceFrame();
+
+  TraceFrame(const TraceFrame&) = delete;
+  TraceFrame& operator=(const TraceFrame&) = delete;
+
+ private:
+  const ros::Time previous_frame_stamp_;
+};
+
+}  // namespace nvblox
+
+#endif  // NVBLOX_ROS__TRACE_RECORDER_HPP_
@@ -67,6 +67,9 @@ class Transformer {
     pose_frame_ = pose_frame;
   }
 
+  static Transform poseToEigen(const geometry_msgs::Pose& pose);
+  static Transform transformToEigen(const geometry_msgs::Transform& transform);
+
  private:
   bool lookupTransformTf(const std::string& from_frame,
                          const std::string& to_frame,
@@ -77,9 +80,6 @@ class Transformer {
   bool lookupSensorTransform(const std::string& sensor_frame,
                              Transform* transform);
 
-  Transform transformToEigen(const geometry_msgs::Transform& transform) const;
-  Transform poseToEigen(const geometry_msgs::Pose& pose) const;
-
   /// ROS State
   ros::NodeHandle nh_;
   std::shared_ptr<tf2_ros::TransformListener> transform_listener_;
@@ -0,0 +1,277 @@
+// SPDX-FileCopyrightText: NVIDIA CORPORATION & AFFILIATES
+// Copyright (c) 2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <glog/logging.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <ros/console.h>
+#include <rosbag/view.h>
+#include <sensor_msgs/Image.h>
+#include <sensor_msgs/PointCloud2.h>
+#include <tf2/exceptions.h>
+#include <tf2_msgs/TFMessage.h>
+
+#include "nvblox_ros/bag_processor.hpp"
+#include "nvblox_ros/transformer.hpp"
+
+namespace nvblox {
+
+BagProcessor::BagProcessor(const BagProcessorOptions& options)
+    : options_(options), pipeline_(options.pipeline) {}
+
+bool BagProcessor::process(const std::vector<std::string>& bag_paths) {
+  std::vector<std::unique_ptr<rosbag::Bag>> bags;
+  std::vector<const rosbag::Bag*> bag_ptrs;
+  for (const std::string& path : bag_paths) {
+    bags.push_back(std::make_unique<rosbag::Bag>());
+    try {
+      bags.back()->open(path, rosbag::bagmode::Read);
+    } catch (const rosbag::BagException& e) {
+      ROS_ERROR_STREAM("Couldn't open the bag " << path << ": " << e.what());
+      return false;
+    }
+    bag_ptrs.push_back(bags.back().get());
+  }
+
+  const size_t num_transforms = loadTransforms(bag_ptrs);
+  ROS_INFO_STREAM("Loaded " << num_transforms << " transforms.");
+
+  std::vector<std::string> topics;
+  for (const std::string& topic :
+       {options_.depth_image_topic, options_.depth_camera_info_topic,
+        options_.color_image_topic, options_.color_camera_info_topic,
+        options_.pointcloud_topic}) {
+    if (!topic.empty()) {
+      topics.push_back(topic);
+    }
+  }
+  rosbag::View view;
+  for (const rosbag::Bag* bag : bag_ptrs) {
+    view.addQuery(*bag, rosbag::TopicQuery(topics));
+  }
+  if (view.size() == 0) {
+    ROS_WARN("None of the sensor topics are in the bags.");
+    return true;
+  }
+  bag_duration_s_ = (view.getEndTime() - view.getBeginTime()).toSec();
+
+  const auto start = std::chrono::steady_clock::now();
+  for (const rosbag::MessageInstance& message : view) {
+    const std::string& topic = message.getTopic();
+    if (topic == options_.depth_camera_info_topic ||
+        topic == options_.color_camera_info_topic) {
+      const sensor_msgs::CameraInfo::ConstPtr camera_info =
+          message.instantiate<sensor_msgs::CameraInfo>();
+      if (camera_info) {
+        camera_infos_[topic] = camera_info;
+      }
+    } else if (topic == options_.depth_image_topic ||
+               topic == options_.color_image_topic) {
+      const sensor_msgs::ImageConstPtr image =
+          message.instantiate<sensor_msgs::Image>();
+      if (!image) {
+        continue;
+      }
+      const bool is_depth = topic == options_.depth_image_topic;
+      const auto camera_info_it =
+          camera_infos_.find(is_depth ? options_.depth_camera_info_topic
+                                      : options_.color_camera_info_topic);
+      if (camera_info_it == camera_infos_.end()) {
+        counts_.skipped_no_camera_info++;
+        continue;
+      }
+      Transform T_L_C;
+      if (!lookupTransform(image->header.frame_id, image->header.stamp,
+                           &T_L_C)) {
+        counts_.skipped_no_transform++;
+        continue;
+      }
+      if (is_depth) {
+        if (pipeline_.processDepthImage(image, *camera_info_it->second,
+                                        T_L_C)) {
+          counts_.depth_images++;
+        } else {
+          counts_.failed++;
+        }
+      } else {
+        if (pipeline_.processColorImage(image, *camera_info_it->second,
+                                        T_L_C)) {
+          counts_.color_images++;
+        } else {
+          counts_.failed++;
+        }
+      }
+    } else if (topic == options_.pointcloud_topic) {
+      const sensor_msgs::PointCloud2::ConstPtr cloud =
+          message.instantiate<sensor_msgs::PointCloud2>();
+      if (!cloud) {
+        continue;
+      }
+      Transform T_L_C;
+      if (!lookupTransform(cloud->header.frame_id, cloud->header.stamp,
+                           &T_L_C)) {
+        counts_.skipped_no_transform++;
+        continue;
+      }
+      if (pipeline_.processLidarPointcloud(cloud, T_L_C)) {
+        counts_.pointclouds++;
+      } else {
+        counts_.failed++;
+      }
+    }
+    updateOutputs(message.getTime());
+  }
+
+  // Bring the outputs up to date with everything that was integrated.
+  pipeline_.processEsdf();
+  counts_.esdf_updates++;
+  if (computesMesh()) {
+    pipeline_.processMesh();
+    counts_.mesh_updates++;
+  }
+
+  const std::chrono::duration<double> processing_time =
+      std::chrono::steady_clock::now() - start;
+  processing_time_s_ = processing_time.count();
+  return true;
+}
+
+size_t BagProcessor::loadTransforms(
+    const std::vector<const rosbag::Bag*>& bags) {
+  rosbag::View view;
+  for (const rosbag::Bag* bag : bags) {
+    view.addQuery(*bag, rosbag::TopicQuery(std::vector<std::string>{
+                            options_.tf_topic, options_.tf_static_topic}));
+  }
+  // Keep all of them, such that every message can be looked up regardless of
+  // the order in which the transforms were recorded.
+  ros::Duration cache_time(1.0);
+  if (view.size() > 0) {
+    cache_time += view.getEndTime() - view.getBeginTime();
+  }
+  tf_buffer_ = std::make_unique<tf2::BufferCore>(cache_time);
+
+  size_t num_transforms = 0;
+  for (const rosbag::MessageInstance& message : view) {
+    const tf2_msgs::TFMessage::ConstPtr tf_msg =
+        message.instantiate<tf2_msgs::TFMessage>();
+    if (!tf_msg) {
+      continue;
+    }
+    const bool is_static = message.getTopic() == options_.tf_static_topic;
+    for (const geometry_msgs::TransformStamped& transform :
+         tf_msg->transforms) {
+      if (tf_buffer_->setTransform(transform, "bag", is_static)) {
+        num_transforms++;
+      }
+    }
+  }
+  return num_transforms;
+}
+
+bool BagProcessor::lookupTransform(const std::string& frame_id,
+                                   const ros::Time& stamp, Transform* T_L_S) {
+  CHECK_NOTNULL(T_L_S);
+  try {
+    const geometry_msgs::TransformStamped T_L_S_msg =
+        tf_buffer_->lookupTransform(options_.global_frame, frame_id, stamp);
+    *T_L_S = Transformer::transformToEigen(T_L_S_msg.transform);
+  } catch (const tf2::TransformException& e) {
+    ROS_DEBUG_STREAM("Cant transform: from: " << options_.global_frame
+                                              << " to " << frame_id
+                                              << ". Error: " << e.what());
+    return false;
+  }
+  return true;
+}
+
+void BagProcessor::updateOutputs(const ros::Time& stamp) {
+  // The first update is one period after the first message.
+  if (options_.esdf_update_rate_hz > 0.0f) {
+    const ros::Duration esdf_period(1.0 / options_.esdf_update_rate_hz);
+    if (next_esdf_update_.isZero()) {
+      next_esdf_update_ = stamp + esdf_period;
+    } else if (stamp >= next_esdf_update_) {
+      pipeline_.processEsdf();
+      counts_.esdf_updates++;
+      next_esdf_update_ = stamp + esdf_period;
+    }
+  }
+  if (computesMesh() && options_.mesh_update_rate_hz > 0.0f) {
+    const ros::Duration mesh_period(1.0 / options_.mesh_update_rate_hz);
+    if (next_mesh_update_.isZero()) {
+      next_mesh_update_ = stamp + mesh_period;
+    } else if (stamp >= next_mesh_update_) {
+      pipeline_.processMesh();
+      counts_.mesh_updates++;
+      next_mesh_update_ = stamp + mesh_period;
+    }
+  }
+}
+
+bool BagProcessor::computesMesh() const {
+  // Only TSDF maps are meshed.
+  return options_.pipeline.projective_layer_type == ProjectiveLayerType::kTsdf;
+}
+
+void BagProcessor::writeReport(std::ostream& out) const {
+  const Mapper& mapper = pipeline_.mapper();
+  const size_t num_frames =
+      counts_.depth_images + counts_.color_images + counts_.pointclouds;
+  out << "{\n"
+      << "\"options\": {"
+      << "\"global_frame\": \"" << options_.global_frame << "\""
+      << ", \"projective_layer\": \""
+      << (computesMesh() ? "tsdf" : "occupancy") << "\""
+      << ", \"voxel_size\": " << options_.pipeline.voxel_size
+      << ", \"esdf_2d\": " << (options_.pipeline.esdf_2d ? "true" : "false")
+      << ", \"esdf_update_rate_hz\": " << options_.esdf_update_rate_hz
+      << ", \"mesh_update_rate_hz\": " << options_.mesh_update_rate_hz
+      << "},\n"
+      << "\"counts\": {"
+      << "\"depth_images\": " << counts_.depth_images
+      << ", \"color_images\": " << counts_.color_images
+      << ", \"pointclouds\": " << counts_.pointclouds
+      << ", \"esdf_updates\": " << counts_.esdf_updates
+      << ", \"mesh_updates\": " << counts_.mesh_updates
+      << ", \"skipped_no_transform\": " << counts_.skipped_no_transform
+      << ", \"skipped_no_camera_info\": " << counts_.skipped_no_camera_info
+      << ", \"failed\": " << counts_.failed << "},\n"
+      << "\"bag_duration_s\": " << bag_duration_s_ << ",\n"
+      << "\"processing_time_s\": " << processing_time_s_ << ",\n"
+      << "\"frames_per_s\": "
+      << (processing_time_s_ > 0.0 ? num_frames / processing_time_s_ : 0.0)
+      << ",\n"
+      << "\"real_time_factor\": "
+      << (processing_time_s_ > 0.0 ? bag_duration_s_ / processing_time_s_
+                                   : 0.0)
+      << ",\n"
+      << "\"num_blocks\": {"
+      << "\"tsdf\": " << mapper.tsdf_layer().numAllocatedBlocks()
+      << ", \"occupancy\": " << mapper.occupancy_layer().numAllocatedBlocks()
+      << ", \"color\": " << mapper.color_layer().numAllocatedBlocks()
+      << ", \"esdf\": " << mapper.esdf_layer().numAllocatedBlocks()
+      << ", \"mesh\": " << mapper.mesh_layer().numAllocatedBlocks() << "},\n"
+      << "\"stages\": ";
+  pipeline_.statistics().writeJson(out);
+  out << "\n}\n";
+}
+
+}  // namespace nvblox
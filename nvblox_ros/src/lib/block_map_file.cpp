@@ -0,0 +1,845 @@
+// SPDX-FileCopyrightText: NVIDIA CORPORATION & AFFILIATES
+// Copyright (c) 2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <lz4.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <ros/console.h>
+
+#include "nvblox_ros/block_map_file.hpp"
+
+namespace nvblox {
+namespace {
+
+constexpr char kBlockMapFileMagic[4] = {'N', 'V', 'B', 'M'};
+constexpr uint32_t kBlockMapFileVersion = 2;
+// Oldest version which can still be read.
+constexpr uint32_t kBlockMapFileMinVersion = 1;
+
+// Blocks are downloaded, encoded and written in chunks of this many blocks,
+// which bounds the host memory used while writing.
+constexpr size_t kWriteChunkNumBlocks = 4096;
+
+// Orders block indices the way they're stored in the index.
+bool indexLess(int32_t x1, int32_t y1, int32_t z1, int32_t x2, int32_t y2,
+               int32_t z2) {
+  if (x1 != x2) {
+    return x1 < x2;
+  }
+  if (y1 != y2) {
+    return y1 < y2;
+  }
+  return z1 < z2;
+}
+
+// Reads the layer headers of a file of the given version, converting older
+// versions to the current layout. Returns false if the file is too short.
+bool readLayerHeaders(const uint8_t* data, size_t size, uint32_t version,
+                      uint32_t num_layers,
+                      std::vector<BlockMapLayerHeader>* layer_headers) {
+  const size_t layer_header_num_bytes = version == 1
+                                            ? sizeof(BlockMapLayerHeaderV1)
+                                            : sizeof(BlockMapLayerHeader);
+  if (sizeof(BlockMapFileHeader) +
+          static_cast<size_t>(num_layers) * layer_header_num_bytes >
+      size) {
+    return false;
+  }
+  const uint8_t* layer_header_data = data + sizeof(BlockMapFileHeader);
+  layer_headers->resize(num_layers);
+  for (uint32_t i = 0; i < num_layers; i++) {
+    BlockMapLayerHeader& layer_header = (*layer_headers)[i];
+    if (version == 1) {
+      BlockMapLayerHeaderV1 layer_header_v1;
+      std::memcpy(&layer_header_v1,
+                  layer_header_data + i * layer_header_num_bytes,
+                  sizeof(layer_header_v1));
+      layer_header.layer_type = layer_header_v1.layer_type;
+      layer_header.block_num_bytes = layer_header_v1.block_num_bytes;
+      layer_header.compression =
+          static_cast<uint32_t>(BlockMapCompression::kNone);
+      layer_header.encoding = static_cast<uint32_t>(BlockMapEncoding::kRaw);
+      layer_header.num_blocks = layer_header_v1.num_blocks;
+      layer_header.index_offset = layer_header_v1.index_offset;
+    } else {
+      std::memcpy(&layer_header,
+                  layer_header_data + i * layer_header_num_bytes,
+                  sizeof(layer_header));
+    }
+  }
+  return true;
+}
+
+// Block index of a position, clamped such that infinite AABBs work.
+Index3D clampedBlockIndex(const Vector3f& position, float block_size) {
+  Index3D block_index;
+  for (int i = 0; i < 3; i++) {
+    const double index = std::floor(static_cast<double>(position[i]) /
+                                    static_cast<double>(block_size));
+    block_index[i] = static_cast<int>(std::min<double>(
+        std::max<double>(index, std::numeric_limits<int>::min()),
+        std::numeric_limits<int>::max()));
+  }
+  return block_index;
+}
+
+// Calls function(i) for all i in [0, num_items), spread over num_threads
+// threads (one per core if <= 0).
+void parallelFor(size_t num_items, int num_threads,
+                 const std::function<void(size_t)>& function) {
+  // Not worth spawning threads for a few blocks.
+  constexpr size_t kMinItemsPerThread = 64;
+  constexpr size_t kBatchSize = 16;
+  if (num_threads <= 0) {
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  const size_t num_used_threads = std::min<size_t>(
+      num_threads, (num_items + kMinItemsPerThread - 1) / kMinItemsPerThread);
+  if (num_used_threads <= 1) {
+    for (size_t i = 0; i < num_items; i++) {
+      function(i);
+    }
+    return;
+  }
+  std::atomic<size_t> next_item(0);
+  const auto work = [&]() {
+    size_t begin;
+    while ((begin = next_item.fetch_add(kBatchSize)) < num_items) {
+      const size_t end = std::min(begin + kBatchSize, num_items);
+      for (size_t i = begin; i < end; i++) {
+        function(i);
+      }
+    }
+  };
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < num_used_threads; i++) {
+    threads.emplace_back(work);
+  }
+  work();
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+}
+
+size_t encodedNumBytes(BlockMapEncoding encoding, size_t block_num_bytes) {
+  if (encoding == BlockMapEncoding::kQuantizedTsdf) {
+    return block_num_bytes / sizeof(TsdfVoxel) * sizeof(QuantizedTsdfVoxel);
+  }
+  return block_num_bytes;
+}
+
+void quantizeTsdfVoxels(const TsdfVoxel* voxels, size_t num_voxels,
+                        float voxel_size, QuantizedTsdfVoxel* quantized) {
+  const float distance_scale =
+      QuantizedTsdfVoxel::kDistanceStepsPerVoxel / voxel_size;
+  for (size_t i = 0; i < num_voxels; i++) {
+    quantized[i].distance = static_cast<int16_t>(
+        std::min(std::max(std::round(voxels[i].distance * distance_scale),
+                          static_cast<float>(INT16_MIN)),
+                 static_cast<float>(INT16_MAX)));
+    quantized[i].weight = static_cast<uint16_t>(std::min(
+        std::max(std::round(voxels[i].weight *
+                            QuantizedTsdfVoxel::kWeightStepsPerUnit),
+                 0.0f),
+        static_cast<float>(UINT16_MAX)));
+  }
+}
+
+void dequantizeTsdfVoxels(const QuantizedTsdfVoxel* quantized,
+                          size_t num_voxels, float voxel_size,
+                          TsdfVoxel* voxels) {
+  const float distance_step =
+      voxel_size / QuantizedTsdfVoxel::kDistanceStepsPerVoxel;
+  for (size_t i = 0; i < num_voxels; i++) {
+    voxels[i].distance = quantized[i].distance * distance_step;
+    voxels[i].weight =
+        quantized[i].weight / QuantizedTsdfVoxel::kWeightStepsPerUnit;
+  }
+}
+
+// Encodes and compresses a block.
+bool encodeBlock(const uint8_t* block, size_t block_num_bytes,
+                 BlockMapEncoding encoding, BlockMapCompression compression,
+                 float voxel_size, std::vector<uint8_t>* stored_block) {
+  const uint8_t* encoded = block;
+  const size_t encoded_num_bytes = encodedNumBytes(encoding, block_num_bytes);
+  std::vector<uint8_t> encoded_buffer;
+  if (encoding == BlockMapEncoding::kQuantizedTsdf) {
+    encoded_buffer.resize(encoded_num_bytes);
+    quantizeTsdfVoxels(
+        reinterpret_cast<const TsdfVoxel*>(block),
+        block_num_bytes / sizeof(TsdfVoxel), voxel_size,
+        reinterpret_cast<QuantizedTsdfVoxel*>(encoded_buffer.data()));
+    encoded = encoded_buffer.data();
+  }
+
+  if (compression == BlockMapCompression::kNone) {
+    stored_block->assign(encoded, encoded + encoded_num_bytes);
+    return true;
+  }
+  stored_block->resize(LZ4_compressBound(encoded_num_bytes));
+  const int compressed_num_bytes = LZ4_compress_default(
+      reinterpret_cast<const char*>(encoded),
+      reinterpret_cast<char*>(stored_block->data()), encoded_num_bytes,
+      stored_block->size());
+  if (compressed_num_bytes <= 0) {
+    return false;
+  }
+  stored_block->resize(compressed_num_bytes);
+  return true;
+}
+
+// Decompresses and decodes a block. Returns false if the stored block is
+// corrupt.
+bool decodeBlock(const uint8_t* stored_block, size_t stored_num_bytes,
+                 BlockMapEncoding encoding, BlockMapCompression compression,
+                 float voxel_size, size_t block_num_bytes, uint8_t* block) {
+  const size_t encoded_num_bytes = encodedNumBytes(encoding, block_num_bytes);
+  std::vector<uint8_t> encoded_buffer;
+  uint8_t* encoded = block;
+  if (encoding == BlockMapEncoding::kQuantizedTsdf) {
+    encoded_buffer.resize(encoded_num_bytes);
+    encoded = encoded_buffer.data();
+  }
+
+  if (compression == BlockMapCompression::kNone) {
+    if (stored_num_bytes != encoded_num_bytes) {
+      return false;
+    }
+    std::memcpy(encoded, stored_block, encoded_num_bytes);
+  } else if (LZ4_decompress_safe(reinterpret_cast<const char*>(stored_block),
+                                 reinterpret_cast<char*>(encoded),
+                                 stored_num_bytes, encoded_num_bytes) !=
+             static_cast<int>(encoded_num_bytes)) {
+    return false;
+  }
+
+  if (encoding == BlockMapEncoding::kQuantizedTsdf) {
+    dequantizeTsdfVoxels(
+        reinterpret_cast<const QuantizedTsdfVoxel*>(encoded),
+        block_num_bytes / sizeof(TsdfVoxel), voxel_size,
+        reinterpret_cast<TsdfVoxel*>(block));
+  }
+  return true;
+}
+
+void writePadding(std::ofstream* out_ptr) {
+  constexpr uint64_t kAlignment = 8;
+  const uint64_t position = static_cast<uint64_t>(out_ptr->tellp());
+  const uint64_t num_padding_bytes =
+      (kAlignment - position % kAlignment) % kAlignment;
+  const char zeros[kAlignment] = {0};
+  out_ptr->write(zeros, num_padding_bytes);
+}
+
+// Writes the blocks of the layer followed by its index, and fills in the
+// layer header. The blocks of the previous entries which aren't allocated in
+// the layer are taken from the previous file.
+template <typename VoxelType>
+bool writeLayer(const VoxelBlockLayer<VoxelType>& layer,
+                BlockMapLayerType layer_type,
+                const BlockMapFileOptions& options, float voxel_size,
+                const std::vector<const BlockMapIndexEntry*>& previous_entries,
+                const BlockMapFile* previous_file, std::ofstream* out_ptr,
+                BlockMapLayerHeader* layer_header_ptr,
+                BlockMapFileStatistics* statistics) {
+  using BlockType = VoxelBlock<VoxelType>;
+  const BlockMapEncoding encoding =
+      (options.quantize_tsdf && layer_type == BlockMapLayerType::kTsdf)
+          ? BlockMapEncoding::kQuantizedTsdf
+          : BlockMapEncoding::kRaw;
+
+  // Previous blocks which are stored the way they'd be written are copied
+  // as they are, the others are decoded and encoded again.
+  bool copy_previous_blocks = false;
+  if (!previous_entries.empty()) {
+    uint32_t previous_block_num_bytes = 0;
+    BlockMapCompression previous_compression;
+    BlockMapEncoding previous_encoding;
+    if (!previous_file->layerFormat(layer_type, &previous_block_num_bytes,
+                                    &previous_compression,
+                                    &previous_encoding) ||
+        previous_block_num_bytes != sizeof(BlockType)) {
+      ROS_WARN_STREAM("The blocks in " << previous_file->filename()
+                                       << " don't match the mapper's.");
+      return false;
+    }
+    copy_previous_blocks =
+        previous_compression == options.compression &&
+        previous_encoding == encoding &&
+        (encoding == BlockMapEncoding::kRaw ||
+         previous_file->voxel_size() == voxel_size);
+  }
+
+  // The blocks to write, with their entry in the previous file if they're
+  // taken from there.
+  std::vector<std::pair<Index3D, const BlockMapIndexEntry*>> blocks;
+  for (const Index3D& block_index : layer.getAllBlockIndices()) {
+    blocks.emplace_back(block_index, nullptr);
+  }
+  for (const BlockMapIndexEntry* entry : previous_entries) {
+    const Index3D block_index(entry->x, entry->y, entry->z);
+    // A block the mapper created since is newer than the stored one.
+    if (layer.isBlockAllocated(block_index)) {
+      continue;
+    }
+    if (previous_file->entryData(*entry) == nullptr) {
+      ROS_WARN_STREAM("Skipping corrupt block " << block_index.transpose()
+                                                << " in "
+                                                << previous_file->filename());
+      continue;
+    }
+    blocks.emplace_back(block_index, entry);
+  }
+  std::sort(blocks.begin(), blocks.end(),
+            [](const std::pair<Index3D, const BlockMapIndexEntry*>& a,
+               const std::pair<Index3D, const BlockMapIndexEntry*>& b) {
+              return indexLess(a.first.x(), a.first.y(), a.first.z(),
+                               b.first.x(), b.first.y(), b.first.z());
+            });
+
+  std::vector<BlockMapIndexEntry> index;
+  index.reserve(blocks.size());
+  std::vector<uint8_t> raw_blocks;
+  std::vector<const uint8_t*> raw_block_ptrs;
+  std::vector<const BlockMapIndexEntry*> transcoded_entries;
+  std::vector<size_t> transcoded_slots;
+  std::vector<uint8_t> decoded_blocks;
+  std::vector<uint8_t> is_valid;
+  std::vector<std::vector<uint8_t>> stored_blocks;
+  for (size_t chunk_begin = 0; chunk_begin < blocks.size();
+       chunk_begin += kWriteChunkNumBlocks) {
+    const size_t chunk_size =
+        std::min(kWriteChunkNumBlocks, blocks.size() - chunk_begin);
+    // Download the mapper's blocks of the chunk, and decode the previous
+    // blocks which aren't copied.
+    raw_blocks.resize(chunk_size * sizeof(BlockType));
+    raw_block_ptrs.assign(chunk_size, nullptr);
+    transcoded_entries.clear();
+    transcoded_slots.clear();
+    for (size_t i = 0; i < chunk_size; i++) {
+      const auto& block = blocks[chunk_begin + i];
+      if (block.second == nullptr) {
+        const typename BlockType::ConstPtr block_ptr =
+            layer.getBlockAtIndex(block.first);
+        checkCudaErrors(cudaMemcpy(raw_blocks.data() + i * sizeof(BlockType),
+                                   block_ptr.get(), sizeof(BlockType),
+                                   cudaMemcpyDefault));
+        raw_block_ptrs[i] = raw_blocks.data() + i * sizeof(BlockType);
+      } else if (!copy_previous_blocks) {
+        transcoded_entries.push_back(block.second);
+        transcoded_slots.push_back(i);
+      }
+    }
+    if (!transcoded_entries.empty()) {
+      previous_file->decodeEntries(layer_type, transcoded_entries,
+                                   &decoded_blocks, &is_valid);
+      for (size_t j = 0; j < transcoded_entries.size(); j++) {
+        if (is_valid[j]) {
+          raw_block_ptrs[transcoded_slots[j]] =
+              decoded_blocks.data() + j * sizeof(BlockType);
+        } else {
+          ROS_WARN_STREAM("Skipping corrupt block "
+                          << blocks[chunk_begin + transcoded_slots[j]]
+                                 .first.transpose()
+                          << " in " << previous_file->filename());
+        }
+      }
+    }
+    // Encode them in parallel.
+    stored_blocks.resize(chunk_size);
+    std::atomic<bool> success(true);
+    parallelFor(chunk_size, options.num_threads, [&](size_t i) {
+      if (raw_block_ptrs[i] != nullptr &&
+          !encodeBlock(raw_block_ptrs[i], sizeof(BlockType), encoding,
+                       options.compression, voxel_size, &stored_blocks[i])) {
+        success = false;
+      }
+    });
+    if (!success) {
+      return false;
+    }
+    // And write them.
+    for (size_t i = 0; i < chunk_size; i++) {
+      const auto& block = blocks[chunk_begin + i];
+      const uint8_t* stored_block;
+      size_t stored_num_bytes;
+      if (raw_block_ptrs[i] != nullptr) {
+        stored_block = stored_blocks[i].data();
+        stored_num_bytes = stored_blocks[i].size();
+      } else if (copy_previous_blocks) {
+        stored_block = previous_file->entryData(*block.second);
+        stored_num_bytes = block.second->num_bytes;
+      } else {
+        // A corrupt block, skipped above.
+        continue;
+      }
+      BlockMapIndexEntry entry;
+      entry.x = block.first.x();
+      entry.y = block.first.y();
+      entry.z = block.first.z();
+      entry.num_bytes = stored_num_bytes;
+      entry.offset = static_cast<uint64_t>(out_ptr->tellp());
+      out_ptr->write(reinterpret_cast<const char*>(stored_block),
+                     stored_num_bytes);
+      index.push_back(entry);
+      statistics->stored_num_bytes += stored_num_bytes;
+    }
+  }
+  statistics->num_blocks += index.size();
+  statistics->raw_num_bytes += index.size() * sizeof(BlockType);
+
+  // The index is accessed in place, so it has to be aligned.
+  writePadding(out_ptr);
+  layer_header_ptr->layer_type = static_cast<uint32_t>(layer_type);
+  layer_header_ptr->block_num_bytes = sizeof(BlockType);
+  layer_header_ptr->compression = static_cast<uint32_t>(options.compression);
+  layer_header_ptr->encoding = static_cast<uint32_t>(encoding);
+  layer_header_ptr->num_blocks = index.size();
+  layer_header_ptr->index_offset = static_cast<uint64_t>(out_ptr->tellp());
+  out_ptr->write(reinterpret_cast<const char*>(index.data()),
+                 index.size() * sizeof(BlockMapIndexEntry));
+  return true;
+}
+
+}  // namespace
+
+bool writeBlockMapFile(const std::string& filename, const Mapper& mapper,
+                       const BlockMapFileOptions& options,
+                       const BlockMapFile* previous_file,
+                       BlockMapFileStatistics* statistics) {
+  BlockMapFileStatistics local_statistics;
+  if (statistics == nullptr) {
+    statistics = &local_statistics;
+  }
+  *statistics = BlockMapFileStatistics();
+
+  std::ofstream out(filename, std::ios::out | std::ios::binary);
+  if (!out.is_open()) {
+    ROS_WARN_STREAM("Couldn't open " << filename << " for writing.");
+    return false;
+  }
+
+  // The blocks of the previous file which are copied over, per layer type.
+  auto unloaded_entries = [previous_file](BlockMapLayerType layer_type) {
+    return previous_file != nullptr
+               ? previous_file->unloadedEntries(layer_type)
+               : std::vector<const BlockMapIndexEntry*>();
+  };
+  const std::vector<const BlockMapIndexEntry*> previous_tsdf_entries =
+      unloaded_entries(BlockMapLayerType::kTsdf);
+  const std::vector<const BlockMapIndexEntry*> previous_color_entries =
+      unloaded_entries(BlockMapLayerType::kColor);
+  const std::vector<const BlockMapIndexEntry*> previous_occupancy_entries =
+      unloaded_entries(BlockMapLayerType::kOccupancy);
+
+  std::vector<BlockMapLayerType> layer_types;
+  if (mapper.tsdf_layer().numAllocatedBlocks() > 0 ||
+      !previous_tsdf_entries.empty()) {
+    layer_types.push_back(BlockMapLayerType::kTsdf);
+  }
+  if (mapper.color_layer().numAllocatedBlocks() > 0 ||
+      !previous_color_entries.empty()) {
+    layer_types.push_back(BlockMapLayerType::kColor);
+  }
+  if (mapper.occupancy_layer().numAllocatedBlocks() > 0 ||
+      !previous_occupancy_entries.empty()) {
+    layer_types.push_back(BlockMapLayerType::kOccupancy);
+  }
+
+  BlockMapFileHeader header;
+  std::memcpy(header.magic, kBlockMapFileMagic, sizeof(header.magic));
+  header.version = kBlockMapFileVersion;
+  header.voxel_size = mapper.voxel_size_m();
+  header.num_layers = layer_types.size();
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+  // The layer headers are only known once the layers are written, so reserve
+  // space for them and fill them in at the end.
+  std::vector<BlockMapLayerHeader> layer_headers(layer_types.size());
+  const std::streampos layer_headers_position = out.tellp();
+  out.write(reinterpret_cast<const char*>(layer_headers.data()),
+            layer_headers.size() * sizeof(BlockMapLayerHeader));
+
+  bool success = true;
+  for (size_t i = 0; i < layer_types.size() && success; i++) {
+    switch (layer_types[i]) {
+      case BlockMapLayerType::kTsdf:
+        success = writeLayer(mapper.tsdf_layer(), layer_types[i], options,
+                             header.voxel_size, previous_tsdf_entries,
+                             previous_file, &out, &layer_headers[i],
+                             statistics);
+        break;
+      case BlockMapLayerType::kColor:
+        success = writeLayer(mapper.color_layer(), layer_types[i], options,
+                             header.voxel_size, previous_color_entries,
+                             previous_file, &out, &layer_headers[i],
+                             statistics);
+        break;
+      case BlockMapLayerType::kOccupancy:
+        success = writeLayer(mapper.occupancy_layer(), layer_types[i],
+                             options, header.voxel_size,
+                             previous_occupancy_entries, previous_file, &out,
+                             &layer_headers[i], statistics);
+        break;
+    }
+  }
+
+  out.seekp(layer_headers_position);
+  out.write(reinterpret_cast<const char*>(layer_headers.data()),
+            layer_headers.size() * sizeof(BlockMapLayerHeader));
+  out.close();
+  if (!success || !out) {
+    ROS_WARN_STREAM("Failed writing block map file " << filename);
+    return false;
+  }
+  return true;
+}
+
+BlockMapFile::~BlockMapFile() { close(); }
+
+bool BlockMapFile::open(const std::string& filename) {
+  close();
+
+  const int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    ROS_WARN_STREAM("Couldn't open block map file " << filename);
+    return false;
+  }
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0 ||
+      static_cast<size_t>(file_stat.st_size) < sizeof(BlockMapFileHeader)) {
+    ROS_WARN_STREAM(filename << " is not a block map file.");
+    ::close(fd);
+    return false;
+  }
+  const size_t size = static_cast<size_t>(file_stat.st_size);
+  void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (data == MAP_FAILED) {
+    ROS_WARN_STREAM("Couldn't map block map file " << filename);
+    return false;
+  }
+  // Blocks are read sparsely, so don't bother reading ahead.
+  madvise(data, size, MADV_RANDOM);
+  filename_ = filename;
+  data_ = static_cast<const uint8_t*>(data);
+  size_ = size;
+
+  const BlockMapFileHeader* header =
+      reinterpret_cast<const BlockMapFileHeader*>(data_);
+  if (std::memcmp(header->magic, kBlockMapFileMagic, sizeof(header->magic)) !=
+          0 ||
+      header->version < kBlockMapFileMinVersion ||
+      header->version > kBlockMapFileVersion || header->voxel_size <= 0.0f) {
+    ROS_WARN_STREAM(filename << " is not a (version "
+                             << kBlockMapFileMinVersion << " to "
+                             << kBlockMapFileVersion << ") block map file.");
+    close();
+    return false;
+  }
+  voxel_size_ = header->voxel_size;
+  block_size_ = voxelSizeToBlockSize(voxel_size_);
+
+  // Version 1 files store the blocks raw, and their layer headers have no
+  // compression or encoding. They're read as if they had been written
+  // uncompressed.
+  std::vector<BlockMapLayerHeader> layer_headers;
+  if (!readLayerHeaders(data_, size_, header->version, header->num_layers,
+                        &layer_headers)) {
+    ROS_WARN_STREAM(filename << " is truncated.");
+    close();
+    return false;
+  }
+  for (const BlockMapLayerHeader& layer_header : layer_headers) {
+    const bool is_tsdf_layer =
+        layer_header.layer_type ==
+        static_cast<uint32_t>(BlockMapLayerType::kTsdf);
+    if (layer_header.layer_type >
+            static_cast<uint32_t>(BlockMapLayerType::kOccupancy) ||
+        layer_header.compression >
+            static_cast<uint32_t>(BlockMapCompression::kLz4) ||
+        layer_header.encoding >
+            static_cast<uint32_t>(BlockMapEncoding::kQuantizedTsdf) ||
+        (layer_header.encoding ==
+             static_cast<uint32_t>(BlockMapEncoding::kQuantizedTsdf) &&
+         !is_tsdf_layer) ||
+        layer_header.index_offset +
+                layer_header.num_blocks * sizeof(BlockMapIndexEntry) >
+            size_) {
+      ROS_WARN_STREAM(filename << " has a corrupt layer header.");
+      close();
+      return false;
+    }
+    LayerIndex layer_index;
+    layer_index.type = static_cast<BlockMapLayerType>(layer_header.layer_type);
+    layer_index.block_num_bytes = layer_header.block_num_bytes;
+    layer_index.compression =
+        static_cast<BlockMapCompression>(layer_header.compression);
+    layer_index.encoding =
+        static_cast<BlockMapEncoding>(layer_header.encoding);
+    layer_index.entries = reinterpret_cast<const BlockMapIndexEntry*>(
+        data_ + layer_header.index_offset);
+    layer_index.num_entries = layer_header.num_blocks;
+    layer_indices_.push_back(std::move(layer_index));
+  }
+  return true;
+}
+
+void BlockMapFile::close() {
+  if (data_ != nullptr) {
+    munmap(const_cast<uint8_t*>(data_), size_);
+  }
+  data_ = nullptr;
+  size_ = 0;
+  filename_.clear();
+  layer_indices_.clear();
+}
+
+void BlockMapFile::num_threads(int num_threads) {
+  CHECK_GE(num_threads, 0);
+  num_threads_ = num_threads;
+}
+
+size_t BlockMapFile::numBlocks(BlockMapLayerType layer_type) const {
+  for (const LayerIndex& layer_index : layer_indices_) {
+    if (layer_index.type == layer_type) {
+      return layer_index.num_entries;
+    }
+  }
+  return 0;
+}
+
+std::vector<const BlockMapIndexEntry*> BlockMapFile::entriesInAABB(
+    const LayerIndex& layer_index, const AxisAlignedBoundingBox& aabb) const {
+  std::vector<const BlockMapIndexEntry*> entries;
+  if (aabb.isEmpty() || layer_index.num_entries == 0) {
+    return entries;
+  }
+  const Index3D min_index = clampedBlockIndex(aabb.min(), block_size_);
+  const Index3D max_index = clampedBlockIndex(aabb.max(), block_size_);
+  const auto in_range = [&](const BlockMapIndexEntry& entry) {
+    return entry.x >= min_index.x() && entry.x <= max_index.x() &&
+           entry.y >= min_index.y() && entry.y <= max_index.y() &&
+           entry.z >= min_index.z() && entry.z <= max_index.z();
+  };
+
+  const BlockMapIndexEntry* begin = layer_index.entries;
+  const BlockMapIndexEntry* end = begin + layer_index.num_entries;
+  // Computed in floating point, as the count overflows for infinite AABBs.
+  const double num_columns =
+      (static_cast<double>(max_index.x()) - min_index.x() + 1.0) *
+      (static_cast<double>(max_index.y()) - min_index.y() + 1.0);
+  if (num_columns >= static_cast<double>(layer_index.num_entries)) {
+    // The region covers (most of) the map, scanning is cheaper than searching.
+    for (const BlockMapIndexEntry* it = begin; it != end; ++it) {
+      if (in_range(*it)) {
+        entries.push_back(it);
+      }
+    }
+    return entries;
+  }
+
+  // The index is sorted by (x, y, z), so the blocks of each (x, y) column in
+  // the region are contiguous.
+  for (int x = min_index.x(); x <= max_index.x(); x++) {
+    for (int y = min_index.y(); y <= max_index.y(); y++) {
+      const BlockMapIndexEntry* it = std::lower_bound(
+          begin, end, min_index.z(),
+          [x, y](const BlockMapIndexEntry& entry, int z) {
+            return indexLess(entry.x, entry.y, entry.z, x, y, z);
+          });
+      for (; it != end && it->x == x && it->y == y && it->z <= max_index.z();
+           ++it) {
+        entries.push_back(it);
+      }
+    }
+  }
+  return entries;
+}
+
+void BlockMapFile::decodeEntries(
+    const LayerIndex& layer_index,
+    const std::vector<const BlockMapIndexEntry*>& entries,
+    std::vector<uint8_t>* decoded_blocks,
+    std::vector<uint8_t>* is_valid) const {
+  CHECK_NOTNULL(decoded_blocks);
+  CHECK_NOTNULL(is_valid);
+  const size_t block_num_bytes = layer_index.block_num_bytes;
+  decoded_blocks->resize(entries.size() * block_num_bytes);
+  is_valid->assign(entries.size(), 0);
+  parallelFor(entries.size(), num_threads_, [&](size_t i) {
+    const BlockMapIndexEntry& entry = *entries[i];
+    (*is_valid)[i] =
+        entry.offset + entry.num_bytes <= size_ &&
+        decodeBlock(data_ + entry.offset, entry.num_bytes,
+                    layer_index.encoding, layer_index.compression,
+                    voxel_size_, block_num_bytes,
+                    decoded_blocks->data() + i * block_num_bytes);
+  });
+}
+
+void BlockMapFile::loadEntries(
+    const std::vector<const BlockMapIndexEntry*>& entries,
+    LayerIndex* layer_index, Mapper* mapper,
+    std::vector<Index3D>* loaded_blocks) {
+  switch (layer_index->type) {
+    case BlockMapLayerType::kTsdf:
+      loadEntriesIntoLayer(entries, layer_index,
+                           mapper->layers().getPtr<TsdfLayer>(),
+                           loaded_blocks);
+      break;
+    case BlockMapLayerType::kColor:
+      loadEntriesIntoLayer(entries, layer_index,
+                           mapper->layers().getPtr<ColorLayer>(),
+                           loaded_blocks);
+      break;
+    case BlockMapLayerType::kOccupancy:
+      loadEntriesIntoLayer(entries, layer_index,
+                           mapper->layers().getPtr<OccupancyLayer>(),
+                           loaded_blocks);
+      break;
+  }
+}
+
+std::vector<Index3D> BlockMapFile::loadBlocksInAABB(
+    const AxisAlignedBoundingBox& aabb, Mapper* mapper) {
+  CHECK_NOTNULL(mapper);
+  CHECK(isOpen());
+  std::vector<Index3D> loaded_blocks;
+  for (LayerIndex& layer_index : layer_indices_) {
+    loadEntries(entriesInAABB(layer_index, aabb), &layer_index, mapper,
+                &loaded_blocks);
+  }
+  // Blocks loaded in several layers are only reported once.
+  const Index3DSet unique_blocks(loaded_blocks.begin(), loaded_blocks.end());
+  return std::vector<Index3D>(unique_blocks.begin(), unique_blocks.end());
+}
+
+std::vector<Index3D> BlockMapFile::loadAllBlocks(Mapper* mapper) {
+  const AxisAlignedBoundingBox everything(
+      Vector3f::Constant(-std::numeric_limits<float>::infinity()),
+      Vector3f::Constant(std::numeric_limits<float>::infinity()));
+  return loadBlocksInAABB(everything, mapper);
+}
+
+std::vector<const BlockMapIndexEntry*> BlockMapFile::unloadedEntries(
+    BlockMapLayerType layer_type) const {
+  std::vector<const BlockMapIndexEntry*> entries;
+  for (const LayerIndex& layer_index : layer_indices_) {
+    if (layer_index.type != layer_type) {
+      continue;
+    }
+    for (size_t i = 0; i < layer_index.num_entries; i++) {
+      const BlockMapIndexEntry& entry = layer_index.entries[i];
+      if (layer_index.loaded.count(Index3D(entry.x, entry.y, entry.z)) == 0) {
+        entries.push_back(&entry);
+      }
+    }
+  }
+  return entries;
+}
+
+const uint8_t* BlockMapFile::entryData(const BlockMapIndexEntry& entry) const {
+  if (entry.offset + entry.num_bytes > size_) {
+    return nullptr;
+  }
+  return data_ + entry.offset;
+}
+
+bool BlockMapFile::layerFormat(BlockMapLayerType layer_type,
+                               uint32_t* block_num_bytes,
+                               BlockMapCompression* compression,
+                               BlockMapEncoding* encoding) const {
+  CHECK_NOTNULL(block_num_bytes);
+  CHECK_NOTNULL(compression);
+  CHECK_NOTNULL(encoding);
+  for (const LayerIndex& layer_index : layer_indices_) {
+    if (layer_index.type == layer_type) {
+      *block_num_bytes = layer_index.block_num_bytes;
+      *compression = layer_index.compression;
+      *encoding = layer_index.encoding;
+      return true;
+    }
+  }
+  return false;
+}
+
+void BlockMapFile::decodeEntries(
+    BlockMapLayerType layer_type,
+    const std::vector<const BlockMapIndexEntry*>& entries,
+    std::vector<uint8_t>* decoded_blocks,
+    std::vector<uint8_t>* is_valid) const {
+  for (const LayerIndex& layer_index : layer_indices_) {
+    if (layer_index.type == layer_type) {
+      decodeEntries(layer_index, entries, decoded_blocks, is_valid);
+      return;
+    }
+  }
+  // None of the entries belong to a stored layer.
+  CHECK_NOTNULL(decoded_blocks)->clear();
+  CHECK_NOTNULL(is_valid)->assign(entries.size(), 0);
+}
+
+std::vector<Index3D> BlockMapFile::loadBlocksInRadius(const Vector3f& center,
+                                                      float radius_m,
+                                                      Mapper* mapper) {
+  CHECK_NOTNULL(mapper);
+  CHECK(isOpen());
+  const AxisAlignedBoundingBox aabb(center - Vector3f::Constant(radius_m),
+                                    center + Vector3f::Constant(radius_m));
+  std::vector<Index3D> loaded_blocks;
+  for (LayerIndex& layer_index : layer_indices_) {
+    std::vector<const BlockMapIndexEntry*> entries =
+        entriesInAABB(layer_index, aabb);
+    // Drop the blocks in the corners of the AABB.
+    entries.erase(
+        std::remove_if(entries.begin(), entries.end(),
+                       [&](const BlockMapIndexEntry* entry) {
+                         const AxisAlignedBoundingBox block_aabb =
+                             getAABBOfBlock(block_size_, Index3D(entry->x,
+                                                                 entry->y,
+                                                                 entry->z));
+                         const Vector3f closest =
+                             center.cwiseMax(block_aabb.min())
+                                 .cwiseMin(block_aabb.max());
+                         return (closest - center).norm() > radius_m;
+                       }),
+        entries.end());
+    loadEntries(entries, &layer_index, mapper, &loaded_blocks);
+  }
+  const Index3DSet unique_blocks(loaded_blocks.begin(), loaded_blocks.end());
+  return std::vector<Index3D>(unique_blocks.begin(), unique_blocks.end());
+}
+
+}  // namespace nvblox
@@ -0,0 +1,170 @@
+// SPDX-FileCopyrightText: NVIDIA CORPORATION & AFFILIATES
+// Copyright (c) 2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <nvblox/utils/timing.h>
+#include <ros/console.h>
+
+#include "nvblox_ros/block_pager.hpp"
+
+namespace nvblox {
+namespace {
+
+// Distance from the point to the closest point of the block.
+float distanceToBlock(const Vector3f& point, float block_size,
+                      const Index3D& block_index) {
+  const AxisAlignedBoundingBox block_aabb =
+      getAABBOfBlock(block_size, block_index);
+  const Vector3f closest =
+      point.cwiseMax(block_aabb.min()).cwiseMin(block_aabb.max());
+  return (closest - point).norm();
+}
+
+}  // namespace
+
+BlockPager::~BlockPager() { close(); }
+
+bool BlockPager::open(const std::string& filename, Mapper* mapper) {
+  CHECK_NOTNULL(mapper);
+  close();
+  // Blocks stored by a previous run don't belong to this map.
+  std::remove(filename.c_str());
+  std::vector<Index3D> restored_blocks;
+  if (!store_.open(filename, mapper, &restored_blocks)) {
+    return false;
+  }
+  filename_ = filename;
+  block_size_ = mapper->tsdf_layer().block_size();
+  return true;
+}
+
+void BlockPager::close() {
+  store_.close();
+  if (!filename_.empty()) {
+    std::remove(filename_.c_str());
+  }
+  filename_.clear();
+  paged_out_blocks_.clear();
+  requested_blocks_.clear();
+}
+
+void BlockPager::clear(Mapper* mapper) {
+  if (isOpen()) {
+    const std::string filename = filename_;
+    open(filename, mapper);
+  }
+}
+
+std::vector<Index3D> BlockPager::blocksOutsideRadius(
+    const Vector3f& center, float radius_m, const Mapper& mapper) const {
+  Index3DSet allocated_blocks;
+  for (const Index3D& block_index : mapper.tsdf_layer().getAllBlockIndices()) {
+    allocated_blocks.insert(block_index);
+  }
+  for (const Index3D& block_index : mapper.color_layer().getAllBlockIndices()) {
+    allocated_blocks.insert(block_index);
+  }
+  for (const Index3D& block_index :
+       mapper.occupancy_layer().getAllBlockIndices()) {
+    allocated_blocks.insert(block_index);
+  }
+  std::vector<Index3D> blocks_outside_radius;
+  for (const Index3D& block_index : allocated_blocks) {
+    if (distanceToBlock(center, block_size_, block_index) > radius_m) {
+      blocks_outside_radius.push_back(block_index);
+    }
+  }
+  return blocks_outside_radius;
+}
+
+void BlockPager::pageOut(const std::vector<Index3D>& block_indices,
+                         Mapper* mapper) {
+  CHECK_NOTNULL(mapper);
+  if (!isOpen() || block_indices.empty()) {
+    return;
+  }
+  timing::Timer page_out_timer("ros/pager/page_out");
+  // Copies the blocks to host memory, the store writes them in the
+  // background.
+  store_.markDirty(block_indices);
+  store_.flush(*mapper, block_indices);
+
+  mapper->layers().getPtr<TsdfLayer>()->clearBlocks(block_indices);
+  mapper->layers().getPtr<ColorLayer>()->clearBlocks(block_indices);
+  mapper->layers().getPtr<OccupancyLayer>()->clearBlocks(block_indices);
+  mapper->layers().getPtr<EsdfLayer>()->clearBlocks(block_indices);
+  mapper->layers().getPtr<MeshLayer>()->clearBlocks(block_indices);
+  paged_out_blocks_.insert(block_indices.begin(), block_indices.end());
+}
+
+void BlockPager::requestPageIn(const Vector3f& center, float radius_m) {
+  if (!isOpen()) {
+    return;
+  }
+  std::vector<Index3D> blocks_to_page_in;
+  for (const Index3D& block_index : paged_out_blocks_) {
+    if (requested_blocks_.count(block_index) == 0 &&
+        distanceToBlock(center, block_size_, block_index) <= radius_m) {
+      blocks_to_page_in.push_back(block_index);
+    }
+  }
+  requested_blocks_.insert(blocks_to_page_in.begin(),
+                           blocks_to_page_in.end());
+  store_.requestRead(blocks_to_page_in);
+}
+
+std::vector<Index3D> BlockPager::insertPagedInBlocks(Mapper* mapper) {
+  CHECK_NOTNULL(mapper);
+  if (!isOpen()) {
+    return {};
+  }
+  const std::vector<Index3D> paged_in_blocks = store_.insertReadBlocks(mapper);
+  for (const Index3D& block_index : paged_in_blocks) {
+    paged_out_blocks_.erase(block_index);
+    requested_blocks_.erase(block_index);
+  }
+  return paged_in_blocks;
+}
+
+std::vector<Index3D> BlockPager::pageIn(
+    const std::vector<Index3D>& block_indices, Mapper* mapper) {
+  CHECK_NOTNULL(mapper);
+  if (!isOpen()) {
+    return {};
+  }
+  std::vector<Index3D> blocks_to_page_in;
+  for (const Index3D& block_index : block_indices) {
+    if (paged_out_blocks_.count(block_index) > 0 &&
+        requested_blocks_.insert(block_index).second) {
+      blocks_to_page_in.push_back(block_index);
+    }
+  }
+  store_.requestRead(blocks_to_page_in);
+  store_.waitUntilIdle();
+  return insertPagedInBlocks(mapper);
+}
+
+std::vector<Index3D> BlockPager::pageInAll(Mapper* mapper) {
+  return pageIn(std::vector<Index3D>(paged_out_blocks_.begin(),
+                                     paged_out_blocks_.end()),
+                mapper);
+}
+
+}  // namespace nvblox
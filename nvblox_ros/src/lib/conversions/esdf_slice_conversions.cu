@@ -24,6 +24,11 @@ namespace conversions {
 
 EsdfSliceConverter::EsdfSliceConverter() { cudaStreamCreate(&cuda_stream_); }
 
+std::vector<BufferCapacity> EsdfSliceConverter::bufferCapacities() const {
+  return {{"pcl_pointcloud_device",
+           pcl_pointcloud_device_.capacity() * sizeof(PclPointXYZI)}};
+}
+
 __global__ void populateSliceFromLayerKernel(
     Index3DDeviceHashMapType<EsdfBlock> block_hash, AxisAlignedBoundingBox aabb,
     float block_size, float* image, int rows, int cols, float z_slice_height,
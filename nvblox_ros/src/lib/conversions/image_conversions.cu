@@ -107,6 +107,19 @@ struct DivideBy1000 : public thrust::unary_function<uint16_t, float> {
   }
 };
 
+void depthBufferFromMillimeterImageMessage(const sensor_msgs::Image& image_msg,
+                                           std::vector<float>* depth_buffer) {
+  CHECK_NOTNULL(depth_buffer);
+  CHECK_EQ(image_msg.encoding, "16UC1");
+  const uint16_t* char_depth_buffer =
+      reinterpret_cast<const uint16_t*>(&image_msg.data[0]);
+  const int numel = image_msg.height * image_msg.width;
+  depth_buffer->resize(numel);
+  for (int i = 0; i < numel; i++) {
+    (*depth_buffer)[i] = static_cast<float>(char_depth_buffer[i]) / 1000.0f;
+  }
+}
+
 // Convert image to depth frame object
 bool depthImageFromImageMessage(const sensor_msgs::ImageConstPtr& image_msg,
                                 DepthImage* depth_image) {
@@ -146,11 +159,8 @@ bool depthImageFromImageMessage(const sensor_msgs::ImageConstPtr& image_msg,
       thrust::transform(char_depth_buffer, char_depth_buffer + numel,
                         depth_image->dataPtr(), DivideBy1000());
     } else {
-      std::vector<float> float_depth_buffer(numel);
-      for (int i = 0; i < numel; i++) {
-        float_depth_buffer[i] =
-            static_cast<float>(char_depth_buffer[i]) / 1000.0f;
-      }
+      std::vector<float> float_depth_buffer;
+      depthBufferFromMillimeterImageMessage(*image_msg, &float_depth_buffer);
       depth_image->populateFromBuffer(image_msg->height, image_msg->width,
                                       float_depth_buffer.data(),
                                       MemoryType::kDevice);
@@ -25,6 +25,13 @@ namespace conversions {
 
 LayerConverter::LayerConverter() { cudaStreamCreate(&cuda_stream_); }
 
+std::vector<BufferCapacity> LayerConverter::bufferCapacities() const {
+  return {{"pcl_pointcloud_device",
+           pcl_pointcloud_device_.capacity() * sizeof(PclPointXYZI)},
+          {"block_indices_device",
+           block_indices_device_.capacity() * sizeof(Index3D)}};
+}
+
 template <typename VoxelType>
 __device__ bool getVoxelIntensity(const VoxelType& voxel, float voxel_size,
                                   float* intensity);
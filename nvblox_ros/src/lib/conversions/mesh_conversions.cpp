@@ -17,6 +17,8 @@
 
 #include "nvblox_ros/conversions/mesh_conversions.hpp"
 
+#include <cmath>
+
 #include <geometry_msgs/Point.h>
 #include <geometry_msgs/Point32.h>
 #include <std_msgs/ColorRGBA.h>
@@ -63,20 +65,76 @@ void meshMessageFromMeshLayer(const BlockLayer<MeshBlock>& mesh_layer,
   meshMessageFromMeshBlocks(mesh_layer, block_indices, mesh_msg);
 }
 
-void meshBlockMessageFromMeshBlock(const MeshBlock& mesh_block,
-                                   nvblox_msgs::MeshBlock* mesh_block_msg) {
+// FNV-1a style mixing of a 32 bit value into a 64 bit hash.
+inline void hashCombine(uint32_t value, uint64_t* hash) {
+  constexpr uint64_t kFnvPrime = 1099511628211ull;
+  for (int byte = 0; byte < 4; byte++) {
+    *hash ^= (value >> (8 * byte)) & 0xFF;
+    *hash *= kFnvPrime;
+  }
+}
+
+void MeshBlockFingerprintCache::vertex_quantization_m(
+    float vertex_quantization_m) {
+  CHECK_GT(vertex_quantization_m, 0.0f);
+  vertex_quantization_m_ = vertex_quantization_m;
+}
+
+bool MeshBlockFingerprintCache::updateFingerprint(
+    const Index3D& block_index, const std::vector<Vector3f>& vertices,
+    const std::vector<int>& triangles, const std::vector<Color>& colors) {
+  // Colors are quantized to 5 bits per channel, such that slow color
+  // integration doesn't trigger a republish on its own.
+  constexpr int kColorQuantizationShift = 3;
+
+  uint64_t fingerprint = 14695981039346656037ull;
+  hashCombine(static_cast<uint32_t>(vertices.size()), &fingerprint);
+  hashCombine(static_cast<uint32_t>(triangles.size()), &fingerprint);
+  const float inv_quantization = 1.0f / vertex_quantization_m_;
+  for (const Vector3f& vertex : vertices) {
+    for (int i = 0; i < 3; i++) {
+      hashCombine(static_cast<uint32_t>(static_cast<int32_t>(
+                      std::lround(vertex[i] * inv_quantization))),
+                  &fingerprint);
+    }
+  }
+  for (const int triangle_index : triangles) {
+    hashCombine(static_cast<uint32_t>(triangle_index), &fingerprint);
+  }
+  for (const Color& color : colors) {
+    hashCombine((static_cast<uint32_t>(color.r >> kColorQuantizationShift)) |
+                    (static_cast<uint32_t>(color.g >> kColorQuantizationShift)
+                     << 8) |
+                    (static_cast<uint32_t>(color.b >> kColorQuantizationShift)
+                     << 16),
+                &fingerprint);
+  }
+
+  auto it = fingerprints_.find(block_index);
+  if (it != fingerprints_.end() && it->second == fingerprint) {
+    return false;
+  }
+  fingerprints_[block_index] = fingerprint;
+  return true;
+}
+
+void MeshBlockFingerprintCache::erase(const Index3D& block_index) {
+  fingerprints_.erase(block_index);
+}
+
+void MeshBlockFingerprintCache::clear() { fingerprints_.clear(); }
+
+void meshBlockMessageFromMeshBlockVectors(
+    const std::vector<Vector3f>& vertices, const std::vector<Vector3f>& normals,
+    const std::vector<Color>& colors, const std::vector<int>& triangles,
+    nvblox_msgs::MeshBlock* mesh_block_msg) {
   CHECK_NOTNULL(mesh_block_msg);
 
-  size_t num_vertices = mesh_block.vertices.size();
+  size_t num_vertices = vertices.size();
 
   mesh_block_msg->vertices.resize(num_vertices);
   mesh_block_msg->normals.resize(num_vertices);
-  mesh_block_msg->colors.resize(mesh_block.colors.size());
-  mesh_block_msg->triangles.resize(mesh_block.triangles.size());
-
-  std::vector<Vector3f> vertices = mesh_block.getVertexVectorOnCPU();
-  std::vector<Vector3f> normals = mesh_block.getNormalVectorOnCPU();
-  std::vector<Color> colors = mesh_block.getColorVectorOnCPU();
+  mesh_block_msg->colors.resize(colors.size());
 
   // Copy over vertices and normals.
   for (size_t i = 0; i < num_vertices; i++) {
@@ -85,38 +143,67 @@ void meshBlockMessageFromMeshBlock(const MeshBlock& mesh_block,
   }
 
   // Copy over colors if available.
-  for (size_t i = 0; i < mesh_block.colors.size(); i++) {
+  for (size_t i = 0; i < colors.size(); i++) {
     mesh_block_msg->colors[i] = colorMessageFromColor(colors[i]);
   }
 
   // Copying over triangles is thankfully easy.
-  mesh_block_msg->triangles = mesh_block.getTriangleVectorOnCPU();
+  mesh_block_msg->triangles = triangles;
 }
 
 void meshMessageFromMeshBlocks(
     const BlockLayer<MeshBlock>& mesh_layer,
     const std::vector<Index3D>& block_indices, nvblox_msgs::Mesh* mesh_msg,
-    const std::vector<Index3D>& block_indices_to_delete) {
+    const std::vector<Index3D>& block_indices_to_delete,
+    MeshBlockFingerprintCache* fingerprint_cache) {
   // Go through all the blocks, converting each individual one.
   mesh_msg->block_size = mesh_layer.block_size();
   mesh_msg->block_indices.resize(block_indices.size());
   mesh_msg->blocks.resize(block_indices.size());
 
+  size_t output_index = 0;
   for (size_t i = 0; i < block_indices.size(); i++) {
     // Get the block origin.
-    mesh_msg->block_indices[i] = index3DMessageFromIndex3D(block_indices[i]);
+    mesh_msg->block_indices[output_index] =
+        index3DMessageFromIndex3D(block_indices[i]);
 
     MeshBlock::ConstPtr mesh_block =
         mesh_layer.getBlockAtIndex(block_indices[i]);
     if (mesh_block == nullptr) {
+      // Leave the block empty, which deletes it on the receiving side.
+      if (fingerprint_cache != nullptr) {
+        fingerprint_cache->erase(block_indices[i]);
+      }
+      mesh_msg->blocks[output_index] = nvblox_msgs::MeshBlock();
+      output_index++;
+      continue;
+    }
+
+    // Bring the block to the CPU.
+    const std::vector<Vector3f> vertices = mesh_block->getVertexVectorOnCPU();
+    const std::vector<int> triangles = mesh_block->getTriangleVectorOnCPU();
+    const std::vector<Color> colors = mesh_block->getColorVectorOnCPU();
+
+    // Skip the block if its content is the same as last time.
+    if (fingerprint_cache != nullptr &&
+        !fingerprint_cache->updateFingerprint(block_indices[i], vertices,
+                                              triangles, colors)) {
       continue;
     }
 
     // Convert the actual block.
-    meshBlockMessageFromMeshBlock(*mesh_block, &mesh_msg->blocks[i]);
+    meshBlockMessageFromMeshBlockVectors(
+        vertices, mesh_block->getNormalVectorOnCPU(), colors, triangles,
+        &mesh_msg->blocks[output_index]);
+    output_index++;
   }
+  mesh_msg->block_indices.resize(output_index);
+  mesh_msg->blocks.resize(output_index);
 
   for (const Index3D& block_index : block_indices_to_delete) {
+    if (fingerprint_cache != nullptr) {
+      fingerprint_cache->erase(block_index);
+    }
     mesh_msg->block_indices.push_back(index3DMessageFromIndex3D(block_index));
     mesh_msg->blocks.push_back(nvblox_msgs::MeshBlock());
   }
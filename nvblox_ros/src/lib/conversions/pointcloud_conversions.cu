@@ -64,6 +64,15 @@ void copyDevicePointcloudToMsg(
 
 PointcloudConverter::PointcloudConverter() { cudaStreamCreate(&cuda_stream_); }
 
+std::vector<BufferCapacity> PointcloudConverter::bufferCapacities() const {
+  return {{"lidar_pointcloud_host",
+           lidar_pointcloud_host_.capacity() * sizeof(Vector3f)},
+          {"lidar_pointcloud_device",
+           lidar_pointcloud_device_.capacity() * sizeof(Vector3f)},
+          {"pcl_pointcloud_device",
+           pcl_pointcloud_device_.capacity() * sizeof(PclPointXYZI)}};
+}
+
 bool PointcloudConverter::checkLidarPointcloud(
     const sensor_msgs::PointCloud2::ConstPtr& pointcloud, const Lidar& lidar) {
   // Check the cache
@@ -173,11 +182,7 @@ void PointcloudConverter::depthImageFromPointcloudGPU(
   }
 
   // Copy the pointcloud into pinned host memory
-  lidar_pointcloud_host_.clear();
-  for (; iter_xyz != iter_xyz.end(); ++iter_xyz) {
-    lidar_pointcloud_host_.push_back(
-        Vector3f(iter_xyz[0], iter_xyz[1], iter_xyz[2]));
-  }
+  pointsFromPointcloudMsg(*pointcloud, &lidar_pointcloud_host_);
   // Copy the pointcloud to the GPU
   lidar_pointcloud_device_ = lidar_pointcloud_host_;
 
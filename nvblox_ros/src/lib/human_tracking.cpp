@@ -0,0 +1,197 @@
+// SPDX-FileCopyrightText: NVIDIA CORPORATION & AFFILIATES
+// Copyright (c) 2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <algorithm>
+#include <numeric>
+#include <tuple>
+#include <utility>
+
+#include <nvblox/core/hash.h>
+#include <nvblox/core/indexing.h>
+
+#include "nvblox_ros/human_tracking.hpp"
+
+namespace nvblox {
+namespace {
+
+int findRoot(std::vector<int>* parents, int i) {
+  // Path halving
+  while ((*parents)[i] != i) {
+    (*parents)[i] = (*parents)[(*parents)[i]];
+    i = (*parents)[i];
+  }
+  return i;
+}
+
+void unite(std::vector<int>* parents, int i, int j) {
+  const int root_i = findRoot(parents, i);
+  const int root_j = findRoot(parents, j);
+  if (root_i != root_j) {
+    (*parents)[std::max(root_i, root_j)] = std::min(root_i, root_j);
+  }
+}
+
+}  // namespace
+
+std::vector<VoxelCluster> clusterVoxelCenters(
+    const std::vector<Vector3f>& voxel_centers, float voxel_size,
+    int max_gap_voxels, int min_cluster_size) {
+  // Hash the voxel indices.
+  Index3DHashMapType<int>::type index_to_voxel;
+  index_to_voxel.reserve(voxel_centers.size());
+  std::vector<Index3D> voxel_indices;
+  voxel_indices.reserve(voxel_centers.size());
+  for (size_t i = 0; i < voxel_centers.size(); i++) {
+    // Note that the block index at voxel_size resolution is the voxel index.
+    const Index3D voxel_index =
+        getBlockIndexFromPositionInLayer(voxel_size, voxel_centers[i]);
+    voxel_indices.push_back(voxel_index);
+    index_to_voxel.emplace(voxel_index, static_cast<int>(i));
+  }
+
+  // Join neighbours. Only half of the neighbourhood has to be checked, because
+  // the connection is symmetric.
+  std::vector<int> parents(voxel_centers.size());
+  std::iota(parents.begin(), parents.end(), 0);
+  for (size_t i = 0; i < voxel_indices.size(); i++) {
+    for (int dx = -max_gap_voxels; dx <= max_gap_voxels; dx++) {
+      for (int dy = -max_gap_voxels; dy <= max_gap_voxels; dy++) {
+        for (int dz = -max_gap_voxels; dz <= max_gap_voxels; dz++) {
+          if (std::make_tuple(dx, dy, dz) <= std::make_tuple(0, 0, 0)) {
+            continue;
+          }
+          const auto it =
+              index_to_voxel.find(voxel_indices[i] + Index3D(dx, dy, dz));
+          if (it != index_to_voxel.end()) {
+            unite(&parents, static_cast<int>(i), it->second);
+          }
+        }
+      }
+    }
+  }
+
+  // Accumulate the clusters.
+  std::vector<int> root_to_cluster(voxel_centers.size(), -1);
+  std::vector<VoxelCluster> clusters;
+  std::vector<Vector3f> sums;
+  for (size_t i = 0; i < voxel_centers.size(); i++) {
+    const int root = findRoot(&parents, static_cast<int>(i));
+    if (root_to_cluster[root] < 0) {
+      root_to_cluster[root] = clusters.size();
+      VoxelCluster cluster;
+      cluster.min_corner = voxel_centers[i];
+      cluster.max_corner = voxel_centers[i];
+      clusters.push_back(cluster);
+      sums.push_back(Vector3f::Zero());
+    }
+    const int cluster_index = root_to_cluster[root];
+    VoxelCluster& cluster = clusters[cluster_index];
+    cluster.min_corner = cluster.min_corner.cwiseMin(voxel_centers[i]);
+    cluster.max_corner = cluster.max_corner.cwiseMax(voxel_centers[i]);
+    cluster.num_voxels++;
+    sums[cluster_index] += voxel_centers[i];
+  }
+
+  // Finalize and drop small clusters.
+  std::vector<VoxelCluster> output;
+  const Vector3f half_voxel = Vector3f::Constant(voxel_size / 2.0f);
+  for (size_t i = 0; i < clusters.size(); i++) {
+    VoxelCluster& cluster = clusters[i];
+    if (cluster.num_voxels < min_cluster_size) {
+      continue;
+    }
+    cluster.centroid = sums[i] / static_cast<float>(cluster.num_voxels);
+    // Corners of the voxels rather than their centers.
+    cluster.min_corner -= half_voxel;
+    cluster.max_corner += half_voxel;
+    output.push_back(cluster);
+  }
+  return output;
+}
+
+void InstanceTracker::update(const std::vector<VoxelCluster>& clusters,
+                             double time_s) {
+  // All candidate associations, closest first.
+  std::vector<std::tuple<float, size_t, size_t>> candidates;
+  for (size_t i = 0; i < instances_.size(); i++) {
+    const TrackedInstance& instance = instances_[i];
+    const float dt = static_cast<float>(time_s - instance.last_seen_s);
+    const Vector3f predicted_centroid =
+        instance.centroid + dt * instance.velocity;
+    for (size_t j = 0; j < clusters.size(); j++) {
+      const float distance = (clusters[j].centroid - predicted_centroid).norm();
+      if (distance <= max_association_distance_m_) {
+        candidates.emplace_back(distance, i, j);
+      }
+    }
+  }
+  std::sort(candidates.begin(), candidates.end());
+
+  // Greedily associate.
+  std::vector<bool> instance_associated(instances_.size(), false);
+  std::vector<bool> cluster_associated(clusters.size(), false);
+  for (const auto& candidate : candidates) {
+    const size_t i = std::get<1>(candidate);
+    const size_t j = std::get<2>(candidate);
+    if (instance_associated[i] || cluster_associated[j]) {
+      continue;
+    }
+    instance_associated[i] = true;
+    cluster_associated[j] = true;
+
+    TrackedInstance& instance = instances_[i];
+    const VoxelCluster& cluster = clusters[j];
+    const double dt = time_s - instance.last_seen_s;
+    if (dt > 0.0) {
+      const Vector3f measured_velocity =
+          (cluster.centroid - instance.centroid) / static_cast<float>(dt);
+      instance.velocity = velocity_smoothing_ * measured_velocity +
+                          (1.0f - velocity_smoothing_) * instance.velocity;
+    }
+    instance.centroid = cluster.centroid;
+    instance.extent = cluster.max_corner - cluster.min_corner;
+    instance.num_voxels = cluster.num_voxels;
+    instance.last_seen_s = time_s;
+  }
+
+  // Drop instances we lost.
+  std::vector<TrackedInstance> instances;
+  instances.reserve(instances_.size() + clusters.size());
+  for (const TrackedInstance& instance : instances_) {
+    if (time_s - instance.last_seen_s <= timeout_s_) {
+      instances.push_back(instance);
+    }
+  }
+
+  // Start new instances.
+  for (size_t j = 0; j < clusters.size(); j++) {
+    if (cluster_associated[j]) {
+      continue;
+    }
+    TrackedInstance instance;
+    instance.id = next_id_++;
+    instance.centroid = clusters[j].centroid;
+    instance.extent = clusters[j].max_corner - clusters[j].min_corner;
+    instance.num_voxels = clusters[j].num_voxels;
+    instance.first_seen_s = time_s;
+    instance.last_seen_s = time_s;
+    instances.push_back(instance);
+  }
+  instances_ = std::move(instances);
+}
+
+}  // namespace nvblox
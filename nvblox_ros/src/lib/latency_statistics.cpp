@@ -0,0 +1,124 @@
+// SPDX-FileCopyrightText: NVIDIA CORPORATION & AFFILIATES
+// Copyright (c) 2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+
+#include "nvblox_ros/latency_statistics.hpp"
+
+namespace nvblox {
+
+LatencyStatistics::LatencyStatistics(size_t window_size)
+    : window_size_(std::max<size_t>(window_size, 1)) {}
+
+void LatencyStatistics::add(const std::string& stage, double latency_s) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Stage& entry = stages_[stage];
+  ++entry.count;
+  entry.total_s += latency_s;
+  if (entry.count == 1) {
+    entry.min_s = latency_s;
+    entry.max_s = latency_s;
+  } else {
+    entry.min_s = std::min(entry.min_s, latency_s);
+    entry.max_s = std::max(entry.max_s, latency_s);
+  }
+  if (entry.window.size() < window_size_) {
+    entry.window.push_back(latency_s);
+  } else {
+    entry.window[entry.window_next] = latency_s;
+    entry.window_next = (entry.window_next + 1) % window_size_;
+  }
+}
+
+LatencyStatistics::Summary LatencyStatistics::summary(
+    const std::string& stage) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const auto it = stages_.find(stage);
+  if (it == stages_.end()) {
+    return Summary();
+  }
+  return summarize(it->second);
+}
+
+std::vector<std::string> LatencyStatistics::stages() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<std::string> names;
+  names.reserve(stages_.size());
+  for (const auto& name_and_stage : stages_) {
+    names.push_back(name_and_stage.first);
+  }
+  return names;
+}
+
+void LatencyStatistics::clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  stages_.clear();
+}
+
+void LatencyStatistics::writeJson(std::ostream& out) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  constexpr double kSToMs = 1000.0;
+  const std::ios_base::fmtflags flags = out.flags();
+  out << std::fixed << std::setprecision(4) << "{";
+  bool first = true;
+  for (const auto& name_and_stage : stages_) {
+    const Summary summary = summarize(name_and_stage.second);
+    // Stage names are identifiers, they don't need escaping.
+    out << (first ? "" : ",") << "\n  \"" << name_and_stage.first << "\": {"
+        << "\"count\": " << summary.count
+        << ", \"mean_ms\": " << summary.mean_s * kSToMs
+        << ", \"p50_ms\": " << summary.p50_s * kSToMs
+        << ", \"p95_ms\": " << summary.p95_s * kSToMs
+        << ", \"p99_ms\": " << summary.p99_s * kSToMs
+        << ", \"max_ms\": " << summary.max_s * kSToMs << "}";
+    first = false;
+  }
+  out << (first ? "}" : "\n}");
+  out.flags(flags);
+}
+
+double LatencyStatistics::percentile(std::vector<double>* samples,
+                                     double fraction) {
+  if (samples->empty()) {
+    return 0.0;
+  }
+  std::sort(samples->begin(), samples->end());
+  const double rank = std::ceil(fraction * samples->size());
+  const size_t index = static_cast<size_t>(std::max(rank, 1.0)) - 1;
+  return (*samples)[std::min(index, samples->size() - 1)];
+}
+
+LatencyStatistics::Summary LatencyStatistics::summarize(
+    const Stage& stage) const {
+  Summary summary;
+  summary.count = stage.count;
+  summary.total_s = stage.total_s;
+  summary.min_s = stage.min_s;
+  summary.max_s = stage.max_s;
+  if (stage.count > 0) {
+    summary.mean_s = stage.total_s / stage.count;
+  }
+  std::vector<double> samples = stage.window;
+  summary.p50_s = percentile(&samples, 0.5);
+  summary.p95_s = percentile(&samples, 0.95);
+  summary.p99_s = percentile(&samples, 0.99);
+  return summary;
+}
+
+}  // namespace nvblox
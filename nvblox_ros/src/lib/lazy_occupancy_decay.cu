@@ -0,0 +1,216 @@
+// SPDX-FileCopyrightText: NVIDIA CORPORATION & AFFILIATES
+// Copyright (c) 2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <cmath>
+
+#include <nvblox/core/log_odds.h>
+#include <nvblox/gpu_hash/internal/cuda/gpu_indexing.cuh>
+
+#include "nvblox_ros/lazy_occupancy_decay.hpp"
+
+namespace nvblox {
+
+LazyOccupancyDecay::LazyOccupancyDecay() { cudaStreamCreate(&cuda_stream_); }
+
+LazyOccupancyDecay::~LazyOccupancyDecay() { cudaStreamDestroy(cuda_stream_); }
+
+void LazyOccupancyDecay::decay_rate_hz(double decay_rate_hz) {
+  CHECK_GT(decay_rate_hz, 0.0);
+  decay_rate_hz_ = decay_rate_hz;
+}
+
+void LazyOccupancyDecay::free_region_decay_probability(
+    float free_region_decay_probability) {
+  CHECK(free_region_decay_probability >= 0.5f &&
+        free_region_decay_probability <= 1.0f);
+  free_region_decay_probability_ = free_region_decay_probability;
+}
+
+void LazyOccupancyDecay::occupied_region_decay_probability(
+    float occupied_region_decay_probability) {
+  CHECK(occupied_region_decay_probability >= 0.0f &&
+        occupied_region_decay_probability <= 0.5f);
+  occupied_region_decay_probability_ = occupied_region_decay_probability;
+}
+
+// Applies num_steps[i] decay steps to all voxels of block i at once. A single
+// step moves the log odds towards zero (unknown) and stops there, so n steps
+// are a single addition of n times the step followed by the same clamp.
+// Should be called with one thread-block per block and one thread per voxel.
+__global__ void decayBlocksKernel(
+    Index3DDeviceHashMapType<OccupancyBlock> block_hash,
+    const Index3D* block_indices, const int* num_steps,
+    float free_region_decay_log_odds, float occupied_region_decay_log_odds,
+    int* is_decayed) {
+  // Get the relevant block.
+  __shared__ OccupancyBlock* block_ptr;
+  if (threadIdx.x == 0 && threadIdx.y == 0 && threadIdx.z == 0) {
+    block_ptr = nullptr;
+    auto it = block_hash.find(block_indices[blockIdx.x]);
+    if (it != block_hash.end()) {
+      block_ptr = it->second;
+    }
+  }
+
+  __syncthreads();
+
+  if (block_ptr == nullptr) {
+    return;
+  }
+
+  OccupancyVoxel* voxel_ptr =
+      &block_ptr->voxels[threadIdx.x][threadIdx.y][threadIdx.z];
+  const float steps = static_cast<float>(num_steps[blockIdx.x]);
+  if (voxel_ptr->log_odds >= 0.0f) {
+    voxel_ptr->log_odds = fmaxf(
+        voxel_ptr->log_odds + steps * occupied_region_decay_log_odds, 0.0f);
+  } else {
+    voxel_ptr->log_odds =
+        fminf(voxel_ptr->log_odds + steps * free_region_decay_log_odds, 0.0f);
+  }
+
+  // A single voxel with information left means the block is still needed.
+  // (Benign race, all writers write the same value.)
+  if (voxel_ptr->log_odds != 0.0f) {
+    is_decayed[blockIdx.x] = 0;
+  }
+}
+
+int LazyOccupancyDecay::takeDueSteps(const Index3D& block_index,
+                                     double time_s) {
+  auto it = last_decay_time_s_.find(block_index);
+  if (it == last_decay_time_s_.end()) {
+    // First time we see this block (it wasn't allocated by an update we know
+    // of). Its contents are treated as new.
+    last_decay_time_s_.emplace(block_index, time_s);
+    return 0;
+  }
+  const int num_steps =
+      static_cast<int>(std::floor((time_s - it->second) * decay_rate_hz_));
+  if (num_steps <= 0) {
+    return 0;
+  }
+  it->second += num_steps / decay_rate_hz_;
+  return num_steps;
+}
+
+void LazyOccupancyDecay::decayBlocks(const std::vector<Index3D>& block_indices,
+                                     double time_s, OccupancyLayer* layer_ptr) {
+  CHECK_NOTNULL(layer_ptr);
+  std::vector<Index3D> blocks_to_decay;
+  std::vector<int> num_steps;
+  for (const Index3D& block_index : block_indices) {
+    if (!layer_ptr->isBlockAllocated(block_index)) {
+      continue;
+    }
+    const int block_num_steps = takeDueSteps(block_index, time_s);
+    if (block_num_steps > 0) {
+      blocks_to_decay.push_back(block_index);
+      num_steps.push_back(block_num_steps);
+    }
+  }
+  std::vector<int> is_decayed;
+  decayBlocksOnGPU(blocks_to_decay, num_steps, layer_ptr, &is_decayed);
+}
+
+void LazyOccupancyDecay::decayBlocksForUpdate(
+    const std::vector<Index3D>& block_indices, double time_s,
+    OccupancyLayer* layer_ptr) {
+  CHECK_NOTNULL(layer_ptr);
+  std::vector<Index3D> blocks_to_decay;
+  std::vector<int> num_steps;
+  for (const Index3D& block_index : block_indices) {
+    if (layer_ptr->isBlockAllocated(block_index)) {
+      const int block_num_steps = takeDueSteps(block_index, time_s);
+      if (block_num_steps > 0) {
+        blocks_to_decay.push_back(block_index);
+        num_steps.push_back(block_num_steps);
+      }
+    }
+    last_decay_time_s_[block_index] = time_s;
+  }
+  std::vector<int> is_decayed;
+  decayBlocksOnGPU(blocks_to_decay, num_steps, layer_ptr, &is_decayed);
+}
+
+std::vector<Index3D> LazyOccupancyDecay::sweep(double time_s,
+                                               OccupancyLayer* layer_ptr) {
+  CHECK_NOTNULL(layer_ptr);
+  // Decay all blocks. Also those without due steps, because we need to know
+  // if they're fully decayed.
+  const std::vector<Index3D> block_indices = layer_ptr->getAllBlockIndices();
+  Index3DHashMapType<double>::type last_decay_time_s;
+  std::vector<int> num_steps;
+  num_steps.reserve(block_indices.size());
+  for (const Index3D& block_index : block_indices) {
+    num_steps.push_back(takeDueSteps(block_index, time_s));
+    last_decay_time_s.emplace(block_index, last_decay_time_s_[block_index]);
+  }
+  // Forget blocks that were deallocated elsewhere.
+  last_decay_time_s_ = std::move(last_decay_time_s);
+
+  std::vector<int> is_decayed;
+  decayBlocksOnGPU(block_indices, num_steps, layer_ptr, &is_decayed);
+
+  // Deallocate the fully decayed blocks.
+  std::vector<Index3D> decayed_blocks;
+  for (size_t i = 0; i < block_indices.size(); i++) {
+    if (is_decayed[i]) {
+      decayed_blocks.push_back(block_indices[i]);
+      last_decay_time_s_.erase(block_indices[i]);
+    }
+  }
+  layer_ptr->clearBlocks(decayed_blocks);
+  return decayed_blocks;
+}
+
+void LazyOccupancyDecay::decayBlocksOnGPU(
+    const std::vector<Index3D>& block_indices,
+    const std::vector<int>& num_steps, OccupancyLayer* layer_ptr,
+    std::vector<int>* is_decayed) {
+  CHECK_NOTNULL(is_decayed);
+  CHECK_EQ(block_indices.size(), num_steps.size());
+  if (block_indices.empty()) {
+    is_decayed->clear();
+    return;
+  }
+
+  // Copy to device memory.
+  block_indices_device_ = block_indices;
+  num_steps_device_ = num_steps;
+  is_decayed_device_ = std::vector<int>(block_indices.size(), 1);
+
+  // Get the hash.
+  GPULayerView<OccupancyBlock> gpu_layer_view = layer_ptr->getGpuLayerView();
+
+  // Call the kernel.
+  constexpr int kVoxelsPerSide = OccupancyBlock::kVoxelsPerSide;
+  const int dim_block = block_indices.size();
+  const dim3 dim_threads(kVoxelsPerSide, kVoxelsPerSide, kVoxelsPerSide);
+  decayBlocksKernel<<<dim_block, dim_threads, 0, cuda_stream_>>>(
+      gpu_layer_view.getHash().impl_, block_indices_device_.data(),
+      num_steps_device_.data(),
+      logOddsFromProbability(free_region_decay_probability_),
+      logOddsFromProbability(occupied_region_decay_probability_),
+      is_decayed_device_.data());
+  checkCudaErrors(cudaStreamSynchronize(cuda_stream_));
+  checkCudaErrors(cudaPeekAtLastError());
+
+  *is_decayed = is_decayed_device_.toVector();
+}
+
+}  // namespace nvblox
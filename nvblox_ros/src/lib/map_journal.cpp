@@ -0,0 +1,617 @@
+// SPDX-FileCopyrightText: NVIDIA CORPORATION & AFFILIATES
+// Copyright (c) 2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <nvblox/utils/timing.h>
+#include <ros/console.h>
+
+#include "nvblox_ros/map_journal.hpp"
+
+namespace nvblox {
+namespace {
+
+constexpr char kMapJournalMagic[4] = {'N', 'V', 'B', 'J'};
+constexpr uint32_t kMapJournalVersion = 1;
+
+// Journals smaller than this are never compacted.
+constexpr uint64_t kMinCompactionSizeBytes = 16 * 1024 * 1024;
+// Size of the chunks in which compacted journals are written.
+constexpr size_t kCompactionChunkSizeBytes = 4 * 1024 * 1024;
+// Time between attempts to write a batch that failed to be written.
+constexpr std::chrono::seconds kWriteRetryDelay(1);
+
+MapJournalFileHeader makeFileHeader(float voxel_size) {
+  MapJournalFileHeader header;
+  std::memcpy(header.magic, kMapJournalMagic, sizeof(header.magic));
+  header.version = kMapJournalVersion;
+  header.voxel_size = voxel_size;
+  header.reserved = 0;
+  return header;
+}
+
+bool writeAll(int fd, const void* data, size_t num_bytes) {
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+  while (num_bytes > 0) {
+    const ssize_t num_written = ::write(fd, bytes, num_bytes);
+    if (num_written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    bytes += num_written;
+    num_bytes -= num_written;
+  }
+  return true;
+}
+
+}  // namespace
+
+uint32_t mapJournalChecksum(const uint8_t* data, size_t num_bytes) {
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < num_bytes; i++) {
+    hash = (hash ^ data[i]) * 16777619u;
+  }
+  return hash;
+}
+
+MapJournal::~MapJournal() { close(); }
+
+void MapJournal::compaction_factor(float compaction_factor) {
+  CHECK_GT(compaction_factor, 1.0f);
+  compaction_factor_ = compaction_factor;
+}
+
+bool MapJournal::open(const std::string& filename, Mapper* mapper,
+                      std::vector<Index3D>* restored_blocks) {
+  CHECK_NOTNULL(mapper);
+  CHECK_NOTNULL(restored_blocks);
+  close();
+
+  fd_ = ::open(filename.c_str(), O_RDWR | O_CREAT, 0644);
+  struct stat file_stat;
+  if (fd_ < 0 || fstat(fd_, &file_stat) != 0) {
+    ROS_WARN_STREAM("Couldn't open map journal " << filename);
+    close();
+    return false;
+  }
+  filename_ = filename;
+  voxel_size_ = mapper->voxel_size_m();
+  file_size_ = static_cast<uint64_t>(file_stat.st_size);
+
+  if (file_size_ == 0) {
+    // A new journal.
+    const MapJournalFileHeader header = makeFileHeader(voxel_size_);
+    if (!writeAll(fd_, &header, sizeof(header))) {
+      ROS_WARN_STREAM("Couldn't write to map journal " << filename);
+      close();
+      return false;
+    }
+    file_size_ = sizeof(header);
+  } else {
+    MapJournalFileHeader header;
+    if (pread(fd_, &header, sizeof(header), 0) !=
+            static_cast<ssize_t>(sizeof(header)) ||
+        std::memcmp(header.magic, kMapJournalMagic, sizeof(header.magic)) !=
+            0 ||
+        header.version != kMapJournalVersion ||
+        header.voxel_size != voxel_size_) {
+      ROS_WARN_STREAM(filename << " is not a (version " << kMapJournalVersion
+                               << ") map journal of a map with voxel size "
+                               << voxel_size_);
+      close();
+      return false;
+    }
+
+    timing::Timer replay_timer("ros/journal/replay");
+    const uint64_t valid_size = scan();
+    if (valid_size < file_size_) {
+      ROS_WARN_STREAM("Dropping an incomplete record at the end of "
+                      << filename);
+      if (ftruncate(fd_, valid_size) != 0) {
+        ROS_WARN_STREAM("Couldn't truncate " << filename);
+        close();
+        return false;
+      }
+      file_size_ = valid_size;
+    }
+    restoreLayer(
+        &record_index_[static_cast<size_t>(BlockMapLayerType::kTsdf)],
+        mapper->layers().getPtr<TsdfLayer>(), restored_blocks);
+    restoreLayer(
+        &record_index_[static_cast<size_t>(BlockMapLayerType::kColor)],
+        mapper->layers().getPtr<ColorLayer>(), restored_blocks);
+    restoreLayer(
+        &record_index_[static_cast<size_t>(BlockMapLayerType::kOccupancy)],
+        mapper->layers().getPtr<OccupancyLayer>(), restored_blocks);
+    // Blocks restored in several layers are only reported once.
+    const Index3DSet unique_blocks(restored_blocks->begin(),
+                                   restored_blocks->end());
+    restored_blocks->assign(unique_blocks.begin(), unique_blocks.end());
+  }
+  lseek(fd_, file_size_, SEEK_SET);
+
+  live_bytes_ = 0;
+  for (size_t i = 0; i < kNumLayerTypes; i++) {
+    for (const auto& index_and_location : record_index_[i]) {
+      journaled_blocks_[i].insert(index_and_location.first);
+      live_bytes_ +=
+          sizeof(MapJournalRecordHeader) + index_and_location.second.num_bytes;
+    }
+  }
+  statistics_ = Statistics();
+  statistics_.file_size_bytes = file_size_;
+  statistics_.live_bytes = live_bytes_;
+
+  is_open_ = true;
+  stop_ = false;
+  io_thread_ = std::thread(&MapJournal::ioLoop, this);
+  return true;
+}
+
+void MapJournal::close() {
+  if (io_thread_.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    queue_condition_.notify_one();
+    io_thread_.join();
+  }
+  if (fd_ >= 0) {
+    ::close(fd_);
+  }
+  fd_ = -1;
+  is_open_ = false;
+  filename_.clear();
+  dirty_blocks_.clear();
+  read_queue_.clear();
+  read_records_.clear();
+  read_blocks_.clear();
+  for (size_t i = 0; i < kNumLayerTypes; i++) {
+    journaled_blocks_[i].clear();
+    record_index_[i].clear();
+  }
+  file_size_ = 0;
+  live_bytes_ = 0;
+}
+
+uint64_t MapJournal::scan() {
+  uint64_t offset = sizeof(MapJournalFileHeader);
+  MapJournalRecordHeader header;
+  while (offset + sizeof(header) <= file_size_) {
+    if (pread(fd_, &header, sizeof(header), offset) !=
+            static_cast<ssize_t>(sizeof(header)) ||
+        header.magic != kMapJournalRecordMagic ||
+        header.layer_type >= kNumLayerTypes ||
+        offset + sizeof(header) + header.num_bytes > file_size_) {
+      break;
+    }
+    RecordIndex& record_index = record_index_[header.layer_type];
+    const Index3D block_index(header.x, header.y, header.z);
+    if (header.num_bytes == 0) {
+      record_index.erase(block_index);
+    } else {
+      record_index[block_index] = RecordLocation{offset, header.num_bytes};
+    }
+    offset += sizeof(header) + header.num_bytes;
+  }
+  return offset;
+}
+
+bool MapJournal::readRecord(const RecordLocation& location,
+                            Record* record) const {
+  CHECK_NOTNULL(record);
+  record->data.resize(location.num_bytes);
+  return pread(fd_, &record->header, sizeof(record->header),
+               location.offset) ==
+             static_cast<ssize_t>(sizeof(record->header)) &&
+         pread(fd_, record->data.data(), record->data.size(),
+               location.offset + sizeof(record->header)) ==
+             static_cast<ssize_t>(record->data.size()) &&
+         mapJournalChecksum(record->data.data(), record->data.size()) ==
+             record->header.checksum;
+}
+
+void MapJournal::markDirty(const std::vector<Index3D>& block_indices) {
+  if (is_open_) {
+    dirty_blocks_.insert(block_indices.begin(), block_indices.end());
+  }
+}
+
+void MapJournal::markAllDirty(const Mapper& mapper) {
+  if (!is_open_) {
+    return;
+  }
+  markDirty(mapper.tsdf_layer().getAllBlockIndices());
+  markDirty(mapper.color_layer().getAllBlockIndices());
+  markDirty(mapper.occupancy_layer().getAllBlockIndices());
+  for (const Index3DSet& journaled_blocks : journaled_blocks_) {
+    dirty_blocks_.insert(journaled_blocks.begin(), journaled_blocks.end());
+  }
+}
+
+void MapJournal::markClean(const std::vector<Index3D>& block_indices) {
+  for (const Index3D& block_index : block_indices) {
+    dirty_blocks_.erase(block_index);
+  }
+}
+
+size_t MapJournal::flush(const Mapper& mapper, size_t max_num_bytes) {
+  if (!is_open_ || dirty_blocks_.empty()) {
+    return 0;
+  }
+  timing::Timer flush_timer("ros/journal/flush");
+  std::vector<Record> records;
+  size_t num_bytes = 0;
+  auto it = dirty_blocks_.begin();
+  while (it != dirty_blocks_.end() && num_bytes < max_num_bytes) {
+    num_bytes += appendRecords(mapper, *it, &records);
+    it = dirty_blocks_.erase(it);
+  }
+  queueRecords(std::move(records));
+  return num_bytes;
+}
+
+size_t MapJournal::flush(const Mapper& mapper,
+                         const std::vector<Index3D>& block_indices) {
+  if (!is_open_) {
+    return 0;
+  }
+  timing::Timer flush_timer("ros/journal/flush");
+  std::vector<Record> records;
+  size_t num_bytes = 0;
+  for (const Index3D& block_index : block_indices) {
+    if (dirty_blocks_.erase(block_index) > 0) {
+      num_bytes += appendRecords(mapper, block_index, &records);
+    }
+  }
+  queueRecords(std::move(records));
+  return num_bytes;
+}
+
+size_t MapJournal::appendRecords(const Mapper& mapper,
+                                 const Index3D& block_index,
+                                 std::vector<Record>* records) {
+  return appendRecord(mapper.tsdf_layer(), BlockMapLayerType::kTsdf,
+                      block_index, records) +
+         appendRecord(mapper.color_layer(), BlockMapLayerType::kColor,
+                      block_index, records) +
+         appendRecord(mapper.occupancy_layer(), BlockMapLayerType::kOccupancy,
+                      block_index, records);
+}
+
+void MapJournal::queueRecords(std::vector<Record>&& records) {
+  if (records.empty()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    queue_.push_back(std::move(records));
+  }
+  queue_condition_.notify_one();
+}
+
+void MapJournal::requestRead(const std::vector<Index3D>& block_indices) {
+  if (!is_open_ || block_indices.empty()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    read_queue_.push_back(block_indices);
+  }
+  queue_condition_.notify_one();
+}
+
+std::vector<Index3D> MapJournal::insertReadBlocks(Mapper* mapper) {
+  CHECK_NOTNULL(mapper);
+  std::vector<Record> records;
+  std::vector<Index3D> read_blocks;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    records.swap(read_records_);
+    read_blocks.swap(read_blocks_);
+  }
+  if (records.empty()) {
+    return read_blocks;
+  }
+  timing::Timer insert_timer("ros/journal/insert_read_blocks");
+  for (const Record& record : records) {
+    switch (static_cast<BlockMapLayerType>(record.header.layer_type)) {
+      case BlockMapLayerType::kTsdf:
+        insertRecord(record, mapper->layers().getPtr<TsdfLayer>());
+        break;
+      case BlockMapLayerType::kColor:
+        insertRecord(record, mapper->layers().getPtr<ColorLayer>());
+        break;
+      case BlockMapLayerType::kOccupancy:
+        insertRecord(record, mapper->layers().getPtr<OccupancyLayer>());
+        break;
+    }
+  }
+  return read_blocks;
+}
+
+void MapJournal::waitUntilIdle() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  idle_condition_.wait(lock, [this]() {
+    // Failed writes don't complete until they're retried successfully.
+    return !is_busy_ && (queue_.empty() || write_failed_) &&
+           read_queue_.empty();
+  });
+}
+
+MapJournal::Statistics MapJournal::statistics() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return statistics_;
+}
+
+bool MapJournal::writeFailed() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return write_failed_;
+}
+
+void MapJournal::ioLoop() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  // When to retry writing the front batch, after it failed to be written.
+  std::chrono::steady_clock::time_point retry_time;
+  while (true) {
+    // Reads aren't held up by a failed write, they see the queued records.
+    const bool wait_for_retry = write_failed_ && !stop_;
+    const auto has_work = [this, wait_for_retry]() {
+      return stop_ || (!queue_.empty() && !wait_for_retry) ||
+             !read_queue_.empty();
+    };
+    if (wait_for_retry) {
+      queue_condition_.wait_until(lock, retry_time, has_work);
+    } else {
+      queue_condition_.wait(lock, has_work);
+    }
+    const bool write_due = !wait_for_retry || stop_ ||
+                           std::chrono::steady_clock::now() >= retry_time;
+    // Writes go first, such that reads see all records queued before them.
+    // Everything queued before stopping is still processed.
+    is_busy_ = true;
+    if (!queue_.empty() && write_due) {
+      // The batch stays queued until it's written, such that it can be
+      // retried.
+      const std::vector<Record>& records = queue_.front();
+      lock.unlock();
+      const bool success = writeRecords(records);
+      lock.lock();
+      write_failed_ = !success;
+      if (success) {
+        queue_.pop_front();
+      } else {
+        ++statistics_.num_failed_writes;
+        retry_time = std::chrono::steady_clock::now() + kWriteRetryDelay;
+        if (stop_) {
+          size_t num_records = 0;
+          for (const std::vector<Record>& batch : queue_) {
+            num_records += batch.size();
+          }
+          ROS_ERROR_STREAM("Giving up on writing "
+                           << num_records << " records to map journal "
+                           << filename_);
+          queue_.clear();
+        }
+      }
+    } else if (!read_queue_.empty()) {
+      const std::vector<Index3D> block_indices =
+          std::move(read_queue_.front());
+      read_queue_.pop_front();
+      lock.unlock();
+      readBlocks(block_indices);
+      lock.lock();
+    } else if (stop_) {
+      is_busy_ = false;
+      idle_condition_.notify_all();
+      return;
+    }
+    is_busy_ = false;
+    idle_condition_.notify_all();
+  }
+}
+
+bool MapJournal::writeRecords(const std::vector<Record>& records) {
+  timing::Timer write_timer("ros/journal/write");
+  // Write the whole batch with a single system call.
+  std::vector<uint8_t> buffer;
+  for (const Record& record : records) {
+    const uint8_t* header_bytes =
+        reinterpret_cast<const uint8_t*>(&record.header);
+    buffer.insert(buffer.end(), header_bytes,
+                  header_bytes + sizeof(record.header));
+    buffer.insert(buffer.end(), record.data.begin(), record.data.end());
+  }
+  if (!writeAll(fd_, buffer.data(), buffer.size()) || fdatasync(fd_) != 0) {
+    ROS_ERROR_STREAM("Failed writing to map journal " << filename_);
+    // Drop the partial batch, replaying would stop there anyways. It's
+    // written again on the next attempt.
+    if (ftruncate(fd_, file_size_) != 0) {
+      ROS_ERROR_STREAM("Couldn't truncate map journal " << filename_);
+    }
+    lseek(fd_, file_size_, SEEK_SET);
+    return false;
+  }
+
+  // Only update the index once the records are on disk.
+  uint64_t offset = file_size_;
+  for (const Record& record : records) {
+    RecordIndex& record_index = record_index_[record.header.layer_type];
+    const Index3D block_index(record.header.x, record.header.y,
+                              record.header.z);
+    auto it = record_index.find(block_index);
+    if (it != record_index.end()) {
+      live_bytes_ -= sizeof(MapJournalRecordHeader) + it->second.num_bytes;
+      record_index.erase(it);
+    }
+    if (record.header.num_bytes > 0) {
+      record_index[block_index] =
+          RecordLocation{offset, record.header.num_bytes};
+      live_bytes_ += sizeof(MapJournalRecordHeader) + record.header.num_bytes;
+    }
+    offset += sizeof(MapJournalRecordHeader) + record.header.num_bytes;
+  }
+  file_size_ = offset;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    statistics_.num_records_written += records.size();
+    statistics_.num_bytes_written += buffer.size();
+    statistics_.file_size_bytes = file_size_;
+    statistics_.live_bytes = live_bytes_;
+  }
+
+  if (file_size_ > kMinCompactionSizeBytes &&
+      file_size_ > compaction_factor_ *
+                       (live_bytes_ + sizeof(MapJournalFileHeader))) {
+    compact();
+  }
+  return true;
+}
+
+void MapJournal::readBlocks(const std::vector<Index3D>& block_indices) {
+  timing::Timer read_timer("ros/journal/read");
+  std::vector<Record> records;
+  // Position of the block's record in records, per layer type.
+  std::array<Index3DHashMapType<size_t>::type, kNumLayerTypes>
+      record_positions;
+  for (const Index3D& block_index : block_indices) {
+    for (size_t i = 0; i < kNumLayerTypes; i++) {
+      const auto it = record_index_[i].find(block_index);
+      if (it == record_index_[i].end()) {
+        continue;
+      }
+      Record record;
+      if (!readRecord(it->second, &record)) {
+        ROS_WARN_STREAM("Couldn't read the record of block "
+                        << block_index.transpose() << " in " << filename_);
+        continue;
+      }
+      record_positions[i][block_index] = records.size();
+      records.push_back(std::move(record));
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  // Records which couldn't be written yet are newer than the ones in the
+  // file.
+  if (!queue_.empty()) {
+    const Index3DSet requested_blocks(block_indices.begin(),
+                                      block_indices.end());
+    for (const std::vector<Record>& batch : queue_) {
+      for (const Record& record : batch) {
+        const Index3D block_index(record.header.x, record.header.y,
+                                  record.header.z);
+        if (requested_blocks.count(block_index) == 0) {
+          continue;
+        }
+        auto& positions = record_positions[record.header.layer_type];
+        const auto it = positions.find(block_index);
+        if (it == positions.end()) {
+          positions[block_index] = records.size();
+          records.push_back(record);
+        } else {
+          records[it->second] = record;
+        }
+      }
+    }
+  }
+  statistics_.num_records_read += records.size();
+  std::move(records.begin(), records.end(),
+            std::back_inserter(read_records_));
+  read_blocks_.insert(read_blocks_.end(), block_indices.begin(),
+                      block_indices.end());
+}
+
+void MapJournal::compact() {
+  timing::Timer compact_timer("ros/journal/compact");
+  // Write the live records to a new file and replace the journal with it
+  // once complete, such that a crash leaves either of the two.
+  const std::string compact_filename = filename_ + ".compact";
+  const int compact_fd =
+      ::open(compact_filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (compact_fd < 0) {
+    ROS_WARN_STREAM("Couldn't open " << compact_filename);
+    return;
+  }
+
+  const MapJournalFileHeader header = makeFileHeader(voxel_size_);
+  std::vector<uint8_t> chunk(reinterpret_cast<const uint8_t*>(&header),
+                             reinterpret_cast<const uint8_t*>(&header) +
+                                 sizeof(header));
+  uint64_t offset = sizeof(header);
+  std::array<RecordIndex, kNumLayerTypes> compact_index;
+  bool success = true;
+  for (size_t i = 0; i < kNumLayerTypes && success; i++) {
+    for (const auto& index_and_location : record_index_[i]) {
+      const RecordLocation& location = index_and_location.second;
+      const size_t record_size =
+          sizeof(MapJournalRecordHeader) + location.num_bytes;
+      const size_t chunk_size = chunk.size();
+      chunk.resize(chunk_size + record_size);
+      if (pread(fd_, chunk.data() + chunk_size, record_size,
+                location.offset) != static_cast<ssize_t>(record_size)) {
+        success = false;
+        break;
+      }
+      compact_index[i][index_and_location.first] =
+          RecordLocation{offset, location.num_bytes};
+      offset += record_size;
+      if (chunk.size() >= kCompactionChunkSizeBytes) {
+        success = writeAll(compact_fd, chunk.data(), chunk.size());
+        chunk.clear();
+        if (!success) {
+          break;
+        }
+      }
+    }
+  }
+  success = success && writeAll(compact_fd, chunk.data(), chunk.size()) &&
+            fdatasync(compact_fd) == 0 &&
+            std::rename(compact_filename.c_str(), filename_.c_str()) == 0;
+  if (!success) {
+    ROS_WARN_STREAM("Failed to compact map journal " << filename_);
+    ::close(compact_fd);
+    std::remove(compact_filename.c_str());
+    return;
+  }
+
+  ::close(fd_);
+  fd_ = compact_fd;
+  record_index_ = std::move(compact_index);
+  file_size_ = offset;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++statistics_.num_compactions;
+  statistics_.file_size_bytes = file_size_;
+}
+
+}  // namespace nvblox
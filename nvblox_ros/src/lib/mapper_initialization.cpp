@@ -15,10 +15,13 @@
 //
 // SPDX-License-Identifier: Apache-2.0
 
+#include <glog/logging.h>
+
 #include <string>
 
 #include <nvblox/integrators/weighting_function.h>
 #include <nvblox/mapper/mapper.h>
+#include <yaml-cpp/yaml.h>
 
 #include "nvblox_ros/mapper_initialization.hpp"
 
@@ -43,13 +46,25 @@ WeightingFunctionType weighting_function_type_from_string(
   }
 }
 
-void initializeMapper(Mapper* mapper_ptr, ros::NodeHandle& nh) {
+namespace {
+
+// Such that initializeMapperFromParameters() finds both sources.
+using nvblox::getParam;
+
+template <typename T>
+bool getParam(ros::NodeHandle& nh, const std::string& name, T* value) {
+  return nh.getParam(name, *value);
+}
+
+template <typename ParameterSource>
+void initializeMapperFromParameters(Mapper* mapper_ptr,
+                                    ParameterSource& parameters) {
   ROS_INFO_STREAM("Initialize Mapper:");
 
   // tsdf or occupancy integrator
   float projective_integrator_max_integration_distance_m = 0.0f;
-  if (nh.getParam("projective_integrator_max_integration_distance_m",
-                  projective_integrator_max_integration_distance_m)) {
+  if (getParam(parameters, "projective_integrator_max_integration_distance_m",
+              &projective_integrator_max_integration_distance_m)) {
     mapper_ptr->tsdf_integrator().max_integration_distance_m(
         projective_integrator_max_integration_distance_m);
     mapper_ptr->occupancy_integrator().max_integration_distance_m(
@@ -57,8 +72,9 @@ void initializeMapper(Mapper* mapper_ptr, ros::NodeHandle& nh) {
   }
 
   float lidar_projective_integrator_max_integration_distance_m = 0.0f;
-  if (nh.getParam("lidar_projective_integrator_max_integration_distance_m",
-                  lidar_projective_integrator_max_integration_distance_m)) {
+  if (getParam(parameters,
+              "lidar_projective_integrator_max_integration_distance_m",
+              &lidar_projective_integrator_max_integration_distance_m)) {
     mapper_ptr->lidar_tsdf_integrator().max_integration_distance_m(
         lidar_projective_integrator_max_integration_distance_m);
     mapper_ptr->lidar_occupancy_integrator().max_integration_distance_m(
@@ -66,8 +82,8 @@ void initializeMapper(Mapper* mapper_ptr, ros::NodeHandle& nh) {
   }
 
   float projective_integrator_truncation_distance_vox = 0.0f;
-  if (nh.getParam("projective_integrator_truncation_distance_vox",
-                  projective_integrator_truncation_distance_vox)) {
+  if (getParam(parameters, "projective_integrator_truncation_distance_vox",
+              &projective_integrator_truncation_distance_vox)) {
     mapper_ptr->tsdf_integrator().truncation_distance_vox(
         projective_integrator_truncation_distance_vox);
     mapper_ptr->occupancy_integrator().truncation_distance_vox(
@@ -82,7 +98,7 @@ void initializeMapper(Mapper* mapper_ptr, ros::NodeHandle& nh) {
   // NOTE(alexmillane): Currently weighting mode does not affect the occupancy
   // integrator.
   std::string weighting_mode_param = "";
-  if (nh.getParam("weighting_mode", weighting_mode_param)) {
+  if (getParam(parameters, "weighting_mode", &weighting_mode_param)) {
     const WeightingFunctionType weight_mode =
         weighting_function_type_from_string(weighting_mode_param);
     mapper_ptr->tsdf_integrator().weighting_function_type(weight_mode);
@@ -90,15 +106,16 @@ void initializeMapper(Mapper* mapper_ptr, ros::NodeHandle& nh) {
   }
 
   float tsdf_integrator_max_weight = 0.0f;
-  if (nh.getParam("tsdf_integrator_max_weight", tsdf_integrator_max_weight)) {
+  if (getParam(parameters, "tsdf_integrator_max_weight",
+              &tsdf_integrator_max_weight)) {
     mapper_ptr->tsdf_integrator().max_weight(tsdf_integrator_max_weight);
     mapper_ptr->lidar_tsdf_integrator().max_weight(tsdf_integrator_max_weight);
   }
 
   // occupancy integrator
   float free_region_occupancy_probability = 0.0f;
-  if (nh.getParam("free_region_occupancy_probability",
-                  free_region_occupancy_probability)) {
+  if (getParam(parameters, "free_region_occupancy_probability",
+              &free_region_occupancy_probability)) {
     mapper_ptr->occupancy_integrator().free_region_occupancy_probability(
         free_region_occupancy_probability);
     mapper_ptr->lidar_occupancy_integrator().free_region_occupancy_probability(
@@ -106,8 +123,8 @@ void initializeMapper(Mapper* mapper_ptr, ros::NodeHandle& nh) {
   }
 
   float occupied_region_occupancy_probability = 0.0f;
-  if (nh.getParam("occupied_region_occupancy_probability",
-                  occupied_region_occupancy_probability)) {
+  if (getParam(parameters, "occupied_region_occupancy_probability",
+              &occupied_region_occupancy_probability)) {
     mapper_ptr->occupancy_integrator().occupied_region_occupancy_probability(
         occupied_region_occupancy_probability);
     mapper_ptr->lidar_occupancy_integrator()
@@ -116,8 +133,8 @@ void initializeMapper(Mapper* mapper_ptr, ros::NodeHandle& nh) {
   }
 
   float unobserved_region_occupancy_probability = 0.0f;
-  if (nh.getParam("unobserved_region_occupancy_probability",
-                  unobserved_region_occupancy_probability)) {
+  if (getParam(parameters, "unobserved_region_occupancy_probability",
+              &unobserved_region_occupancy_probability)) {
     mapper_ptr->occupancy_integrator().unobserved_region_occupancy_probability(
         unobserved_region_occupancy_probability);
     mapper_ptr->lidar_occupancy_integrator()
@@ -126,8 +143,8 @@ void initializeMapper(Mapper* mapper_ptr, ros::NodeHandle& nh) {
   }
 
   float occupied_region_half_width_m = 0.0f;
-  if (nh.getParam("occupied_region_half_width_m",
-                  occupied_region_half_width_m)) {
+  if (getParam(parameters, "occupied_region_half_width_m",
+              &occupied_region_half_width_m)) {
     mapper_ptr->occupancy_integrator().occupied_region_half_width_m(
         occupied_region_half_width_m);
     mapper_ptr->lidar_occupancy_integrator().occupied_region_half_width_m(
@@ -135,57 +152,85 @@ void initializeMapper(Mapper* mapper_ptr, ros::NodeHandle& nh) {
   }
 
   float free_region_decay_probability = 0.0f;
-  if (nh.getParam("free_region_decay_probability",
-                  free_region_decay_probability)) {
+  if (getParam(parameters, "free_region_decay_probability",
+              &free_region_decay_probability)) {
     mapper_ptr->occupancy_decay_integrator().free_region_decay_probability(
         free_region_decay_probability);
   }
 
   float occupied_region_decay_probability = 0.0f;
-  if (nh.getParam("occupied_region_decay_probability",
-                  occupied_region_decay_probability)) {
+  if (getParam(parameters, "occupied_region_decay_probability",
+              &occupied_region_decay_probability)) {
     mapper_ptr->occupancy_decay_integrator().occupied_region_decay_probability(
         occupied_region_decay_probability);
   }
 
   float mesh_integrator_min_weight = 0.0f;
-  if (nh.getParam("mesh_integrator_min_weight", mesh_integrator_min_weight)) {
+  if (getParam(parameters, "mesh_integrator_min_weight",
+              &mesh_integrator_min_weight)) {
     mapper_ptr->mesh_integrator().min_weight(mesh_integrator_min_weight);
   }
 
   bool mesh_integrator_weld_vertices = false;
-  if (nh.getParam("mesh_integrator_weld_vertices",
-                  mesh_integrator_weld_vertices)) {
+  if (getParam(parameters, "mesh_integrator_weld_vertices",
+              &mesh_integrator_weld_vertices)) {
     mapper_ptr->mesh_integrator().weld_vertices(mesh_integrator_weld_vertices);
   }
 
   // color integrator
   float color_integrator_max_integration_distance_m = 0.0f;
-  if (nh.getParam("color_integrator_max_integration_distance_m",
-                  color_integrator_max_integration_distance_m)) {
+  if (getParam(parameters, "color_integrator_max_integration_distance_m",
+              &color_integrator_max_integration_distance_m)) {
     mapper_ptr->color_integrator().max_integration_distance_m(
         color_integrator_max_integration_distance_m);
   }
 
   // esdf integrator
   float esdf_integrator_min_weight = 0.0f;
-  if (nh.getParam("esdf_integrator_min_weight", esdf_integrator_min_weight)) {
+  if (getParam(parameters, "esdf_integrator_min_weight",
+              &esdf_integrator_min_weight)) {
     mapper_ptr->esdf_integrator().min_weight(esdf_integrator_min_weight);
   }
 
   float esdf_integrator_max_site_distance_vox = 0.0f;
-  if (nh.getParam("esdf_integrator_max_site_distance_vox",
-                  esdf_integrator_max_site_distance_vox)) {
+  if (getParam(parameters, "esdf_integrator_max_site_distance_vox",
+              &esdf_integrator_max_site_distance_vox)) {
     mapper_ptr->esdf_integrator().max_site_distance_vox(
         esdf_integrator_max_site_distance_vox);
   }
 
   float esdf_integrator_max_distance_m = 0.0f;
-  if (nh.getParam("esdf_integrator_max_distance_m",
-                  esdf_integrator_max_distance_m)) {
+  if (getParam(parameters, "esdf_integrator_max_distance_m",
+              &esdf_integrator_max_distance_m)) {
     mapper_ptr->esdf_integrator().max_distance_m(
         esdf_integrator_max_distance_m);
   }
 }
 
+}  // namespace
+
+void initializeMapper(Mapper* mapper_ptr, ros::NodeHandle& nh) {
+  initializeMapperFromParameters(mapper_ptr, nh);
+}
+
+void initializeMapper(Mapper* mapper_ptr, const YAML::Node& parameters) {
+  initializeMapperFromParameters(mapper_ptr, parameters);
+}
+
+bool loadParameterFile(const std::string& filename, YAML::Node* parameters) {
+  CHECK_NOTNULL(parameters);
+  try {
+    *parameters = YAML::LoadFile(filename);
+  } catch (const YAML::Exception& e) {
+    ROS_ERROR_STREAM("Couldn't load the parameters from " << filename << ": "
+                                                          << e.what());
+    return false;
+  }
+  if (!parameters->IsMap()) {
+    ROS_ERROR_STREAM(filename << " doesn't contain a map of parameters.");
+    return false;
+  }
+  return true;
+}
+
 }  // namespace nvblox
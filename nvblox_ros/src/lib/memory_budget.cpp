@@ -0,0 +1,165 @@
+// SPDX-FileCopyrightText: NVIDIA CORPORATION & AFFILIATES
+// Copyright (c) 2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <string>
+#include <vector>
+
+#include <nvblox/utils/timing.h>
+
+#include "nvblox_ros/memory_budget.hpp"
+
+namespace nvblox {
+
+void MemoryBudget::touch(const std::vector<Index3D>& block_indices) {
+  for (const Index3D& block_index : block_indices) {
+    auto it = lru_positions_.find(block_index);
+    if (it != lru_positions_.end()) {
+      lru_blocks_.splice(lru_blocks_.end(), lru_blocks_, it->second);
+    } else {
+      lru_positions_.emplace(
+          block_index, lru_blocks_.insert(lru_blocks_.end(), block_index));
+    }
+  }
+}
+
+std::vector<Index3D> MemoryBudget::selectBlocksToEvict(
+    const std::vector<LayerMemoryUsage>& layers, const Vector3f& center,
+    float block_size) {
+  timing::Timer select_timer("ros/memory_budget/select");
+  // Number of blocks each layer is over its budget.
+  std::vector<size_t> num_excess_blocks(layers.size(), 0);
+  bool is_over_budget = false;
+  for (size_t i = 0; i < layers.size(); i++) {
+    const LayerMemoryUsage& layer = layers[i];
+    for (const Index3D& block_index : layer.block_indices) {
+      if (lru_positions_.count(block_index) == 0) {
+        lru_positions_.emplace(
+            block_index, lru_blocks_.insert(lru_blocks_.end(), block_index));
+      }
+    }
+    if (layer.budget_bytes > 0 && layer.bytes_per_block > 0 &&
+        layer.num_bytes() > layer.budget_bytes) {
+      num_excess_blocks[i] =
+          layer.num_blocks() - layer.budget_bytes / layer.bytes_per_block;
+      is_over_budget = true;
+    }
+  }
+
+  // Also forgets the blocks which were deleted by others on the way.
+  std::vector<Index3D> blocks_to_evict;
+  auto it = lru_blocks_.begin();
+  while (it != lru_blocks_.end()) {
+    const Index3D block_index = *it;
+    bool is_allocated = false;
+    bool reduces_excess = false;
+    for (size_t i = 0; i < layers.size(); i++) {
+      if (layers[i].block_indices.count(block_index) > 0) {
+        is_allocated = true;
+        reduces_excess |= num_excess_blocks[i] > 0;
+      }
+    }
+    if (!is_allocated) {
+      lru_positions_.erase(block_index);
+      it = lru_blocks_.erase(it);
+      continue;
+    }
+    const AxisAlignedBoundingBox block_aabb =
+        getAABBOfBlock(block_size, block_index);
+    const Vector3f closest =
+        center.cwiseMax(block_aabb.min()).cwiseMin(block_aabb.max());
+    if (!is_over_budget || !reduces_excess ||
+        (closest - center).norm() < protection_radius_m_) {
+      ++it;
+      continue;
+    }
+
+    is_over_budget = false;
+    for (size_t i = 0; i < layers.size(); i++) {
+      if (layers[i].block_indices.count(block_index) > 0) {
+        ++num_evicted_blocks_[layers[i].name];
+        if (num_excess_blocks[i] > 0) {
+          --num_excess_blocks[i];
+        }
+      }
+      is_over_budget |= num_excess_blocks[i] > 0;
+    }
+    blocks_to_evict.push_back(block_index);
+    lru_positions_.erase(block_index);
+    it = lru_blocks_.erase(it);
+  }
+  return blocks_to_evict;
+}
+
+LayerMemoryUsage getMeshLayerMemoryUsage(const std::string& name,
+                                         const MeshLayer& layer) {
+  LayerMemoryUsage usage = getLayerMemoryUsage(name, layer, 0);
+  for (const Index3D& block_index : usage.block_indices) {
+    const MeshBlock::ConstPtr block = layer.getBlockAtIndex(block_index);
+    if (block) {
+      usage.extra_bytes += block->vertices.capacity() * sizeof(Vector3f) +
+                           block->normals.capacity() * sizeof(Vector3f) +
+                           block->colors.capacity() * sizeof(Color) +
+                           block->triangles.capacity() * sizeof(int);
+    }
+  }
+  return usage;
+}
+
+void BlockAllocationTracker::update(const std::vector<LayerMemoryUsage>& layers,
+                                    double time_s) {
+  for (const LayerMemoryUsage& layer : layers) {
+    auto it = layers_.find(layer.name);
+    if (it == layers_.end()) {
+      // Everything that exists at the first update counts as allocated.
+      LayerState& state = layers_[layer.name];
+      state.block_indices = layer.block_indices;
+      state.time_s = time_s;
+      state.counts.num_allocated_blocks = layer.num_blocks();
+      continue;
+    }
+    LayerState& state = it->second;
+    size_t num_allocated = 0;
+    for (const Index3D& block_index : layer.block_indices) {
+      num_allocated += state.block_indices.count(block_index) == 0;
+    }
+    // Blocks are either kept, freed or allocated.
+    const size_t num_freed =
+        state.block_indices.size() + num_allocated - layer.num_blocks();
+    const double period_s = time_s - state.time_s;
+    state.counts.num_allocated_blocks += num_allocated;
+    state.counts.num_freed_blocks += num_freed;
+    if (period_s > 0.0) {
+      state.counts.allocated_blocks_per_s = num_allocated / period_s;
+      state.counts.freed_blocks_per_s = num_freed / period_s;
+    }
+    state.block_indices = layer.block_indices;
+    state.time_s = time_s;
+  }
+}
+
+BlockAllocationTracker::Counts BlockAllocationTracker::counts(
+    const std::string& layer_name) const {
+  const auto it = layers_.find(layer_name);
+  return it != layers_.end() ? it->second.counts : Counts();
+}
+
+uint64_t MemoryBudget::numEvictedBlocks(const std::string& layer_name) const {
+  const auto it = num_evicted_blocks_.find(layer_name);
+  return it != num_evicted_blocks_.end() ? it->second : 0;
+}
+
+}  // namespace nvblox
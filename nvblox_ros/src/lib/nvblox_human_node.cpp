@@ -15,12 +15,17 @@
 //
 // SPDX-License-Identifier: Apache-2.0
 
+#include <algorithm>
+#include <cmath>
 #include <limits>
 #include <memory>
+#include <sstream>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <geometry_msgs/Point.h>
+#include <nvblox_msgs/TrackedInstanceArray.h>
 #include <visualization_msgs/Marker.h>
 
 #include <nvblox/io/csv.h>
@@ -31,9 +36,10 @@ namespace nvblox {
 
 NvbloxHumanNode::NvbloxHumanNode(ros::NodeHandle& nh,
                                  ros::NodeHandle& nh_private)
-    : NvbloxNode(nh, nh_private),
+    : NvbloxNode(nh, nh_private, /*open_map_storage=*/false),
       human_pointcloud_C_device_(MemoryType::kDevice),
-      human_pointcloud_L_device_(MemoryType::kDevice) {
+      human_pointcloud_L_device_(MemoryType::kDevice),
+      human_block_centers_L_device_(MemoryType::kDevice) {
   ROS_INFO_STREAM("NvbloxHumanNode::NvbloxHumanNode()");
 
   // Get parameters specific to the human node.
@@ -41,6 +47,8 @@ NvbloxHumanNode::NvbloxHumanNode(ros::NodeHandle& nh,
 
   // Initialize the MultiMapper and overwrite the base-class node's Mapper.
   initializeMultiMapper();
+  // Only now that the final static mapper exists.
+  openMapStorage();
 
   // Subscribe to topics
   // NOTE(alexmillane): This function modifies to base class subscriptions to
@@ -56,6 +64,35 @@ void NvbloxHumanNode::getParameters() {
   // TODO(TT) how to handle this node?
   nh_private_.getParam("human_occupancy_decay_rate_hz", human_occupancy_decay_rate_hz_);
   nh_private_.getParam("human_esdf_update_rate_hz", human_esdf_update_rate_hz_);
+  nh_private_.getParam("human_occupancy_lazy_decay",
+                       human_occupancy_lazy_decay_);
+  nh_private_.getParam("human_occupancy_sweep_rate_hz",
+                       human_occupancy_sweep_rate_hz_);
+  nh_private_.getParam("human_esdf_limit_to_region",
+                       human_esdf_limit_to_region_);
+  nh_private_.getParam("human_esdf_region_padding_m",
+                       human_esdf_region_padding_m_);
+  nh_private_.getParam("human_esdf_region_timeout_s",
+                       human_esdf_region_timeout_s_);
+  nh_private_.getParam("human_cluster_max_gap_voxels",
+                       human_cluster_max_gap_voxels_);
+  nh_private_.getParam("human_cluster_min_voxels", human_cluster_min_voxels_);
+  float human_tracking_max_association_distance_m =
+      human_tracker_.max_association_distance_m();
+  nh_private_.getParam("human_tracking_max_association_distance_m",
+                       human_tracking_max_association_distance_m);
+  human_tracker_.max_association_distance_m(
+      human_tracking_max_association_distance_m);
+  double human_tracking_timeout_s = human_tracker_.timeout_s();
+  nh_private_.getParam("human_tracking_timeout_s", human_tracking_timeout_s);
+  human_tracker_.timeout_s(human_tracking_timeout_s);
+  nh_private_.getParam("human_occupancy_memory_budget_mb",
+                       human_occupancy_memory_budget_mb_);
+  nh_private_.getParam("human_esdf_memory_budget_mb",
+                       human_esdf_memory_budget_mb_);
+  human_memory_budget_.protection_radius_m(memory_budget_protection_radius_m_);
+  nh_private_.getParam("mask_join_tolerance_ms", mask_join_tolerance_ms_);
+  nh_private_.getParam("mask_join_max_pending", mask_join_max_pending_);
 }
 
 void NvbloxHumanNode::initializeMultiMapper() {
@@ -78,6 +115,7 @@ void NvbloxHumanNode::initializeMultiMapper() {
   // Set to an invalid depth to ignore human pixels in the unmasked mapper
   // during integration.
   multi_mapper_->setDepthUnmaskedImageInvalidPixel(-1.f);
+  image_masker_.depth_unmasked_image_invalid_pixel(-1.f);
 
   // Initialize the human mapper (masked mapper of the multi mapper)
   const std::string mapper_name = "human_mapper";
@@ -91,49 +129,75 @@ void NvbloxHumanNode::initializeMultiMapper() {
   // Currently this leads to blocks being allocated even behind solid obstacles.
   multi_mapper_->setDepthMaskedImageInvalidPixel(
       human_mapper_->occupancy_integrator().max_integration_distance_m() * 2.f);
+  image_masker_.depth_masked_image_invalid_pixel(
+      human_mapper_->occupancy_integrator().max_integration_distance_m() * 2.f);
+
+  // The lazy decay uses the same decay as the mapper, at the decay rate.
+  lazy_occupancy_decay_.decay_rate_hz(human_occupancy_decay_rate_hz_);
+  lazy_occupancy_decay_.free_region_decay_probability(
+      human_mapper_->occupancy_decay_integrator()
+          .free_region_decay_probability());
+  lazy_occupancy_decay_.occupied_region_decay_probability(
+      human_mapper_->occupancy_decay_integrator()
+          .occupied_region_decay_probability());
 }
 
 void NvbloxHumanNode::subscribeToTopics() {
   ROS_INFO_STREAM("NvbloxHumanNode::subscribeToTopics()");
 
-  // Increased queue size compared to the NvbloxNode,
-  // because of bigger delay comming from segmentation.
-  constexpr int kQueueSize = 40;
-
   // Unsubscribe from base-class synchronized topics.
   // We redo synchronization below.
   NvbloxNode::timesync_depth_.reset();
   NvbloxNode::timesync_color_.reset();
 
-  segmentation_mask_sub_.subscribe(nh_, "mask/image", 20);
-  segmentation_camera_info_sub_.subscribe(nh_, "mask/camera_info", 20);
+  // Images and masks are joined by stamp in our own buffers. This lets us
+  // pair each mask with both a depth and a color image, even if the
+  // segmentation latency varies.
+  const ros::Duration join_tolerance(mask_join_tolerance_ms_ / 1000.0);
+  const size_t join_max_pending =
+      static_cast<size_t>(std::max(mask_join_max_pending_, 1));
+
+  segmentation_mask_sub_.subscribe(nh_, "mask/image",
+                                   maximum_sensor_message_queue_length_);
+  segmentation_camera_info_sub_.subscribe(
+      nh_, "mask/camera_info", maximum_sensor_message_queue_length_);
+  timesync_mask_.reset(new message_filters::Synchronizer<time_policy_t>(
+      time_policy_t(maximum_sensor_message_queue_length_),
+      segmentation_mask_sub_, segmentation_camera_info_sub_));
+  timesync_mask_->registerCallback(
+      std::bind(&NvbloxHumanNode::maskWithInfoCallback, this,
+                std::placeholders::_1, std::placeholders::_2));
 
   if (use_depth_) {
-    // Unsubscribe from the depth topic in nvblox_node
-    timesync_depth_.reset();
-    // Subscribe to depth + mask + cam_infos
-    timesync_depth_mask_ =
-        std::make_shared<message_filters::Synchronizer<mask_time_policy_t>>(
-            mask_time_policy_t(kQueueSize), depth_sub_, depth_camera_info_sub_,
-            segmentation_mask_sub_, segmentation_camera_info_sub_);
-    timesync_depth_mask_->registerCallback(
-        std::bind(&NvbloxHumanNode::depthPlusMaskImageCallback, this,
-                  std::placeholders::_1, std::placeholders::_2,
-                  std::placeholders::_3, std::placeholders::_4));
+    depth_mask_join_buffer_ = std::make_unique<ImageMaskJoinBuffer>(
+        join_tolerance, join_max_pending,
+        [this](const ImageInfoPair& depth, const ImageInfoPair& mask) {
+          depthPlusMaskImageCallback(depth.first, depth.second, mask.first,
+                                     mask.second);
+        });
+    // Subscribe to depth + cam_info
+    timesync_depth_.reset(new message_filters::Synchronizer<time_policy_t>(
+        time_policy_t(maximum_sensor_message_queue_length_), depth_sub_,
+        depth_camera_info_sub_));
+    timesync_depth_->registerCallback(
+        std::bind(&NvbloxHumanNode::depthWithInfoCallback, this,
+                  std::placeholders::_1, std::placeholders::_2));
   }
 
   if (use_color_) {
-    // Unsubscribe from the color topic in nvblox_node
-    timesync_color_.reset();
-    // Subscribe to color + mask + cam_infos
-    timesync_color_mask_ =
-        std::make_shared<message_filters::Synchronizer<mask_time_policy_t>>(
-            mask_time_policy_t(kQueueSize), color_sub_, color_camera_info_sub_,
-            segmentation_mask_sub_, segmentation_camera_info_sub_);
-    timesync_color_mask_->registerCallback(
-        std::bind(&NvbloxHumanNode::colorPlusMaskImageCallback, this,
-                  std::placeholders::_1, std::placeholders::_2,
-                  std::placeholders::_3, std::placeholders::_4));
+    color_mask_join_buffer_ = std::make_unique<ImageMaskJoinBuffer>(
+        join_tolerance, join_max_pending,
+        [this](const ImageInfoPair& color, const ImageInfoPair& mask) {
+          colorPlusMaskImageCallback(color.first, color.second, mask.first,
+                                     mask.second);
+        });
+    // Subscribe to color + cam_info
+    timesync_color_.reset(new message_filters::Synchronizer<time_policy_t>(
+        time_policy_t(maximum_sensor_message_queue_length_), color_sub_,
+        color_camera_info_sub_));
+    timesync_color_->registerCallback(
+        std::bind(&NvbloxHumanNode::colorWithInfoCallback, this,
+                  std::placeholders::_1, std::placeholders::_2));
   }
 }
 
@@ -161,10 +225,19 @@ void NvbloxHumanNode::advertiseTopics() {
       "depth_frame_overlay", 1, false);
   color_frame_overlay_publisher_ = nh_private_.advertise<sensor_msgs::Image>(
       "color_frame_overlay", 1, false);
+  human_instances_publisher_ =
+      nh_private_.advertise<nvblox_msgs::TrackedInstanceArray>(
+          "human_instances", 1, false);
 }
 
 void NvbloxHumanNode::setupTimers() {
-  {
+  if (human_occupancy_lazy_decay_) {
+    ros::TimerOptions timer_options(
+        ros::Duration(1.0 / human_occupancy_sweep_rate_hz_),
+        boost::bind(&NvbloxHumanNode::sweepHumanOccupancy, this, _1),
+        &processing_queue_);
+    human_occupancy_sweep_timer_ = nh_private_.createTimer(timer_options);
+  } else {
     ros::TimerOptions timer_options(
         ros::Duration(1.0 / human_occupancy_decay_rate_hz_),
         boost::bind(&NvbloxHumanNode::decayHumanOccupancy, this, _1),
@@ -178,6 +251,36 @@ void NvbloxHumanNode::setupTimers() {
         &processing_queue_);
     human_esdf_processing_timer_ = nh_private_.createTimer(timer_options);
   }
+  // Now that the human budgets are known.
+  startMemoryBudgetTimer();
+}
+
+void NvbloxHumanNode::depthWithInfoCallback(
+    const sensor_msgs::ImageConstPtr& depth_img_ptr,
+    const sensor_msgs::CameraInfo::ConstPtr& camera_info_msg) {
+  depth_mask_join_buffer_->addFirst(
+      depth_img_ptr->header.stamp,
+      std::make_pair(depth_img_ptr, camera_info_msg));
+}
+
+void NvbloxHumanNode::colorWithInfoCallback(
+    const sensor_msgs::ImageConstPtr& color_img_ptr,
+    const sensor_msgs::CameraInfo::ConstPtr& camera_info_msg) {
+  color_mask_join_buffer_->addFirst(
+      color_img_ptr->header.stamp,
+      std::make_pair(color_img_ptr, camera_info_msg));
+}
+
+void NvbloxHumanNode::maskWithInfoCallback(
+    const sensor_msgs::ImageConstPtr& mask_img_ptr,
+    const sensor_msgs::CameraInfo::ConstPtr& mask_camera_info_msg) {
+  const ImageInfoPair mask = std::make_pair(mask_img_ptr, mask_camera_info_msg);
+  if (depth_mask_join_buffer_) {
+    depth_mask_join_buffer_->addSecond(mask_img_ptr->header.stamp, mask);
+  }
+  if (color_mask_join_buffer_) {
+    color_mask_join_buffer_->addSecond(mask_img_ptr->header.stamp, mask);
+  }
 }
 
 void NvbloxHumanNode::depthPlusMaskImageCallback(
@@ -217,6 +320,8 @@ void NvbloxHumanNode::processDepthQueue(const ros::TimerEvent& /*event*/) {
   limitQueueSizeByDeletingOldestMessages(maximum_sensor_message_queue_length_,
                                          "depth_mask", &depth_mask_image_queue_,
                                          &depth_mask_queue_mutex_);
+
+  printJoinStatistics();
 }
 
 void NvbloxHumanNode::processColorQueue(const ros::TimerEvent& /*event*/) {
@@ -236,11 +341,43 @@ void NvbloxHumanNode::processColorQueue(const ros::TimerEvent& /*event*/) {
                                          &color_mask_queue_mutex_);
 }
 
+void NvbloxHumanNode::printJoinStatistics() {
+  // Called for every processed queue, so check the period before building the
+  // output.
+  constexpr double kPrintPeriodS = 10.0;
+  const ros::WallTime now = ros::WallTime::now();
+  if ((now - last_join_statistics_print_time_).toSec() < kPrintPeriodS) {
+    return;
+  }
+  last_join_statistics_print_time_ = now;
+
+  auto to_string = [](const std::string& name,
+                      const ImageMaskJoinBuffer& buffer) {
+    const ImageMaskJoinBuffer::Statistics stats = buffer.statistics();
+    std::stringstream ss;
+    ss << name << ": joined " << stats.num_joined << ", missed images "
+       << stats.num_first_missed << ", missed masks "
+       << stats.num_second_missed << ", join latency mean "
+       << stats.mean_join_latency_s * 1000.0 << " ms, max "
+       << stats.max_join_latency_s * 1000.0 << " ms\n";
+    return ss.str();
+  };
+  std::string output;
+  if (depth_mask_join_buffer_) {
+    output += to_string("depth_mask", *depth_mask_join_buffer_);
+  }
+  if (color_mask_join_buffer_) {
+    output += to_string("color_mask", *color_mask_join_buffer_);
+  }
+  ROS_INFO_STREAM("Image/mask join statistics: \n" << output);
+}
+
 bool NvbloxHumanNode::processDepthImage(
     const ImageSegmentationMaskMsgTuple& depth_mask_msg) {
-  timing::Timer ros_total_timer("ros/total");
-  timing::Timer ros_depth_timer("ros/depth");
-  timing::Timer transform_timer("ros/depth/transform");
+  const TraceFrame trace_frame(std::get<0>(depth_mask_msg)->header.stamp);
+  StageTimer ros_total_timer("ros/total", &stage_statistics_);
+  StageTimer ros_depth_timer("ros/depth", &stage_statistics_);
+  StageTimer transform_timer("ros/depth/transform", &stage_statistics_);
 
   // Message parts
   const sensor_msgs::ImageConstPtr& depth_img_ptr = std::get<0>(depth_mask_msg);
@@ -278,7 +415,7 @@ bool NvbloxHumanNode::processDepthImage(
   }
   transform_timer.Stop();
 
-  timing::Timer conversions_timer("ros/depth/conversions");
+  StageTimer conversions_timer("ros/depth/conversions", &stage_statistics_);
   // Convert camera info message to camera object.
   depth_camera_ = conversions::cameraFromMessage(*depth_camera_info_msg);
   const Camera mask_camera =
@@ -292,19 +429,54 @@ bool NvbloxHumanNode::processDepthImage(
   }
   conversions_timer.Stop();
 
+  // Split the depth frame into the human and the static part.
+  StageTimer split_timer("ros/depth/split", &stage_statistics_);
+  image_masker_.splitImageOnGPU(depth_image_, mask_image_, T_CM_CD,
+                                depth_camera_, mask_camera,
+                                &depth_frame_unmasked_, &depth_frame_masked_,
+                                &depth_frame_overlay_);
+  split_timer.Stop();
+
   // Integrate
-  timing::Timer integration_timer("ros/depth/integrate");
-  multi_mapper_->integrateDepth(depth_image_, mask_image_, T_L_C_depth_,
-                                T_CM_CD, depth_camera_, mask_camera);
+  // The mappers are integrated one after the other. nvblox's timers are
+  // process-global and not thread safe, so they can't run on two threads.
+  StageTimer integration_timer("ros/depth/integrate", &stage_statistics_);
+  {
+    std::lock_guard<std::mutex> human_lock(human_map_mutex_);
+    StageTimer human_integration_timer("ros/depth/integrate/human",
+                                       &stage_statistics_);
+    if (human_occupancy_lazy_decay_) {
+      decayHumanOccupancyForUpdate(depth_img_ptr->header.stamp);
+    }
+    human_mapper_->integrateDepth(depth_frame_masked_, T_L_C_depth_,
+                                  depth_camera_);
+  }
+  {
+    std::lock_guard<std::mutex> static_lock(map_mutex_);
+    StageTimer static_integration_timer("ros/depth/integrate/static",
+                                        &stage_statistics_);
+    mapper_->integrateDepth(depth_frame_unmasked_, T_L_C_depth_,
+                            depth_camera_);
+  }
   integration_timer.Stop();
+  updateNewestStamp(depth_img_ptr->header.stamp, &newest_tsdf_stamp_);
+  updateNewestStamp(depth_img_ptr->header.stamp, &newest_human_stamp_);
+
+  // Track where the humans are, such that the human ESDF can be limited to
+  // these regions.
+  if (human_esdf_limit_to_region_) {
+    std::lock_guard<std::mutex> human_lock(human_map_mutex_);
+    StageTimer region_timer("ros/humans/region/update", &stage_statistics_);
+    backProjectHumanDepthFrame();
+    updateHumanBlocks(depth_img_ptr->header.stamp);
+  }
 
-  timing::Timer overlay_timer("ros/depth/output/human_overlay");
+  StageTimer overlay_timer("ros/depth/output/human_overlay",
+                           &stage_statistics_);
   if (depth_frame_overlay_publisher_.getNumSubscribers() > 0) {
     sensor_msgs::Image img_msg;
-    const ColorImage& depth_overlay =
-        multi_mapper_->getLastDepthFrameMaskOverlay();
-    conversions::imageMessageFromColorImage(depth_overlay, depth_img_frame,
-                                            &img_msg);
+    conversions::imageMessageFromColorImage(depth_frame_overlay_,
+                                            depth_img_frame, &img_msg);
     depth_frame_overlay_publisher_.publish(img_msg);
   }
 
@@ -313,9 +485,10 @@ bool NvbloxHumanNode::processDepthImage(
 
 bool NvbloxHumanNode::processColorImage(
     const ImageSegmentationMaskMsgTuple& color_mask_msg) {
-  timing::Timer ros_total_timer("ros/total");
-  timing::Timer ros_color_timer("ros/color");
-  timing::Timer transform_timer("ros/color/transform");
+  const TraceFrame trace_frame(std::get<0>(color_mask_msg)->header.stamp);
+  StageTimer ros_total_timer("ros/total", &stage_statistics_);
+  StageTimer ros_color_timer("ros/color", &stage_statistics_);
+  StageTimer transform_timer("ros/color/transform", &stage_statistics_);
 
   // Message parts
   const sensor_msgs::ImageConstPtr& color_img_ptr = std::get<0>(color_mask_msg);
@@ -347,7 +520,7 @@ bool NvbloxHumanNode::processColorImage(
   }
   transform_timer.Stop();
 
-  timing::Timer conversions_timer("ros/color/conversions");
+  StageTimer conversions_timer("ros/color/conversions", &stage_statistics_);
   // Convert camera info message to camera object.
   const Camera color_camera = conversions::cameraFromMessage(*camera_info_msg);
   const Camera mask_camera =
@@ -367,11 +540,19 @@ bool NvbloxHumanNode::processColorImage(
   conversions_timer.Stop();
 
   // Integrate
-  timing::Timer integration_timer("ros/color/integrate");
+  // Color integration touches both mappers.
+  std::unique_lock<std::mutex> static_lock(map_mutex_, std::defer_lock);
+  std::unique_lock<std::mutex> human_lock(human_map_mutex_, std::defer_lock);
+  std::lock(static_lock, human_lock);
+  StageTimer integration_timer("ros/color/integrate", &stage_statistics_);
   multi_mapper_->integrateColor(color_image_, mask_image_, T_L_C, color_camera);
   integration_timer.Stop();
+  updateNewestStamp(color_img_ptr->header.stamp, &newest_color_stamp_);
+  static_lock.unlock();
+  human_lock.unlock();
 
-  timing::Timer overlay_timer("ros/color/output/human_overlay");
+  StageTimer overlay_timer("ros/color/output/human_overlay",
+                           &stage_statistics_);
   if (color_frame_overlay_publisher_.getNumSubscribers() > 0) {
     sensor_msgs::Image img_msg;
     const ColorImage& color_overlay =
@@ -385,9 +566,11 @@ bool NvbloxHumanNode::processColorImage(
 }
 
 void NvbloxHumanNode::processHumanEsdf(const ros::TimerEvent& /*event*/) {
-  std::unique_lock<std::mutex> lock(map_mutex_);
-  timing::Timer ros_total_timer("ros/total");
-  timing::Timer ros_human_total_timer("ros/humans");
+  // The human ESDF only needs the human mapper, the combined slice below
+  // additionally locks the static mapper.
+  std::unique_lock<std::mutex> human_lock(human_map_mutex_);
+  StageTimer ros_total_timer("ros/total", &stage_statistics_);
+  StageTimer ros_human_total_timer("ros/humans", &stage_statistics_);
 
   if (last_depth_update_time_.toSec() <= 0.f) {
     return;  // no data yet.
@@ -395,12 +578,21 @@ void NvbloxHumanNode::processHumanEsdf(const ros::TimerEvent& /*event*/) {
   publishHumanDebugOutput();
 
   // Process the human esdf layer.
-  timing::Timer esdf_integration_timer("ros/humans/esdf/integrate");
+  StageTimer esdf_integration_timer("ros/humans/esdf/integrate",
+                                    &stage_statistics_);
   std::vector<Index3D> updated_blocks;
-  if (esdf_2d_) {
+  AxisAlignedBoundingBox human_slice_aabb;
+  if (human_esdf_limit_to_region_) {
+    updated_blocks = updateHumanEsdfInRegion(&human_slice_aabb);
+  } else if (esdf_2d_) {
+    // The mapper only updates the ESDF of the blocks integrated since the last
+    // update. With lazy decay, those got their due decay right before the
+    // integration (see decayHumanOccupancyForUpdate()), so there's nothing to
+    // decay here.
     updated_blocks = human_mapper_->updateEsdfSlice(
         esdf_2d_min_height_, esdf_2d_max_height_, esdf_slice_height_);
   } else {
+    // As above, there's nothing to decay.
     updated_blocks = human_mapper_->updateEsdf();
   }
   esdf_integration_timer.Stop();
@@ -409,44 +601,54 @@ void NvbloxHumanNode::processHumanEsdf(const ros::TimerEvent& /*event*/) {
     return;
   }
 
-  timing::Timer esdf_output_timer("ros/humans/esdf/output");
+  StageTimer esdf_output_timer("ros/humans/esdf/output", &stage_statistics_);
 
   // Check if anyone wants any human slice
   if (esdf_distance_slice_ &&
           (human_esdf_pointcloud_publisher_.getNumSubscribers() > 0) ||
       (human_map_slice_publisher_.getNumSubscribers() > 0)) {
     // Get the slice as an image
-    timing::Timer esdf_slice_compute_timer("ros/humans/esdf/output/compute");
+    StageTimer esdf_slice_compute_timer("ros/humans/esdf/output/compute",
+                                        &stage_statistics_);
     AxisAlignedBoundingBox aabb;
     Image<float> map_slice_image;
-    esdf_slice_converter_.distanceMapSliceImageFromLayer(
-        human_mapper_->esdf_layer(), esdf_slice_height_, &map_slice_image,
-        &aabb);
+    if (human_esdf_limit_to_region_) {
+      aabb = human_slice_aabb;
+      esdf_slice_converter_.distanceMapSliceImageFromLayer(
+          human_mapper_->esdf_layer(), esdf_slice_height_, aabb,
+          &map_slice_image);
+    } else {
+      esdf_slice_converter_.distanceMapSliceImageFromLayer(
+          human_mapper_->esdf_layer(), esdf_slice_height_, &map_slice_image,
+          &aabb);
+    }
     esdf_slice_compute_timer.Stop();
 
     // Human slice pointcloud (for visualization)
     if (human_esdf_pointcloud_publisher_.getNumSubscribers() > 0) {
-      timing::Timer esdf_output_human_pointcloud_timer(
-          "ros/humans/esdf/output/pointcloud");
+      StageTimer esdf_output_human_pointcloud_timer(
+          "ros/humans/esdf/output/pointcloud", &stage_statistics_);
       sensor_msgs::PointCloud2 pointcloud_msg;
       esdf_slice_converter_.sliceImageToPointcloud(
           map_slice_image, aabb, esdf_slice_height_,
           human_mapper_->esdf_layer().voxel_size(), &pointcloud_msg);
       pointcloud_msg.header.frame_id = global_frame_;
-      pointcloud_msg.header.stamp = ros::Time::now();
+      pointcloud_msg.header.stamp =
+          outputStamp("humans/esdf/pointcloud", newest_human_stamp_);
       human_esdf_pointcloud_publisher_.publish(pointcloud_msg);
     }
 
     // Human slice (for navigation)
     if (human_map_slice_publisher_.getNumSubscribers() > 0) {
-      timing::Timer esdf_output_human_slice_timer(
-          "ros/humans/esdf/output/slice");
+      StageTimer esdf_output_human_slice_timer(
+          "ros/humans/esdf/output/slice", &stage_statistics_);
       nvblox_msgs::DistanceMapSlice map_slice_msg;
       esdf_slice_converter_.distanceMapSliceImageToMsg(
           map_slice_image, aabb, esdf_slice_height_,
           human_mapper_->voxel_size_m(), &map_slice_msg);
       map_slice_msg.header.frame_id = global_frame_;
-      map_slice_msg.header.stamp = ros::Time::now();
+      map_slice_msg.header.stamp =
+          outputStamp("humans/esdf/slice", newest_human_stamp_);
       human_map_slice_publisher_.publish(map_slice_msg);
     }
   }
@@ -456,38 +658,48 @@ void NvbloxHumanNode::processHumanEsdf(const ros::TimerEvent& /*event*/) {
           (combined_esdf_pointcloud_publisher_.getNumSubscribers() > 0) ||
       (combined_map_slice_publisher_.getNumSubscribers() > 0)) {
     // Combined slice
-    timing::Timer esdf_slice_compute_timer(
-        "ros/humans/esdf/output/combined/compute");
+    StageTimer esdf_slice_compute_timer(
+        "ros/humans/esdf/output/combined/compute", &stage_statistics_);
     Image<float> combined_slice_image;
     AxisAlignedBoundingBox combined_aabb;
-    esdf_slice_converter_.distanceMapSliceFromLayers(
-        mapper_->esdf_layer(), human_mapper_->esdf_layer(), esdf_slice_height_,
-        &combined_slice_image, &combined_aabb);
+    {
+      // Lock both mappers together to avoid deadlocks (see header).
+      human_lock.unlock();
+      std::unique_lock<std::mutex> static_lock(map_mutex_, std::defer_lock);
+      std::lock(static_lock, human_lock);
+      esdf_slice_converter_.distanceMapSliceFromLayers(
+          mapper_->esdf_layer(), human_mapper_->esdf_layer(),
+          esdf_slice_height_, &combined_slice_image, &combined_aabb);
+    }
     esdf_slice_compute_timer.Stop();
+    const ros::Time combined_stamp =
+        std::max(newest_tsdf_stamp_, newest_human_stamp_);
 
     // Human+Static slice pointcloud (for visualization)
     if (combined_esdf_pointcloud_publisher_.getNumSubscribers() > 0) {
-      timing::Timer esdf_output_human_pointcloud_timer(
-          "ros/humans/esdf/output/combined/pointcloud");
+      StageTimer esdf_output_human_pointcloud_timer(
+          "ros/humans/esdf/output/combined/pointcloud", &stage_statistics_);
       sensor_msgs::PointCloud2 pointcloud_msg;
       esdf_slice_converter_.sliceImageToPointcloud(
           combined_slice_image, combined_aabb, esdf_slice_height_,
           human_mapper_->esdf_layer().voxel_size(), &pointcloud_msg);
       pointcloud_msg.header.frame_id = global_frame_;
-      pointcloud_msg.header.stamp = ros::Time::now();
+      pointcloud_msg.header.stamp =
+          outputStamp("humans/esdf/combined/pointcloud", combined_stamp);
       combined_esdf_pointcloud_publisher_.publish(pointcloud_msg);
     }
 
     // Human+Static slice (for navigation)
     if (combined_map_slice_publisher_.getNumSubscribers() > 0) {
-      timing::Timer esdf_output_human_slice_timer(
-          "ros/humans/esdf/output/combined/slice");
+      StageTimer esdf_output_human_slice_timer(
+          "ros/humans/esdf/output/combined/slice", &stage_statistics_);
       nvblox_msgs::DistanceMapSlice map_slice_msg;
       esdf_slice_converter_.distanceMapSliceImageToMsg(
           combined_slice_image, combined_aabb, esdf_slice_height_,
           human_mapper_->voxel_size_m(), &map_slice_msg);
       map_slice_msg.header.frame_id = global_frame_;
-      map_slice_msg.header.stamp = ros::Time::now();
+      map_slice_msg.header.stamp =
+          outputStamp("humans/esdf/combined/slice", combined_stamp);
       human_map_slice_publisher_.publish(map_slice_msg);
     }
   }
@@ -496,26 +708,302 @@ void NvbloxHumanNode::processHumanEsdf(const ros::TimerEvent& /*event*/) {
 
 void NvbloxHumanNode::decayHumanOccupancy(
     const ros::TimerEvent& /*event*/) {
-  std::unique_lock<std::mutex> lock(map_mutex_);
+  std::unique_lock<std::mutex> lock(human_map_mutex_);
+  StageTimer decay_timer("ros/humans/decay", &stage_statistics_);
   human_mapper_->decayOccupancy();
 }
 
+void NvbloxHumanNode::sweepHumanOccupancy(const ros::TimerEvent& /*event*/) {
+  if (last_depth_update_time_.toSec() <= 0.f) {
+    return;  // no data yet.
+  }
+  std::unique_lock<std::mutex> lock(human_map_mutex_);
+  StageTimer sweep_timer("ros/humans/decay/sweep", &stage_statistics_);
+  lazy_occupancy_decay_.sweep(
+      last_depth_update_time_.toSec(),
+      human_mapper_->layers().getPtr<OccupancyLayer>());
+}
+
+bool NvbloxHumanNode::hasMemoryBudget() const {
+  return hasMapMemoryBudget() || hasHumanMemoryBudget();
+}
+
+bool NvbloxHumanNode::hasHumanMemoryBudget() const {
+  return human_occupancy_memory_budget_mb_ > 0.0f ||
+         human_esdf_memory_budget_mb_ > 0.0f;
+}
+
+void NvbloxHumanNode::enforceMemoryBudget(const ros::TimerEvent& /*event*/) {
+  nvblox_msgs::MemoryUsage msg;
+  msg.header.stamp = ros::Time::now();
+  msg.header.frame_id = global_frame_;
+  nvblox_msgs::MemoryUsage* msg_ptr = publish_memory_usage_ ? &msg : nullptr;
+  if (hasMapMemoryBudget() || publish_memory_usage_) {
+    enforceMapMemoryBudget(msg_ptr);
+  }
+  if (hasHumanMemoryBudget() || publish_memory_usage_) {
+    enforceHumanMemoryBudget(msg_ptr);
+  }
+  if (publish_memory_usage_) {
+    memory_usage_publisher_.publish(msg);
+  }
+}
+
+void NvbloxHumanNode::enforceHumanMemoryBudget(
+    nvblox_msgs::MemoryUsage* msg) {
+  constexpr float kBytesPerMegabyte = 1024.0f * 1024.0f;
+  auto budget_bytes = [](float budget_mb) {
+    return static_cast<size_t>(std::max(budget_mb, 0.0f) * kBytesPerMegabyte);
+  };
+
+  std::unique_lock<std::mutex> lock(human_map_mutex_);
+  StageTimer budget_timer("ros/humans/memory_budget", &stage_statistics_);
+  std::vector<LayerMemoryUsage> layers = {
+      getLayerMemoryUsage("human_occupancy", human_mapper_->occupancy_layer(),
+                          budget_bytes(human_occupancy_memory_budget_mb_)),
+      getLayerMemoryUsage("human_esdf", human_mapper_->esdf_layer(),
+                          budget_bytes(human_esdf_memory_budget_mb_))};
+
+  Transform T_L_MC;  // MC = map clearing frame
+  if (hasHumanMemoryBudget() &&
+      transformer_.lookupTransformToGlobalFrame(map_clearing_frame_id_,
+                                                ros::Time(0), &T_L_MC)) {
+    const std::vector<Index3D> blocks_to_evict =
+        human_memory_budget_.selectBlocksToEvict(
+            layers, T_L_MC.translation(),
+            human_mapper_->occupancy_layer().block_size());
+    human_mapper_->layers().getPtr<OccupancyLayer>()->clearBlocks(
+        blocks_to_evict);
+    human_mapper_->layers().getPtr<EsdfLayer>()->clearBlocks(blocks_to_evict);
+    for (const Index3D& block_index : blocks_to_evict) {
+      human_block_last_seen_.erase(block_index);
+      human_esdf_region_.erase(block_index);
+      for (LayerMemoryUsage& layer : layers) {
+        layer.block_indices.erase(block_index);
+      }
+    }
+  }
+  if (msg == nullptr) {
+    return;
+  }
+  addMemoryUsageToMessage(layers, human_memory_budget_, msg);
+
+  addBufferUsageToMessage(
+      "humans/",
+      {{"mask_image", mask_image_.numel() * sizeof(uint8_t)},
+       {"depth_frame_unmasked", depth_frame_unmasked_.numel() * sizeof(float)},
+       {"depth_frame_masked", depth_frame_masked_.numel() * sizeof(float)},
+       {"depth_frame_overlay", depth_frame_overlay_.numel() * sizeof(Color)},
+       {"pointcloud_C",
+        human_pointcloud_C_device_.size() * sizeof(Vector3f)},
+       {"pointcloud_L",
+        human_pointcloud_L_device_.size() * sizeof(Vector3f)},
+       {"voxel_centers_L",
+        human_voxel_centers_L_device_.size() * sizeof(Vector3f)},
+       {"block_centers_L",
+        human_block_centers_L_device_.size() * sizeof(Vector3f)}},
+      msg);
+}
+
+void NvbloxHumanNode::decayHumanOccupancyBlocks(
+    const std::vector<Index3D>& block_indices) {
+  StageTimer decay_timer("ros/humans/decay/lazy", &stage_statistics_);
+  lazy_occupancy_decay_.decayBlocks(
+      block_indices, last_depth_update_time_.toSec(),
+      human_mapper_->layers().getPtr<OccupancyLayer>());
+}
+
+void NvbloxHumanNode::decayHumanOccupancyForUpdate(
+    const ros::Time& frame_stamp) {
+  StageTimer decay_timer("ros/humans/decay/update", &stage_statistics_);
+  // The blocks the occupancy integrator is about to update.
+  const OccupancyIntegrator& integrator = human_mapper_->occupancy_integrator();
+  const std::vector<Index3D> blocks_in_view =
+      human_view_calculator_.getBlocksInImageViewRaycast(
+          depth_frame_masked_, T_L_C_depth_, depth_camera_,
+          human_mapper_->occupancy_layer().block_size(),
+          integrator.truncation_distance_vox() * voxel_size_,
+          integrator.max_integration_distance_m());
+  lazy_occupancy_decay_.decayBlocksForUpdate(
+      blocks_in_view, frame_stamp.toSec(),
+      human_mapper_->layers().getPtr<OccupancyLayer>());
+}
+
+void NvbloxHumanNode::backProjectHumanDepthFrame() {
+  image_back_projector_.backProjectOnGPU(
+      depth_frame_masked_, depth_camera_, &human_pointcloud_C_device_,
+      human_mapper_->occupancy_integrator().max_integration_distance_m());
+  transformPointcloudOnGPU(T_L_C_depth_, human_pointcloud_C_device_,
+                           &human_pointcloud_L_device_);
+}
+
+void NvbloxHumanNode::updateHumanBlocks(const ros::Time& timestamp) {
+  // Bin the human points into blocks on the GPU, such that we only transfer
+  // one point per block to the host.
+  const float block_size = human_mapper_->occupancy_layer().block_size();
+  image_back_projector_.pointcloudToVoxelCentersOnGPU(
+      human_pointcloud_L_device_, block_size, &human_block_centers_L_device_);
+  std::vector<Index3D> observed_blocks;
+  for (const Vector3f& block_center :
+       human_block_centers_L_device_.points().toVector()) {
+    const Index3D block_index =
+        getBlockIndexFromPositionInLayer(block_size, block_center);
+    human_block_last_seen_[block_index] = timestamp;
+    observed_blocks.push_back(block_index);
+  }
+  if (hasHumanMemoryBudget()) {
+    human_memory_budget_.touch(observed_blocks);
+  }
+}
+
+std::vector<Index3D> NvbloxHumanNode::updateHumanEsdfInRegion(
+    AxisAlignedBoundingBox* slice_aabb) {
+  CHECK_NOTNULL(slice_aabb);
+  const OccupancyLayer& occupancy_layer = human_mapper_->occupancy_layer();
+  EsdfLayer* esdf_layer = human_mapper_->layers().getPtr<EsdfLayer>();
+  const float block_size = occupancy_layer.block_size();
+
+  // Forget blocks in which we haven't seen humans for a while.
+  const ros::Time oldest_valid_time =
+      last_depth_update_time_ - ros::Duration(human_esdf_region_timeout_s_);
+  for (auto it = human_block_last_seen_.begin();
+       it != human_block_last_seen_.end();) {
+    if (it->second < oldest_valid_time) {
+      it = human_block_last_seen_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  // Pad the blocks containing humans. In 2D mode we only pad horizontally and
+  // only consider the blocks that are compressed into the slice.
+  const int padding_blocks =
+      static_cast<int>(std::ceil(human_esdf_region_padding_m_ / block_size));
+  const int padding_blocks_z = esdf_2d_ ? 0 : padding_blocks;
+  int min_z_block = std::numeric_limits<int>::lowest();
+  int max_z_block = std::numeric_limits<int>::max();
+  const int slice_z_block =
+      getBlockIndexFromPositionInLayer(block_size,
+                                       Vector3f(0.0f, 0.0f, esdf_slice_height_))
+          .z();
+  if (esdf_2d_) {
+    min_z_block = getBlockIndexFromPositionInLayer(
+                      block_size, Vector3f(0.0f, 0.0f, esdf_2d_min_height_))
+                      .z();
+    max_z_block = getBlockIndexFromPositionInLayer(
+                      block_size, Vector3f(0.0f, 0.0f, esdf_2d_max_height_))
+                      .z();
+  }
+  Index3DSet region;
+  Index3DSet esdf_region;
+  for (const auto& block_and_time : human_block_last_seen_) {
+    const Index3D& center_index = block_and_time.first;
+    for (int dx = -padding_blocks; dx <= padding_blocks; dx++) {
+      for (int dy = -padding_blocks; dy <= padding_blocks; dy++) {
+        for (int dz = -padding_blocks_z; dz <= padding_blocks_z; dz++) {
+          const Index3D block_index = center_index + Index3D(dx, dy, dz);
+          if (block_index.z() < min_z_block || block_index.z() > max_z_block ||
+              !occupancy_layer.isBlockAllocated(block_index)) {
+            continue;
+          }
+          region.insert(block_index);
+          // The 2D ESDF is stored in the blocks at the slice height.
+          esdf_region.insert(esdf_2d_ ? Index3D(block_index.x(),
+                                                block_index.y(), slice_z_block)
+                                      : block_index);
+        }
+      }
+    }
+  }
+
+  // Clear the ESDF blocks which left the region, such that the people who
+  // were there don't linger in the (combined) slice.
+  std::vector<Index3D> blocks_to_clear;
+  for (const Index3D& block_index : human_esdf_region_) {
+    if (esdf_region.count(block_index) == 0) {
+      blocks_to_clear.push_back(block_index);
+    }
+  }
+  esdf_layer->clearBlocks(blocks_to_clear);
+
+  // Update the ESDF within the region.
+  const std::vector<Index3D> region_blocks(region.begin(), region.end());
+  if (human_occupancy_lazy_decay_) {
+    decayHumanOccupancyBlocks(region_blocks);
+  }
+  if (!region_blocks.empty()) {
+    if (esdf_2d_) {
+      human_mapper_->esdf_integrator().integrateSlice(
+          occupancy_layer, region_blocks, esdf_2d_min_height_,
+          esdf_2d_max_height_, esdf_slice_height_, esdf_layer);
+    } else {
+      human_mapper_->esdf_integrator().integrateBlocks(
+          occupancy_layer, region_blocks, esdf_layer);
+    }
+  }
+
+  // The slice has to cover the cleared blocks too, such that they are
+  // overwritten downstream.
+  std::vector<Index3D> updated_blocks(esdf_region.begin(), esdf_region.end());
+  updated_blocks.insert(updated_blocks.end(), blocks_to_clear.begin(),
+                        blocks_to_clear.end());
+  slice_aabb->setEmpty();
+  for (const Index3D& block_index : updated_blocks) {
+    slice_aabb->extend(getAABBOfBlock(
+        block_size,
+        Index3D(block_index.x(), block_index.y(), slice_z_block)));
+  }
+
+  human_esdf_region_ = std::move(esdf_region);
+  return updated_blocks;
+}
+
+void NvbloxHumanNode::publishHumanInstances() {
+  StageTimer ros_human_instances_timer("ros/humans/output/instances",
+                                       &stage_statistics_);
+  const std::vector<VoxelCluster> clusters = clusterVoxelCenters(
+      human_voxel_centers_L_device_.points().toVector(), voxel_size_,
+      human_cluster_max_gap_voxels_, human_cluster_min_voxels_);
+  human_tracker_.update(clusters, last_depth_update_time_.toSec());
+
+  nvblox_msgs::TrackedInstanceArray instances_msg;
+  instances_msg.header.frame_id = global_frame_;
+  instances_msg.header.stamp = last_depth_update_time_;
+  for (const TrackedInstance& instance : human_tracker_.instances()) {
+    nvblox_msgs::TrackedInstance instance_msg;
+    instance_msg.id = instance.id;
+    instance_msg.centroid.x = instance.centroid.x();
+    instance_msg.centroid.y = instance.centroid.y();
+    instance_msg.centroid.z = instance.centroid.z();
+    instance_msg.extent.x = instance.extent.x();
+    instance_msg.extent.y = instance.extent.y();
+    instance_msg.extent.z = instance.extent.z();
+    instance_msg.velocity.x = instance.velocity.x();
+    instance_msg.velocity.y = instance.velocity.y();
+    instance_msg.velocity.z = instance.velocity.z();
+    instance_msg.num_voxels = instance.num_voxels;
+    instance_msg.last_seen = ros::Time(instance.last_seen_s);
+    instances_msg.instances.push_back(instance_msg);
+  }
+  human_instances_publisher_.publish(instances_msg);
+}
+
 void NvbloxHumanNode::publishHumanDebugOutput() {
-  timing::Timer ros_human_debug_timer("ros/humans/output/debug");
+  StageTimer ros_human_debug_timer("ros/humans/output/debug",
+                                   &stage_statistics_);
+
+  const bool publish_instances =
+      human_instances_publisher_.getNumSubscribers() > 0;
+  const bool need_voxels =
+      human_voxels_publisher_.getNumSubscribers() > 0 || publish_instances;
 
   // Get a human pointcloud
-  if (human_pointcloud_publisher_.getNumSubscribers() +
-          human_voxels_publisher_.getNumSubscribers() >
-      0) {
-    // Grab the human only image.
-    const DepthImage& depth_image_only_humans =
-        multi_mapper_->getLastDepthFrameMasked();
-    // Back project
-    image_back_projector_.backProjectOnGPU(
-        depth_image_only_humans, depth_camera_, &human_pointcloud_C_device_,
-        human_mapper_->occupancy_integrator().max_integration_distance_m());
-    transformPointcloudOnGPU(T_L_C_depth_, human_pointcloud_C_device_,
-                             &human_pointcloud_L_device_);
+  // (If the human ESDF is limited to a region, this was done already for
+  // every depth frame.)
+  if (!human_esdf_limit_to_region_ &&
+      (human_pointcloud_publisher_.getNumSubscribers() > 0 || need_voxels)) {
+    // Back project the human only image.
+    backProjectHumanDepthFrame();
   }
 
   // Publish the human pointcloud
@@ -525,33 +1013,47 @@ void NvbloxHumanNode::publishHumanDebugOutput() {
     pointcloud_converter_.pointcloudMsgFromPointcloud(
         human_pointcloud_L_device_, &pointcloud_msg);
     pointcloud_msg.header.frame_id = global_frame_;
-    pointcloud_msg.header.stamp = ros::Time::now();
+    pointcloud_msg.header.stamp =
+        outputStamp("humans/pointcloud", newest_human_stamp_);
     human_pointcloud_publisher_.publish(pointcloud_msg);
   }
 
-  // Publish human voxels
-  if (human_voxels_publisher_.getNumSubscribers() > 0) {
-    // Human voxels from points (in the layer frame)
+  // Human voxels from points (in the layer frame)
+  if (need_voxels) {
     image_back_projector_.pointcloudToVoxelCentersOnGPU(
         human_pointcloud_L_device_, voxel_size_,
         &human_voxel_centers_L_device_);
-    // Publish
+  }
+
+  // Publish human voxels
+  if (human_voxels_publisher_.getNumSubscribers() > 0) {
     visualization_msgs::Marker marker_msg;
     pointcloud_converter_.pointsToCubesMarkerMsg(
         human_voxel_centers_L_device_.points().toVector(), voxel_size_,
         Color::Red(), &marker_msg);
     marker_msg.header.frame_id = global_frame_;
-    marker_msg.header.stamp = ros::Time::now();
+    marker_msg.header.stamp =
+        outputStamp("humans/voxels", newest_human_stamp_);
     human_voxels_publisher_.publish(marker_msg);
   }
 
+  // Publish human instances
+  if (publish_instances) {
+    publishHumanInstances();
+  }
+
   // Publish the human occupancy layer
   if (human_occupancy_publisher_.getNumSubscribers() > 0) {
+    if (human_occupancy_lazy_decay_) {
+      decayHumanOccupancyBlocks(
+          human_mapper_->occupancy_layer().getAllBlockIndices());
+    }
     sensor_msgs::PointCloud2 pointcloud_msg;
     layer_converter_.pointcloudMsgFromLayer(human_mapper_->occupancy_layer(),
                                             &pointcloud_msg);
     pointcloud_msg.header.frame_id = global_frame_;
-    pointcloud_msg.header.stamp = ros::Time::now();
+    pointcloud_msg.header.stamp =
+        outputStamp("humans/occupancy", newest_human_stamp_);
     human_occupancy_publisher_.publish(pointcloud_msg);
   }
 }
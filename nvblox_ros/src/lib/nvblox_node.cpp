@@ -15,9 +15,15 @@
 //
 // SPDX-License-Identifier: Apache-2.0
 
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
 #include <limits>
 #include <memory>
 #include <mutex>
+#include <sstream>
 #include <string>
 #include <utility>
 #include <vector>
@@ -26,6 +32,7 @@
 #include <nvblox/io/pointcloud_io.h>
 #include <nvblox/utils/timing.h>
 
+#include "nvblox_ros/processing_steps.hpp"
 #include "nvblox_ros/transformer.hpp"
 #include "nvblox_ros/visualization.hpp"
 
@@ -34,6 +41,10 @@
 namespace nvblox {
 
 NvbloxNode::NvbloxNode(ros::NodeHandle& nh, ros::NodeHandle& nh_private)
+    : NvbloxNode(nh, nh_private, true) {}
+
+NvbloxNode::NvbloxNode(ros::NodeHandle& nh, ros::NodeHandle& nh_private,
+                       bool open_map_storage)
     : nh_(nh),
       nh_private_(nh_private),
       processing_spinner_(1, &processing_queue_),
@@ -57,6 +68,28 @@ NvbloxNode::NvbloxNode(ros::NodeHandle& nh, ros::NodeHandle& nh_private)
 
   initializeMapper(mapper_.get(), nh_private_);
 
+  mesh_fingerprint_cache_.vertex_quantization_m(
+      mesh_block_fingerprint_quantization_m_);
+  block_map_file_.num_threads(map_file_options_.num_threads);
+  memory_budget_.protection_radius_m(memory_budget_protection_radius_m_);
+  if (trace_buffer_size_ > 0) {
+    TraceRecorder::instance().enable(trace_buffer_size_);
+    ROS_INFO_STREAM("Tracing the last " << trace_buffer_size_ << " events.");
+  }
+
+  if (roll_map_window_ && map_clearing_radius_m_ > 0.0f) {
+    const float window_size_blocks =
+        2.0f * map_clearing_radius_m_ / mapper_->tsdf_layer().block_size();
+    rolling_window_.resize(static_cast<int>(std::ceil(window_size_blocks)));
+    ROS_INFO_STREAM("Keeping a rolling window of "
+                    << rolling_window_.numSlots() << " blocks around "
+                    << map_clearing_frame_id_);
+  }
+  // After the rolling window is sized, which forgets its blocks.
+  if (open_map_storage) {
+    openMapStorage();
+  }
+
   // Setup interactions with ROS
   subscribeToTopics();
   setupTimers();
@@ -79,6 +112,35 @@ NvbloxNode::~NvbloxNode() {
   // Need to explicitly delete these or there's a segfault on exit :(
   timesync_depth_.reset();
   timesync_color_.reset();
+
+  // Write out all remaining changes.
+  std::unique_lock<std::mutex> lock(map_mutex_);
+  map_journal_.flush(*mapper_, std::numeric_limits<size_t>::max());
+}
+
+void NvbloxNode::openMapStorage() {
+  std::unique_lock<std::mutex> lock(map_mutex_);
+  // Restore the map from the journal of a previous run.
+  if (!map_journal_file_.empty()) {
+    map_journal_.compaction_factor(map_journal_compaction_factor_);
+    std::vector<Index3D> restored_blocks;
+    if (map_journal_.open(map_journal_file_, mapper_.get(),
+                          &restored_blocks)) {
+      ROS_INFO_STREAM("Restored " << restored_blocks.size()
+                                  << " blocks from map journal "
+                                  << map_journal_file_);
+      markBlocksForUpdate(restored_blocks);
+      // They're in the journal already.
+      map_journal_.markClean(restored_blocks);
+    }
+  }
+
+  if (page_map_outside_radius_ && map_clearing_radius_m_ > 0.0f &&
+      !block_pager_.open(map_paging_file_, mapper_.get())) {
+    ROS_WARN_STREAM("Couldn't create the block store "
+                    << map_paging_file_
+                    << ", deleting blocks outside of the radius instead.");
+  }
 }
 
 void NvbloxNode::getParameters() {
@@ -154,6 +216,75 @@ void NvbloxNode::getParameters() {
   nh_private_.param("clear_outside_radius_rate_hz",
                     clear_outside_radius_rate_hz_,
                     clear_outside_radius_rate_hz_);
+  std::string map_clearing_mode = "clear";
+  nh_private_.param("map_clearing_mode", map_clearing_mode, map_clearing_mode);
+  if (map_clearing_mode == "page") {
+    page_map_outside_radius_ = true;
+  } else if (map_clearing_mode == "rolling") {
+    roll_map_window_ = true;
+  } else if (map_clearing_mode != "clear") {
+    ROS_WARN_STREAM("Unknown map_clearing_mode " << map_clearing_mode
+                                                 << ", using clear.");
+  }
+  nh_private_.param("map_paging_file", map_paging_file_, map_paging_file_);
+  nh_private_.param("map_paging_hysteresis_m", map_paging_hysteresis_m_,
+                    map_paging_hysteresis_m_);
+  nh_private_.param("map_page_in_radius_m", map_page_in_radius_m_,
+                    map_page_in_radius_m_);
+  nh_private_.param("map_page_in_rate_hz", map_page_in_rate_hz_,
+                    map_page_in_rate_hz_);
+  bool map_file_compression = true;
+  nh_private_.param("map_file_compression", map_file_compression,
+                    map_file_compression);
+  map_file_options_.compression = map_file_compression
+                                       ? BlockMapCompression::kLz4
+                                       : BlockMapCompression::kNone;
+  nh_private_.param("map_file_quantize_tsdf", map_file_options_.quantize_tsdf,
+                    map_file_options_.quantize_tsdf);
+  nh_private_.param("map_file_num_threads", map_file_options_.num_threads,
+                    map_file_options_.num_threads);
+  nh_private_.param("map_journal_file", map_journal_file_, map_journal_file_);
+  nh_private_.param("map_journal_flush_rate_hz", map_journal_flush_rate_hz_,
+                    map_journal_flush_rate_hz_);
+  nh_private_.param("map_journal_max_bytes_per_s",
+                    map_journal_max_bytes_per_s_,
+                    map_journal_max_bytes_per_s_);
+  nh_private_.param("map_journal_compaction_factor",
+                    map_journal_compaction_factor_,
+                    map_journal_compaction_factor_);
+  nh_private_.param("tsdf_memory_budget_mb", tsdf_memory_budget_mb_,
+                    tsdf_memory_budget_mb_);
+  nh_private_.param("color_memory_budget_mb", color_memory_budget_mb_,
+                    color_memory_budget_mb_);
+  nh_private_.param("occupancy_memory_budget_mb", occupancy_memory_budget_mb_,
+                    occupancy_memory_budget_mb_);
+  nh_private_.param("esdf_memory_budget_mb", esdf_memory_budget_mb_,
+                    esdf_memory_budget_mb_);
+  nh_private_.param("memory_budget_protection_radius_m",
+                    memory_budget_protection_radius_m_,
+                    memory_budget_protection_radius_m_);
+  nh_private_.param("memory_budget_rate_hz", memory_budget_rate_hz_,
+                    memory_budget_rate_hz_);
+  nh_private_.param("publish_memory_usage", publish_memory_usage_,
+                    publish_memory_usage_);
+  nh_private_.param("suppress_unchanged_mesh_blocks",
+                    suppress_unchanged_mesh_blocks_,
+                    suppress_unchanged_mesh_blocks_);
+  nh_private_.param("mesh_block_fingerprint_quantization_m",
+                    mesh_block_fingerprint_quantization_m_,
+                    mesh_block_fingerprint_quantization_m_);
+  nh_private_.param("timing_metrics_rate_hz", timing_metrics_rate_hz_,
+                    timing_metrics_rate_hz_);
+  nh_private_.param("timing_metrics_prometheus_file",
+                    timing_metrics_prometheus_file_,
+                    timing_metrics_prometheus_file_);
+  nh_private_.param("print_timing_statistics", print_timing_statistics_,
+                    print_timing_statistics_);
+  nh_private_.param("trace_buffer_size", trace_buffer_size_,
+                    trace_buffer_size_);
+  nh_private_.param("stamp_outputs_with_sensor_time",
+                    stamp_outputs_with_sensor_time_,
+                    stamp_outputs_with_sensor_time_);
 }
 
 void NvbloxNode::subscribeToTopics() {
@@ -220,6 +351,16 @@ void NvbloxNode::advertiseTopics() {
       "map_slice_bounds", 1, true);
   occupancy_publisher_ =
       nh_private_.advertise<sensor_msgs::PointCloud2>("occupancy", 1, false);
+  memory_usage_publisher_ =
+      nh_private_.advertise<nvblox_msgs::MemoryUsage>("memory_usage", 1, false);
+  // On the global topic, where the diagnostic aggregator expects it.
+  diagnostics_publisher_ = nh_.advertise<diagnostic_msgs::DiagnosticArray>(
+      "/diagnostics", 1, false);
+  if (timing_metrics_rate_hz_ > 0.0f) {
+    timing_metrics_exporter_ = std::make_unique<TimingMetricsExporter>(
+        diagnostics_publisher_, ros::this_node::getName() + "/timing",
+        timing_metrics_prometheus_file_);
+  }
 }
 
 void NvbloxNode::advertiseServices() {
@@ -229,6 +370,12 @@ void NvbloxNode::advertiseServices() {
       nh_private_.advertiseService("save_map", &NvbloxNode::saveMap, this);
   load_map_service_ =
       nh_private_.advertiseService("load_map", &NvbloxNode::loadMap, this);
+  load_map_region_service_ = nh_private_.advertiseService(
+      "load_map_region", &NvbloxNode::loadMapRegion, this);
+  dump_trace_service_ =
+      nh_private_.advertiseService("dump_trace", &NvbloxNode::dumpTrace, this);
+  clear_region_service_ = nh_private_.advertiseService(
+      "clear_region", &NvbloxNode::clearRegion, this);
 }
 
 void NvbloxNode::setupTimers() {
@@ -283,6 +430,41 @@ void NvbloxNode::setupTimers() {
         &processing_queue_);
     clear_outside_radius_timer_ = nh_private_.createTimer(timer_options);
   }
+  if (map_page_in_radius_m_ > 0.0f) {
+    ros::TimerOptions timer_options(
+        ros::Duration(1.0 / map_page_in_rate_hz_),
+        boost::bind(&NvbloxNode::pageInMapBlocks, this, _1),
+        &processing_queue_);
+    map_page_in_timer_ = nh_private_.createTimer(timer_options);
+  }
+  if (!map_journal_file_.empty()) {
+    ros::TimerOptions timer_options(
+        ros::Duration(1.0 / map_journal_flush_rate_hz_),
+        boost::bind(&NvbloxNode::flushMapJournal, this, _1),
+        &processing_queue_);
+    map_journal_timer_ = nh_private_.createTimer(timer_options);
+  }
+  if (timing_metrics_rate_hz_ > 0.0f) {
+    ros::TimerOptions timer_options(
+        ros::Duration(1.0 / timing_metrics_rate_hz_),
+        boost::bind(&NvbloxNode::publishTimingMetrics, this, _1),
+        &processing_queue_);
+    timing_metrics_timer_ = nh_private_.createTimer(timer_options);
+  }
+  // Derived nodes add their own budgets, they call this again.
+  startMemoryBudgetTimer();
+}
+
+void NvbloxNode::startMemoryBudgetTimer() {
+  if (memory_budget_timer_.isValid() ||
+      !(hasMemoryBudget() || publish_memory_usage_)) {
+    return;
+  }
+  ros::TimerOptions timer_options(
+      ros::Duration(1.0 / memory_budget_rate_hz_),
+      boost::bind(&NvbloxNode::enforceMemoryBudget, this, _1),
+      &processing_queue_);
+  memory_budget_timer_ = nh_private_.createTimer(timer_options);
 }
 
 void NvbloxNode::transformCallback(
@@ -298,6 +480,8 @@ void NvbloxNode::poseCallback(
 void NvbloxNode::depthImageCallback(
     const sensor_msgs::ImageConstPtr& depth_img_ptr,
     const sensor_msgs::CameraInfo::ConstPtr& camera_info_msg) {
+  TraceRecorder::instance().recordInstant("ros/depth/enqueue",
+                                          depth_img_ptr->header.stamp);
   pushMessageOntoQueue({depth_img_ptr, camera_info_msg}, &depth_image_queue_,
                        &depth_queue_mutex_);
 }
@@ -305,12 +489,16 @@ void NvbloxNode::depthImageCallback(
 void NvbloxNode::colorImageCallback(
     const sensor_msgs::ImageConstPtr& color_image_ptr,
     const sensor_msgs::CameraInfo::ConstPtr& camera_info_msg) {
+  TraceRecorder::instance().recordInstant("ros/color/enqueue",
+                                          color_image_ptr->header.stamp);
   pushMessageOntoQueue({color_image_ptr, camera_info_msg}, &color_image_queue_,
                        &color_queue_mutex_);
 }
 
 void NvbloxNode::pointcloudCallback(
     const sensor_msgs::PointCloud2::ConstPtr pointcloud) {
+  TraceRecorder::instance().recordInstant("ros/lidar/enqueue",
+                                          pointcloud->header.stamp);
   pushMessageOntoQueue(pointcloud, &pointcloud_queue_,
                        &pointcloud_queue_mutex_);
 }
@@ -319,7 +507,12 @@ void NvbloxNode::processDepthQueue(const ros::TimerEvent& /*event*/) {
   using ImageInfoMsgPair =
       std::pair<sensor_msgs::ImageConstPtr, sensor_msgs::CameraInfo::ConstPtr>;
   auto message_ready = [this](const ImageInfoMsgPair& msg) {
-    return this->canTransform(msg.first->header);
+    if (!this->canTransform(msg.first->header)) {
+      return false;
+    }
+    TraceRecorder::instance().recordInstant("ros/depth/ready",
+                                            msg.first->header.stamp);
+    return true;
   };
 
   processMessageQueue<ImageInfoMsgPair>(
@@ -337,7 +530,12 @@ void NvbloxNode::processColorQueue(const ros::TimerEvent& /*event*/) {
   using ImageInfoMsgPair =
       std::pair<sensor_msgs::ImageConstPtr, sensor_msgs::CameraInfo::ConstPtr>;
   auto message_ready = [this](const ImageInfoMsgPair& msg) {
-    return this->canTransform(msg.first->header);
+    if (!this->canTransform(msg.first->header)) {
+      return false;
+    }
+    TraceRecorder::instance().recordInstant("ros/color/ready",
+                                            msg.first->header.stamp);
+    return true;
   };
 
   processMessageQueue<ImageInfoMsgPair>(
@@ -354,7 +552,12 @@ void NvbloxNode::processColorQueue(const ros::TimerEvent& /*event*/) {
 void NvbloxNode::processPointcloudQueue(const ros::TimerEvent& /*event*/) {
   using PointcloudMsg = sensor_msgs::PointCloud2::ConstPtr;
   auto message_ready = [this](const PointcloudMsg& msg) {
-    return this->canTransform(msg->header);
+    if (!this->canTransform(msg->header)) {
+      return false;
+    }
+    TraceRecorder::instance().recordInstant("ros/lidar/ready",
+                                            msg->header.stamp);
+    return true;
   };
   processMessageQueue<PointcloudMsg>(
       &pointcloud_queue_,        // NOLINT
@@ -369,34 +572,41 @@ void NvbloxNode::processPointcloudQueue(const ros::TimerEvent& /*event*/) {
 }
 
 void NvbloxNode::processEsdf(const ros::TimerEvent& /*event*/) {
+  StageTimer lock_wait_timer("ros/esdf/lock_wait", &stage_statistics_);
   std::unique_lock<std::mutex> lock(map_mutex_);
+  lock_wait_timer.Stop();
 
   const ros::Time timestamp = ros::Time::now();
-  timing::Timer ros_total_timer("ros/total");
-  timing::Timer ros_esdf_timer("ros/esdf");
-
-  timing::Timer esdf_integration_timer("ros/esdf/integrate");
-  std::vector<Index3D> updated_blocks;
-  if (esdf_2d_) {
-    updated_blocks = mapper_->updateEsdfSlice(
-        esdf_2d_min_height_, esdf_2d_max_height_, esdf_slice_height_);
-  } else {
-    updated_blocks = mapper_->updateEsdf();
+  StageTimer ros_total_timer("ros/total", &stage_statistics_);
+  StageTimer ros_esdf_timer("ros/esdf", &stage_statistics_);
+
+  // Blocks loaded from file are not known to the mapper.
+  const std::vector<Index3D> loaded_blocks(esdf_blocks_to_update_.begin(),
+                                           esdf_blocks_to_update_.end());
+  esdf_blocks_to_update_.clear();
+  const std::vector<Index3D> updated_blocks = processing::updateEsdf(
+      loaded_blocks, static_projective_layer_type_, esdf_2d_,
+      esdf_2d_min_height_, esdf_2d_max_height_, esdf_slice_height_, "ros/",
+      &stage_statistics_, mapper_.get());
+  map_journal_.markDirty(updated_blocks);
+  if (hasMapMemoryBudget()) {
+    memory_budget_.touch(updated_blocks);
   }
-  esdf_integration_timer.Stop();
+  rolling_window_.insert(updated_blocks);
 
   if (updated_blocks.empty()) {
     return;
   }
 
-  timing::Timer esdf_output_timer("ros/esdf/output");
+  StageTimer esdf_output_timer("ros/esdf/output", &stage_statistics_);
 
   // If anyone wants a slice
   if (esdf_distance_slice_ &&
       (esdf_pointcloud_publisher_.getNumSubscribers() > 0 ||
        map_slice_publisher_.getNumSubscribers() > 0)) {
     // Get the slice as an image
-    timing::Timer esdf_slice_compute_timer("ros/esdf/output/compute");
+    StageTimer esdf_slice_compute_timer("ros/esdf/output/compute",
+                                        &stage_statistics_);
     AxisAlignedBoundingBox aabb;
     Image<float> map_slice_image;
     esdf_slice_converter_.distanceMapSliceImageFromLayer(
@@ -405,25 +615,29 @@ void NvbloxNode::processEsdf(const ros::TimerEvent& /*event*/) {
 
     // Slice pointcloud for RVIZ
     if (esdf_pointcloud_publisher_.getNumSubscribers() > 0) {
-      timing::Timer esdf_output_pointcloud_timer("ros/esdf/output/pointcloud");
+      StageTimer esdf_output_pointcloud_timer("ros/esdf/output/pointcloud",
+                                              &stage_statistics_);
       sensor_msgs::PointCloud2 pointcloud_msg;
       esdf_slice_converter_.sliceImageToPointcloud(
           map_slice_image, aabb, esdf_slice_height_,
           mapper_->esdf_layer().voxel_size(), &pointcloud_msg);
       pointcloud_msg.header.frame_id = global_frame_;
-      pointcloud_msg.header.stamp = ros::Time::now();
+      pointcloud_msg.header.stamp =
+          outputStamp("esdf/pointcloud", newest_tsdf_stamp_);
       esdf_pointcloud_publisher_.publish(pointcloud_msg);
     }
 
     // Also publish the map slice (costmap for nav2).
     if (map_slice_publisher_.getNumSubscribers() > 0) {
-      timing::Timer esdf_output_esdf_slice_timer("ros/esdf/output/slice");
+      StageTimer esdf_output_esdf_slice_timer("ros/esdf/output/slice",
+                                              &stage_statistics_);
       nvblox_msgs::DistanceMapSlice map_slice_msg;
       esdf_slice_converter_.distanceMapSliceImageToMsg(
           map_slice_image, aabb, esdf_slice_height_, mapper_->voxel_size_m(),
           &map_slice_msg);
       map_slice_msg.header.frame_id = global_frame_;
-      map_slice_msg.header.stamp = ros::Time::now();
+      map_slice_msg.header.stamp =
+          outputStamp("esdf/slice", newest_tsdf_stamp_);
       map_slice_publisher_.publish(map_slice_msg);
     }
   }
@@ -452,26 +666,37 @@ void NvbloxNode::processEsdf(const ros::TimerEvent& /*event*/) {
   // If we don't want the slice, output the full map.
   if (!esdf_distance_slice_ &&
       esdf_pointcloud_publisher_.getNumSubscribers() > 0) {
-    timing::Timer esdf_output_esdf_full_map_timer("ros/esdf/output/full_cloud");
+    StageTimer esdf_output_esdf_full_map_timer("ros/esdf/output/full_cloud",
+                                               &stage_statistics_);
     sensor_msgs::PointCloud2 pointcloud_msg;
     layer_converter_.pointcloudMsgFromLayer(mapper_->esdf_layer(),
                                             &pointcloud_msg);
     pointcloud_msg.header.frame_id = global_frame_;
-    pointcloud_msg.header.stamp = ros::Time::now();
+    pointcloud_msg.header.stamp =
+        outputStamp("esdf/pointcloud", newest_tsdf_stamp_);
     esdf_pointcloud_publisher_.publish(pointcloud_msg);
   }
 }
 
 void NvbloxNode::processMesh(const ros::TimerEvent& /*event*/) {
+  StageTimer lock_wait_timer("ros/mesh/lock_wait", &stage_statistics_);
   std::unique_lock<std::mutex> lock(map_mutex_);
-
-  const ros::Time timestamp = ros::Time::now();
-  timing::Timer ros_total_timer("ros/total");
-  timing::Timer ros_mesh_timer("ros/mesh");
-
-  timing::Timer mesh_integration_timer("ros/mesh/integrate_and_color");
-  const std::vector<Index3D> mesh_updated_list = mapper_->updateMesh();
-  mesh_integration_timer.Stop();
+  lock_wait_timer.Stop();
+
+  StageTimer ros_total_timer("ros/total", &stage_statistics_);
+  StageTimer ros_mesh_timer("ros/mesh", &stage_statistics_);
+
+  // Blocks loaded from file are not known to the mapper.
+  const std::vector<Index3D> loaded_blocks(mesh_blocks_to_update_.begin(),
+                                           mesh_blocks_to_update_.end());
+  mesh_blocks_to_update_.clear();
+  const std::vector<Index3D> mesh_updated_list = processing::updateMesh(
+      loaded_blocks, "ros/", &stage_statistics_, mapper_.get());
+  map_journal_.markDirty(mesh_updated_list);
+  if (hasMapMemoryBudget()) {
+    memory_budget_.touch(mesh_updated_list);
+  }
+  rolling_window_.insert(mesh_updated_list);
 
   // In the case that some mesh blocks have been re-added after deletion, remove
   // them from the deleted list.
@@ -483,27 +708,35 @@ void NvbloxNode::processMesh(const ros::TimerEvent& /*event*/) {
                                                    mesh_blocks_deleted_.end());
   mesh_blocks_deleted_.clear();
 
-  bool should_publish = !mesh_updated_list.empty();
-
   // Publish the mesh updates.
-  timing::Timer mesh_output_timer("ros/mesh/output");
+  StageTimer mesh_output_timer("ros/mesh/output", &stage_statistics_);
   size_t new_subscriber_count = mesh_publisher_.getNumSubscribers();
   if (new_subscriber_count > 0) {
+    // Blocks which were re-meshed but didn't change are only dropped if
+    // requested.
+    conversions::MeshBlockFingerprintCache* fingerprint_cache =
+        suppress_unchanged_mesh_blocks_ ? &mesh_fingerprint_cache_ : nullptr;
     nvblox_msgs::Mesh mesh_msg;
     // In case we have new subscribers, publish the ENTIRE map once.
     if (new_subscriber_count > mesh_subscriber_count_) {
       ROS_INFO("Got a new subscriber, sending entire map.");
-      conversions::meshMessageFromMeshLayer(mapper_->mesh_layer(), &mesh_msg);
+      // Re-fingerprint everything such that the cache reflects what the
+      // subscribers have seen.
+      mesh_fingerprint_cache_.clear();
+      conversions::meshMessageFromMeshBlocks(
+          mapper_->mesh_layer(), mapper_->mesh_layer().getAllBlockIndices(),
+          &mesh_msg, std::vector<Index3D>(), fingerprint_cache);
       mesh_msg.clear = true;
-      should_publish = true;
     } else {
-      conversions::meshMessageFromMeshBlocks(mapper_->mesh_layer(),
-                                             mesh_updated_list, &mesh_msg,
-                                             mesh_blocks_to_delete);
+      conversions::meshMessageFromMeshBlocks(
+          mapper_->mesh_layer(), mesh_updated_list, &mesh_msg,
+          mesh_blocks_to_delete, fingerprint_cache);
     }
     mesh_msg.header.frame_id = global_frame_;
-    mesh_msg.header.stamp = timestamp;
-    if (should_publish) {
+    // The mesh has the geometry of the TSDF and the colors of the color layer.
+    mesh_msg.header.stamp = outputStamp(
+        "mesh", std::max(newest_tsdf_stamp_, newest_color_stamp_));
+    if (mesh_msg.clear || !mesh_msg.block_indices.empty()) {
       mesh_publisher_.publish(mesh_msg);
     }
   }
@@ -536,12 +769,30 @@ bool NvbloxNode::isUpdateTooFrequent(const ros::Time& current_stamp,
   return false;
 }
 
+void NvbloxNode::updateNewestStamp(const ros::Time& sensor_stamp,
+                                   ros::Time* newest_stamp) {
+  CHECK_NOTNULL(newest_stamp);
+  *newest_stamp = std::max(*newest_stamp, sensor_stamp);
+}
+
+ros::Time NvbloxNode::outputStamp(const std::string& output,
+                                  const ros::Time& sensor_stamp) {
+  const ros::Time now = ros::Time::now();
+  // Nothing was integrated yet.
+  if (sensor_stamp.isZero()) {
+    return now;
+  }
+  stage_statistics_.add("latency/" + output, (now - sensor_stamp).toSec());
+  return stamp_outputs_with_sensor_time_ ? sensor_stamp : now;
+}
+
 bool NvbloxNode::processDepthImage(
     const std::pair<sensor_msgs::ImageConstPtr,
                     sensor_msgs::CameraInfo::ConstPtr>& depth_camera_pair) {
   ROS_DEBUG("Depth Image processing has started");
-  timing::Timer ros_depth_timer("ros/depth");
-  timing::Timer transform_timer("ros/depth/transform");
+  const TraceFrame trace_frame(depth_camera_pair.first->header.stamp);
+  StageTimer ros_depth_timer("ros/depth", &stage_statistics_);
+  StageTimer transform_timer("ros/depth/transform", &stage_statistics_);
 
   // Message parts
   const sensor_msgs::ImageConstPtr& depth_img_ptr = depth_camera_pair.first;
@@ -567,31 +818,30 @@ bool NvbloxNode::processDepthImage(
   }
   transform_timer.Stop();
 
-  timing::Timer conversions_timer("ros/depth/conversions");
-  // Convert camera info message to camera object.
-  Camera camera = conversions::cameraFromMessage(*camera_info_msg);
-
-  // Convert the depth image.
-  if (!conversions::depthImageFromImageMessage(depth_img_ptr, &depth_image_)) {
-    ROS_ERROR("Failed to transform depth image.");
+  Camera camera;
+  if (!processing::convertDepthImage(depth_img_ptr, *camera_info_msg, "ros/",
+                                     &stage_statistics_, &depth_image_,
+                                     &camera)) {
     return false;
   }
-  conversions_timer.Stop();
 
   // Integrate
+  StageTimer lock_wait_timer("ros/depth/lock_wait", &stage_statistics_);
   std::unique_lock<std::mutex> lock(map_mutex_);
-  timing::Timer integration_timer("ros/depth/integrate");
-  mapper_->integrateDepth(depth_image_, T_L_C, camera);
+  lock_wait_timer.Stop();
+  processing::integrateDepthImage(depth_image_, T_L_C, camera, "ros/",
+                                  &stage_statistics_, mapper_.get());
+  updateNewestStamp(depth_img_ptr->header.stamp, &newest_tsdf_stamp_);
   ROS_DEBUG("Depth Camera based depth integration is done.");
-  integration_timer.Stop();
   return true;
 }
 
 bool NvbloxNode::processColorImage(
     const std::pair<sensor_msgs::ImageConstPtr,
                     sensor_msgs::CameraInfo::ConstPtr>& color_camera_pair) {
-  timing::Timer ros_color_timer("ros/color");
-  timing::Timer transform_timer("ros/color/transform");
+  const TraceFrame trace_frame(color_camera_pair.first->header.stamp);
+  StageTimer ros_color_timer("ros/color", &stage_statistics_);
+  StageTimer transform_timer("ros/color/transform", &stage_statistics_);
 
   const sensor_msgs::ImageConstPtr& color_img_ptr = color_camera_pair.first;
   const sensor_msgs::CameraInfo::ConstPtr& camera_info_msg =
@@ -615,30 +865,28 @@ bool NvbloxNode::processColorImage(
 
   transform_timer.Stop();
 
-  timing::Timer color_convert_timer("ros/color/conversion");
-
-  // Convert camera info message to camera object.
-  Camera camera = conversions::cameraFromMessage(*camera_info_msg);
-
-  // Convert the color image.
-  if (!conversions::colorImageFromImageMessage(color_img_ptr, &color_image_)) {
-    ROS_ERROR("Failed to transform color image.");
+  Camera camera;
+  if (!processing::convertColorImage(color_img_ptr, *camera_info_msg, "ros/",
+                                     &stage_statistics_, &color_image_,
+                                     &camera)) {
     return false;
   }
-  color_convert_timer.Stop();
 
   // Integrate.
+  StageTimer lock_wait_timer("ros/color/lock_wait", &stage_statistics_);
   std::unique_lock<std::mutex> lock(map_mutex_);
-  timing::Timer color_integrate_timer("ros/color/integrate");
-  mapper_->integrateColor(color_image_, T_L_C, camera);
-  color_integrate_timer.Stop();
+  lock_wait_timer.Stop();
+  processing::integrateColorImage(color_image_, T_L_C, camera, "ros/",
+                                  &stage_statistics_, mapper_.get());
+  updateNewestStamp(color_img_ptr->header.stamp, &newest_color_stamp_);
   return true;
 }
 
 bool NvbloxNode::processLidarPointcloud(
     const sensor_msgs::PointCloud2::ConstPtr& pointcloud_ptr) {
-  timing::Timer ros_lidar_timer("ros/lidar");
-  timing::Timer transform_timer("ros/lidar/transform");
+  const TraceFrame trace_frame(pointcloud_ptr->header.stamp);
+  StageTimer ros_lidar_timer("ros/lidar", &stage_statistics_);
+  StageTimer transform_timer("ros/lidar/transform", &stage_statistics_);
 
   // Check that we're not updating more quickly than we should.
   if (isUpdateTooFrequent(pointcloud_ptr->header.stamp, last_lidar_update_time_,
@@ -666,31 +914,27 @@ bool NvbloxNode::processLidarPointcloud(
   // NOTE(alexmillane): If the check fails we return true which indicates that
   // this pointcloud can be removed from the queue even though it wasn't
   // integrated (because the intrisics model is messed up).
-  // NOTE(alexmillane): Note that internally we cache checks, so each LiDAR
-  // intrisics model is only tested against a single pointcloud. This is because
-  // the check is expensive to perform.
-  if (!pointcloud_converter_.checkLidarPointcloud(pointcloud_ptr, lidar)) {
-    ROS_ERROR("LiDAR intrinsics are inconsistent with the received pointcloud");
+  if (!processing::convertLidarPointcloud(pointcloud_ptr, lidar, "ros/",
+                                          &stage_statistics_,
+                                          &pointcloud_converter_,
+                                          &pointcloud_image_)) {
     return true;
   }
 
-  timing::Timer lidar_conversion_timer("ros/lidar/conversion");
-  pointcloud_converter_.depthImageFromPointcloudGPU(pointcloud_ptr, lidar,
-                                                    &pointcloud_image_);
-  lidar_conversion_timer.Stop();
-
+  StageTimer lock_wait_timer("ros/lidar/lock_wait", &stage_statistics_);
   std::unique_lock<std::mutex> lock(map_mutex_);
+  lock_wait_timer.Stop();
 
-  timing::Timer lidar_integration_timer("ros/lidar/integration");
-  mapper_->integrateLidarDepth(pointcloud_image_, T_L_C, lidar);
-  lidar_integration_timer.Stop();
+  processing::integrateLidarDepthImage(pointcloud_image_, T_L_C, lidar, "ros/",
+                                       &stage_statistics_, mapper_.get());
+  updateNewestStamp(pointcloud_ptr->header.stamp, &newest_tsdf_stamp_);
 
   return true;
 }
 
 void NvbloxNode::publishOccupancyPointcloud(const ros::TimerEvent& /*event*/) {
-  timing::Timer ros_total_timer("ros/total");
-  timing::Timer esdf_output_timer("ros/occupancy/output");
+  StageTimer ros_total_timer("ros/total", &stage_statistics_);
+  StageTimer esdf_output_timer("ros/occupancy/output", &stage_statistics_);
 
   if (occupancy_publisher_.getNumSubscribers() > 0) {
     sensor_msgs::PointCloud2 pointcloud_msg;
@@ -698,7 +942,7 @@ void NvbloxNode::publishOccupancyPointcloud(const ros::TimerEvent& /*event*/) {
     layer_converter_.pointcloudMsgFromLayer(mapper_->occupancy_layer(),
                                             &pointcloud_msg);
     pointcloud_msg.header.frame_id = global_frame_;
-    pointcloud_msg.header.stamp = ros::Time::now();
+    pointcloud_msg.header.stamp = outputStamp("occupancy", newest_tsdf_stamp_);
     occupancy_publisher_.publish(pointcloud_msg);
   }
 }
@@ -711,10 +955,19 @@ void NvbloxNode::clearMapOutsideOfRadiusOfLastKnownPose(
     if (transformer_.lookupTransformToGlobalFrame(map_clearing_frame_id_,
                                                   ros::Time(0), &T_L_MC)) {
       std::unique_lock<std::mutex> lock(map_mutex_);
+      if (block_pager_.isOpen()) {
+        pageMapAroundPosition(T_L_MC.translation());
+        return;
+      }
+      if (rolling_window_.numSlots() > 0) {
+        rollMapWindowToPosition(T_L_MC.translation());
+        return;
+      }
       const std::vector<Index3D> blocks_cleared = mapper_->clearOutsideRadius(
           T_L_MC.translation(), map_clearing_radius_m_);
       // We keep track of the deleted blocks for publishing later.
       mesh_blocks_deleted_.insert(blocks_cleared.begin(), blocks_cleared.end());
+      map_journal_.markDirty(blocks_cleared);
     } else {
       constexpr float kTimeBetweenDebugMessages = 1.0;
       ROS_INFO_STREAM_THROTTLE(
@@ -725,6 +978,309 @@ void NvbloxNode::clearMapOutsideOfRadiusOfLastKnownPose(
   }
 }
 
+void NvbloxNode::pageMapAroundPosition(const Vector3f& position) {
+  // Blocks read back since the last call.
+  markBlocksForUpdate(block_pager_.insertPagedInBlocks(mapper_.get()));
+
+  const std::vector<Index3D> blocks_to_page_out =
+      block_pager_.blocksOutsideRadius(
+          position, map_clearing_radius_m_ + map_paging_hysteresis_m_,
+          *mapper_);
+  evictBlocks(blocks_to_page_out);
+
+  block_pager_.requestPageIn(position, map_clearing_radius_m_);
+  ROS_DEBUG_STREAM("Paged out " << blocks_to_page_out.size() << " blocks, "
+                                << block_pager_.numPagedOutBlocks()
+                                << " blocks are on disk.");
+}
+
+void NvbloxNode::rollMapWindowToPosition(const Vector3f& position) {
+  const bool was_placed = rolling_window_.isPlaced();
+  std::vector<Index3D> blocks_to_delete = rolling_window_.moveTo(
+      position, mapper_->tsdf_layer().block_size());
+  // The blocks are normally registered as their ESDF or mesh is updated. If
+  // neither is computed, or the window was just placed, we register all
+  // allocated blocks, which are at most the ones of the window.
+  const bool registers_updated_blocks =
+      compute_esdf_ ||
+      (compute_mesh_ &&
+       static_projective_layer_type_ == ProjectiveLayerType::kTsdf);
+  if (!was_placed || !registers_updated_blocks) {
+    Index3DSet allocated_blocks;
+    for (const std::vector<Index3D>& block_indices :
+         {mapper_->tsdf_layer().getAllBlockIndices(),
+          mapper_->color_layer().getAllBlockIndices(),
+          mapper_->occupancy_layer().getAllBlockIndices()}) {
+      allocated_blocks.insert(block_indices.begin(), block_indices.end());
+    }
+    rolling_window_.insert(std::vector<Index3D>(allocated_blocks.begin(),
+                                                allocated_blocks.end()));
+    if (!was_placed) {
+      blocks_to_delete = rolling_window_.moveTo(
+          position, mapper_->tsdf_layer().block_size());
+    }
+  }
+  deleteBlocks(blocks_to_delete);
+  ROS_DEBUG_STREAM("Deleted " << blocks_to_delete.size()
+                              << " blocks outside of the rolling window, "
+                              << rolling_window_.numBlocks()
+                              << " blocks remain.");
+}
+
+void NvbloxNode::evictBlocks(const std::vector<Index3D>& block_indices) {
+  if (!block_pager_.isOpen()) {
+    deleteBlocks(block_indices);
+    return;
+  }
+  if (block_indices.empty()) {
+    return;
+  }
+  // The paged out blocks stay in the journal.
+  map_journal_.flush(*mapper_, block_indices);
+  block_pager_.pageOut(block_indices, mapper_.get());
+  markBlocksDeleted(block_indices);
+}
+
+void NvbloxNode::deleteBlocks(const std::vector<Index3D>& block_indices) {
+  if (block_indices.empty()) {
+    return;
+  }
+  mapper_->layers().getPtr<TsdfLayer>()->clearBlocks(block_indices);
+  mapper_->layers().getPtr<ColorLayer>()->clearBlocks(block_indices);
+  mapper_->layers().getPtr<OccupancyLayer>()->clearBlocks(block_indices);
+  mapper_->layers().getPtr<EsdfLayer>()->clearBlocks(block_indices);
+  mapper_->layers().getPtr<MeshLayer>()->clearBlocks(block_indices);
+  map_journal_.markDirty(block_indices);
+  markBlocksDeleted(block_indices);
+}
+
+void NvbloxNode::markBlocksDeleted(const std::vector<Index3D>& block_indices) {
+  rolling_window_.remove(block_indices);
+  for (const Index3D& block_index : block_indices) {
+    mesh_blocks_to_update_.erase(block_index);
+    esdf_blocks_to_update_.erase(block_index);
+  }
+  // We keep track of the deleted blocks for publishing later.
+  mesh_blocks_deleted_.insert(block_indices.begin(), block_indices.end());
+}
+
+bool NvbloxNode::hasMapMemoryBudget() const {
+  return tsdf_memory_budget_mb_ > 0.0f || color_memory_budget_mb_ > 0.0f ||
+         occupancy_memory_budget_mb_ > 0.0f || esdf_memory_budget_mb_ > 0.0f;
+}
+
+void NvbloxNode::enforceMemoryBudget(const ros::TimerEvent& /*event*/) {
+  nvblox_msgs::MemoryUsage msg;
+  msg.header.stamp = ros::Time::now();
+  msg.header.frame_id = global_frame_;
+  enforceMapMemoryBudget(publish_memory_usage_ ? &msg : nullptr);
+  if (publish_memory_usage_) {
+    memory_usage_publisher_.publish(msg);
+  }
+}
+
+void NvbloxNode::enforceMapMemoryBudget(nvblox_msgs::MemoryUsage* msg) {
+  constexpr float kBytesPerMegabyte = 1024.0f * 1024.0f;
+  auto budget_bytes = [](float budget_mb) {
+    return static_cast<size_t>(std::max(budget_mb, 0.0f) * kBytesPerMegabyte);
+  };
+
+  std::unique_lock<std::mutex> lock(map_mutex_);
+  StageTimer budget_timer("ros/memory_budget", &stage_statistics_);
+  std::vector<LayerMemoryUsage> layers = {
+      getLayerMemoryUsage("tsdf", mapper_->tsdf_layer(),
+                          budget_bytes(tsdf_memory_budget_mb_)),
+      getLayerMemoryUsage("color", mapper_->color_layer(),
+                          budget_bytes(color_memory_budget_mb_)),
+      getLayerMemoryUsage("occupancy", mapper_->occupancy_layer(),
+                          budget_bytes(occupancy_memory_budget_mb_)),
+      getLayerMemoryUsage("esdf", mapper_->esdf_layer(),
+                          budget_bytes(esdf_memory_budget_mb_))};
+
+  if (hasMapMemoryBudget()) {
+    Transform T_L_MC;  // MC = map clearing frame
+    if (transformer_.lookupTransformToGlobalFrame(map_clearing_frame_id_,
+                                                  ros::Time(0), &T_L_MC)) {
+      const std::vector<Index3D> blocks_to_evict =
+          memory_budget_.selectBlocksToEvict(
+              layers, T_L_MC.translation(),
+              mapper_->tsdf_layer().block_size());
+      evictBlocks(blocks_to_evict);
+      for (LayerMemoryUsage& layer : layers) {
+        for (const Index3D& block_index : blocks_to_evict) {
+          layer.block_indices.erase(block_index);
+        }
+      }
+      if (!blocks_to_evict.empty()) {
+        ROS_DEBUG_STREAM("Evicted " << blocks_to_evict.size()
+                                    << " blocks to stay within the budget.");
+      }
+    } else {
+      constexpr float kTimeBetweenDebugMessages = 1.0;
+      ROS_INFO_STREAM_THROTTLE(
+          kTimeBetweenDebugMessages,
+          "Tried to enforce the memory budget but couldn't look up frame: "
+              << map_clearing_frame_id_);
+    }
+  }
+  if (msg == nullptr) {
+    return;
+  }
+  layers.push_back(getMeshLayerMemoryUsage("mesh", mapper_->mesh_layer()));
+  addMemoryUsageToMessage(layers, memory_budget_, msg);
+
+  // The buffers are only resized by callbacks of the (single threaded)
+  // processing queue, which also runs this one.
+  addBufferUsageToMessage("layer_converter/",
+                          layer_converter_.bufferCapacities(), msg);
+  addBufferUsageToMessage("pointcloud_converter/",
+                          pointcloud_converter_.bufferCapacities(), msg);
+  addBufferUsageToMessage("esdf_slice_converter/",
+                          esdf_slice_converter_.bufferCapacities(), msg);
+  addBufferUsageToMessage(
+      "",
+      {{"color_image", color_image_.numel() * sizeof(Color)},
+       {"depth_image", depth_image_.numel() * sizeof(float)},
+       {"pointcloud_image", pointcloud_image_.numel() * sizeof(float)}},
+      msg);
+}
+
+void NvbloxNode::addMemoryUsageToMessage(
+    const std::vector<LayerMemoryUsage>& layers,
+    const MemoryBudget& memory_budget, nvblox_msgs::MemoryUsage* msg) {
+  CHECK_NOTNULL(msg);
+  allocation_tracker_.update(layers, ros::Time::now().toSec());
+  for (const LayerMemoryUsage& layer : layers) {
+    const BlockAllocationTracker::Counts counts =
+        allocation_tracker_.counts(layer.name);
+    nvblox_msgs::LayerMemoryUsage layer_msg;
+    layer_msg.name = layer.name;
+    layer_msg.num_blocks = layer.num_blocks();
+    layer_msg.num_bytes = layer.num_bytes();
+    layer_msg.budget_bytes = layer.budget_bytes;
+    layer_msg.num_evicted_blocks = memory_budget.numEvictedBlocks(layer.name);
+    layer_msg.num_allocated_blocks = counts.num_allocated_blocks;
+    layer_msg.num_freed_blocks = counts.num_freed_blocks;
+    layer_msg.allocated_blocks_per_s = counts.allocated_blocks_per_s;
+    layer_msg.freed_blocks_per_s = counts.freed_blocks_per_s;
+    msg->layers.push_back(layer_msg);
+  }
+}
+
+void NvbloxNode::addBufferUsageToMessage(
+    const std::string& prefix,
+    const std::vector<conversions::BufferCapacity>& buffers,
+    nvblox_msgs::MemoryUsage* msg) {
+  CHECK_NOTNULL(msg);
+  for (const conversions::BufferCapacity& buffer : buffers) {
+    nvblox_msgs::BufferUsage buffer_msg;
+    buffer_msg.name = prefix + buffer.name;
+    buffer_msg.capacity_bytes = buffer.capacity_bytes;
+    msg->buffers.push_back(buffer_msg);
+  }
+}
+
+void NvbloxNode::pageInMapBlocks(const ros::TimerEvent& /*event*/) {
+  std::unique_lock<std::mutex> lock(map_mutex_);
+  if (!block_map_file_.isOpen()) {
+    return;
+  }
+  StageTimer page_in_timer("ros/map_page_in", &stage_statistics_);
+  Transform T_L_MC;  // MC = map clearing frame
+  if (transformer_.lookupTransformToGlobalFrame(map_clearing_frame_id_,
+                                                ros::Time(0), &T_L_MC)) {
+    markBlocksForUpdate(block_map_file_.loadBlocksInRadius(
+        T_L_MC.translation(), map_page_in_radius_m_, mapper_.get()));
+  } else {
+    constexpr float kTimeBetweenDebugMessages = 1.0;
+    ROS_INFO_STREAM_THROTTLE(
+        kTimeBetweenDebugMessages,
+        "Tried to page in map blocks but couldn't look up frame: "
+            << map_clearing_frame_id_);
+  }
+}
+
+void NvbloxNode::markBlocksForUpdate(
+    const std::vector<Index3D>& block_indices) {
+  map_journal_.markDirty(block_indices);
+  rolling_window_.insert(block_indices);
+  // Only TSDF maps are meshed.
+  if (compute_mesh_ &&
+      static_projective_layer_type_ == ProjectiveLayerType::kTsdf) {
+    mesh_blocks_to_update_.insert(block_indices.begin(), block_indices.end());
+  }
+  if (compute_esdf_) {
+    esdf_blocks_to_update_.insert(block_indices.begin(), block_indices.end());
+  }
+}
+
+bool NvbloxNode::openBlockMapFile(const std::string& filename) {
+  if (!block_map_file_.open(filename)) {
+    return false;
+  }
+  if (block_map_file_.voxel_size() != mapper_->voxel_size_m()) {
+    ROS_WARN_STREAM("Voxel size of " << filename << " ("
+                                     << block_map_file_.voxel_size()
+                                     << ") doesn't match the map.");
+    block_map_file_.close();
+    return false;
+  }
+  return true;
+}
+
+void NvbloxNode::flushMapJournal(const ros::TimerEvent& /*event*/) {
+  std::unique_lock<std::mutex> lock(map_mutex_);
+  const size_t max_num_bytes =
+      static_cast<size_t>(map_journal_max_bytes_per_s_ /
+                          map_journal_flush_rate_hz_);
+  map_journal_.flush(*mapper_, max_num_bytes);
+  constexpr float kTimeBetweenDebugMessages = 10.0;
+  if (map_journal_.writeFailed()) {
+    ROS_ERROR_STREAM_THROTTLE(kTimeBetweenDebugMessages,
+                              "Writing to the map journal "
+                                  << map_journal_file_
+                                  << " is failing. Changes are kept in memory "
+                                     "and retried.");
+  }
+  if (map_journal_.numDirtyBlocks() > 0) {
+    ROS_INFO_STREAM_THROTTLE(kTimeBetweenDebugMessages,
+                             map_journal_.numDirtyBlocks()
+                                 << " blocks are waiting to be journaled.");
+  }
+}
+
+void NvbloxNode::publishTimingMetrics(const ros::TimerEvent& /*event*/) {
+  // Runs on the processing thread, as the nvblox timers aren't thread safe.
+  // Only the snapshot is taken here, the formatting happens in the exporter.
+  timing_metrics_exporter_->push(collectTimerMetrics(stage_statistics_),
+                                 ros::Time::now());
+  if (print_timing_statistics_) {
+    ROS_INFO_STREAM("Timing statistics: \n" << timing::Timing::Print());
+  }
+}
+
+bool NvbloxNode::dumpTrace(nvblox_msgs::FilePath::Request& request,
+                           nvblox_msgs::FilePath::Response& response) {
+  if (!TraceRecorder::instance().isEnabled()) {
+    response.success = false;
+    response.message = "Tracing is disabled, set trace_buffer_size.";
+    return true;
+  }
+  std::ofstream out(request.file_path);
+  const size_t num_events = TraceRecorder::instance().writeChromeTrace(out);
+  if (!out) {
+    ROS_WARN_STREAM("Failed to write the trace to " << request.file_path);
+    response.success = false;
+    response.message = "Failed to write " + request.file_path;
+    return true;
+  }
+  ROS_INFO_STREAM("Wrote " << num_events << " trace events to "
+                           << request.file_path);
+  response.success = true;
+  response.message = "Wrote " + std::to_string(num_events) + " events.";
+  return true;
+}
+
 // Helper function for ends with. :)
 bool ends_with(const std::string& value, const std::string& ending) {
   if (ending.size() > value.size()) {
@@ -768,6 +1324,44 @@ bool NvbloxNode::saveMap(nvblox_msgs::FilePath::Request& request,
                          nvblox_msgs::FilePath::Response& response) {
   std::unique_lock<std::mutex> lock(map_mutex_);
 
+  // Paged out blocks are part of the map too.
+  markBlocksForUpdate(block_pager_.pageInAll(mapper_.get()));
+
+  // Block map files are partially loadable.
+  if (ends_with(request.file_path, ".nvbm")) {
+    // Blocks which weren't paged in yet are part of the map too. They're
+    // copied over from the opened file, rather than loaded into the mapper.
+    // Write to a temporary file first, the target may be the mapped file.
+    StageTimer save_timer("ros/save_block_map_file", &stage_statistics_);
+    const std::string tmp_filename = request.file_path + ".tmp";
+    BlockMapFileStatistics statistics;
+    response.success =
+        writeBlockMapFile(tmp_filename, *mapper_, map_file_options_,
+                          block_map_file_.isOpen() ? &block_map_file_
+                                                   : nullptr,
+                          &statistics) &&
+        std::rename(tmp_filename.c_str(), request.file_path.c_str()) == 0;
+    save_timer.Stop();
+    if (response.success) {
+      const double compression_ratio =
+          statistics.stored_num_bytes > 0
+              ? static_cast<double>(statistics.raw_num_bytes) /
+                    statistics.stored_num_bytes
+              : 1.0;
+      std::stringstream message;
+      message << "Wrote " << statistics.num_blocks << " blocks, "
+              << statistics.stored_num_bytes << " bytes (compression ratio "
+              << std::fixed << std::setprecision(2) << compression_ratio
+              << ").";
+      response.message = message.str();
+      ROS_INFO_STREAM("Output block map file to " << request.file_path << ". "
+                                                  << response.message);
+    } else {
+      ROS_WARN_STREAM("Failed to write file to " << request.file_path);
+    }
+    return true;
+  }
+
   std::string filename = request.file_path;
   if (!ends_with(request.file_path, ".nvblx")) {
     filename += ".nvblx";
@@ -786,6 +1380,22 @@ bool NvbloxNode::loadMap(nvblox_msgs::FilePath::Request& request,
                          nvblox_msgs::FilePath::Response& response) {
   std::unique_lock<std::mutex> lock(map_mutex_);
 
+  // Block map files are only mapped here. Their blocks are paged in around
+  // the robot (or all at once if paging is disabled) and added to the current
+  // map.
+  if (ends_with(request.file_path, ".nvbm")) {
+    response.success = openBlockMapFile(request.file_path);
+    if (response.success && map_page_in_radius_m_ <= 0.0f) {
+      markBlocksForUpdate(block_map_file_.loadAllBlocks(mapper_.get()));
+    }
+    if (response.success) {
+      ROS_INFO_STREAM("Opened block map file " << request.file_path);
+    } else {
+      ROS_WARN_STREAM("Failed to open block map file " << request.file_path);
+    }
+    return true;
+  }
+
   std::string filename = request.file_path;
   if (!ends_with(request.file_path, ".nvblx")) {
     filename += ".nvblx";
@@ -793,6 +1403,10 @@ bool NvbloxNode::loadMap(nvblox_msgs::FilePath::Request& request,
 
   response.success = mapper_->loadMap(filename);
   if (response.success) {
+    // The map was replaced as a whole.
+    map_journal_.markAllDirty(*mapper_);
+    block_pager_.clear(mapper_.get());
+    rolling_window_.clear();
     ROS_INFO_STREAM("Loaded map to file from " << filename);
   } else {
     ROS_WARN_STREAM("Failed to load map file from " << filename);
@@ -800,4 +1414,162 @@ bool NvbloxNode::loadMap(nvblox_msgs::FilePath::Request& request,
   return true;
 }
 
+bool NvbloxNode::loadMapRegion(
+    nvblox_msgs::LoadMapRegion::Request& request,
+    nvblox_msgs::LoadMapRegion::Response& response) {
+  std::unique_lock<std::mutex> lock(map_mutex_);
+  response.success = false;
+  response.num_blocks_loaded = 0;
+
+  if (!request.file_path.empty() &&
+      request.file_path != block_map_file_.filename()) {
+    if (!openBlockMapFile(request.file_path)) {
+      ROS_WARN_STREAM("Failed to open block map file " << request.file_path);
+      return true;
+    }
+  }
+  if (!block_map_file_.isOpen()) {
+    ROS_WARN("No block map file to load a region from.");
+    return true;
+  }
+
+  StageTimer load_region_timer("ros/load_map_region", &stage_statistics_);
+  std::vector<Index3D> loaded_blocks;
+  if (request.radius_m > 0.0f) {
+    const Vector3f center(request.center.x, request.center.y,
+                          request.center.z);
+    loaded_blocks = block_map_file_.loadBlocksInRadius(center, request.radius_m,
+                                                       mapper_.get());
+  } else {
+    const AxisAlignedBoundingBox aabb(
+        Vector3f(request.aabb_min.x, request.aabb_min.y, request.aabb_min.z),
+        Vector3f(request.aabb_max.x, request.aabb_max.y, request.aabb_max.z));
+    loaded_blocks = block_map_file_.loadBlocksInAABB(aabb, mapper_.get());
+  }
+  markBlocksForUpdate(loaded_blocks);
+  response.success = true;
+  response.num_blocks_loaded = loaded_blocks.size();
+  ROS_INFO_STREAM("Loaded " << loaded_blocks.size() << " blocks from "
+                            << block_map_file_.filename());
+  return true;
+}
+
+bool NvbloxNode::clearRegion(nvblox_msgs::ClearRegion::Request& request,
+                             nvblox_msgs::ClearRegion::Response& response) {
+  response.success = false;
+  response.num_blocks_cleared = 0;
+  response.num_blocks_reset = 0;
+  if (request.aabb_min.size() != request.aabb_max.size() ||
+      request.box_poses.size() != request.box_sizes.size()) {
+    response.message =
+        "aabb_min and aabb_max, and box_poses and box_sizes need to have the "
+        "same length.";
+    ROS_WARN_STREAM("Not clearing the region: " << response.message);
+    return true;
+  }
+
+  ClearingRegion region;
+  for (size_t i = 0; i < request.aabb_min.size(); i++) {
+    const geometry_msgs::Point& min = request.aabb_min[i];
+    const geometry_msgs::Point& max = request.aabb_max[i];
+    region.addAABB(AxisAlignedBoundingBox(Vector3f(min.x, min.y, min.z),
+                                          Vector3f(max.x, max.y, max.z)));
+  }
+  for (size_t i = 0; i < request.box_poses.size(); i++) {
+    const geometry_msgs::Vector3& size = request.box_sizes[i];
+    region.addOrientedBox(Transformer::poseToEigen(request.box_poses[i]),
+                          Vector3f(size.x, size.y, size.z));
+  }
+  std::vector<Vector2f> polygon;
+  for (const geometry_msgs::Point32& point : request.polygon.points) {
+    polygon.emplace_back(point.x, point.y);
+  }
+  region.addExtrudedPolygon(polygon, request.polygon_min_z,
+                            request.polygon_max_z);
+  if (region.empty()) {
+    response.message = "The region is empty.";
+    ROS_WARN_STREAM("Not clearing the region: " << response.message);
+    return true;
+  }
+
+  std::unique_lock<std::mutex> lock(map_mutex_);
+  StageTimer clear_region_timer("ros/clear_region", &stage_statistics_);
+  const float block_size = mapper_->tsdf_layer().block_size();
+
+  // Paged out blocks are read back first, such that they're cleared as well.
+  std::vector<Index3D> paged_out_blocks_in_region;
+  for (const Index3D& block_index : block_pager_.pagedOutBlocks()) {
+    if (region.mayIntersect(getAABBOfBlock(block_size, block_index))) {
+      paged_out_blocks_in_region.push_back(block_index);
+    }
+  }
+  markBlocksForUpdate(
+      block_pager_.pageIn(paged_out_blocks_in_region, mapper_.get()));
+
+  // Small regions are looked up block by block, such that clearing doesn't
+  // scale with the size of the map.
+  const auto is_allocated = [this](const Index3D& block_index) {
+    return mapper_->tsdf_layer().isBlockAllocated(block_index) ||
+           mapper_->color_layer().isBlockAllocated(block_index) ||
+           mapper_->occupancy_layer().isBlockAllocated(block_index) ||
+           mapper_->esdf_layer().isBlockAllocated(block_index);
+  };
+  const size_t num_allocated_blocks =
+      mapper_->tsdf_layer().numAllocatedBlocks() +
+      mapper_->color_layer().numAllocatedBlocks() +
+      mapper_->occupancy_layer().numAllocatedBlocks() +
+      mapper_->esdf_layer().numAllocatedBlocks();
+  const auto get_allocated_blocks = [this]() {
+    Index3DSet allocated_blocks;
+    for (const std::vector<Index3D>& block_indices :
+         {mapper_->tsdf_layer().getAllBlockIndices(),
+          mapper_->color_layer().getAllBlockIndices(),
+          mapper_->occupancy_layer().getAllBlockIndices(),
+          mapper_->esdf_layer().getAllBlockIndices()}) {
+      allocated_blocks.insert(block_indices.begin(), block_indices.end());
+    }
+    return std::vector<Index3D>(allocated_blocks.begin(),
+                                allocated_blocks.end());
+  };
+  const RegionBlocks region_blocks = region.findBlocks(
+      is_allocated, num_allocated_blocks, get_allocated_blocks, block_size);
+
+  deleteBlocks(region_blocks.full_blocks);
+  resetVoxels(region_blocks, mapper_->layers().getPtr<TsdfLayer>());
+  resetVoxels(region_blocks, mapper_->layers().getPtr<ColorLayer>());
+  resetVoxels(region_blocks, mapper_->layers().getPtr<OccupancyLayer>());
+  resetVoxels(region_blocks, mapper_->layers().getPtr<EsdfLayer>());
+
+  // The meshes and ESDFs of the remaining blocks next to the cleared ones
+  // depend on the cleared voxels.
+  Index3DSet blocks_to_update(region_blocks.partial_blocks.begin(),
+                              region_blocks.partial_blocks.end());
+  for (const Index3D& block_index : region_blocks.full_blocks) {
+    for (int x = -1; x <= 1; x++) {
+      for (int y = -1; y <= 1; y++) {
+        for (int z = -1; z <= 1; z++) {
+          const Index3D neighbor_index = block_index + Index3D(x, y, z);
+          if (mapper_->tsdf_layer().isBlockAllocated(neighbor_index) ||
+              mapper_->occupancy_layer().isBlockAllocated(neighbor_index)) {
+            blocks_to_update.insert(neighbor_index);
+          }
+        }
+      }
+    }
+  }
+  markBlocksForUpdate(std::vector<Index3D>(blocks_to_update.begin(),
+                                           blocks_to_update.end()));
+
+  response.success = true;
+  response.num_blocks_cleared = region_blocks.full_blocks.size();
+  response.num_blocks_reset = region_blocks.partial_blocks.size();
+  std::stringstream message;
+  message << "Cleared " << response.num_blocks_cleared
+          << " blocks and reset the voxels of " << response.num_blocks_reset
+          << " blocks.";
+  response.message = message.str();
+  ROS_INFO_STREAM(response.message);
+  return true;
+}
+
 }  // namespace nvblox
@@ -0,0 +1,437 @@
+// SPDX-FileCopyrightText: NVIDIA CORPORATION & AFFILIATES
+// Copyright (c) 2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <algorithm>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <nvblox_msgs/SemanticLabelsStamped.h>
+
+#include "nvblox_ros/nvblox_semantic_node.hpp"
+
+namespace nvblox {
+
+NvbloxSemanticNode::NvbloxSemanticNode(ros::NodeHandle& nh,
+                                       ros::NodeHandle& nh_private)
+    : NvbloxNode(nh, nh_private) {
+  ROS_INFO_STREAM("NvbloxSemanticNode::NvbloxSemanticNode()");
+
+  // Get parameters specific to the semantic node.
+  getParameters();
+
+  // Create one occupancy mapper per class.
+  initializeSemanticMappers();
+
+  // Subscribe to topics
+  // NOTE: This function modifies the base class subscriptions to add
+  // synchronization with label images.
+  subscribeToTopics();
+
+  // Add additional timers and publish more topics
+  setupTimers();
+  advertiseTopics();
+}
+
+void NvbloxSemanticNode::getParameters() {
+  nh_private_.getParam("semantic_esdf_update_rate_hz",
+                       semantic_esdf_update_rate_hz_);
+  nh_private_.getParam("semantic_clearing_duration_s",
+                       semantic_clearing_duration_s_);
+  nh_private_.getParam("label_join_tolerance_ms", label_join_tolerance_ms_);
+  nh_private_.getParam("label_join_max_pending", label_join_max_pending_);
+
+  std::vector<std::string> class_names;
+  nh_private_.getParam("semantic_classes", class_names);
+  if (class_names.size() > SemanticImageSplitter::kMaxNumClasses) {
+    ROS_ERROR_STREAM("Only " << SemanticImageSplitter::kMaxNumClasses
+                             << " semantic classes are supported. Ignoring "
+                             << "the remaining ones.");
+    class_names.resize(SemanticImageSplitter::kMaxNumClasses);
+  }
+  for (const std::string& class_name : class_names) {
+    ros::NodeHandle class_nh(nh_private_, "semantic_mappers/" + class_name);
+    SemanticClass semantic_class;
+    semantic_class.name = class_name;
+    class_nh.getParam("label_ids", semantic_class.label_ids);
+    class_nh.getParam("decay_rate_hz", semantic_class.decay_rate_hz);
+    if (semantic_class.label_ids.empty()) {
+      ROS_WARN_STREAM("Semantic class \"" << class_name
+                                          << "\" has no label_ids.");
+    }
+    semantic_classes_.push_back(std::move(semantic_class));
+  }
+}
+
+void NvbloxSemanticNode::initializeSemanticMappers() {
+  // The static mapper is the one of the base class. It gets the pixels which
+  // belong to no class.
+  std::vector<std::vector<int>> class_label_ids;
+  for (SemanticClass& semantic_class : semantic_classes_) {
+    semantic_class.mapper = std::make_shared<Mapper>(
+        voxel_size_, MemoryType::kDevice, ProjectiveLayerType::kOccupancy);
+    ros::NodeHandle class_nh(nh_private_,
+                             "semantic_mappers/" + semantic_class.name);
+    initializeMapper(semantic_class.mapper.get(), class_nh);
+    // Set to a distance bigger than the max. integration distance to not
+    // include the pixels of other classes, but clear along the projection.
+    semantic_class.invalid_depth =
+        semantic_class.mapper->occupancy_integrator()
+            .max_integration_distance_m() *
+        2.f;
+    class_label_ids.push_back(semantic_class.label_ids);
+  }
+  image_splitter_.setClassLabelIds(class_label_ids);
+  class_clearing_frames_.resize(semantic_classes_.size());
+}
+
+void NvbloxSemanticNode::subscribeToTopics() {
+  ROS_INFO_STREAM("NvbloxSemanticNode::subscribeToTopics()");
+
+  // Unsubscribe from the base-class depth topic. We redo synchronization
+  // below. Color is integrated into the static map by the base class.
+  NvbloxNode::timesync_depth_.reset();
+
+  if (!use_depth_) {
+    return;
+  }
+
+  depth_labels_join_buffer_ = std::make_unique<DepthLabelsJoinBuffer>(
+      ros::Duration(label_join_tolerance_ms_ / 1000.0),
+      static_cast<size_t>(std::max(label_join_max_pending_, 1)),
+      [this](const ImageInfoPair& depth,
+             const sensor_msgs::ImageConstPtr& labels) {
+        pushMessageOntoQueue<DepthLabelsMsgTuple>(
+            std::make_tuple(depth.first, depth.second, labels),
+            &depth_labels_queue_, &depth_labels_queue_mutex_);
+      });
+
+  // Subscribe to depth + cam_info
+  timesync_depth_.reset(new message_filters::Synchronizer<time_policy_t>(
+      time_policy_t(maximum_sensor_message_queue_length_), depth_sub_,
+      depth_camera_info_sub_));
+  timesync_depth_->registerCallback(
+      std::bind(&NvbloxSemanticNode::depthWithInfoCallback, this,
+                std::placeholders::_1, std::placeholders::_2));
+
+  // Subscribe to labels
+  label_image_sub_.subscribe(nh_, "labels/image",
+                             maximum_sensor_message_queue_length_);
+  label_image_sub_.registerCallback(&NvbloxSemanticNode::labelImageCallback,
+                                    this);
+}
+
+void NvbloxSemanticNode::advertiseTopics() {
+  for (SemanticClass& semantic_class : semantic_classes_) {
+    const std::string prefix = "semantic/" + semantic_class.name + "/";
+    semantic_class.occupancy_publisher =
+        nh_private_.advertise<sensor_msgs::PointCloud2>(prefix + "occupancy",
+                                                        1, false);
+    semantic_class.esdf_pointcloud_publisher =
+        nh_private_.advertise<sensor_msgs::PointCloud2>(
+            prefix + "esdf_pointcloud", 1, false);
+    semantic_class.map_slice_publisher =
+        nh_private_.advertise<nvblox_msgs::DistanceMapSlice>(
+            prefix + "map_slice", 1, false);
+  }
+
+  // The class names, in the order of the classes. Latched, it only changes
+  // on restart.
+  semantic_labels_publisher_ =
+      nh_private_.advertise<nvblox_msgs::SemanticLabelsStamped>(
+          "semantic_labels", 1, true);
+  nvblox_msgs::SemanticLabelsStamped labels_msg;
+  labels_msg.header.stamp = ros::Time::now();
+  labels_msg.header.frame_id = global_frame_;
+  for (size_t i = 0; i < semantic_classes_.size(); i++) {
+    labels_msg.labels += (i > 0 ? "," : "") + semantic_classes_[i].name;
+  }
+  semantic_labels_publisher_.publish(labels_msg);
+}
+
+void NvbloxSemanticNode::setupTimers() {
+  for (size_t i = 0; i < semantic_classes_.size(); i++) {
+    ros::TimerOptions timer_options(
+        ros::Duration(1.0 / semantic_classes_[i].decay_rate_hz),
+        boost::bind(&NvbloxSemanticNode::decaySemanticOccupancy, this, i, _1),
+        &processing_queue_);
+    semantic_classes_[i].decay_timer = nh_private_.createTimer(timer_options);
+  }
+  {
+    ros::TimerOptions timer_options(
+        ros::Duration(1.0 / semantic_esdf_update_rate_hz_),
+        boost::bind(&NvbloxSemanticNode::processSemanticEsdf, this, _1),
+        &processing_queue_);
+    semantic_esdf_processing_timer_ = nh_private_.createTimer(timer_options);
+  }
+}
+
+void NvbloxSemanticNode::depthWithInfoCallback(
+    const sensor_msgs::ImageConstPtr& depth_img_ptr,
+    const sensor_msgs::CameraInfo::ConstPtr& camera_info_msg) {
+  depth_labels_join_buffer_->addFirst(
+      depth_img_ptr->header.stamp,
+      std::make_pair(depth_img_ptr, camera_info_msg));
+}
+
+void NvbloxSemanticNode::labelImageCallback(
+    const sensor_msgs::ImageConstPtr& label_img_ptr) {
+  depth_labels_join_buffer_->addSecond(label_img_ptr->header.stamp,
+                                       label_img_ptr);
+}
+
+void NvbloxSemanticNode::processDepthQueue(const ros::TimerEvent& /*event*/) {
+  auto message_ready = [this](const DepthLabelsMsgTuple& msg) {
+    return this->canTransform(std::get<0>(msg)->header);
+  };
+  processMessageQueue<DepthLabelsMsgTuple>(
+      &depth_labels_queue_,        // NOLINT
+      &depth_labels_queue_mutex_,  // NOLINT
+      message_ready,               // NOLINT
+      std::bind(&NvbloxSemanticNode::processDepthImage, this,
+                std::placeholders::_1));
+
+  limitQueueSizeByDeletingOldestMessages(
+      maximum_sensor_message_queue_length_, "depth_labels",
+      &depth_labels_queue_, &depth_labels_queue_mutex_);
+}
+
+bool NvbloxSemanticNode::processDepthImage(
+    const DepthLabelsMsgTuple& depth_labels_msg) {
+  const TraceFrame trace_frame(std::get<0>(depth_labels_msg)->header.stamp);
+  StageTimer ros_total_timer("ros/total", &stage_statistics_);
+  StageTimer ros_depth_timer("ros/depth", &stage_statistics_);
+  StageTimer transform_timer("ros/depth/transform", &stage_statistics_);
+
+  // Message parts
+  const sensor_msgs::ImageConstPtr& depth_img_ptr =
+      std::get<0>(depth_labels_msg);
+  const sensor_msgs::CameraInfo::ConstPtr& camera_info_msg =
+      std::get<1>(depth_labels_msg);
+  const sensor_msgs::ImageConstPtr& label_img_ptr =
+      std::get<2>(depth_labels_msg);
+
+  // Check that we're not updating more quickly than we should.
+  if (isUpdateTooFrequent(depth_img_ptr->header.stamp, last_depth_update_time_,
+                          max_depth_update_hz_)) {
+    return true;
+  }
+  last_depth_update_time_ = depth_img_ptr->header.stamp;
+
+  // Get the TF for this image. The labels are registered to the depth image.
+  Transform T_L_C;
+  const std::string target_frame = depth_img_ptr->header.frame_id;
+  if (!transformer_.lookupTransformToGlobalFrame(
+          target_frame, depth_img_ptr->header.stamp, &T_L_C)) {
+    ROS_ERROR("Could not get transform from %s to %s", target_frame.c_str(),
+              global_frame_.c_str());
+    return false;
+  }
+  transform_timer.Stop();
+
+  StageTimer conversions_timer("ros/depth/conversions", &stage_statistics_);
+  // Convert camera info message to camera object.
+  const Camera camera = conversions::cameraFromMessage(*camera_info_msg);
+
+  // Convert the depth and label images.
+  if (!conversions::depthImageFromImageMessage(depth_img_ptr, &depth_image_) ||
+      !conversions::monoImageFromImageMessage(label_img_ptr, &label_image_)) {
+    ROS_ERROR("Failed to transform depth or label image.");
+    return false;
+  }
+  conversions_timer.Stop();
+
+  // Split the depth frame into the static part and one part per class in
+  // view.
+  StageTimer split_timer("ros/depth/split", &stage_statistics_);
+  // Set to an invalid depth to ignore the pixels of the classes in the
+  // static mapper.
+  constexpr float kUnmaskedInvalidDepth = -1.0f;
+  std::vector<float> class_invalid_depths;
+  for (const SemanticClass& semantic_class : semantic_classes_) {
+    class_invalid_depths.push_back(semantic_class.invalid_depth);
+  }
+  if (!image_splitter_.splitImageOnGPU(
+          depth_image_, label_image_, kUnmaskedInvalidDepth,
+          class_invalid_depths, &depth_frame_unmasked_, &class_depth_frames_,
+          &class_pixel_counts_, &class_bounding_boxes_)) {
+    ROS_WARN_STREAM_THROTTLE(
+        1.0, "The label image has to be registered to the depth image. "
+                 << "Got a label image of size " << label_image_.cols() << "x"
+                 << label_image_.rows() << " and a depth image of size "
+                 << depth_image_.cols() << "x" << depth_image_.rows() << ".");
+    return true;
+  }
+  split_timer.Stop();
+
+  // Integrate
+  StageTimer integration_timer("ros/depth/integrate", &stage_statistics_);
+  {
+    std::lock_guard<std::mutex> static_lock(map_mutex_);
+    StageTimer static_integration_timer("ros/depth/integrate/static",
+                                        &stage_statistics_);
+    mapper_->integrateDepth(depth_frame_unmasked_, T_L_C, camera);
+  }
+  updateNewestStamp(depth_img_ptr->header.stamp, &newest_tsdf_stamp_);
+  {
+    // The classes in view are integrated within the bounding box of their
+    // pixels only, such that their cost scales with their size in the image.
+    // Where they were outside of it is cleared by their decay. The classes
+    // which were in view recently are integrated with a frame of only invalid
+    // depth, to clear where they were. The others only decay.
+    std::lock_guard<std::mutex> semantic_lock(semantic_map_mutex_);
+    StageTimer semantic_integration_timer("ros/depth/integrate/semantic",
+                                          &stage_statistics_);
+    const ros::Duration clearing_duration(semantic_clearing_duration_s_);
+    for (size_t i = 0; i < semantic_classes_.size(); i++) {
+      SemanticClass& semantic_class = semantic_classes_[i];
+      if (class_pixel_counts_[i] > 0) {
+        semantic_class.last_seen = depth_img_ptr->header.stamp;
+        semantic_class.mapper->integrateDepth(
+            class_depth_frames_[i], T_L_C,
+            SemanticImageSplitter::cropCamera(camera,
+                                              class_bounding_boxes_[i]));
+      } else if (semantic_class.last_seen.isZero() ||
+                 depth_img_ptr->header.stamp - semantic_class.last_seen >
+                     clearing_duration) {
+        continue;
+      } else {
+        // The clearing frame only depends on the image size, so it's only
+        // written when that changes.
+        DepthImage& clearing_frame = class_clearing_frames_[i];
+        if (clearing_frame.rows() != depth_image_.rows() ||
+            clearing_frame.cols() != depth_image_.cols()) {
+          image_splitter_.fillImageOnGPU(depth_image_.rows(),
+                                         depth_image_.cols(),
+                                         semantic_class.invalid_depth,
+                                         &clearing_frame);
+        }
+        semantic_class.mapper->integrateDepth(clearing_frame, T_L_C, camera);
+      }
+      updateNewestStamp(depth_img_ptr->header.stamp,
+                        &semantic_class.newest_stamp);
+    }
+  }
+  integration_timer.Stop();
+  return true;
+}
+
+void NvbloxSemanticNode::processSemanticEsdf(
+    const ros::TimerEvent& /*event*/) {
+  std::unique_lock<std::mutex> lock(semantic_map_mutex_);
+  StageTimer ros_total_timer("ros/total", &stage_statistics_);
+  StageTimer ros_semantic_total_timer("ros/semantic", &stage_statistics_);
+
+  if (last_depth_update_time_.toSec() <= 0.f) {
+    return;  // no data yet.
+  }
+
+  for (const SemanticClass& semantic_class : semantic_classes_) {
+    if (semantic_class.mapper->occupancy_layer().numAllocatedBlocks() == 0) {
+      continue;
+    }
+    StageTimer esdf_integration_timer("ros/semantic/esdf/integrate",
+                                      &stage_statistics_);
+    std::vector<Index3D> updated_blocks;
+    if (esdf_2d_) {
+      updated_blocks = semantic_class.mapper->updateEsdfSlice(
+          esdf_2d_min_height_, esdf_2d_max_height_, esdf_slice_height_);
+    } else {
+      updated_blocks = semantic_class.mapper->updateEsdf();
+    }
+    esdf_integration_timer.Stop();
+
+    if (!updated_blocks.empty()) {
+      publishSemanticClass(semantic_class);
+    }
+  }
+}
+
+void NvbloxSemanticNode::publishSemanticClass(
+    const SemanticClass& semantic_class) {
+  StageTimer esdf_output_timer("ros/semantic/esdf/output", &stage_statistics_);
+  const Mapper& mapper = *semantic_class.mapper;
+
+  // Check if anyone wants any slice
+  if (esdf_distance_slice_ &&
+      (semantic_class.esdf_pointcloud_publisher.getNumSubscribers() > 0 ||
+       semantic_class.map_slice_publisher.getNumSubscribers() > 0)) {
+    // Get the slice as an image
+    StageTimer esdf_slice_compute_timer("ros/semantic/esdf/output/compute",
+                                        &stage_statistics_);
+    AxisAlignedBoundingBox aabb;
+    Image<float> map_slice_image;
+    esdf_slice_converter_.distanceMapSliceImageFromLayer(
+        mapper.esdf_layer(), esdf_slice_height_, &map_slice_image, &aabb);
+    esdf_slice_compute_timer.Stop();
+
+    // Slice pointcloud (for visualization)
+    if (semantic_class.esdf_pointcloud_publisher.getNumSubscribers() > 0) {
+      StageTimer esdf_output_pointcloud_timer(
+          "ros/semantic/esdf/output/pointcloud", &stage_statistics_);
+      sensor_msgs::PointCloud2 pointcloud_msg;
+      esdf_slice_converter_.sliceImageToPointcloud(
+          map_slice_image, aabb, esdf_slice_height_,
+          mapper.esdf_layer().voxel_size(), &pointcloud_msg);
+      pointcloud_msg.header.frame_id = global_frame_;
+      pointcloud_msg.header.stamp =
+          outputStamp("semantic/" + semantic_class.name + "/esdf/pointcloud",
+                      semantic_class.newest_stamp);
+      semantic_class.esdf_pointcloud_publisher.publish(pointcloud_msg);
+    }
+
+    // Slice (for navigation)
+    if (semantic_class.map_slice_publisher.getNumSubscribers() > 0) {
+      StageTimer esdf_output_slice_timer("ros/semantic/esdf/output/slice",
+                                         &stage_statistics_);
+      nvblox_msgs::DistanceMapSlice map_slice_msg;
+      esdf_slice_converter_.distanceMapSliceImageToMsg(
+          map_slice_image, aabb, esdf_slice_height_, mapper.voxel_size_m(),
+          &map_slice_msg);
+      map_slice_msg.header.frame_id = global_frame_;
+      map_slice_msg.header.stamp =
+          outputStamp("semantic/" + semantic_class.name + "/esdf/slice",
+                      semantic_class.newest_stamp);
+      semantic_class.map_slice_publisher.publish(map_slice_msg);
+    }
+  }
+
+  // Publish the occupancy layer
+  if (semantic_class.occupancy_publisher.getNumSubscribers() > 0) {
+    StageTimer occupancy_output_timer("ros/semantic/output/occupancy",
+                                      &stage_statistics_);
+    sensor_msgs::PointCloud2 pointcloud_msg;
+    layer_converter_.pointcloudMsgFromLayer(mapper.occupancy_layer(),
+                                            &pointcloud_msg);
+    pointcloud_msg.header.frame_id = global_frame_;
+    pointcloud_msg.header.stamp =
+        outputStamp("semantic/" + semantic_class.name + "/occupancy",
+                    semantic_class.newest_stamp);
+    semantic_class.occupancy_publisher.publish(pointcloud_msg);
+  }
+}
+
+void NvbloxSemanticNode::decaySemanticOccupancy(
+    size_t class_index, const ros::TimerEvent& /*event*/) {
+  std::unique_lock<std::mutex> lock(semantic_map_mutex_);
+  StageTimer decay_timer("ros/semantic/decay", &stage_statistics_);
+  semantic_classes_[class_index].mapper->decayOccupancy();
+}
+
+}  // namespace nvblox
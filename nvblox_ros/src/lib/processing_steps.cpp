@@ -0,0 +1,186 @@
+// SPDX-FileCopyrightText: NVIDIA CORPORATION & AFFILIATES
+// Copyright (c) 2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <glog/logging.h>
+
+#include <string>
+#include <vector>
+
+#include <ros/console.h>
+
+#include "nvblox_ros/conversions/image_conversions.hpp"
+#include "nvblox_ros/stage_timer.hpp"
+
+#include "nvblox_ros/processing_steps.hpp"
+
+namespace nvblox {
+namespace processing {
+
+bool convertDepthImage(const sensor_msgs::ImageConstPtr& depth_image_msg,
+                       const sensor_msgs::CameraInfo& camera_info,
+                       const std::string& stage_prefix,
+                       LatencyStatistics* statistics, DepthImage* depth_image,
+                       Camera* camera) {
+  CHECK_NOTNULL(depth_image);
+  CHECK_NOTNULL(camera);
+  StageTimer conversions_timer(stage_prefix + "depth/conversions", statistics);
+  // Convert camera info message to camera object.
+  *camera = conversions::cameraFromMessage(camera_info);
+
+  // Convert the depth image.
+  if (!conversions::depthImageFromImageMessage(depth_image_msg, depth_image)) {
+    ROS_ERROR("Failed to transform depth image.");
+    return false;
+  }
+  return true;
+}
+
+void integrateDepthImage(const DepthImage& depth_image, const Transform& T_L_C,
+                         const Camera& camera, const std::string& stage_prefix,
+                         LatencyStatistics* statistics, Mapper* mapper) {
+  CHECK_NOTNULL(mapper);
+  StageTimer integration_timer(stage_prefix + "depth/integrate", statistics);
+  mapper->integrateDepth(depth_image, T_L_C, camera);
+}
+
+bool convertColorImage(const sensor_msgs::ImageConstPtr& color_image_msg,
+                       const sensor_msgs::CameraInfo& camera_info,
+                       const std::string& stage_prefix,
+                       LatencyStatistics* statistics, ColorImage* color_image,
+                       Camera* camera) {
+  CHECK_NOTNULL(color_image);
+  CHECK_NOTNULL(camera);
+  StageTimer color_convert_timer(stage_prefix + "color/conversion",
+                                 statistics);
+  // Convert camera info message to camera object.
+  *camera = conversions::cameraFromMessage(camera_info);
+
+  // Convert the color image.
+  if (!conversions::colorImageFromImageMessage(color_image_msg, color_image)) {
+    ROS_ERROR("Failed to transform color image.");
+    return false;
+  }
+  return true;
+}
+
+void integrateColorImage(const ColorImage& color_image, const Transform& T_L_C,
+                         const Camera& camera, const std::string& stage_prefix,
+                         LatencyStatistics* statistics, Mapper* mapper) {
+  CHECK_NOTNULL(mapper);
+  StageTimer color_integrate_timer(stage_prefix + "color/integrate",
+                                   statistics);
+  mapper->integrateColor(color_image, T_L_C, camera);
+}
+
+bool convertLidarPointcloud(const sensor_msgs::PointCloud2::ConstPtr& cloud,
+                            const Lidar& lidar,
+                            const std::string& stage_prefix,
+                            LatencyStatistics* statistics,
+                            conversions::PointcloudConverter* converter,
+                            DepthImage* depth_image) {
+  CHECK_NOTNULL(converter);
+  CHECK_NOTNULL(depth_image);
+  // NOTE(alexmillane): Note that internally we cache checks, so each LiDAR
+  // intrisics model is only tested against a single pointcloud. This is because
+  // the check is expensive to perform.
+  if (!converter->checkLidarPointcloud(cloud, lidar)) {
+    ROS_ERROR("LiDAR intrinsics are inconsistent with the received pointcloud");
+    return false;
+  }
+
+  StageTimer lidar_conversion_timer(stage_prefix + "lidar/conversion",
+                                    statistics);
+  converter->depthImageFromPointcloudGPU(cloud, lidar, depth_image);
+  return true;
+}
+
+void integrateLidarDepthImage(const DepthImage& depth_image,
+                              const Transform& T_L_C, const Lidar& lidar,
+                              const std::string& stage_prefix,
+                              LatencyStatistics* statistics, Mapper* mapper) {
+  CHECK_NOTNULL(mapper);
+  StageTimer lidar_integration_timer(stage_prefix + "lidar/integration",
+                                     statistics);
+  mapper->integrateLidarDepth(depth_image, T_L_C, lidar);
+}
+
+std::vector<Index3D> updateEsdf(const std::vector<Index3D>& extra_blocks,
+                                ProjectiveLayerType projective_layer_type,
+                                bool esdf_2d, float esdf_2d_min_height,
+                                float esdf_2d_max_height,
+                                float esdf_slice_height,
+                                const std::string& stage_prefix,
+                                LatencyStatistics* statistics, Mapper* mapper) {
+  CHECK_NOTNULL(mapper);
+  StageTimer esdf_integration_timer(stage_prefix + "esdf/integrate",
+                                    statistics);
+  std::vector<Index3D> updated_blocks;
+  if (esdf_2d) {
+    updated_blocks = mapper->updateEsdfSlice(
+        esdf_2d_min_height, esdf_2d_max_height, esdf_slice_height);
+  } else {
+    updated_blocks = mapper->updateEsdf();
+  }
+  if (extra_blocks.empty()) {
+    return updated_blocks;
+  }
+  EsdfLayer* esdf_layer_ptr = mapper->layers().getPtr<EsdfLayer>();
+  if (projective_layer_type == ProjectiveLayerType::kTsdf) {
+    if (esdf_2d) {
+      mapper->esdf_integrator().integrateSlice(
+          mapper->tsdf_layer(), extra_blocks, esdf_2d_min_height,
+          esdf_2d_max_height, esdf_slice_height, esdf_layer_ptr);
+    } else {
+      mapper->esdf_integrator().integrateBlocks(mapper->tsdf_layer(),
+                                                extra_blocks, esdf_layer_ptr);
+    }
+  } else {
+    if (esdf_2d) {
+      mapper->esdf_integrator().integrateSlice(
+          mapper->occupancy_layer(), extra_blocks, esdf_2d_min_height,
+          esdf_2d_max_height, esdf_slice_height, esdf_layer_ptr);
+    } else {
+      mapper->esdf_integrator().integrateBlocks(
+          mapper->occupancy_layer(), extra_blocks, esdf_layer_ptr);
+    }
+  }
+  updated_blocks.insert(updated_blocks.end(), extra_blocks.begin(),
+                        extra_blocks.end());
+  return updated_blocks;
+}
+
+std::vector<Index3D> updateMesh(const std::vector<Index3D>& extra_blocks,
+                                const std::string& stage_prefix,
+                                LatencyStatistics* statistics, Mapper* mapper) {
+  CHECK_NOTNULL(mapper);
+  StageTimer mesh_integration_timer(stage_prefix + "mesh/integrate_and_color",
+                                    statistics);
+  std::vector<Index3D> updated_blocks = mapper->updateMesh();
+  if (extra_blocks.empty()) {
+    return updated_blocks;
+  }
+  mapper->mesh_integrator().integrateBlocksGPU(
+      mapper->tsdf_layer(), extra_blocks, mapper->layers().getPtr<MeshLayer>());
+  mapper->mesh_integrator().colorMesh(mapper->color_layer(), extra_blocks,
+                                      mapper->layers().getPtr<MeshLayer>());
+  updated_blocks.insert(updated_blocks.end(), extra_blocks.begin(),
+                        extra_blocks.end());
+  return updated_blocks;
+}
+
+}  // namespace processing
+}  // namespace nvblox
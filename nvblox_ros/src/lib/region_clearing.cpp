@@ -0,0 +1,187 @@
+// SPDX-FileCopyrightText: NVIDIA CORPORATION & AFFILIATES
+// Copyright (c) 2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <vector>
+
+#include "nvblox_ros/region_clearing.hpp"
+
+namespace nvblox {
+
+void ClearingRegion::addAABB(const AxisAlignedBoundingBox& aabb) {
+  if (aabb.isEmpty()) {
+    return;
+  }
+  aabbs_.push_back(aabb);
+  bounding_boxes_.push_back(aabb);
+}
+
+void ClearingRegion::addOrientedBox(const Transform& T_L_B,
+                                    const Vector3f& size) {
+  if ((size.array() < 0.0f).any()) {
+    return;
+  }
+  const Vector3f half_size = 0.5f * size;
+  AxisAlignedBoundingBox bounding_box;
+  for (int corner = 0; corner < 8; corner++) {
+    const Vector3f corner_B((corner & 1) ? half_size.x() : -half_size.x(),
+                            (corner & 2) ? half_size.y() : -half_size.y(),
+                            (corner & 4) ? half_size.z() : -half_size.z());
+    bounding_box.extend(T_L_B * corner_B);
+  }
+  oriented_boxes_.push_back(OrientedBox{T_L_B.inverse(), half_size});
+  bounding_boxes_.push_back(bounding_box);
+}
+
+void ClearingRegion::addExtrudedPolygon(const std::vector<Vector2f>& polygon,
+                                        float min_z, float max_z) {
+  if (polygon.size() < 3 || min_z > max_z) {
+    return;
+  }
+  AxisAlignedBoundingBox bounding_box;
+  for (const Vector2f& vertex : polygon) {
+    bounding_box.extend(Vector3f(vertex.x(), vertex.y(), min_z));
+    bounding_box.extend(Vector3f(vertex.x(), vertex.y(), max_z));
+  }
+  polygons_.push_back(ExtrudedPolygon{polygon, min_z, max_z});
+  bounding_boxes_.push_back(bounding_box);
+}
+
+bool ClearingRegion::contains(const Vector3f& position) const {
+  for (const AxisAlignedBoundingBox& aabb : aabbs_) {
+    if (aabb.contains(position)) {
+      return true;
+    }
+  }
+  for (const OrientedBox& box : oriented_boxes_) {
+    if (contains(box, position)) {
+      return true;
+    }
+  }
+  for (const ExtrudedPolygon& polygon : polygons_) {
+    if (contains(polygon, position)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ClearingRegion::contains(const OrientedBox& box,
+                              const Vector3f& position) {
+  const Vector3f position_B = box.T_B_L * position;
+  return (position_B.cwiseAbs().array() <= box.half_size.array()).all();
+}
+
+bool ClearingRegion::contains(const ExtrudedPolygon& polygon,
+                              const Vector3f& position) {
+  if (position.z() < polygon.min_z || position.z() > polygon.max_z) {
+    return false;
+  }
+  // Even-odd rule: count the edges crossed by a ray along +x.
+  const std::vector<Vector2f>& vertices = polygon.polygon;
+  bool is_inside = false;
+  for (size_t i = 0, j = vertices.size() - 1; i < vertices.size(); j = i++) {
+    const Vector2f& a = vertices[i];
+    const Vector2f& b = vertices[j];
+    if ((a.y() > position.y()) != (b.y() > position.y())) {
+      const float crossing_x =
+          a.x() + (position.y() - a.y()) / (b.y() - a.y()) * (b.x() - a.x());
+      if (position.x() < crossing_x) {
+        is_inside = !is_inside;
+      }
+    }
+  }
+  return is_inside;
+}
+
+bool ClearingRegion::mayIntersect(const AxisAlignedBoundingBox& aabb) const {
+  for (const AxisAlignedBoundingBox& bounding_box : bounding_boxes_) {
+    if (bounding_box.intersects(aabb)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+RegionBlocks ClearingRegion::findBlocks(
+    const std::function<bool(const Index3D&)>& is_allocated,
+    size_t num_allocated_blocks,
+    const std::function<std::vector<Index3D>()>& get_allocated_blocks,
+    float block_size) const {
+  // Candidates: the blocks overlapping the bounding box of any volume.
+  Index3DSet candidate_blocks;
+  std::vector<Index3D> allocated_blocks;
+  bool has_allocated_blocks = false;
+  for (const AxisAlignedBoundingBox& bounding_box : bounding_boxes_) {
+    const Index3D min_index =
+        getBlockIndexFromPositionInLayer(block_size, bounding_box.min());
+    const Index3D max_index =
+        getBlockIndexFromPositionInLayer(block_size, bounding_box.max());
+    const Index3D extent = max_index - min_index + Index3D::Ones();
+    const double num_indices = static_cast<double>(extent.x()) * extent.y() *
+                               static_cast<double>(extent.z());
+    if (num_indices <= static_cast<double>(num_allocated_blocks)) {
+      for (int x = min_index.x(); x <= max_index.x(); x++) {
+        for (int y = min_index.y(); y <= max_index.y(); y++) {
+          for (int z = min_index.z(); z <= max_index.z(); z++) {
+            const Index3D block_index(x, y, z);
+            if (is_allocated(block_index)) {
+              candidate_blocks.insert(block_index);
+            }
+          }
+        }
+      }
+    } else {
+      if (!has_allocated_blocks) {
+        allocated_blocks = get_allocated_blocks();
+        has_allocated_blocks = true;
+      }
+      for (const Index3D& block_index : allocated_blocks) {
+        if (getAABBOfBlock(block_size, block_index).intersects(bounding_box)) {
+          candidate_blocks.insert(block_index);
+        }
+      }
+    }
+  }
+
+  // Test the voxel centers of the candidates.
+  constexpr int kVoxelsPerSide = VoxelBlock<TsdfVoxel>::kVoxelsPerSide;
+  RegionBlocks region_blocks;
+  for (const Index3D& block_index : candidate_blocks) {
+    VoxelMask mask;
+    for (int x = 0; x < kVoxelsPerSide; x++) {
+      for (int y = 0; y < kVoxelsPerSide; y++) {
+        for (int z = 0; z < kVoxelsPerSide; z++) {
+          const Vector3f position =
+              getCenterPositionFromBlockIndexAndVoxelIndex(
+                  block_size, block_index, Index3D(x, y, z));
+          if (contains(position)) {
+            mask.set((x * kVoxelsPerSide + y) * kVoxelsPerSide + z);
+          }
+        }
+      }
+    }
+    if (mask.all()) {
+      region_blocks.full_blocks.push_back(block_index);
+    } else if (mask.any()) {
+      region_blocks.partial_blocks.push_back(block_index);
+      region_blocks.partial_masks.push_back(mask);
+    }
+  }
+  return region_blocks;
+}
+
+}  // namespace nvblox
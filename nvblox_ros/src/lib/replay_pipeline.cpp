@@ -0,0 +1,123 @@
+// SPDX-FileCopyrightText: NVIDIA CORPORATION & AFFILIATES
+// Copyright (c) 2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <cmath>
+#include <string>
+
+#include "nvblox_ros/conversions/mesh_conversions.hpp"
+#include "nvblox_ros/mapper_initialization.hpp"
+#include "nvblox_ros/processing_steps.hpp"
+#include "nvblox_ros/stage_timer.hpp"
+
+#include "nvblox_ros/replay_pipeline.hpp"
+
+namespace nvblox {
+
+namespace {
+
+// The stages are named like the node's timers.
+const std::string kStagePrefix = "ros/";
+
+}  // namespace
+
+ReplayPipeline::ReplayPipeline(const ReplayPipelineOptions& options)
+    : options_(options),
+      mapper_(new Mapper(options.voxel_size, MemoryType::kDevice,
+                         options.projective_layer_type)) {
+  initializeMapper(mapper_.get(), options.mapper_parameters);
+}
+
+bool ReplayPipeline::processDepthImage(
+    const sensor_msgs::ImageConstPtr& depth_image,
+    const sensor_msgs::CameraInfo& camera_info, const Transform& T_L_C) {
+  StageTimer depth_timer(kStagePrefix + "depth", &statistics_);
+  Camera camera;
+  if (!processing::convertDepthImage(depth_image, camera_info, kStagePrefix,
+                                     &statistics_, &depth_image_, &camera)) {
+    return false;
+  }
+  processing::integrateDepthImage(depth_image_, T_L_C, camera, kStagePrefix,
+                                  &statistics_, mapper_.get());
+  return true;
+}
+
+bool ReplayPipeline::processColorImage(
+    const sensor_msgs::ImageConstPtr& color_image,
+    const sensor_msgs::CameraInfo& camera_info, const Transform& T_L_C) {
+  StageTimer color_timer(kStagePrefix + "color", &statistics_);
+  Camera camera;
+  if (!processing::convertColorImage(color_image, camera_info, kStagePrefix,
+                                     &statistics_, &color_image_, &camera)) {
+    return false;
+  }
+  processing::integrateColorImage(color_image_, T_L_C, camera, kStagePrefix,
+                                  &statistics_, mapper_.get());
+  return true;
+}
+
+bool ReplayPipeline::processLidarPointcloud(
+    const sensor_msgs::PointCloud2::ConstPtr& cloud, const Transform& T_L_C) {
+  StageTimer lidar_timer(kStagePrefix + "lidar", &statistics_);
+  const Lidar lidar(options_.lidar_width, options_.lidar_height,
+                    options_.lidar_vertical_fov_deg * M_PI / 180.0);
+  if (!processing::convertLidarPointcloud(cloud, lidar, kStagePrefix,
+                                          &statistics_, &pointcloud_converter_,
+                                          &pointcloud_image_)) {
+    return false;
+  }
+  processing::integrateLidarDepthImage(pointcloud_image_, T_L_C, lidar,
+                                       kStagePrefix, &statistics_,
+                                       mapper_.get());
+  return true;
+}
+
+std::vector<Index3D> ReplayPipeline::processEsdf(
+    nvblox_msgs::DistanceMapSlice* map_slice) {
+  StageTimer esdf_timer(kStagePrefix + "esdf", &statistics_);
+  const std::vector<Index3D> updated_blocks = processing::updateEsdf(
+      std::vector<Index3D>(), options_.projective_layer_type,
+      options_.esdf_2d, options_.esdf_2d_min_height,
+      options_.esdf_2d_max_height, options_.esdf_slice_height, kStagePrefix,
+      &statistics_, mapper_.get());
+
+  if (map_slice != nullptr && !updated_blocks.empty()) {
+    StageTimer output_timer(kStagePrefix + "esdf/output/slice", &statistics_);
+    AxisAlignedBoundingBox aabb;
+    esdf_slice_converter_.distanceMapSliceImageFromLayer(
+        mapper_->esdf_layer(), options_.esdf_slice_height, &map_slice_image_,
+        &aabb);
+    esdf_slice_converter_.distanceMapSliceImageToMsg(
+        map_slice_image_, aabb, options_.esdf_slice_height,
+        mapper_->voxel_size_m(), map_slice);
+  }
+  return updated_blocks;
+}
+
+std::vector<Index3D> ReplayPipeline::processMesh(nvblox_msgs::Mesh* mesh) {
+  StageTimer mesh_timer(kStagePrefix + "mesh", &statistics_);
+  const std::vector<Index3D> updated_blocks = processing::updateMesh(
+      std::vector<Index3D>(), kStagePrefix, &statistics_, mapper_.get());
+
+  if (mesh != nullptr) {
+    StageTimer output_timer(kStagePrefix + "mesh/output", &statistics_);
+    conversions::meshMessageFromMeshBlocks(mapper_->mesh_layer(),
+                                           updated_blocks, mesh);
+  }
+  return updated_blocks;
+}
+
+}  // namespace nvblox
@@ -0,0 +1,149 @@
+// SPDX-FileCopyrightText: NVIDIA CORPORATION & AFFILIATES
+// Copyright (c) 2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+#include "nvblox_ros/rolling_block_window.hpp"
+
+namespace nvblox {
+
+void RollingBlockWindow::resize(int num_blocks_per_side) {
+  num_blocks_per_side_ = std::max(num_blocks_per_side, 0);
+  const size_t num_slots = static_cast<size_t>(num_blocks_per_side_) *
+                           num_blocks_per_side_ * num_blocks_per_side_;
+  slot_blocks_.resize(num_slots);
+  is_slot_occupied_.resize(num_slots);
+  clear();
+}
+
+void RollingBlockWindow::clear() {
+  std::fill(is_slot_occupied_.begin(), is_slot_occupied_.end(), 0);
+  num_blocks_ = 0;
+  is_placed_ = false;
+  blocks_outside_.clear();
+}
+
+bool RollingBlockWindow::contains(const Index3D& block_index) const {
+  const Index3D offset = block_index - min_block_index_;
+  return is_placed_ && (offset.array() >= 0).all() &&
+         (offset.array() < num_blocks_per_side_).all();
+}
+
+size_t RollingBlockWindow::slotIndex(const Index3D& block_index) const {
+  const int n = num_blocks_per_side_;
+  const Index3D slot = block_index.unaryExpr([n](int i) {
+    return ((i % n) + n) % n;
+  });
+  return (static_cast<size_t>(slot.x()) * n + slot.y()) * n + slot.z();
+}
+
+void RollingBlockWindow::evictSlot(size_t slot_index,
+                                   std::vector<Index3D>* evicted_blocks) {
+  if (is_slot_occupied_[slot_index]) {
+    evicted_blocks->push_back(slot_blocks_[slot_index]);
+    is_slot_occupied_[slot_index] = 0;
+    --num_blocks_;
+  }
+}
+
+void RollingBlockWindow::insert(const std::vector<Index3D>& block_indices) {
+  if (!is_placed_) {
+    return;
+  }
+  for (const Index3D& block_index : block_indices) {
+    if (!contains(block_index)) {
+      blocks_outside_.insert(block_index);
+      continue;
+    }
+    // Blocks within the window never share a slot.
+    const size_t slot_index = slotIndex(block_index);
+    if (!is_slot_occupied_[slot_index]) {
+      is_slot_occupied_[slot_index] = 1;
+      ++num_blocks_;
+    }
+    slot_blocks_[slot_index] = block_index;
+  }
+}
+
+void RollingBlockWindow::remove(const std::vector<Index3D>& block_indices) {
+  for (const Index3D& block_index : block_indices) {
+    if (contains(block_index)) {
+      const size_t slot_index = slotIndex(block_index);
+      if (is_slot_occupied_[slot_index] &&
+          slot_blocks_[slot_index] == block_index) {
+        is_slot_occupied_[slot_index] = 0;
+        --num_blocks_;
+      }
+    }
+  }
+}
+
+std::vector<Index3D> RollingBlockWindow::moveTo(const Vector3f& position,
+                                                float block_size) {
+  std::vector<Index3D> evicted_blocks(blocks_outside_.begin(),
+                                      blocks_outside_.end());
+  blocks_outside_.clear();
+  if (num_blocks_per_side_ == 0) {
+    return evicted_blocks;
+  }
+  const int n = num_blocks_per_side_;
+  const Index3D min_block_index =
+      getBlockIndexFromPositionInLayer(block_size, position) -
+      Index3D::Constant(n / 2);
+  if (!is_placed_) {
+    min_block_index_ = min_block_index;
+    is_placed_ = true;
+    return evicted_blocks;
+  }
+  const Index3D shift = min_block_index - min_block_index_;
+  const Index3D previous_min_block_index = min_block_index_;
+  min_block_index_ = min_block_index;
+  if ((shift.array().abs() >= n).any()) {
+    // The windows don't overlap, all blocks left.
+    for (size_t slot_index = 0; slot_index < slot_blocks_.size();
+         slot_index++) {
+      evictSlot(slot_index, &evicted_blocks);
+    }
+    return evicted_blocks;
+  }
+
+  // Per axis, the blocks which left the window occupy slabs of slots.
+  for (int axis = 0; axis < 3; axis++) {
+    const int num_left = std::abs(shift[axis]);
+    const int first_left = shift[axis] > 0
+                               ? previous_min_block_index[axis]
+                               : previous_min_block_index[axis] + n - num_left;
+    for (int i = 0; i < num_left; i++) {
+      Index3D slot;
+      slot[axis] = (((first_left + i) % n) + n) % n;
+      for (int a = 0; a < n; a++) {
+        for (int b = 0; b < n; b++) {
+          slot[(axis + 1) % 3] = a;
+          slot[(axis + 2) % 3] = b;
+          evictSlot((static_cast<size_t>(slot.x()) * n + slot.y()) * n +
+                        slot.z(),
+                    &evicted_blocks);
+        }
+      }
+    }
+  }
+  return evicted_blocks;
+}
+
+}  // namespace nvblox
@@ -0,0 +1,269 @@
+// SPDX-FileCopyrightText: NVIDIA CORPORATION & AFFILIATES
+// Copyright (c) 2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <algorithm>
+#include <climits>
+
+#include "nvblox_ros/semantic_image_splitter.hpp"
+
+namespace nvblox {
+
+SemanticImageSplitter::SemanticImageSplitter() {
+  cudaStreamCreate(&cuda_stream_);
+  setClassLabelIds({});
+}
+
+SemanticImageSplitter::~SemanticImageSplitter() {
+  cudaStreamDestroy(cuda_stream_);
+}
+
+void SemanticImageSplitter::setClassLabelIds(
+    const std::vector<std::vector<int>>& class_label_ids) {
+  CHECK_LE(static_cast<int>(class_label_ids.size()), kMaxNumClasses);
+  num_classes_ = class_label_ids.size();
+  std::vector<int> label_to_class(kNumLabelValues, -1);
+  for (int class_index = 0; class_index < num_classes_; class_index++) {
+    for (const int label_id : class_label_ids[class_index]) {
+      if (label_id < 0 || label_id >= kNumLabelValues) {
+        LOG(WARNING) << "Ignoring label id " << label_id
+                     << " which is not in [0, " << kNumLabelValues - 1 << "].";
+        continue;
+      }
+      if (label_to_class[label_id] >= 0) {
+        LOG(WARNING) << "Label id " << label_id
+                     << " is assigned to multiple classes. Using class "
+                     << label_to_class[label_id] << ".";
+        continue;
+      }
+      label_to_class[label_id] = class_index;
+    }
+  }
+  label_to_class_device_ = label_to_class;
+}
+
+// Calling rules:
+// - One thread per pixel, 1D grid.
+// - Less than SemanticImageSplitter::kMaxNumClasses classes.
+__global__ void countSemanticImageKernel(
+    const float* depth_image, const uint8_t* label_image, int num_pixels,
+    int num_cols, const int* label_to_class, int num_classes,
+    float unmasked_invalid_depth, float* unmasked_depth_output,
+    int* class_pixel_counts, int* class_bounding_boxes) {
+  // Count the pixels (and bound them) per thread-block first, to keep the
+  // global atomics down.
+  constexpr int kMaxNumClasses = SemanticImageSplitter::kMaxNumClasses;
+  __shared__ int block_class_pixel_counts[kMaxNumClasses];
+  __shared__ int block_class_bounding_boxes[4 * kMaxNumClasses];
+  if (threadIdx.x < num_classes) {
+    block_class_pixel_counts[threadIdx.x] = 0;
+    block_class_bounding_boxes[4 * threadIdx.x + 0] = INT_MAX;
+    block_class_bounding_boxes[4 * threadIdx.x + 1] = -1;
+    block_class_bounding_boxes[4 * threadIdx.x + 2] = INT_MAX;
+    block_class_bounding_boxes[4 * threadIdx.x + 3] = -1;
+  }
+  __syncthreads();
+
+  const int pixel_index = blockIdx.x * blockDim.x + threadIdx.x;
+  if (pixel_index < num_pixels) {
+    const float depth = depth_image[pixel_index];
+    const int class_index = label_to_class[label_image[pixel_index]];
+    unmasked_depth_output[pixel_index] =
+        (class_index < 0) ? depth : unmasked_invalid_depth;
+    if (class_index >= 0 && depth > 0.0f) {
+      const int row = pixel_index / num_cols;
+      const int col = pixel_index % num_cols;
+      int* bounding_box = &block_class_bounding_boxes[4 * class_index];
+      atomicAdd(&block_class_pixel_counts[class_index], 1);
+      atomicMin(&bounding_box[0], row);
+      atomicMax(&bounding_box[1], row);
+      atomicMin(&bounding_box[2], col);
+      atomicMax(&bounding_box[3], col);
+    }
+  }
+
+  __syncthreads();
+  if (threadIdx.x < num_classes && block_class_pixel_counts[threadIdx.x] > 0) {
+    atomicAdd(&class_pixel_counts[threadIdx.x],
+              block_class_pixel_counts[threadIdx.x]);
+    const int* block_bounding_box =
+        &block_class_bounding_boxes[4 * threadIdx.x];
+    int* bounding_box = &class_bounding_boxes[4 * threadIdx.x];
+    atomicMin(&bounding_box[0], block_bounding_box[0]);
+    atomicMax(&bounding_box[1], block_bounding_box[1]);
+    atomicMin(&bounding_box[2], block_bounding_box[2]);
+    atomicMax(&bounding_box[3], block_bounding_box[3]);
+  }
+}
+
+// Calling rules:
+// - One thread per pixel of the largest bounding box in x, one written class
+//   per blockIdx.y.
+__global__ void writeSemanticClassesKernel(
+    const float* depth_image, const uint8_t* label_image, int num_cols,
+    const int* label_to_class, const int* written_class_indices,
+    const int* class_bounding_boxes, const float* class_invalid_depths,
+    float** class_depth_outputs) {
+  const int class_index = written_class_indices[blockIdx.y];
+  const int* bounding_box = &class_bounding_boxes[4 * class_index];
+  const int box_rows = bounding_box[1] - bounding_box[0] + 1;
+  const int box_cols = bounding_box[3] - bounding_box[2] + 1;
+  const int box_pixel_index = blockIdx.x * blockDim.x + threadIdx.x;
+  if (box_pixel_index >= box_rows * box_cols) {
+    return;
+  }
+  const int row = bounding_box[0] + box_pixel_index / box_cols;
+  const int col = bounding_box[2] + box_pixel_index % box_cols;
+  const int pixel_index = row * num_cols + col;
+  class_depth_outputs[blockIdx.y][box_pixel_index] =
+      (label_to_class[label_image[pixel_index]] == class_index)
+          ? depth_image[pixel_index]
+          : class_invalid_depths[class_index];
+}
+
+// Calling rules:
+// - One thread per pixel, 1D grid.
+__global__ void fillImageKernel(float value, int num_pixels, float* image) {
+  const int pixel_index = blockIdx.x * blockDim.x + threadIdx.x;
+  if (pixel_index < num_pixels) {
+    image[pixel_index] = value;
+  }
+}
+
+bool SemanticImageSplitter::splitImageOnGPU(
+    const DepthImage& depth_image, const MonoImage& label_image,
+    float unmasked_invalid_depth,
+    const std::vector<float>& class_invalid_depths,
+    DepthImage* unmasked_depth_output,
+    std::vector<DepthImage>* class_depth_outputs,
+    std::vector<int>* class_pixel_counts,
+    std::vector<PixelBoundingBox>* class_bounding_boxes) {
+  CHECK_NOTNULL(unmasked_depth_output);
+  CHECK_NOTNULL(class_depth_outputs);
+  CHECK_NOTNULL(class_pixel_counts);
+  CHECK_NOTNULL(class_bounding_boxes);
+  CHECK_EQ(static_cast<int>(class_invalid_depths.size()), num_classes_);
+  if (depth_image.rows() != label_image.rows() ||
+      depth_image.cols() != label_image.cols()) {
+    return false;
+  }
+  const int rows = depth_image.rows();
+  const int cols = depth_image.cols();
+
+  // Allocate the outputs (if needed).
+  auto allocate = [](int rows, int cols, DepthImage* image) {
+    if (image->rows() != rows || image->cols() != cols) {
+      *image = DepthImage(rows, cols, MemoryType::kDevice);
+    }
+  };
+  allocate(rows, cols, unmasked_depth_output);
+  class_depth_outputs->resize(num_classes_);
+
+  // Copy to device memory.
+  class_pixel_counts_device_ = std::vector<int>(num_classes_, 0);
+  std::vector<int> empty_bounding_boxes;
+  for (int i = 0; i < num_classes_; i++) {
+    empty_bounding_boxes.insert(empty_bounding_boxes.end(),
+                                {INT_MAX, -1, INT_MAX, -1});
+  }
+  class_bounding_boxes_device_ = empty_bounding_boxes;
+
+  // Count and bound the pixels of the classes.
+  constexpr int kThreadsPerBlock = 256;
+  static_assert(kThreadsPerBlock >= kMaxNumClasses,
+                "Need a thread per class for the reduction.");
+  const int num_pixels = rows * cols;
+  const int num_blocks = (num_pixels + kThreadsPerBlock - 1) / kThreadsPerBlock;
+  countSemanticImageKernel<<<num_blocks, kThreadsPerBlock, 0, cuda_stream_>>>(
+      depth_image.dataConstPtr(), label_image.dataConstPtr(), num_pixels,
+      cols, label_to_class_device_.data(), num_classes_,
+      unmasked_invalid_depth, unmasked_depth_output->dataPtr(),
+      class_pixel_counts_device_.data(), class_bounding_boxes_device_.data());
+  checkCudaErrors(cudaStreamSynchronize(cuda_stream_));
+  checkCudaErrors(cudaPeekAtLastError());
+
+  *class_pixel_counts = class_pixel_counts_device_.toVector();
+  const std::vector<int> bounding_boxes =
+      class_bounding_boxes_device_.toVector();
+  class_bounding_boxes->resize(num_classes_);
+  for (int i = 0; i < num_classes_; i++) {
+    PixelBoundingBox& bounding_box = (*class_bounding_boxes)[i];
+    bounding_box.row_min = bounding_boxes[4 * i + 0];
+    bounding_box.row_max = bounding_boxes[4 * i + 1];
+    bounding_box.col_min = bounding_boxes[4 * i + 2];
+    bounding_box.col_max = bounding_boxes[4 * i + 3];
+  }
+
+  // Write the classes which are in the image, within their bounding boxes.
+  std::vector<int> written_class_indices;
+  std::vector<float*> class_depth_output_ptrs;
+  int max_box_num_pixels = 0;
+  for (int i = 0; i < num_classes_; i++) {
+    if ((*class_pixel_counts)[i] == 0) {
+      continue;
+    }
+    const PixelBoundingBox& bounding_box = (*class_bounding_boxes)[i];
+    DepthImage* class_depth_output = &(*class_depth_outputs)[i];
+    allocate(bounding_box.rows(), bounding_box.cols(), class_depth_output);
+    written_class_indices.push_back(i);
+    class_depth_output_ptrs.push_back(class_depth_output->dataPtr());
+    max_box_num_pixels = std::max(max_box_num_pixels,
+                                  bounding_box.rows() * bounding_box.cols());
+  }
+  if (written_class_indices.empty()) {
+    return true;
+  }
+  written_class_indices_device_ = written_class_indices;
+  class_depth_outputs_device_ = class_depth_output_ptrs;
+  class_invalid_depths_device_ = class_invalid_depths;
+  const dim3 write_num_blocks(
+      (max_box_num_pixels + kThreadsPerBlock - 1) / kThreadsPerBlock,
+      written_class_indices.size());
+  writeSemanticClassesKernel<<<write_num_blocks, kThreadsPerBlock, 0,
+                               cuda_stream_>>>(
+      depth_image.dataConstPtr(), label_image.dataConstPtr(), cols,
+      label_to_class_device_.data(), written_class_indices_device_.data(),
+      class_bounding_boxes_device_.data(), class_invalid_depths_device_.data(),
+      class_depth_outputs_device_.data());
+  checkCudaErrors(cudaStreamSynchronize(cuda_stream_));
+  checkCudaErrors(cudaPeekAtLastError());
+  return true;
+}
+
+void SemanticImageSplitter::fillImageOnGPU(int rows, int cols,
+                                           float invalid_depth,
+                                           DepthImage* image) {
+  CHECK_NOTNULL(image);
+  if (image->rows() != rows || image->cols() != cols) {
+    *image = DepthImage(rows, cols, MemoryType::kDevice);
+  }
+  constexpr int kThreadsPerBlock = 256;
+  const int num_pixels = rows * cols;
+  const int num_blocks = (num_pixels + kThreadsPerBlock - 1) / kThreadsPerBlock;
+  fillImageKernel<<<num_blocks, kThreadsPerBlock, 0, cuda_stream_>>>(
+      invalid_depth, num_pixels, image->dataPtr());
+  checkCudaErrors(cudaStreamSynchronize(cuda_stream_));
+  checkCudaErrors(cudaPeekAtLastError());
+}
+
+Camera SemanticImageSplitter::cropCamera(const Camera& camera,
+                                         const PixelBoundingBox& bounding_box) {
+  return Camera(camera.fu(), camera.fv(), camera.cu() - bounding_box.col_min,
+                camera.cv() - bounding_box.row_min, bounding_box.cols(),
+                bounding_box.rows());
+}
+
+}  // namespace nvblox
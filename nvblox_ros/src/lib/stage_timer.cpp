@@ -0,0 +1,48 @@
+// SPDX-FileCopyrightText: NVIDIA CORPORATION & AFFILIATES
+// Copyright (c) 2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <chrono>
+
+#include "nvblox_ros/stage_timer.hpp"
+
+namespace nvblox {
+
+StageTimer::StageTimer(const std::string& tag, LatencyStatistics* statistics)
+    : timer_(tag),
+      statistics_(CHECK_NOTNULL(statistics)),
+      tag_(tag),
+      start_(TraceRecorder::Clock::now()),
+      is_traced_(TraceRecorder::instance().isEnabled()) {}
+
+StageTimer::~StageTimer() { Stop(); }
+
+void StageTimer::Stop() {
+  if (!is_running_) {
+    return;
+  }
+  timer_.Stop();
+  const TraceRecorder::Clock::time_point end = TraceRecorder::Clock::now();
+  const std::chrono::duration<double> latency = end - start_;
+  statistics_->add(tag_, latency.count());
+  if (is_traced_) {
+    TraceRecorder::instance().recordStage(tag_, start_, end,
+                                          TraceRecorder::currentFrameStamp());
+  }
+  is_running_ = false;
+}
+
+}  // namespace nvblox
@@ -0,0 +1,289 @@
+// SPDX-FileCopyrightText: NVIDIA CORPORATION & AFFILIATES
+// Copyright (c) 2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <diagnostic_msgs/DiagnosticStatus.h>
+#include <nvblox/utils/timing.h>
+#include <ros/console.h>
+
+#include "nvblox_ros/timing_metrics.hpp"
+
+namespace nvblox {
+
+namespace {
+
+void addValue(const std::string& key, const std::string& value,
+              diagnostic_msgs::DiagnosticStatus* status) {
+  diagnostic_msgs::KeyValue key_value;
+  key_value.key = key;
+  key_value.value = value;
+  status->values.push_back(key_value);
+}
+
+void addMilliseconds(const std::string& key, double seconds,
+                     diagnostic_msgs::DiagnosticStatus* status) {
+  addValue(key + " [ms]", std::to_string(seconds * 1000.0), status);
+}
+
+// Escapes a Prometheus label value.
+std::string escapeLabel(const std::string& value) {
+  std::string escaped;
+  for (const char c : value) {
+    if (c == '\\' || c == '"') {
+      escaped += '\\';
+      escaped += c;
+    } else if (c == '\n') {
+      escaped += "\\n";
+    } else {
+      escaped += c;
+    }
+  }
+  return escaped;
+}
+
+void writeHeader(const std::string& metric, const std::string& type,
+                 const std::string& help, std::ostream& out) {
+  out << "# HELP " << metric << " " << help << "\n";
+  out << "# TYPE " << metric << " " << type << "\n";
+}
+
+void writeSample(const std::string& metric, const std::string& labels,
+                 double value, std::ostream& out) {
+  out << metric << "{" << labels << "} " << value << "\n";
+}
+
+}  // namespace
+
+std::vector<TimerMetrics> collectTimerMetrics(
+    const LatencyStatistics& stage_statistics) {
+  std::vector<TimerMetrics> metrics;
+  // The timer handles are consecutive, unknown handles have no tag.
+  for (size_t handle = 0;; handle++) {
+    const std::string tag = timing::Timing::GetTag(handle);
+    if (tag.empty()) {
+      break;
+    }
+    TimerMetrics timer;
+    timer.name = tag;
+    timer.count = timing::Timing::GetNumSamples(handle);
+    timer.total_s = timing::Timing::GetTotalSeconds(handle);
+    timer.mean_s = timing::Timing::GetMeanSeconds(handle);
+    timer.min_s = timing::Timing::GetMinSeconds(handle);
+    timer.max_s = timing::Timing::GetMaxSeconds(handle);
+    timer.rate_hz = timing::Timing::GetHz(handle);
+    const LatencyStatistics::Summary summary = stage_statistics.summary(tag);
+    if (summary.count > 0) {
+      timer.has_percentiles = true;
+      timer.p50_s = summary.p50_s;
+      timer.p95_s = summary.p95_s;
+      timer.p99_s = summary.p99_s;
+    }
+    metrics.push_back(timer);
+  }
+  // Stages which aren't timed.
+  const size_t num_timers = metrics.size();
+  for (const std::string& stage : stage_statistics.stages()) {
+    const auto timers_end = metrics.begin() + num_timers;
+    if (std::find_if(metrics.begin(), timers_end,
+                     [&stage](const TimerMetrics& timer) {
+                       return timer.name == stage;
+                     }) != timers_end) {
+      continue;
+    }
+    const LatencyStatistics::Summary summary = stage_statistics.summary(stage);
+    TimerMetrics timer;
+    timer.name = stage;
+    timer.count = summary.count;
+    timer.total_s = summary.total_s;
+    timer.mean_s = summary.mean_s;
+    timer.min_s = summary.min_s;
+    timer.max_s = summary.max_s;
+    timer.has_percentiles = true;
+    timer.p50_s = summary.p50_s;
+    timer.p95_s = summary.p95_s;
+    timer.p99_s = summary.p99_s;
+    metrics.push_back(timer);
+  }
+  std::sort(metrics.begin(), metrics.end(),
+            [](const TimerMetrics& lhs, const TimerMetrics& rhs) {
+              return lhs.name < rhs.name;
+            });
+  return metrics;
+}
+
+void diagnosticArrayFromTimerMetrics(
+    const std::vector<TimerMetrics>& metrics, const std::string& name_prefix,
+    const ros::Time& stamp, diagnostic_msgs::DiagnosticArray* diagnostics_msg) {
+  CHECK_NOTNULL(diagnostics_msg);
+  diagnostics_msg->header.stamp = stamp;
+  diagnostics_msg->status.clear();
+  diagnostics_msg->status.reserve(metrics.size());
+  for (const TimerMetrics& timer : metrics) {
+    diagnostic_msgs::DiagnosticStatus status;
+    status.level = diagnostic_msgs::DiagnosticStatus::OK;
+    status.name = name_prefix + "/" + timer.name;
+    std::ostringstream message;
+    message << "mean " << timer.mean_s * 1000.0 << " ms over " << timer.count
+            << " samples";
+    status.message = message.str();
+    addValue("count", std::to_string(timer.count), &status);
+    addValue("total [s]", std::to_string(timer.total_s), &status);
+    addMilliseconds("mean", timer.mean_s, &status);
+    addMilliseconds("min", timer.min_s, &status);
+    addMilliseconds("max", timer.max_s, &status);
+    addValue("rate [Hz]", std::to_string(timer.rate_hz), &status);
+    if (timer.has_percentiles) {
+      addMilliseconds("p50", timer.p50_s, &status);
+      addMilliseconds("p95", timer.p95_s, &status);
+      addMilliseconds("p99", timer.p99_s, &status);
+    }
+    diagnostics_msg->status.push_back(std::move(status));
+  }
+}
+
+void writePrometheusText(const std::vector<TimerMetrics>& metrics,
+                         std::ostream& out) {
+  std::ostringstream text;
+  text.precision(9);
+
+  writeHeader("nvblox_timer_latency_seconds", "summary",
+              "Latency of the nvblox timers. The quantiles are over the "
+              "recent samples.",
+              text);
+  for (const TimerMetrics& timer : metrics) {
+    const std::string labels = "timer=\"" + escapeLabel(timer.name) + "\"";
+    if (timer.has_percentiles) {
+      writeSample("nvblox_timer_latency_seconds", labels + ",quantile=\"0.5\"",
+                  timer.p50_s, text);
+      writeSample("nvblox_timer_latency_seconds", labels + ",quantile=\"0.95\"",
+                  timer.p95_s, text);
+      writeSample("nvblox_timer_latency_seconds", labels + ",quantile=\"0.99\"",
+                  timer.p99_s, text);
+    }
+    writeSample("nvblox_timer_latency_seconds_sum", labels, timer.total_s,
+                text);
+    writeSample("nvblox_timer_latency_seconds_count", labels, timer.count,
+                text);
+  }
+
+  struct Gauge {
+    std::string metric;
+    std::string help;
+    double TimerMetrics::*value;
+  };
+  const std::vector<Gauge> gauges = {
+      {"nvblox_timer_mean_seconds", "Mean latency of the nvblox timers.",
+       &TimerMetrics::mean_s},
+      {"nvblox_timer_min_seconds", "Minimum latency of the nvblox timers.",
+       &TimerMetrics::min_s},
+      {"nvblox_timer_max_seconds", "Maximum latency of the nvblox timers.",
+       &TimerMetrics::max_s},
+      {"nvblox_timer_rate_hz", "Rate of the nvblox timers.",
+       &TimerMetrics::rate_hz}};
+  for (const Gauge& gauge : gauges) {
+    writeHeader(gauge.metric, "gauge", gauge.help, text);
+    for (const TimerMetrics& timer : metrics) {
+      writeSample(gauge.metric, "timer=\"" + escapeLabel(timer.name) + "\"",
+                  timer.*gauge.value, text);
+    }
+  }
+  out << text.str();
+}
+
+TimingMetricsExporter::TimingMetricsExporter(const ros::Publisher& publisher,
+                                             const std::string& name_prefix,
+                                             const std::string& prometheus_file)
+    : publisher_(publisher),
+      name_prefix_(name_prefix),
+      prometheus_file_(prometheus_file) {
+  export_thread_ = std::thread(&TimingMetricsExporter::exportLoop, this);
+}
+
+TimingMetricsExporter::~TimingMetricsExporter() {
+  {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  condition_.notify_one();
+  export_thread_.join();
+}
+
+void TimingMetricsExporter::push(std::vector<TimerMetrics>&& metrics,
+                                 const ros::Time& stamp) {
+  {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    pending_metrics_ = std::move(metrics);
+    pending_stamp_ = stamp;
+    has_pending_metrics_ = true;
+  }
+  condition_.notify_one();
+}
+
+void TimingMetricsExporter::exportLoop() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    condition_.wait(lock, [this]() { return stop_ || has_pending_metrics_; });
+    if (stop_) {
+      return;
+    }
+    const std::vector<TimerMetrics> metrics = std::move(pending_metrics_);
+    const ros::Time stamp = pending_stamp_;
+    has_pending_metrics_ = false;
+    lock.unlock();
+
+    if (publisher_.getNumSubscribers() > 0) {
+      diagnostic_msgs::DiagnosticArray diagnostics_msg;
+      diagnosticArrayFromTimerMetrics(metrics, name_prefix_, stamp,
+                                      &diagnostics_msg);
+      publisher_.publish(diagnostics_msg);
+    }
+    if (!prometheus_file_.empty()) {
+      writePrometheusFile(metrics);
+    }
+
+    lock.lock();
+  }
+}
+
+void TimingMetricsExporter::writePrometheusFile(
+    const std::vector<TimerMetrics>& metrics) const {
+  // Write to a temporary file first, such that readers never see a partial
+  // file.
+  const std::string temporary_file = prometheus_file_ + ".tmp";
+  {
+    std::ofstream out(temporary_file, std::ios::trunc);
+    writePrometheusText(metrics, out);
+    if (!out) {
+      ROS_WARN_STREAM_THROTTLE(60, "Failed to write the timing metrics to "
+                                       << temporary_file);
+      return;
+    }
+  }
+  if (std::rename(temporary_file.c_str(), prometheus_file_.c_str()) != 0) {
+    ROS_WARN_STREAM_THROTTLE(60, "Failed to replace the timing metrics file "
+                                     << prometheus_file_);
+  }
+}
+
+}  // namespace nvblox
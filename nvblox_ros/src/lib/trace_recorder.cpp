@@ -0,0 +1,186 @@
+// SPDX-FileCopyrightText: NVIDIA CORPORATION & AFFILIATES
+// Copyright (c) 2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <iomanip>
+#include <string>
+
+#include <glog/logging.h>
+
+#include "nvblox_ros/trace_recorder.hpp"
+
+namespace nvblox {
+
+namespace {
+
+uint32_t currentThreadId() {
+  thread_local const uint32_t thread_id =
+      static_cast<uint32_t>(syscall(SYS_gettid));
+  return thread_id;
+}
+
+int64_t nanoseconds(const TraceRecorder::Clock::duration& duration) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(duration)
+      .count();
+}
+
+void writeJsonString(const std::string& value, std::ostream& out) {
+  out << '"';
+  for (const char c : value) {
+    if (c == '"' || c == '\\') {
+      out << '\\' << c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      out << ' ';
+    } else {
+      out << c;
+    }
+  }
+  out << '"';
+}
+
+}  // namespace
+
+TraceRecorder& TraceRecorder::instance() {
+  static TraceRecorder recorder;
+  return recorder;
+}
+
+void TraceRecorder::enable(size_t capacity) {
+  CHECK_GT(capacity, 0);
+  const std::lock_guard<std::mutex> lock(mutex_);
+  events_.clear();
+  events_.resize(capacity);
+  next_event_ = 0;
+  num_events_ = 0;
+  is_enabled_.store(true, std::memory_order_relaxed);
+}
+
+void TraceRecorder::disable() {
+  is_enabled_.store(false, std::memory_order_relaxed);
+}
+
+void TraceRecorder::recordStage(const std::string& name,
+                                const Clock::time_point& begin,
+                                const Clock::time_point& end,
+                                const ros::Time& frame_stamp) {
+  if (isEnabled()) {
+    record(name, 'X', begin, end, frame_stamp);
+  }
+}
+
+void TraceRecorder::recordInstant(const std::string& name,
+                                  const ros::Time& frame_stamp) {
+  if (isEnabled()) {
+    const Clock::time_point now = Clock::now();
+    record(name, 'i', now, now, frame_stamp);
+  }
+}
+
+void TraceRecorder::record(const std::string& name, char phase,
+                           const Clock::time_point& begin,
+                           const Clock::time_point& end,
+                           const ros::Time& frame_stamp) {
+  const uint32_t thread_id = currentThreadId();
+  const std::lock_guard<std::mutex> lock(mutex_);
+  if (events_.empty()) {
+    return;
+  }
+  // Reuses the memory of the overwritten event, such that recording doesn't
+  // allocate once the ring buffer went around.
+  Event& event = events_[next_event_];
+  event.name.assign(name);
+  event.phase = phase;
+  event.begin_ns = nanoseconds(begin.time_since_epoch());
+  event.duration_ns = nanoseconds(end - begin);
+  event.thread_id = thread_id;
+  event.frame_stamp = frame_stamp;
+  next_event_ = (next_event_ + 1) % events_.size();
+  num_events_ = std::min(num_events_ + 1, events_.size());
+}
+
+size_t TraceRecorder::writeChromeTrace(std::ostream& out) const {
+  // Copy the events out, such that recording isn't blocked while writing.
+  std::vector<Event> events;
+  {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    events.reserve(num_events_);
+    const size_t first_event =
+        (next_event_ + events_.size() - num_events_) % events_.size();
+    for (size_t i = 0; i < num_events_; i++) {
+      events.push_back(events_[(first_event + i) % events_.size()]);
+    }
+  }
+
+  const int pid = getpid();
+  out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  for (size_t i = 0; i < events.size(); i++) {
+    const Event& event = events[i];
+    out << (i == 0 ? "\n" : ",\n") << "{\"name\":";
+    writeJsonString(event.name, out);
+    out << ",\"cat\":\"nvblox\",\"ph\":\"" << event.phase << "\"";
+    // Microseconds, with nanosecond precision.
+    out << ",\"ts\":" << event.begin_ns / 1000 << "." << std::setw(3)
+        << std::setfill('0') << event.begin_ns % 1000 << std::setfill(' ');
+    if (event.phase == 'X') {
+      out << ",\"dur\":" << event.duration_ns / 1000 << "." << std::setw(3)
+          << std::setfill('0') << event.duration_ns % 1000
+          << std::setfill(' ');
+    } else {
+      // Instant events are scoped to their thread.
+      out << ",\"s\":\"t\"";
+    }
+    out << ",\"pid\":" << pid << ",\"tid\":" << event.thread_id;
+    if (!event.frame_stamp.isZero()) {
+      out << ",\"args\":{\"stamp\":\"" << event.frame_stamp << "\"}";
+    }
+    out << "}";
+  }
+  out << "\n]}\n";
+  return events.size();
+}
+
+size_t TraceRecorder::size() const {
+  const std::lock_guard<std::mutex> lock(mutex_);
+  return num_events_;
+}
+
+void TraceRecorder::clear() {
+  const std::lock_guard<std::mutex> lock(mutex_);
+  next_event_ = 0;
+  num_events_ = 0;
+}
+
+ros::Time& TraceRecorder::threadFrameStamp() {
+  thread_local ros::Time frame_stamp;
+  return frame_stamp;
+}
+
+ros::Time TraceRecorder::currentFrameStamp() { return threadFrameStamp(); }
+
+TraceFrame::TraceFrame(const ros::Time& frame_stamp)
+    : previous_frame_stamp_(TraceRecorder::threadFrameStamp()) {
+  TraceRecorder::threadFrameStamp() = frame_stamp;
+}
+
+TraceFrame::~TraceFrame() {
+  TraceRecorder::threadFrameStamp() = previous_frame_stamp_;
+}
+
+}  // namespace nvblox
@@ -170,15 +170,14 @@ bool Transformer::lookupSensorTransform(const std::string& sensor_frame,
   }
 }
 
-Transform Transformer::transformToEigen(
-    const geometry_msgs::Transform& msg) const {
+Transform Transformer::transformToEigen(const geometry_msgs::Transform& msg) {
   return Transform(Eigen::Translation3f(msg.translation.x, msg.translation.y,
                                         msg.translation.z) *
                    Eigen::Quaternionf(msg.rotation.w, msg.rotation.x,
                                       msg.rotation.y, msg.rotation.z));
 }
 
-Transform Transformer::poseToEigen(const geometry_msgs::Pose& msg) const {
+Transform Transformer::poseToEigen(const geometry_msgs::Pose& msg) {
   return Transform(
       Eigen::Translation3d(msg.position.x, msg.position.y, msg.position.z) *
       Eigen::Quaterniond(msg.orientation.w, msg.orientation.x,
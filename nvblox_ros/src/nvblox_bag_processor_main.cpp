@@ -0,0 +1,286 @@
+// SPDX-FileCopyrightText: NVIDIA CORPORATION & AFFILIATES
+// Copyright (c) 2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+// Builds a map from recorded bags as fast as possible, without a ROS master
+// and without dropping messages, then saves it. Usage:
+//   nvblox_bag_processor --depth_image_topic=/camera/depth/image
+//       --depth_camera_info_topic=/camera/depth/camera_info
+//       --map=map.nvblx a.bag [b.bag ...]
+// See printUsage() for all options.
+
+#include <glog/logging.h>
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <ros/time.h>
+
+#include <nvblox/core/internal/warmup_cuda.h>
+#include <nvblox/io/mesh_io.h>
+#include <nvblox/io/pointcloud_io.h>
+#include <nvblox/utils/timing.h>
+
+#include "nvblox_ros/bag_processor.hpp"
+#include "nvblox_ros/mapper_initialization.hpp"
+
+namespace {
+
+struct ProcessorOptions {
+  nvblox::BagProcessorOptions processor;
+  std::vector<std::string> bag_paths;
+  // Parameter file of the node, the flags override its settings.
+  std::string params;
+  // Outputs, not written if empty.
+  std::string map;
+  std::string mesh_ply;
+  std::string esdf_ply;
+  std::string timing_report;
+};
+
+void printUsage(const char* name) {
+  const nvblox::BagProcessorOptions defaults;
+  std::cerr
+      << "Usage: " << name << " [options] BAG [BAG ...]\n"
+      << "  --params=FILE                  Node parameter file (.yaml), sets\n"
+      << "                                 up the mapper like the node. The\n"
+      << "                                 other options override it.\n"
+      << "  --global_frame=FRAME           Map frame ("
+      << defaults.global_frame << ").\n"
+      << "  --depth_image_topic=TOPIC      Depth images to integrate.\n"
+      << "  --depth_camera_info_topic=TOPIC\n"
+      << "  --color_image_topic=TOPIC      Color images to integrate.\n"
+      << "  --color_camera_info_topic=TOPIC\n"
+      << "  --pointcloud_topic=TOPIC       LiDAR pointclouds to integrate.\n"
+      << "  --tf_topic=TOPIC               (" << defaults.tf_topic << ").\n"
+      << "  --tf_static_topic=TOPIC        (" << defaults.tf_static_topic
+      << ").\n"
+      << "  --esdf_update_rate_hz=X        In bag time ("
+      << defaults.esdf_update_rate_hz << ").\n"
+      << "  --mesh_update_rate_hz=X        In bag time ("
+      << defaults.mesh_update_rate_hz << ").\n"
+      << "  --voxel_size=X                 Voxel size in meters ("
+      << defaults.pipeline.voxel_size << ").\n"
+      << "  --use_static_occupancy_layer   Integrate into an occupancy layer\n"
+      << "                                 instead of a TSDF (no mesh).\n"
+      << "  --esdf_2d                      Compute a 2D ESDF.\n"
+      << "  --esdf_2d_min_height=X         ("
+      << defaults.pipeline.esdf_2d_min_height << ").\n"
+      << "  --esdf_2d_max_height=X         ("
+      << defaults.pipeline.esdf_2d_max_height << ").\n"
+      << "  --esdf_slice_height=X          ("
+      << defaults.pipeline.esdf_slice_height << ").\n"
+      << "  --lidar_width=N                ("
+      << defaults.pipeline.lidar_width << ").\n"
+      << "  --lidar_height=N               ("
+      << defaults.pipeline.lidar_height << ").\n"
+      << "  --lidar_vertical_fov_deg=X     ("
+      << defaults.pipeline.lidar_vertical_fov_deg << ").\n"
+      << "  --map=FILE                     Save the map (.nvblx).\n"
+      << "  --mesh_ply=FILE                Save the mesh (.ply).\n"
+      << "  --esdf_ply=FILE                Save the ESDF (.ply).\n"
+      << "  --timing_report=FILE           Write the timing report (JSON).\n";
+}
+
+// Takes the settings of the processor from a node parameter file.
+void applyParameters(const YAML::Node& parameters,
+                     nvblox::BagProcessorOptions* processor) {
+  nvblox::ReplayPipelineOptions& pipeline = processor->pipeline;
+  nvblox::getParam(parameters, "global_frame", &processor->global_frame);
+  bool use_static_occupancy_layer = false;
+  if (nvblox::getParam(parameters, "use_static_occupancy_layer",
+                       &use_static_occupancy_layer)) {
+    pipeline.projective_layer_type =
+        use_static_occupancy_layer ? nvblox::ProjectiveLayerType::kOccupancy
+                                   : nvblox::ProjectiveLayerType::kTsdf;
+  }
+  nvblox::getParam(parameters, "voxel_size", &pipeline.voxel_size);
+  nvblox::getParam(parameters, "esdf_2d", &pipeline.esdf_2d);
+  nvblox::getParam(parameters, "esdf_2d_min_height",
+                   &pipeline.esdf_2d_min_height);
+  nvblox::getParam(parameters, "esdf_2d_max_height",
+                   &pipeline.esdf_2d_max_height);
+  nvblox::getParam(parameters, "esdf_slice_height",
+                   &pipeline.esdf_slice_height);
+  nvblox::getParam(parameters, "lidar_width", &pipeline.lidar_width);
+  nvblox::getParam(parameters, "lidar_height", &pipeline.lidar_height);
+  nvblox::getParam(parameters, "lidar_vertical_fov_deg",
+                   &pipeline.lidar_vertical_fov_deg);
+  pipeline.mapper_parameters = parameters;
+}
+
+bool parseOptions(int argc, char* argv[], ProcessorOptions* options) {
+  nvblox::BagProcessorOptions& processor = options->processor;
+  // The parameter file first, such that the flags override it.
+  for (int i = 1; i < argc; i++) {
+    const std::string arg = argv[i];
+    if (arg.rfind("--params=", 0) == 0) {
+      options->params = arg.substr(std::string("--params=").size());
+      YAML::Node parameters;
+      if (!nvblox::loadParameterFile(options->params, &parameters)) {
+        return false;
+      }
+      applyParameters(parameters, &processor);
+    }
+  }
+  for (int i = 1; i < argc; i++) {
+    const std::string arg = argv[i];
+    if (arg.rfind("--", 0) != 0) {
+      options->bag_paths.push_back(arg);
+      continue;
+    }
+    const size_t equals = arg.find('=');
+    const std::string name = arg.substr(0, equals);
+    const std::string value =
+        equals == std::string::npos ? "" : arg.substr(equals + 1);
+    if (name == "--params") {
+      // Applied above.
+    } else if (name == "--global_frame") {
+      processor.global_frame = value;
+    } else if (name == "--depth_image_topic") {
+      processor.depth_image_topic = value;
+    } else if (name == "--depth_camera_info_topic") {
+      processor.depth_camera_info_topic = value;
+    } else if (name == "--color_image_topic") {
+      processor.color_image_topic = value;
+    } else if (name == "--color_camera_info_topic") {
+      processor.color_camera_info_topic = value;
+    } else if (name == "--pointcloud_topic") {
+      processor.pointcloud_topic = value;
+    } else if (name == "--tf_topic") {
+      processor.tf_topic = value;
+    } else if (name == "--tf_static_topic") {
+      processor.tf_static_topic = value;
+    } else if (name == "--esdf_update_rate_hz") {
+      processor.esdf_update_rate_hz = std::atof(value.c_str());
+    } else if (name == "--mesh_update_rate_hz") {
+      processor.mesh_update_rate_hz = std::atof(value.c_str());
+    } else if (name == "--voxel_size") {
+      processor.pipeline.voxel_size = std::atof(value.c_str());
+    } else if (name == "--use_static_occupancy_layer") {
+      processor.pipeline.projective_layer_type =
+          nvblox::ProjectiveLayerType::kOccupancy;
+    } else if (name == "--esdf_2d") {
+      processor.pipeline.esdf_2d = true;
+    } else if (name == "--esdf_2d_min_height") {
+      processor.pipeline.esdf_2d_min_height = std::atof(value.c_str());
+    } else if (name == "--esdf_2d_max_height") {
+      processor.pipeline.esdf_2d_max_height = std::atof(value.c_str());
+    } else if (name == "--esdf_slice_height") {
+      processor.pipeline.esdf_slice_height = std::atof(value.c_str());
+    } else if (name == "--lidar_width") {
+      processor.pipeline.lidar_width = std::atoi(value.c_str());
+    } else if (name == "--lidar_height") {
+      processor.pipeline.lidar_height = std::atoi(value.c_str());
+    } else if (name == "--lidar_vertical_fov_deg") {
+      processor.pipeline.lidar_vertical_fov_deg = std::atof(value.c_str());
+    } else if (name == "--map") {
+      options->map = value;
+    } else if (name == "--mesh_ply") {
+      options->mesh_ply = value;
+    } else if (name == "--esdf_ply") {
+      options->esdf_ply = value;
+    } else if (name == "--timing_report") {
+      options->timing_report = value;
+    } else {
+      std::cerr << "Unknown option: " << arg << "\n";
+      return false;
+    }
+  }
+  const bool has_depth = !processor.depth_image_topic.empty() &&
+                         !processor.depth_camera_info_topic.empty();
+  const bool has_lidar = !processor.pointcloud_topic.empty();
+  if (!has_depth && !has_lidar) {
+    std::cerr << "Either a depth image (and camera info) or a pointcloud "
+                 "topic is needed.\n";
+    return false;
+  }
+  if (!processor.color_image_topic.empty() &&
+      processor.color_camera_info_topic.empty()) {
+    std::cerr << "The color images need a camera info topic.\n";
+    return false;
+  }
+  if (!options->mesh_ply.empty() && processor.pipeline.projective_layer_type !=
+                                        nvblox::ProjectiveLayerType::kTsdf) {
+    std::cerr << "Occupancy maps have no mesh.\n";
+    return false;
+  }
+  return !options->bag_paths.empty() && processor.pipeline.voxel_size > 0.0f;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  google::InitGoogleLogging(argv[0]);
+  FLAGS_alsologtostderr = true;
+  google::InstallFailureSignalHandler();
+
+  ProcessorOptions options;
+  if (!parseOptions(argc, argv, &options)) {
+    printUsage(argv[0]);
+    return 1;
+  }
+
+  ros::Time::init();
+  nvblox::warmupCuda();
+
+  nvblox::BagProcessor processor(options.processor);
+  if (!processor.process(options.bag_paths)) {
+    return 1;
+  }
+  const nvblox::BagProcessor::Counts& counts = processor.counts();
+  LOG(INFO) << "Processed " << counts.depth_images << " depth images, "
+            << counts.color_images << " color images and "
+            << counts.pointclouds << " pointclouds ("
+            << processor.bag_duration_s() << " s of data) in "
+            << processor.processing_time_s() << " s. Skipped "
+            << counts.skipped_no_transform << " without transform and "
+            << counts.skipped_no_camera_info << " without camera info, "
+            << counts.failed << " failed.";
+
+  nvblox::Mapper& mapper = processor.pipeline().mapper();
+  bool success = true;
+  if (!options.map.empty() && !mapper.saveMap(options.map)) {
+    LOG(ERROR) << "Couldn't save the map to " << options.map << ".";
+    success = false;
+  }
+  if (!options.mesh_ply.empty() &&
+      !nvblox::io::outputMeshLayerToPly(mapper.mesh_layer(),
+                                        options.mesh_ply)) {
+    LOG(ERROR) << "Couldn't save the mesh to " << options.mesh_ply << ".";
+    success = false;
+  }
+  if (!options.esdf_ply.empty() &&
+      !nvblox::io::outputVoxelLayerToPly(mapper.esdf_layer(),
+                                         options.esdf_ply)) {
+    LOG(ERROR) << "Couldn't save the ESDF to " << options.esdf_ply << ".";
+    success = false;
+  }
+
+  std::cout << nvblox::timing::Timing::Print() << "\n";
+  if (!options.timing_report.empty()) {
+    std::ofstream file(options.timing_report);
+    if (!file) {
+      LOG(ERROR) << "Couldn't open " << options.timing_report << ".";
+      return 1;
+    }
+    processor.writeReport(file);
+  }
+  return success ? 0 : 1;
+}
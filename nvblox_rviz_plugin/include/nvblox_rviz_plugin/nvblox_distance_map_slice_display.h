@@ -0,0 +1,61 @@
+// SPDX-FileCopyrightText: NVIDIA CORPORATION & AFFILIATES
+// Copyright (c) 2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <memory>
+
+#include <rviz/message_filter_display.h>
+#include <rviz/properties/float_property.h>
+
+#include <nvblox_msgs/DistanceMapSlice.h>
+
+#include "nvblox_rviz_plugin/nvblox_distance_map_slice_visual.h"
+
+namespace nvblox_rviz_plugin {
+
+/// Displays the ESDF slices published by nvblox. Unlike the esdf_pointcloud
+/// output of the node, the slice is color mapped here, so the robot only
+/// sends the distances.
+class NvbloxDistanceMapSliceDisplay
+    : public rviz::MessageFilterDisplay<nvblox_msgs::DistanceMapSlice> {
+  Q_OBJECT
+ public:
+  NvbloxDistanceMapSliceDisplay();
+  virtual ~NvbloxDistanceMapSliceDisplay();
+
+ public Q_SLOTS:
+  virtual void updateColorOptions();
+
+ protected:
+  virtual void onInitialize();
+
+  virtual void reset();
+
+ private:
+  void processMessage(
+      const nvblox_msgs::DistanceMapSlice::ConstPtr& msg) override;
+
+  rviz::FloatProperty* min_distance_property_;
+  rviz::FloatProperty* max_distance_property_;
+  rviz::FloatProperty* alpha_property_;
+  rviz::FloatProperty* unknown_alpha_property_;
+
+  std::unique_ptr<NvbloxDistanceMapSliceVisual> visual_;
+};
+
+}  // namespace nvblox_rviz_plugin
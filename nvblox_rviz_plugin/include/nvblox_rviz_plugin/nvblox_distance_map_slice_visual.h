@@ -0,0 +1,80 @@
+// SPDX-FileCopyrightText: NVIDIA CORPORATION & AFFILIATES
+// Copyright (c) 2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <OGRE/OgreManualObject.h>
+#include <OGRE/OgreMaterial.h>
+#include <OGRE/OgreQuaternion.h>
+#include <OGRE/OgreSceneManager.h>
+#include <OGRE/OgreSceneNode.h>
+#include <OGRE/OgreTexture.h>
+#include <OGRE/OgreVector3.h>
+
+#include <nvblox_msgs/DistanceMapSlice.h>
+
+namespace nvblox_rviz_plugin {
+
+/// Visualizes a nvblox_msgs::DistanceMapSlice message as a color mapped
+/// texture on a plane at the height of the slice.
+class NvbloxDistanceMapSliceVisual {
+ public:
+  NvbloxDistanceMapSliceVisual(Ogre::SceneManager* scene_manager,
+                               Ogre::SceneNode* parent_node);
+  virtual ~NvbloxDistanceMapSliceVisual();
+
+  void setMessage(const nvblox_msgs::DistanceMapSlice::ConstPtr& msg);
+
+  /// Set the coordinate frame pose.
+  void setFramePosition(const Ogre::Vector3& position);
+  void setFrameOrientation(const Ogre::Quaternion& orientation);
+
+  /// Distances are mapped onto a rainbow between the min and max distance.
+  void setColorScale(float min_distance, float max_distance);
+  /// Alpha of the observed and the unknown cells.
+  void setAlpha(float alpha, float unknown_alpha);
+
+ private:
+  // Color maps the last message into the texture.
+  void updateTexture();
+  void updatePlane();
+
+  Ogre::SceneNode* frame_node_;
+  Ogre::SceneManager* scene_manager_;
+  Ogre::ManualObject* plane_;
+  Ogre::MaterialPtr material_;
+  Ogre::TexturePtr texture_;
+  std::string texture_name_;
+
+  unsigned int instance_number_;
+  static unsigned int instance_counter_;
+
+  float min_distance_ = 0.0f;
+  float max_distance_ = 2.0f;
+  float alpha_ = 1.0f;
+  float unknown_alpha_ = 0.0f;
+
+  nvblox_msgs::DistanceMapSlice::ConstPtr msg_;
+  // RGBA, one byte per channel.
+  std::vector<uint8_t> pixels_;
+};
+
+}  // namespace nvblox_rviz_plugin
@@ -0,0 +1,127 @@
+// SPDX-FileCopyrightText: NVIDIA CORPORATION & AFFILIATES
+// Copyright (c) 2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <OGRE/OgreSimpleRenderable.h>
+
+#include "nvblox_rviz_plugin/nvblox_hash_utils.h"
+
+namespace nvblox_rviz_plugin {
+
+/// A vertex of the mesh, as laid out in the hardware vertex buffers.
+struct MeshVertex {
+  float position[3];
+  float normal[3];
+  /// ABGR, i.e. red in the lowest byte.
+  Ogre::uint32 colour;
+};
+
+/// Draws the meshes of a group of blocks in a single batch. The blocks share
+/// a vertex and an index buffer in which each block owns a range. Changed
+/// blocks are rewritten in place if they fit in their range and appended
+/// otherwise. The buffers are only repacked, and grown if needed, once they're
+/// full or mostly made of stale ranges.
+/// Far away chunks can be drawn with a coarser mesh, which reuses the vertex
+/// buffer with a second, smaller index buffer.
+class NvbloxMeshChunk : public Ogre::SimpleRenderable {
+ public:
+  explicit NvbloxMeshChunk(const std::string& material_name);
+  ~NvbloxMeshChunk() override;
+
+  /// Sets the mesh of a block, replacing its previous mesh.
+  /// @param block_index The index of the block.
+  /// @param vertices The vertices of the block.
+  /// @param indices The triangles of the block, indexing its vertices.
+  void setBlock(const Index3D& block_index, std::vector<MeshVertex>&& vertices,
+                std::vector<uint32_t>&& indices);
+  void removeBlock(const Index3D& block_index);
+  bool empty() const { return blocks_.empty(); }
+
+  /// Writes the blocks changed since the last call to the hardware buffers.
+  void update();
+
+  /// Draws a coarser mesh when the chunk is far from the camera. The coarse
+  /// mesh merges the vertices in each cell of a grid. Takes effect on the
+  /// next update().
+  /// @param lod_distance Distance to the camera from which the coarse mesh is
+  /// drawn. Zero (or less) disables the coarse mesh.
+  /// @param lod_cell_size Side of the grid cells (in meters).
+  void setLevelOfDetail(float lod_distance, float lod_cell_size);
+
+  void getRenderOperation(Ogre::RenderOperation& op) override;
+  void _notifyCurrentCamera(Ogre::Camera* camera) override;
+  Ogre::Real getBoundingRadius() const override;
+  Ogre::Real getSquaredViewDepth(const Ogre::Camera* camera) const override;
+
+ private:
+  struct Block {
+    std::vector<MeshVertex> vertices;
+    std::vector<uint32_t> indices;
+    // The triangles of the coarse mesh, indexing the vertices of the block.
+    std::vector<uint32_t> lod_indices;
+    Ogre::AxisAlignedBox bounds;
+    // The ranges of the block in the buffers.
+    bool has_range = false;
+    size_t vertex_start = 0;
+    size_t vertex_capacity = 0;
+    size_t index_start = 0;
+    size_t index_capacity = 0;
+    bool is_changed = false;
+  };
+
+  void writeChangedBlocks();
+  // Writes the block to its range. The rest of its index range is filled with
+  // degenerate triangles.
+  void writeBlock(const Block& block);
+  void clearIndexRange(size_t index_start, size_t num_indices);
+  // Writes all blocks to contiguous ranges, growing the buffers if needed.
+  void repack();
+  void createBuffers(size_t vertex_capacity, size_t index_capacity);
+  // Rewrites the coarse index buffer.
+  void writeLodIndices();
+  bool isLodEnabled() const { return lod_distance_ > 0.0f; }
+
+  Index3DHashMapType<Block>::type blocks_;
+  std::vector<Index3D> changed_blocks_;
+
+  // Buffer state, in number of elements.
+  size_t vertex_capacity_ = 0;
+  size_t index_capacity_ = 0;
+  size_t vertex_end_ = 0;
+  size_t index_end_ = 0;
+  // Number of vertices and indices of all blocks.
+  size_t num_vertices_ = 0;
+  size_t num_indices_ = 0;
+  // Set when blocks were added or removed since the last update().
+  bool is_changed_ = false;
+
+  // The coarse mesh.
+  Ogre::IndexData* lod_index_data_;
+  size_t lod_index_capacity_ = 0;
+  float lod_distance_ = 0.0f;
+  float lod_cell_size_ = 0.0f;
+  bool lod_changed_ = false;
+  // Whether the coarse mesh is drawn for the current camera.
+  bool draw_lod_ = false;
+};
+
+}  // namespace nvblox_rviz_plugin
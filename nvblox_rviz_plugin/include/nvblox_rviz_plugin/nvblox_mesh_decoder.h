@@ -0,0 +1,85 @@
+// SPDX-FileCopyrightText: NVIDIA CORPORATION & AFFILIATES
+// Copyright (c) 2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <nvblox_msgs/Mesh.h>
+
+#include "nvblox_rviz_plugin/nvblox_hash_utils.h"
+#include "nvblox_rviz_plugin/nvblox_mesh_chunk.h"
+
+namespace nvblox_rviz_plugin {
+
+/// A mesh block in the vertex layout of the chunks.
+struct DecodedMeshBlock {
+  Index3D block_index;
+  /// Empty for deleted blocks.
+  std::vector<MeshVertex> vertices;
+  std::vector<uint32_t> indices;
+};
+
+/// A mesh message in the vertex layout of the chunks.
+struct DecodedMesh {
+  std_msgs::Header header;
+  float block_size = 0.0f;
+  bool clear = false;
+  std::vector<DecodedMeshBlock> blocks;
+};
+
+/// Decodes mesh messages on a worker thread, such that the render thread only
+/// has to upload the vertices. Meshes come out in the order of the messages.
+class NvbloxMeshDecoder {
+ public:
+  NvbloxMeshDecoder();
+  ~NvbloxMeshDecoder();
+
+  NvbloxMeshDecoder(const NvbloxMeshDecoder&) = delete;
+  NvbloxMeshDecoder& operator=(const NvbloxMeshDecoder&) = delete;
+
+  /// Queues a message for decoding.
+  void push(const nvblox_msgs::Mesh::ConstPtr& msg);
+
+  /// Takes the meshes decoded so far.
+  std::vector<DecodedMesh> takeDecoded();
+
+  /// Drops the queued messages and the decoded meshes.
+  void clear();
+
+  static DecodedMesh decode(const nvblox_msgs::Mesh& msg);
+
+ private:
+  void decodeLoop();
+
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  std::deque<nvblox_msgs::Mesh::ConstPtr> pending_;
+  std::vector<DecodedMesh> decoded_;
+  // Incremented by clear(), such that a message being decoded while clearing
+  // is dropped.
+  uint64_t generation_ = 0;
+  bool stop_ = false;
+  std::thread thread_;
+};
+
+}  // namespace nvblox_rviz_plugin
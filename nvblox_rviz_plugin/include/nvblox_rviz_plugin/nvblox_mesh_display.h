@@ -26,6 +26,7 @@
 
 #include <nvblox_msgs/Mesh.h>
 
+#include "nvblox_rviz_plugin/nvblox_mesh_decoder.h"
 #include "nvblox_rviz_plugin/nvblox_mesh_visual.h"
 
 namespace nvblox_rviz_plugin {
@@ -40,22 +41,31 @@ class NvbloxMeshDisplay : public rviz::MessageFilterDisplay<nvblox_msgs::Mesh> {
 
  public Q_SLOTS:
   virtual void updateCeilingOptions();
- public Q_SLOTS:
   virtual void updateMeshColorOptions();
+ public Q_SLOTS:
+  virtual void updateDistanceOptions();
 
  protected:
   virtual void onInitialize();
 
   virtual void reset();
 
+  /// Uploads the meshes decoded since the last frame.
+  void update(float wall_dt, float ros_dt) override;
+
  private:
  void processMessage(const nvblox_msgs::Mesh::ConstPtr& msg) override;
 
   rviz::BoolProperty* cut_ceiling_property_;
   rviz::FloatProperty* ceiling_height_property_;
   rviz::EnumProperty* mesh_color_property_;
+  rviz::FloatProperty* rendering_distance_property_;
+  rviz::FloatProperty* lod_distance_property_;
 
   std::unique_ptr<NvbloxMeshVisual> visual_;
+
+  // Decodes the messages off the render thread.
+  NvbloxMeshDecoder decoder_;
 };
 
 }  // namespace nvblox_rviz_plugin
@@ -0,0 +1,41 @@
+// SPDX-FileCopyrightText: NVIDIA CORPORATION & AFFILIATES
+// Copyright (c) 2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <string>
+
+#include <OGRE/OgreMaterial.h>
+
+namespace nvblox_rviz_plugin {
+
+/// Creates a material which shades the mesh on the GPU. The coloring is
+/// selected by a shader uniform, see setMeshMaterialColorMode().
+/// @param name Name of the material, has to be unique.
+Ogre::MaterialPtr createMeshMaterial(const std::string& name);
+
+/// Sets how the mesh is colored: 0 uses the vertex colors, 1 shades them with
+/// two directional lights, and 2 colors the normals.
+void setMeshMaterialColorMode(const Ogre::MaterialPtr& material,
+                              int color_mode);
+
+/// Discards the fragments above the ceiling height (in the mesh frame) if
+/// cut_ceiling is set.
+void setMeshMaterialCeiling(const Ogre::MaterialPtr& material,
+                            bool cut_ceiling, float ceiling_height);
+
+}  // namespace nvblox_rviz_plugin
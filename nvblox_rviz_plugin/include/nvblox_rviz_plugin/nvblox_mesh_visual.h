@@ -17,21 +17,26 @@
 
 #pragma once
 
-#include <OGRE/OgreManualObject.h>
+#include <memory>
+
+#include <OGRE/OgreMaterial.h>
 #include <OGRE/OgreQuaternion.h>
 #include <OGRE/OgreSceneManager.h>
 #include <OGRE/OgreSceneNode.h>
 #include <OGRE/OgreVector3.h>
 
-#include <std_msgs/ColorRGBA.h>
-#include <geometry_msgs/Point32.h>
-#include <nvblox_msgs/Mesh.h>
-
 #include "nvblox_rviz_plugin/nvblox_hash_utils.h"
+#include "nvblox_rviz_plugin/nvblox_mesh_chunk.h"
+#include "nvblox_rviz_plugin/nvblox_mesh_decoder.h"
 
 namespace nvblox_rviz_plugin {
 
-/// Visualizes a single nvblox_msgs::Mesh message.
+/// Visualizes a single nvblox_msgs::Mesh message. The blocks are drawn in
+/// chunks, each covering a square of blocks in x and y and a single block in
+/// z. Ogre culls the chunks outside of the view frustum, and we additionally
+/// hide the chunks which are above the ceiling or too far from the camera. The
+/// mesh is shaded and cut at the ceiling on the GPU, so changing these
+/// settings doesn't touch the vertices.
 class NvbloxMeshVisual {
  public:
   enum MeshColor { kColor = 0, kLambertColor = 1, kNormals = 2 };
@@ -40,7 +45,8 @@ class NvbloxMeshVisual {
                    Ogre::SceneNode* parent_node);
   virtual ~NvbloxMeshVisual();
 
-  void setMessage(const nvblox_msgs::Mesh::ConstPtr& msg);
+  /// Uploads a decoded mesh message.
+  void setMessage(DecodedMesh&& mesh);
 
   /// Set the coordinate frame pose.
   void setFramePosition(const Ogre::Vector3& position);
@@ -49,18 +55,28 @@ class NvbloxMeshVisual {
   void setCeilingCutoff(bool cut_ceiling, float ceiling_height);
   void setMeshColor(MeshColor mesh_color);
 
+  /// Hides the chunks further than the distance from the camera. Zero means
+  /// no limit.
+  void setRenderingDistance(float rendering_distance);
+  /// Draws a coarser mesh for the chunks further than the distance from the
+  /// camera. Zero disables the coarse meshes.
+  void setLodDistance(float lod_distance);
+
  private:
-  // Color helpers.
-  Ogre::Vector3 lambertShading(const Ogre::Vector3& normal,
-                               const Ogre::Vector3& light,
-                               const Ogre::Vector3& color) const;
+  // Chunk helpers.
+  Index3D getChunkIndex(const Index3D& block_index) const;
+  bool isChunkVisible(const Index3D& chunk_index) const;
+  void setChunkLevelOfDetail(NvbloxMeshChunk* chunk) const;
+  void destroyChunks();
 
-  std_msgs::ColorRGBA getMeshColorFromColorAndNormal(
-      const std_msgs::ColorRGBA& color,
-      const geometry_msgs::Point32& normal) const;
+  // Side of a chunk in x and y (in blocks).
+  static constexpr int kChunkSizeBlocks = 16;
+  // Side of the grid cells of the coarse meshes (in blocks).
+  static constexpr float kLodCellSizeBlocks = 0.25f;
 
   Ogre::SceneNode* frame_node_;
   Ogre::SceneManager* scene_manager_;
+  Ogre::MaterialPtr material_;
 
   unsigned int instance_number_;
   static unsigned int instance_counter_;
@@ -68,10 +84,13 @@ class NvbloxMeshVisual {
   bool cut_ceiling_ = false;
   float ceiling_height_ = 0.0f;
   MeshColor mesh_color_ = MeshColor::kColor;
+  float rendering_distance_ = 0.0f;
+  float lod_distance_ = 0.0f;
 
   float block_size_ = 0.0f;
 
-  nvblox_rviz_plugin::Index3DHashMapType<Ogre::ManualObject*>::type object_map_;
+  nvblox_rviz_plugin::Index3DHashMapType<
+      std::unique_ptr<NvbloxMeshChunk>>::type chunk_map_;
 };
 
 }  // namespace nvblox_rviz_plugin
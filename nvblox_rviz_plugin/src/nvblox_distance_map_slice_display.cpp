@@ -0,0 +1,99 @@
+// SPDX-FileCopyrightText: NVIDIA CORPORATION & AFFILIATES
+// Copyright (c) 2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <rviz/frame_manager.h>
+#include <rviz/visualization_manager.h>
+
+#include "nvblox_rviz_plugin/nvblox_distance_map_slice_display.h"
+
+namespace nvblox_rviz_plugin {
+
+NvbloxDistanceMapSliceDisplay::NvbloxDistanceMapSliceDisplay() {
+  min_distance_property_ = new rviz::FloatProperty(
+      "Min Distance", 0.0,
+      "Distance mapped to the first color of the color scale.", this,
+      SLOT(updateColorOptions()));
+
+  max_distance_property_ = new rviz::FloatProperty(
+      "Max Distance", 2.0,
+      "Distance mapped to the last color of the color scale.", this,
+      SLOT(updateColorOptions()));
+
+  alpha_property_ = new rviz::FloatProperty(
+      "Alpha", 1.0, "Opacity of the observed cells.", this,
+      SLOT(updateColorOptions()));
+  alpha_property_->setMin(0.0);
+  alpha_property_->setMax(1.0);
+
+  unknown_alpha_property_ = new rviz::FloatProperty(
+      "Unknown Alpha", 0.0,
+      "Opacity of the unknown cells. 0 hides them.", this,
+      SLOT(updateColorOptions()));
+  unknown_alpha_property_->setMin(0.0);
+  unknown_alpha_property_->setMax(1.0);
+}
+
+void NvbloxDistanceMapSliceDisplay::updateColorOptions() {
+  if (visual_ != nullptr) {
+    visual_->setColorScale(min_distance_property_->getFloat(),
+                           max_distance_property_->getFloat());
+    visual_->setAlpha(alpha_property_->getFloat(),
+                      unknown_alpha_property_->getFloat());
+  }
+}
+
+void NvbloxDistanceMapSliceDisplay::onInitialize() {
+  MFDClass::onInitialize();
+}
+
+NvbloxDistanceMapSliceDisplay::~NvbloxDistanceMapSliceDisplay() {}
+
+void NvbloxDistanceMapSliceDisplay::reset() {
+  MFDClass::reset();
+  visual_.reset();
+}
+
+void NvbloxDistanceMapSliceDisplay::processMessage(
+    const nvblox_msgs::DistanceMapSlice::ConstPtr& msg) {
+  Ogre::Quaternion orientation;
+  Ogre::Vector3 position;
+  if (!context_->getFrameManager()->getTransform(
+          msg->header.frame_id, msg->header.stamp, position, orientation)) {
+    ROS_ERROR("Error transforming from frame '%s' to frame '%s'",
+              msg->header.frame_id.c_str(), qPrintable(fixed_frame_));
+    return;
+  }
+
+  if (visual_ == nullptr) {
+    visual_.reset(new NvbloxDistanceMapSliceVisual(context_->getSceneManager(),
+                                                   scene_node_));
+    visual_->setColorScale(min_distance_property_->getFloat(),
+                           max_distance_property_->getFloat());
+    visual_->setAlpha(alpha_property_->getFloat(),
+                      unknown_alpha_property_->getFloat());
+  }
+
+  visual_->setMessage(msg);
+  visual_->setFramePosition(position);
+  visual_->setFrameOrientation(orientation);
+}
+
+}  // namespace nvblox_rviz_plugin
+
+#include <pluginlib/class_list_macros.h>
+PLUGINLIB_EXPORT_CLASS(nvblox_rviz_plugin::NvbloxDistanceMapSliceDisplay,
+                       rviz::Display)
@@ -0,0 +1,212 @@
+// SPDX-FileCopyrightText: NVIDIA CORPORATION & AFFILIATES
+// Copyright (c) 2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+#include <OGRE/OgreMaterialManager.h>
+#include <OGRE/OgrePass.h>
+#include <OGRE/OgreTechnique.h>
+#include <OGRE/OgreTextureManager.h>
+
+#include <ros/console.h>
+
+#include "nvblox_rviz_plugin/nvblox_distance_map_slice_visual.h"
+
+namespace nvblox_rviz_plugin {
+
+namespace {
+
+// Cells within this distance of the unknown value are unknown (the slice is
+// made of floats).
+constexpr float kUnknownValueEps = 1e-2f;
+
+uint8_t toByte(float value) {
+  return static_cast<uint8_t>(std::min(std::max(value, 0.0f), 1.0f) * 255.0f +
+                              0.5f);
+}
+
+// Rainbow from red (0), i.e. close to obstacles, to magenta (1).
+void rainbowColor(float value, uint8_t* rgb) {
+  value = std::min(std::max(value, 0.0f), 1.0f);
+  const float h = (1.0f - value) * 5.0f + 1.0f;
+  const int i = static_cast<int>(std::floor(h));
+  float f = h - i;
+  if (!(i & 1)) {
+    f = 1.0f - f;
+  }
+  const float n = 1.0f - f;
+  float r, g, b;
+  if (i <= 1) {
+    r = n, g = 0.0f, b = 1.0f;
+  } else if (i == 2) {
+    r = 0.0f, g = n, b = 1.0f;
+  } else if (i == 3) {
+    r = 0.0f, g = 1.0f, b = n;
+  } else if (i == 4) {
+    r = n, g = 1.0f, b = 0.0f;
+  } else {
+    r = 1.0f, g = n, b = 0.0f;
+  }
+  rgb[0] = toByte(r);
+  rgb[1] = toByte(g);
+  rgb[2] = toByte(b);
+}
+
+}  // namespace
+
+unsigned int NvbloxDistanceMapSliceVisual::instance_counter_ = 0;
+
+NvbloxDistanceMapSliceVisual::NvbloxDistanceMapSliceVisual(
+    Ogre::SceneManager* scene_manager, Ogre::SceneNode* parent_node) {
+  scene_manager_ = scene_manager;
+  frame_node_ = parent_node->createChildSceneNode();
+  instance_number_ = instance_counter_++;
+  const std::string name = "nvblox_rviz_plugin/distance_map_slice_" +
+                           std::to_string(instance_number_);
+  texture_name_ = name + "/texture";
+
+  material_ = Ogre::MaterialManager::getSingleton().create(
+      name, Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME);
+  Ogre::Pass* pass = material_->getTechnique(0)->getPass(0);
+  pass->setLightingEnabled(false);
+  pass->setCullingMode(Ogre::CULL_NONE);
+  pass->setSceneBlending(Ogre::SBT_TRANSPARENT_ALPHA);
+  pass->setDepthWriteEnabled(false);
+  Ogre::TextureUnitState* texture_unit = pass->createTextureUnitState();
+  // Every cell is drawn as a square.
+  texture_unit->setTextureFiltering(Ogre::TFO_NONE);
+  texture_unit->setTextureAddressingMode(
+      Ogre::TextureUnitState::TAM_CLAMP);
+
+  plane_ = scene_manager_->createManualObject();
+  plane_->setDynamic(true);
+  frame_node_->attachObject(plane_);
+}
+
+NvbloxDistanceMapSliceVisual::~NvbloxDistanceMapSliceVisual() {
+  frame_node_->detachObject(plane_);
+  scene_manager_->destroyManualObject(plane_);
+  scene_manager_->destroySceneNode(frame_node_);
+  Ogre::MaterialManager::getSingleton().remove(material_->getName());
+  if (!texture_.isNull()) {
+    Ogre::TextureManager::getSingleton().remove(texture_name_);
+  }
+}
+
+void NvbloxDistanceMapSliceVisual::setMessage(
+    const nvblox_msgs::DistanceMapSlice::ConstPtr& msg) {
+  if (msg->data.size() !=
+      static_cast<size_t>(msg->width) * static_cast<size_t>(msg->height)) {
+    ROS_WARN_STREAM("Dropping distance map slice with "
+                    << msg->data.size() << " values for a " << msg->width
+                    << "x" << msg->height << " slice.");
+    return;
+  }
+  msg_ = msg;
+  updateTexture();
+  updatePlane();
+}
+
+void NvbloxDistanceMapSliceVisual::setFramePosition(
+    const Ogre::Vector3& position) {
+  frame_node_->setPosition(position);
+}
+
+void NvbloxDistanceMapSliceVisual::setFrameOrientation(
+    const Ogre::Quaternion& orientation) {
+  frame_node_->setOrientation(orientation);
+}
+
+void NvbloxDistanceMapSliceVisual::setColorScale(float min_distance,
+                                                 float max_distance) {
+  min_distance_ = min_distance;
+  max_distance_ = max_distance;
+  updateTexture();
+}
+
+void NvbloxDistanceMapSliceVisual::setAlpha(float alpha, float unknown_alpha) {
+  alpha_ = alpha;
+  unknown_alpha_ = unknown_alpha;
+  updateTexture();
+}
+
+void NvbloxDistanceMapSliceVisual::updateTexture() {
+  if (msg_ == nullptr || msg_->data.empty()) {
+    return;
+  }
+  const float range = std::max(max_distance_ - min_distance_, 1e-6f);
+  const uint8_t alpha = toByte(alpha_);
+  const uint8_t unknown_alpha = toByte(unknown_alpha_);
+  pixels_.resize(4 * msg_->data.size());
+  for (size_t i = 0; i < msg_->data.size(); i++) {
+    const float distance = msg_->data[i];
+    uint8_t* pixel = &pixels_[4 * i];
+    if (std::fabs(distance - msg_->unknown_value) < kUnknownValueEps) {
+      pixel[0] = pixel[1] = pixel[2] = 0;
+      pixel[3] = unknown_alpha;
+      continue;
+    }
+    rainbowColor((distance - min_distance_) / range, pixel);
+    pixel[3] = alpha;
+  }
+
+  // The slices grow with the map, in which case we need a new texture.
+  Ogre::TextureManager& texture_manager = Ogre::TextureManager::getSingleton();
+  if (texture_.isNull() || texture_->getWidth() != msg_->width ||
+      texture_->getHeight() != msg_->height) {
+    if (!texture_.isNull()) {
+      texture_manager.remove(texture_name_);
+    }
+    texture_ = texture_manager.createManual(
+        texture_name_, Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME,
+        Ogre::TEX_TYPE_2D, msg_->width, msg_->height, 0, Ogre::PF_BYTE_RGBA,
+        Ogre::TU_DYNAMIC_WRITE_ONLY_DISCARDABLE);
+    material_->getTechnique(0)->getPass(0)->getTextureUnitState(0)
+        ->setTextureName(texture_name_);
+  }
+  texture_->getBuffer()->blitFromMemory(Ogre::PixelBox(
+      msg_->width, msg_->height, 1, Ogre::PF_BYTE_RGBA, pixels_.data()));
+}
+
+void NvbloxDistanceMapSliceVisual::updatePlane() {
+  plane_->clear();
+  if (msg_->data.empty()) {
+    return;
+  }
+  // The origin is the corner of the first cell, the rows of the slice go
+  // along y.
+  const float x_min = msg_->origin.x;
+  const float y_min = msg_->origin.y;
+  const float x_max = x_min + msg_->width * msg_->resolution;
+  const float y_max = y_min + msg_->height * msg_->resolution;
+  const float z = msg_->origin.z;
+  plane_->begin(material_->getName(), Ogre::RenderOperation::OT_TRIANGLE_LIST);
+  plane_->position(x_min, y_min, z);
+  plane_->textureCoord(0.0f, 0.0f);
+  plane_->position(x_max, y_min, z);
+  plane_->textureCoord(1.0f, 0.0f);
+  plane_->position(x_max, y_max, z);
+  plane_->textureCoord(1.0f, 1.0f);
+  plane_->position(x_min, y_max, z);
+  plane_->textureCoord(0.0f, 1.0f);
+  plane_->quad(0, 1, 2, 3);
+  plane_->end();
+}
+
+}  // namespace nvblox_rviz_plugin
@@ -0,0 +1,342 @@
+// SPDX-FileCopyrightText: NVIDIA CORPORATION & AFFILIATES
+// Copyright (c) 2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <utility>
+
+#include <OGRE/OgreCamera.h>
+#include <OGRE/OgreHardwareBufferManager.h>
+
+#include "nvblox_rviz_plugin/nvblox_mesh_chunk.h"
+
+namespace nvblox_rviz_plugin {
+
+namespace {
+
+// Smallest buffers we allocate, and the factor by which we grow them, such
+// that a growing chunk isn't reallocated on every update.
+constexpr size_t kMinBufferCapacity = 1024;
+constexpr float kBufferGrowthFactor = 1.5f;
+
+// Merges the vertices in each cell of the grid into the first of them, and
+// returns the triangles that don't collapse.
+std::vector<uint32_t> clusterVertices(const std::vector<MeshVertex>& vertices,
+                                      const std::vector<uint32_t>& indices,
+                                      float cell_size) {
+  Index3DHashMapType<uint32_t>::type cell_to_vertex;
+  std::vector<uint32_t> vertex_to_cluster(vertices.size());
+  for (size_t i = 0; i < vertices.size(); i++) {
+    Index3D cell;
+    cell.x = static_cast<int>(std::floor(vertices[i].position[0] / cell_size));
+    cell.y = static_cast<int>(std::floor(vertices[i].position[1] / cell_size));
+    cell.z = static_cast<int>(std::floor(vertices[i].position[2] / cell_size));
+    vertex_to_cluster[i] =
+        cell_to_vertex.emplace(cell, static_cast<uint32_t>(i)).first->second;
+  }
+  std::vector<uint32_t> lod_indices;
+  for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+    const uint32_t a = vertex_to_cluster[indices[i]];
+    const uint32_t b = vertex_to_cluster[indices[i + 1]];
+    const uint32_t c = vertex_to_cluster[indices[i + 2]];
+    if (a == b || b == c || c == a) {
+      continue;
+    }
+    lod_indices.push_back(a);
+    lod_indices.push_back(b);
+    lod_indices.push_back(c);
+  }
+  return lod_indices;
+}
+
+}  // namespace
+
+NvbloxMeshChunk::NvbloxMeshChunk(const std::string& material_name) {
+  mRenderOp.operationType = Ogre::RenderOperation::OT_TRIANGLE_LIST;
+  mRenderOp.useIndexes = true;
+  mRenderOp.vertexData = new Ogre::VertexData();
+  mRenderOp.indexData = new Ogre::IndexData();
+  lod_index_data_ = new Ogre::IndexData();
+
+  Ogre::VertexDeclaration* declaration =
+      mRenderOp.vertexData->vertexDeclaration;
+  declaration->addElement(0, offsetof(MeshVertex, position), Ogre::VET_FLOAT3,
+                          Ogre::VES_POSITION);
+  declaration->addElement(0, offsetof(MeshVertex, normal), Ogre::VET_FLOAT3,
+                          Ogre::VES_NORMAL);
+  declaration->addElement(0, offsetof(MeshVertex, colour),
+                          Ogre::VET_COLOUR_ABGR, Ogre::VES_DIFFUSE);
+  setMaterial(material_name);
+}
+
+NvbloxMeshChunk::~NvbloxMeshChunk() {
+  delete mRenderOp.vertexData;
+  delete mRenderOp.indexData;
+  delete lod_index_data_;
+}
+
+void NvbloxMeshChunk::setBlock(const Index3D& block_index,
+                               std::vector<MeshVertex>&& vertices,
+                               std::vector<uint32_t>&& indices) {
+  Block& block = blocks_[block_index];
+  num_vertices_ = num_vertices_ - block.vertices.size() + vertices.size();
+  num_indices_ = num_indices_ - block.indices.size() + indices.size();
+  block.vertices = std::move(vertices);
+  block.indices = std::move(indices);
+  block.bounds.setNull();
+  for (const MeshVertex& vertex : block.vertices) {
+    block.bounds.merge(Ogre::Vector3(vertex.position[0], vertex.position[1],
+                                     vertex.position[2]));
+  }
+  if (isLodEnabled()) {
+    block.lod_indices =
+        clusterVertices(block.vertices, block.indices, lod_cell_size_);
+  }
+  is_changed_ = true;
+  if (!block.is_changed) {
+    block.is_changed = true;
+    changed_blocks_.push_back(block_index);
+  }
+}
+
+void NvbloxMeshChunk::removeBlock(const Index3D& block_index) {
+  const auto it = blocks_.find(block_index);
+  if (it == blocks_.end()) {
+    return;
+  }
+  const Block& block = it->second;
+  if (block.has_range) {
+    clearIndexRange(block.index_start, block.index_capacity);
+  }
+  num_vertices_ -= block.vertices.size();
+  num_indices_ -= block.indices.size();
+  blocks_.erase(it);
+  is_changed_ = true;
+}
+
+void NvbloxMeshChunk::setLevelOfDetail(float lod_distance,
+                                       float lod_cell_size) {
+  const bool needs_clustering =
+      lod_distance > 0.0f &&
+      (!isLodEnabled() || lod_cell_size != lod_cell_size_);
+  lod_distance_ = lod_distance;
+  lod_cell_size_ = lod_cell_size;
+  if (needs_clustering) {
+    for (auto& index_and_block : blocks_) {
+      Block& block = index_and_block.second;
+      block.lod_indices =
+          clusterVertices(block.vertices, block.indices, lod_cell_size_);
+    }
+    lod_changed_ = true;
+  }
+}
+
+void NvbloxMeshChunk::update() {
+  if (!is_changed_ && !lod_changed_) {
+    return;
+  }
+  if (is_changed_) {
+    writeChangedBlocks();
+    Ogre::AxisAlignedBox bounds;
+    for (const auto& index_and_block : blocks_) {
+      bounds.merge(index_and_block.second.bounds);
+    }
+    setBoundingBox(bounds);
+  }
+  // The coarse mesh indexes the vertex buffer, so we rewrite it whenever the
+  // blocks (may have) moved.
+  if (isLodEnabled()) {
+    writeLodIndices();
+  }
+  is_changed_ = false;
+  lod_changed_ = false;
+}
+
+void NvbloxMeshChunk::writeChangedBlocks() {
+  bool needs_repack = false;
+  for (const Index3D& block_index : changed_blocks_) {
+    const auto it = blocks_.find(block_index);
+    if (it == blocks_.end() || !it->second.is_changed) {
+      continue;
+    }
+    Block& block = it->second;
+    block.is_changed = false;
+    if (needs_repack) {
+      continue;
+    }
+    if (block.has_range && block.vertices.size() <= block.vertex_capacity &&
+        block.indices.size() <= block.index_capacity) {
+      writeBlock(block);
+      continue;
+    }
+    // The block grew: move it to the end of the buffers.
+    if (block.has_range) {
+      clearIndexRange(block.index_start, block.index_capacity);
+      block.has_range = false;
+    }
+    if (vertex_end_ + block.vertices.size() > vertex_capacity_ ||
+        index_end_ + block.indices.size() > index_capacity_) {
+      needs_repack = true;
+      continue;
+    }
+    block.has_range = true;
+    block.vertex_start = vertex_end_;
+    block.vertex_capacity = block.vertices.size();
+    block.index_start = index_end_;
+    block.index_capacity = block.indices.size();
+    vertex_end_ += block.vertex_capacity;
+    index_end_ += block.index_capacity;
+    writeBlock(block);
+  }
+  changed_blocks_.clear();
+
+  // Stale ranges still cost vertex processing, so we drop them once they
+  // make up most of the buffers.
+  if (needs_repack || index_end_ > 2 * num_indices_ + kMinBufferCapacity) {
+    repack();
+  }
+  mRenderOp.vertexData->vertexCount = vertex_end_;
+  mRenderOp.indexData->indexCount = index_end_;
+}
+
+void NvbloxMeshChunk::writeLodIndices() {
+  std::vector<uint32_t> indices;
+  for (const auto& index_and_block : blocks_) {
+    const Block& block = index_and_block.second;
+    for (uint32_t index : block.lod_indices) {
+      indices.push_back(index + block.vertex_start);
+    }
+  }
+  if (indices.size() > lod_index_capacity_) {
+    lod_index_capacity_ = std::max(
+        static_cast<size_t>(kBufferGrowthFactor * indices.size()),
+        kMinBufferCapacity);
+    lod_index_data_->indexBuffer =
+        Ogre::HardwareBufferManager::getSingleton().createIndexBuffer(
+            Ogre::HardwareIndexBuffer::IT_32BIT, lod_index_capacity_,
+            Ogre::HardwareBuffer::HBU_DYNAMIC_WRITE_ONLY);
+    lod_index_data_->indexStart = 0;
+  }
+  if (!indices.empty()) {
+    lod_index_data_->indexBuffer->writeData(
+        0, indices.size() * sizeof(uint32_t), indices.data(), true);
+  }
+  lod_index_data_->indexCount = indices.size();
+}
+
+void NvbloxMeshChunk::writeBlock(const Block& block) {
+  mRenderOp.vertexData->vertexBufferBinding->getBuffer(0)->writeData(
+      block.vertex_start * sizeof(MeshVertex),
+      block.vertices.size() * sizeof(MeshVertex), block.vertices.data());
+  // Indices 0 make degenerate triangles, which aren't drawn.
+  std::vector<uint32_t> indices(block.index_capacity, 0);
+  for (size_t i = 0; i < block.indices.size(); i++) {
+    indices[i] = block.indices[i] + block.vertex_start;
+  }
+  mRenderOp.indexData->indexBuffer->writeData(
+      block.index_start * sizeof(uint32_t), indices.size() * sizeof(uint32_t),
+      indices.data());
+}
+
+void NvbloxMeshChunk::clearIndexRange(size_t index_start,
+                                      size_t num_indices) {
+  const std::vector<uint32_t> indices(num_indices, 0);
+  mRenderOp.indexData->indexBuffer->writeData(
+      index_start * sizeof(uint32_t), indices.size() * sizeof(uint32_t),
+      indices.data());
+}
+
+void NvbloxMeshChunk::repack() {
+  if (num_vertices_ > vertex_capacity_ || num_indices_ > index_capacity_) {
+    createBuffers(
+        std::max(vertex_capacity_,
+                 static_cast<size_t>(kBufferGrowthFactor * num_vertices_)),
+        std::max(index_capacity_,
+                 static_cast<size_t>(kBufferGrowthFactor * num_indices_)));
+  }
+  std::vector<MeshVertex> vertices;
+  vertices.reserve(num_vertices_);
+  std::vector<uint32_t> indices;
+  indices.reserve(num_indices_);
+  for (auto& index_and_block : blocks_) {
+    Block& block = index_and_block.second;
+    block.has_range = true;
+    block.vertex_start = vertices.size();
+    block.vertex_capacity = block.vertices.size();
+    block.index_start = indices.size();
+    block.index_capacity = block.indices.size();
+    vertices.insert(vertices.end(), block.vertices.begin(),
+                    block.vertices.end());
+    for (uint32_t index : block.indices) {
+      indices.push_back(index + block.vertex_start);
+    }
+  }
+  vertex_end_ = vertices.size();
+  index_end_ = indices.size();
+  if (!vertices.empty()) {
+    mRenderOp.vertexData->vertexBufferBinding->getBuffer(0)->writeData(
+        0, vertices.size() * sizeof(MeshVertex), vertices.data(), true);
+  }
+  if (!indices.empty()) {
+    mRenderOp.indexData->indexBuffer->writeData(
+        0, indices.size() * sizeof(uint32_t), indices.data(), true);
+  }
+}
+
+void NvbloxMeshChunk::createBuffers(size_t vertex_capacity,
+                                    size_t index_capacity) {
+  vertex_capacity_ = std::max(vertex_capacity, kMinBufferCapacity);
+  index_capacity_ = std::max(index_capacity, kMinBufferCapacity);
+  Ogre::HardwareBufferManager& buffer_manager =
+      Ogre::HardwareBufferManager::getSingleton();
+  mRenderOp.vertexData->vertexBufferBinding->setBinding(
+      0, buffer_manager.createVertexBuffer(
+             sizeof(MeshVertex), vertex_capacity_,
+             Ogre::HardwareBuffer::HBU_DYNAMIC_WRITE_ONLY));
+  mRenderOp.vertexData->vertexStart = 0;
+  mRenderOp.indexData->indexBuffer = buffer_manager.createIndexBuffer(
+      Ogre::HardwareIndexBuffer::IT_32BIT, index_capacity_,
+      Ogre::HardwareBuffer::HBU_DYNAMIC_WRITE_ONLY);
+  mRenderOp.indexData->indexStart = 0;
+}
+
+void NvbloxMeshChunk::getRenderOperation(Ogre::RenderOperation& op) {
+  op = mRenderOp;
+  if (draw_lod_) {
+    op.indexData = lod_index_data_;
+  }
+}
+
+void NvbloxMeshChunk::_notifyCurrentCamera(Ogre::Camera* camera) {
+  Ogre::SimpleRenderable::_notifyCurrentCamera(camera);
+  draw_lod_ = isLodEnabled() && lod_index_data_->indexCount > 0 &&
+              getWorldBoundingBox(true).distance(
+                  camera->getDerivedPosition()) > lod_distance_;
+}
+
+Ogre::Real NvbloxMeshChunk::getBoundingRadius() const {
+  return Ogre::Math::Sqrt(std::max(mBox.getMaximum().squaredLength(),
+                                   mBox.getMinimum().squaredLength()));
+}
+
+Ogre::Real NvbloxMeshChunk::getSquaredViewDepth(
+    const Ogre::Camera* camera) const {
+  return (camera->getDerivedPosition() - mBox.getCenter()).squaredLength();
+}
+
+}  // namespace nvblox_rviz_plugin
@@ -0,0 +1,124 @@
+// SPDX-FileCopyrightText: NVIDIA CORPORATION & AFFILIATES
+// Copyright (c) 2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <algorithm>
+#include <utility>
+
+#include "nvblox_rviz_plugin/nvblox_mesh_decoder.h"
+
+namespace nvblox_rviz_plugin {
+
+namespace {
+
+// Packs a color in the byte order of VET_COLOUR_ABGR (red in the lowest byte).
+uint32_t packColor(const std_msgs::ColorRGBA& color) {
+  auto to_byte = [](float value) {
+    return static_cast<uint32_t>(
+        std::min(std::max(value, 0.0f), 1.0f) * 255.0f + 0.5f);
+  };
+  return to_byte(color.r) | (to_byte(color.g) << 8) |
+         (to_byte(color.b) << 16) | (255u << 24);
+}
+
+}  // namespace
+
+NvbloxMeshDecoder::NvbloxMeshDecoder()
+    : thread_(&NvbloxMeshDecoder::decodeLoop, this) {}
+
+NvbloxMeshDecoder::~NvbloxMeshDecoder() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  condition_.notify_all();
+  thread_.join();
+}
+
+void NvbloxMeshDecoder::push(const nvblox_msgs::Mesh::ConstPtr& msg) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_.push_back(msg);
+  }
+  condition_.notify_all();
+}
+
+std::vector<DecodedMesh> NvbloxMeshDecoder::takeDecoded() {
+  std::vector<DecodedMesh> decoded;
+  std::lock_guard<std::mutex> lock(mutex_);
+  decoded.swap(decoded_);
+  return decoded;
+}
+
+void NvbloxMeshDecoder::clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  pending_.clear();
+  decoded_.clear();
+  ++generation_;
+}
+
+void NvbloxMeshDecoder::decodeLoop() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    condition_.wait(lock, [this] { return stop_ || !pending_.empty(); });
+    if (stop_) {
+      return;
+    }
+    const nvblox_msgs::Mesh::ConstPtr msg = pending_.front();
+    pending_.pop_front();
+    const uint64_t generation = generation_;
+
+    lock.unlock();
+    DecodedMesh mesh = decode(*msg);
+    lock.lock();
+
+    if (generation == generation_) {
+      decoded_.push_back(std::move(mesh));
+    }
+  }
+}
+
+DecodedMesh NvbloxMeshDecoder::decode(const nvblox_msgs::Mesh& msg) {
+  DecodedMesh mesh;
+  mesh.header = msg.header;
+  mesh.block_size = msg.block_size;
+  mesh.clear = msg.clear;
+  mesh.blocks.resize(msg.block_indices.size());
+  for (size_t i = 0; i < msg.block_indices.size(); i++) {
+    const nvblox_msgs::MeshBlock& mesh_block = msg.blocks[i];
+    DecodedMeshBlock& block = mesh.blocks[i];
+    block.block_index = msg.block_indices[i];
+
+    block.vertices.resize(mesh_block.vertices.size());
+    for (size_t j = 0; j < mesh_block.vertices.size(); j++) {
+      MeshVertex& vertex = block.vertices[j];
+      vertex.position[0] = mesh_block.vertices[j].x;
+      vertex.position[1] = mesh_block.vertices[j].y;
+      vertex.position[2] = mesh_block.vertices[j].z;
+      vertex.normal[0] = mesh_block.normals[j].x;
+      vertex.normal[1] = mesh_block.normals[j].y;
+      vertex.normal[2] = mesh_block.normals[j].z;
+      vertex.colour = mesh_block.colors.empty()
+                          ? packColor(std_msgs::ColorRGBA())
+                          : packColor(mesh_block.colors[j]);
+    }
+    block.indices.assign(mesh_block.triangles.begin(),
+                         mesh_block.triangles.end());
+  }
+  return mesh;
+}
+
+}  // namespace nvblox_rviz_plugin
@@ -15,6 +15,8 @@
 //
 // SPDX-License-Identifier: Apache-2.0
 
+#include <utility>
+
 #include <rviz/frame_manager.h>
 #include <rviz/visualization_manager.h>
 
@@ -37,6 +39,20 @@ NvbloxMeshDisplay::NvbloxMeshDisplay() {
       "Mesh Color", "Color + Shading", "How to color the displayed mesh.", this,
       SLOT(updateMeshColorOptions()));
 
+  rendering_distance_property_ = new rviz::FloatProperty(
+      "Max Distance", 0.0,
+      "Parts of the mesh further than this from the camera are not drawn. "
+      "0 means no limit.",
+      this, SLOT(updateDistanceOptions()));
+  rendering_distance_property_->setMin(0.0);
+
+  lod_distance_property_ = new rviz::FloatProperty(
+      "Coarse Mesh Distance", 0.0,
+      "Parts of the mesh further than this from the camera are drawn with a "
+      "coarser mesh. 0 disables the coarse mesh.",
+      this, SLOT(updateDistanceOptions()));
+  lod_distance_property_->setMin(0.0);
+
   // Set up valid options.
   mesh_color_property_->addOption("Color", NvbloxMeshVisual::MeshColor::kColor);
   mesh_color_property_->addOption("Color + Shading",
@@ -59,40 +75,59 @@ void NvbloxMeshDisplay::updateMeshColorOptions() {
   }
 }
 
+void NvbloxMeshDisplay::updateDistanceOptions() {
+  if (visual_ != nullptr) {
+    visual_->setRenderingDistance(rendering_distance_property_->getFloat());
+    visual_->setLodDistance(lod_distance_property_->getFloat());
+  }
+}
+
 void NvbloxMeshDisplay::onInitialize() { MFDClass::onInitialize(); }
 
 NvbloxMeshDisplay::~NvbloxMeshDisplay() {}
 
 void NvbloxMeshDisplay::reset() {
   MFDClass::reset();
+  decoder_.clear();
   visual_.reset();
 }
 
 void NvbloxMeshDisplay::processMessage(const nvblox_msgs::Mesh::ConstPtr& msg) {
-  // Here we call the rviz::FrameManager to get the transform from the
-  // fixed frame to the frame in the header of this Imu message.  If
-  // it fails, we can't do anything else so we return.
-  Ogre::Quaternion orientation;
-  Ogre::Vector3 position;
-  if (!context_->getFrameManager()->getTransform(
-          msg->header.frame_id, msg->header.stamp, position, orientation)) {
-    ROS_ERROR("Error transforming from frame '%s' to frame '%s'",
-                 msg->header.frame_id.c_str(), qPrintable(fixed_frame_));
-    return;
-  }
+  // The message is decoded on the decoder's thread and uploaded in update().
+  decoder_.push(msg);
+}
 
-  if (visual_ == nullptr) {
-    visual_.reset(new NvbloxMeshVisual(context_->getSceneManager(), scene_node_));
-    visual_->setCeilingCutoff(cut_ceiling_property_->getBool(),
-                              ceiling_height_property_->getFloat());
-    visual_->setMeshColor(static_cast<NvbloxMeshVisual::MeshColor>(
-        mesh_color_property_->getOptionInt()));
+void NvbloxMeshDisplay::update(float wall_dt, float ros_dt) {
+  MFDClass::update(wall_dt, ros_dt);
+  for (DecodedMesh& mesh : decoder_.takeDecoded()) {
+    // Here we call the rviz::FrameManager to get the transform from the
+    // fixed frame to the frame in the header of this Imu message.  If
+    // it fails, we can't do anything else so we return.
+    Ogre::Quaternion orientation;
+    Ogre::Vector3 position;
+    if (!context_->getFrameManager()->getTransform(
+            mesh.header.frame_id, mesh.header.stamp, position, orientation)) {
+      ROS_ERROR("Error transforming from frame '%s' to frame '%s'",
+                   mesh.header.frame_id.c_str(), qPrintable(fixed_frame_));
+      continue;
+    }
+
+    if (visual_ == nullptr) {
+      visual_.reset(
+          new NvbloxMeshVisual(context_->getSceneManager(), scene_node_));
+      visual_->setCeilingCutoff(cut_ceiling_property_->getBool(),
+                                ceiling_height_property_->getFloat());
+      visual_->setMeshColor(static_cast<NvbloxMeshVisual::MeshColor>(
+          mesh_color_property_->getOptionInt()));
+      visual_->setRenderingDistance(rendering_distance_property_->getFloat());
+      visual_->setLodDistance(lod_distance_property_->getFloat());
+    }
+
+    // Now set or update the contents of the chosen visual.
+    visual_->setMessage(std::move(mesh));
+    visual_->setFramePosition(position);
+    visual_->setFrameOrientation(orientation);
   }
-
-  // Now set or update the contents of the chosen visual.
-  visual_->setMessage(msg);
-  visual_->setFramePosition(position);
-  visual_->setFrameOrientation(orientation);
 }
 
 }  // namespace nvblox_rviz_plugin
@@ -0,0 +1,131 @@
+// SPDX-FileCopyrightText: NVIDIA CORPORATION & AFFILIATES
+// Copyright (c) 2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <limits>
+
+#include <OGRE/OgreGpuProgramManager.h>
+#include <OGRE/OgreHighLevelGpuProgramManager.h>
+#include <OGRE/OgreMaterialManager.h>
+#include <OGRE/OgrePass.h>
+#include <OGRE/OgreTechnique.h>
+
+#include "nvblox_rviz_plugin/nvblox_mesh_material.h"
+
+namespace nvblox_rviz_plugin {
+
+namespace {
+
+constexpr char kVertexProgramName[] = "nvblox_rviz_plugin/mesh_vertex";
+constexpr char kFragmentProgramName[] = "nvblox_rviz_plugin/mesh_fragment";
+
+constexpr char kVertexProgramSource[] = R"(
+#version 120
+uniform mat4 worldviewproj_matrix;
+varying vec4 vertex_color;
+varying vec3 vertex_normal;
+varying float vertex_height;
+void main() {
+  gl_Position = worldviewproj_matrix * gl_Vertex;
+  vertex_color = gl_Color;
+  vertex_normal = gl_Normal;
+  vertex_height = gl_Vertex.z;
+}
+)";
+
+// The lights are made up, they are fixed in the mesh frame. The ceiling is a
+// clip plane at a height in the mesh frame.
+constexpr char kFragmentProgramSource[] = R"(
+#version 120
+uniform int color_mode;
+uniform float ceiling_height;
+varying vec4 vertex_color;
+varying vec3 vertex_normal;
+varying float vertex_height;
+void main() {
+  if (vertex_height > ceiling_height) {
+    discard;
+  }
+  vec3 normal = normalize(vertex_normal);
+  vec3 color = vertex_color.rgb;
+  if (color_mode == 1) {
+    vec3 light_dir = normalize(vec3(0.8, -0.2, 0.7));
+    vec3 light_dir2 = normalize(vec3(-0.5, 0.2, 0.2));
+    vec3 ambient = vec3(0.2, 0.2, 0.2);
+    color = max(dot(normal, light_dir), 0.0) * color +
+            max(dot(normal, light_dir2), 0.0) * color + ambient;
+    color = min(color, vec3(1.0));
+  } else if (color_mode == 2) {
+    color = normal * 0.5 + 0.5;
+  }
+  gl_FragColor = vec4(color, 1.0);
+}
+)";
+
+// The programs are shared by all materials.
+void createProgramIfMissing(const char* name, const char* source,
+                            Ogre::GpuProgramType type) {
+  Ogre::HighLevelGpuProgramManager& program_manager =
+      Ogre::HighLevelGpuProgramManager::getSingleton();
+  if (!program_manager.getByName(name).isNull()) {
+    return;
+  }
+  Ogre::HighLevelGpuProgramPtr program = program_manager.createProgram(
+      name, Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME, "glsl",
+      type);
+  program->setSource(source);
+  program->load();
+}
+
+}  // namespace
+
+Ogre::MaterialPtr createMeshMaterial(const std::string& name) {
+  createProgramIfMissing(kVertexProgramName, kVertexProgramSource,
+                         Ogre::GPT_VERTEX_PROGRAM);
+  createProgramIfMissing(kFragmentProgramName, kFragmentProgramSource,
+                         Ogre::GPT_FRAGMENT_PROGRAM);
+
+  Ogre::MaterialPtr material = Ogre::MaterialManager::getSingleton().create(
+      name, Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME);
+  Ogre::Pass* pass = material->getTechnique(0)->getPass(0);
+  pass->setLightingEnabled(false);
+  pass->setVertexProgram(kVertexProgramName);
+  pass->setFragmentProgram(kFragmentProgramName);
+  pass->getVertexProgramParameters()->setNamedAutoConstant(
+      "worldviewproj_matrix",
+      Ogre::GpuProgramParameters::ACT_WORLDVIEWPROJ_MATRIX);
+  pass->getFragmentProgramParameters()->setNamedConstant("color_mode", 0);
+  pass->getFragmentProgramParameters()->setNamedConstant(
+      "ceiling_height", std::numeric_limits<float>::max());
+  material->load();
+  return material;
+}
+
+void setMeshMaterialColorMode(const Ogre::MaterialPtr& material,
+                              int color_mode) {
+  material->getTechnique(0)->getPass(0)->getFragmentProgramParameters()
+      ->setNamedConstant("color_mode", color_mode);
+}
+
+void setMeshMaterialCeiling(const Ogre::MaterialPtr& material,
+                            bool cut_ceiling, float ceiling_height) {
+  material->getTechnique(0)->getPass(0)->getFragmentProgramParameters()
+      ->setNamedConstant("ceiling_height",
+                         cut_ceiling ? ceiling_height
+                                     : std::numeric_limits<float>::max());
+}
+
+}  // namespace nvblox_rviz_plugin
@@ -15,9 +15,14 @@
 //
 // SPDX-License-Identifier: Apache-2.0
 
-#include <iostream>
-#include <limits>
+#include <cmath>
+#include <string>
+#include <utility>
+#include <vector>
 
+#include <OGRE/OgreMaterialManager.h>
+
+#include "nvblox_rviz_plugin/nvblox_mesh_material.h"
 #include "nvblox_rviz_plugin/nvblox_mesh_visual.h"
 
 namespace nvblox_rviz_plugin {
@@ -30,159 +35,118 @@ NvbloxMeshVisual::NvbloxMeshVisual(Ogre::SceneManager* scene_manager,
   // Maybe not necessary anymore?
   frame_node_ = parent_node->createChildSceneNode();
   instance_number_ = instance_counter_++;
+  material_ = createMeshMaterial("nvblox_rviz_plugin/mesh_" +
+                                 std::to_string(instance_number_));
+  setMeshMaterialColorMode(material_, static_cast<int>(mesh_color_));
 }
 
 NvbloxMeshVisual::~NvbloxMeshVisual() {
-  // Destroy all the objects
-  for (const auto ogre_object : object_map_) {
-    scene_manager_->destroyManualObject(ogre_object.second);
-  }
+  destroyChunks();
+  Ogre::MaterialManager::getSingleton().remove(material_->getName());
 }
 
 void NvbloxMeshVisual::setCeilingCutoff(bool cut_ceiling,
                                         float ceiling_height) {
   cut_ceiling_ = cut_ceiling;
   ceiling_height_ = ceiling_height;
+  setMeshMaterialCeiling(material_, cut_ceiling_, ceiling_height_);
 
-  // Iterate over all the ogre objects, setting blocks visible and not again.
-  for (const auto kv : object_map_) {
-    if (cut_ceiling_) {
-      if (kv.first.z * block_size_ <= ceiling_height_) {
-        kv.second->setVisible(true);
-      } else {
-        kv.second->setVisible(false);
-      }
-    } else {
-      kv.second->setVisible(true);
-    }
+  // The material cuts the mesh, we only hide the chunks which are completely
+  // above the ceiling such that they aren't drawn at all.
+  for (const auto& kv : chunk_map_) {
+    kv.second->setVisible(isChunkVisible(kv.first));
+  }
+}
+
+Index3D NvbloxMeshVisual::getChunkIndex(const Index3D& block_index) const {
+  Index3D chunk_index;
+  chunk_index.x = static_cast<int>(
+      std::floor(static_cast<float>(block_index.x) / kChunkSizeBlocks));
+  chunk_index.y = static_cast<int>(
+      std::floor(static_cast<float>(block_index.y) / kChunkSizeBlocks));
+  chunk_index.z = block_index.z;
+  return chunk_index;
+}
+
+bool NvbloxMeshVisual::isChunkVisible(const Index3D& chunk_index) const {
+  return !cut_ceiling_ || chunk_index.z * block_size_ <= ceiling_height_;
+}
+
+void NvbloxMeshVisual::setChunkLevelOfDetail(NvbloxMeshChunk* chunk) const {
+  chunk->setLevelOfDetail(lod_distance_, kLodCellSizeBlocks * block_size_);
+}
+
+void NvbloxMeshVisual::destroyChunks() {
+  for (const auto& kv : chunk_map_) {
+    frame_node_->detachObject(kv.second.get());
   }
+  chunk_map_.clear();
 }
 
 void NvbloxMeshVisual::setMeshColor(NvbloxMeshVisual::MeshColor mesh_color) {
   mesh_color_ = mesh_color;
+  setMeshMaterialColorMode(material_, static_cast<int>(mesh_color_));
 }
 
-Ogre::Vector3 NvbloxMeshVisual::lambertShading(
-    const Ogre::Vector3& normal, const Ogre::Vector3& light,
-    const Ogre::Vector3& color) const {
-  return std::max<float>(normal.dotProduct(light), 0.0f) * color;
+void NvbloxMeshVisual::setRenderingDistance(float rendering_distance) {
+  rendering_distance_ = rendering_distance;
+  for (const auto& kv : chunk_map_) {
+    kv.second->setRenderingDistance(rendering_distance_);
+  }
 }
 
-std_msgs::ColorRGBA NvbloxMeshVisual::getMeshColorFromColorAndNormal(
-    const std_msgs::ColorRGBA& color,
-    const geometry_msgs::Point32& normal) const {
-  std_msgs::ColorRGBA output_color;
-  output_color.a = 1.0f;
-  if (mesh_color_ == MeshColor::kColor) {
-    output_color = color;
-  } else if (mesh_color_ == MeshColor::kLambertColor) {
-    // Make up some lights or whatever.
-    const Ogre::Vector3 light_dir =
-        Ogre::Vector3(0.8f, -0.2f, 0.7f).normalisedCopy();
-    const Ogre::Vector3 light_dir2 =
-        Ogre::Vector3(-0.5f, 0.2f, 0.2f).normalisedCopy();
-    const Ogre::Vector3 ambient(0.2f, 0.2f, 0.2f);
-    const Ogre::Vector3 color_pt(color.r, color.g, color.b);
-    const Ogre::Vector3 normal_pt(normal.x, normal.y, normal.z);
-
-    Ogre::Vector3 lambert = lambertShading(normal_pt, light_dir, color_pt) +
-                            lambertShading(normal_pt, light_dir2, color_pt) +
-                            ambient;
-
-    output_color.r = std::min<float>(lambert.x, 1.0f);
-    output_color.g = std::min<float>(lambert.y, 1.0f);
-    output_color.b = std::min<float>(lambert.z, 1.0f);
-  } else if (mesh_color_ == MeshColor::kNormals) {
-    output_color.r = normal.x * 0.5f + 0.5f;
-    output_color.g = normal.y * 0.5f + 0.5f;
-    output_color.b = normal.z * 0.5f + 0.5f;
+void NvbloxMeshVisual::setLodDistance(float lod_distance) {
+  lod_distance_ = lod_distance;
+  for (const auto& kv : chunk_map_) {
+    setChunkLevelOfDetail(kv.second.get());
+    kv.second->update();
   }
-  return output_color;
 }
 
-void NvbloxMeshVisual::setMessage(
-    const nvblox_msgs::Mesh::ConstPtr& msg) {
-  block_size_ = msg->block_size;
+void NvbloxMeshVisual::setMessage(DecodedMesh&& mesh) {
+  block_size_ = mesh.block_size;
 
   // First, check if we need to clear the existing map.
-  if (msg->clear) {
-    for (const auto ogre_object : object_map_) {
-      scene_manager_->destroyManualObject(ogre_object.second);
-    }
-    object_map_.clear();
+  if (mesh.clear) {
+    destroyChunks();
   }
 
-  // Iterate over all the blocks in the message and make sure to add them.
-  for (size_t i = 0; i < msg->block_indices.size(); i++) {
-    const nvblox_msgs::Index3D& block_index = msg->block_indices[i];
-    const nvblox_msgs::MeshBlock& mesh_block = msg->blocks[i];
+  // Iterate over all the blocks in the message and add them to their chunks.
+  Index3DHashMapType<NvbloxMeshChunk*>::type changed_chunks;
+  for (DecodedMeshBlock& block : mesh.blocks) {
+    const Index3D chunk_index = getChunkIndex(block.block_index);
 
-    // create ogre object
-    Ogre::ManualObject* ogre_object;
-    bool new_object = true;
-    const auto it = object_map_.find(block_index);
-    if (it != object_map_.end()) {
+    auto it = chunk_map_.find(chunk_index);
+    if (block.vertices.empty()) {
       // delete empty mesh blocks
-      if (mesh_block.vertices.empty()) {
-        scene_manager_->destroyManualObject(it->second);
-        object_map_.erase(it);
-        continue;
+      if (it != chunk_map_.end()) {
+        it->second->removeBlock(block.block_index);
+        changed_chunks[chunk_index] = it->second.get();
       }
-
-      ogre_object = it->second;
-      new_object = false;
-    } else {
-      if (mesh_block.vertices.empty()) {
-        continue;
-      }
-      std::string object_name =
-          std::to_string(block_index.x) + std::string(" ") +
-          std::to_string(block_index.y) + std::string(" ") +
-          std::to_string(block_index.z) + std::string(" ") +
-          std::to_string(instance_number_);
-      ogre_object = scene_manager_->createManualObject(object_name);
-      object_map_.insert(std::make_pair(block_index, ogre_object));
-
-      frame_node_->attachObject(ogre_object);
-    }
-
-    ogre_object->estimateVertexCount(mesh_block.vertices.size());
-    ogre_object->estimateIndexCount(mesh_block.triangles.size());
-    if (new_object) {
-      ogre_object->begin("BaseWhiteNoLighting",
-                         Ogre::RenderOperation::OT_TRIANGLE_LIST);
-    } else {
-      ogre_object->beginUpdate(0);
-    }
-
-    for (size_t i = 0; i < mesh_block.vertices.size(); ++i) {
-      // note calling position changes what vertex the color and normal calls
-      // point to
-      ogre_object->position(mesh_block.vertices[i].x, mesh_block.vertices[i].y,
-                            mesh_block.vertices[i].z);
-
-      ogre_object->normal(mesh_block.normals[i].x, mesh_block.normals[i].y,
-                          mesh_block.normals[i].z);
-
-      std_msgs::ColorRGBA color;
-      if (!mesh_block.colors.empty()) {
-        color = mesh_block.colors[i];
-      }
-      color = getMeshColorFromColorAndNormal(color, mesh_block.normals[i]);
-
-      ogre_object->colour(color.r, color.g, color.b);
+      continue;
     }
-
-    // needed for anything other than flat rendering
-    for (int32_t index : mesh_block.triangles) {
-      ogre_object->index(index);
+    if (it == chunk_map_.end()) {
+      std::unique_ptr<NvbloxMeshChunk> chunk(
+          new NvbloxMeshChunk(material_->getName()));
+      chunk->setVisible(isChunkVisible(chunk_index));
+      chunk->setRenderingDistance(rendering_distance_);
+      setChunkLevelOfDetail(chunk.get());
+      frame_node_->attachObject(chunk.get());
+      it = chunk_map_.emplace(chunk_index, std::move(chunk)).first;
     }
+    it->second->setBlock(block.block_index, std::move(block.vertices),
+                         std::move(block.indices));
+    changed_chunks[chunk_index] = it->second.get();
+  }
 
-    ogre_object->end();
-
-    // Cut the ceiling immediatly if we're doing that.
-    if (cut_ceiling_ && block_index.z * block_size_ > ceiling_height_) {
-      ogre_object->setVisible(false);
+  // Write the changes to the hardware buffers, once per chunk.
+  for (const auto& kv : changed_chunks) {
+    NvbloxMeshChunk* chunk = kv.second;
+    if (chunk->empty()) {
+      frame_node_->detachObject(chunk);
+      chunk_map_.erase(kv.first);
+    } else {
+      chunk->update();
     }
   }
 }